@@ -0,0 +1,96 @@
+#include <gamebank/chain/block_replay_pipeline.hpp>
+
+namespace gamebank { namespace chain {
+
+   block_replay_pipeline::block_replay_pipeline( const block_log& log, uint32_t first, uint32_t last, uint32_t threads, uint32_t queue_size )
+   : _log( log ), _last( last ), _slots( std::max< uint32_t >( queue_size, 1 ) ), _next_decode( first ), _next_apply( first )
+   {
+      for( uint32_t i = 0; i < std::max< uint32_t >( threads, 1 ); ++i )
+         _threads.emplace_back( [this]() { work(); } );
+   }
+
+   block_replay_pipeline::~block_replay_pipeline()
+   {
+      {
+         std::lock_guard< std::mutex > guard( _mutex );
+         _stop = true;
+      }
+      _space.notify_all();
+      for( auto& t : _threads )
+         t.join();
+   }
+
+   std::shared_ptr< const decoded_block > block_replay_pipeline::next()
+   {
+      std::unique_lock< std::mutex > lock( _mutex );
+      if( _next_apply > _last )
+         return nullptr;
+
+      slot& s = _slots[ _next_apply % _slots.size() ];
+      _ready.wait( lock, [&]() { return s.block_num == _next_apply; } );
+
+      if( s.error )
+         std::rethrow_exception( s.error );
+
+      auto result = std::move( s.block );
+      s.block_num = 0;
+      ++_next_apply;
+      lock.unlock();
+      _space.notify_all();
+      return result;
+   }
+
+   void block_replay_pipeline::work()
+   {
+      while( true )
+      {
+         uint32_t block_num;
+         {
+            std::unique_lock< std::mutex > lock( _mutex );
+            _space.wait( lock, [&]() { return _stop || _next_decode > _last || _next_decode < _next_apply + _slots.size(); } );
+            if( _stop || _next_decode > _last )
+               return;
+            block_num = _next_decode++;
+         }
+
+         slot result;
+         result.block_num = block_num;
+         try
+         {
+            result.block = decode( block_num );
+         }
+         catch( ... )
+         {
+            result.error = std::current_exception();
+         }
+
+         bool failed = bool( result.error );
+         {
+            std::lock_guard< std::mutex > guard( _mutex );
+            _slots[ block_num % _slots.size() ] = std::move( result );
+         }
+         _ready.notify_all();
+
+         // the consumer stops at the first error, no point decoding past it
+         if( failed )
+            return;
+      }
+   }
+
+   std::shared_ptr< const decoded_block > block_replay_pipeline::decode( uint32_t block_num )const
+   {
+      auto b = _log.read_block_by_num( block_num );
+      FC_ASSERT( b.valid(), "Block ${n} is missing from the block log", ("n", block_num) );
+
+      auto result = std::make_shared< decoded_block >();
+      result->block = std::move( *b );
+      result->id = result->block.id();
+      result->signee = result->block.signee();
+      result->merkle_root = result->block.calculate_merkle_root();
+      result->transaction_ids.reserve( result->block.transactions.size() );
+      for( const auto& trx : result->block.transactions )
+         result->transaction_ids.push_back( trx.id() );
+      return result;
+   }
+
+} }
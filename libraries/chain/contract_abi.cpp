@@ -0,0 +1,82 @@
+#include <gamebank/chain/contract/contract_abi.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+
+namespace gamebank { namespace chain {
+
+	contract_abi contract_abi::from_string(const std::string& abi)
+	{
+		contract_abi result;
+		fc::variant abiv = fc::json::from_string(abi);
+		fc::variants abis = abiv.as< std::vector< fc::variant > >();
+		for (size_t i = 0; i < abis.size(); ++i)
+		{
+			fc::variant_object abi_obj = abis[i].get_object();
+			std::string name = abi_obj["name"].as_string();
+			fc::variants abi_args = abi_obj["args"].as< std::vector< fc::variant > >();
+
+			signature_type signature;
+			signature.reserve(abi_args.size());
+			for (size_t j = 0; j < abi_args.size(); ++j)
+			{
+				// deploy only rejects nested arrays, an object here can never match an argument
+				if (abi_args[j].is_object())
+					signature.push_back(contract_abi_unknown);
+				else
+					signature.push_back(arg_type_from_string(abi_args[j].as_string()));
+			}
+
+			result.methods[name].push_back(std::move(signature));
+			result.method_names.insert(name);
+		}
+		return result;
+	}
+
+	contract_abi_arg_type contract_abi::arg_type_from_string(const std::string& type)
+	{
+		if (type == "uint64")
+			return contract_abi_uint64;
+		if (type == "int64")
+			return contract_abi_int64;
+		if (type == "string")
+			return contract_abi_string;
+		if (type == "object")
+			return contract_abi_object;
+		if (type == "array")
+			return contract_abi_array;
+		return contract_abi_unknown;
+	}
+
+	bool contract_abi::check_arg(const fc::variant& arg, contract_abi_arg_type type)
+	{
+		switch (type)
+		{
+		case contract_abi_uint64:
+			return arg.is_uint64();
+		case contract_abi_int64:
+			return arg.is_int64();
+		case contract_abi_string:
+			return arg.is_string();
+		case contract_abi_object:
+			return arg.is_object();
+		case contract_abi_array:
+			return arg.is_array();
+		default:
+			return false;
+		}
+	}
+
+	void contract_abi::check_call(const std::string& method, const fc::variants& args)const
+	{
+		auto itr = methods.find(method);
+		FC_ASSERT(itr != methods.end(), "contract abi check op name error");
+		for (const auto& signature : itr->second)
+		{
+			FC_ASSERT(signature.size() == args.size(), "contract args num error");
+			for (size_t j = 0; j < args.size(); ++j)
+				FC_ASSERT(check_arg(args[j], signature[j]), "contract abi args err");
+		}
+	}
+
+}}
@@ -0,0 +1,100 @@
+#include <gamebank/chain/contract/contract_cache.hpp>
+
+#include <fc/io/raw.hpp>
+
+namespace gamebank { namespace chain {
+
+	contract_cache::bytecode_ptr contract_cache::get(const account_name_type& name, const digest_type& version)
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		auto itr = _entries.find(name);
+		if (itr == _entries.end() || itr->second.version != version || !itr->second.bytecode)
+		{
+			++_stats.misses;
+			return bytecode_ptr();
+		}
+		++_stats.hits;
+		return itr->second.bytecode;
+	}
+
+	contract_cache::cache_entry& contract_cache::get_entry(const account_name_type& name, const digest_type& version)
+	{
+		auto& entry = _entries[name];
+		if (entry.version != version) {
+			// a different contract under the same name, nothing cached for it is valid
+			if (entry.bytecode)
+				_stats.bytes -= entry.bytecode->size();
+			entry.bytecode.reset();
+			entry.abi.reset();
+			entry.version = version;
+		}
+		_stats.entries = _entries.size();
+		return entry;
+	}
+
+	void contract_cache::set(const account_name_type& name, const digest_type& version, std::string bytecode)
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		auto& entry = get_entry(name, version);
+		if (entry.bytecode)
+			_stats.bytes -= entry.bytecode->size();
+		_stats.bytes += bytecode.size();
+		entry.bytecode = std::make_shared< const std::string >(std::move(bytecode));
+	}
+
+	contract_cache::abi_ptr contract_cache::get_abi(const account_name_type& name, const digest_type& version)
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		auto itr = _entries.find(name);
+		if (itr == _entries.end() || itr->second.version != version || !itr->second.abi)
+		{
+			++_stats.abi_misses;
+			return abi_ptr();
+		}
+		++_stats.abi_hits;
+		return itr->second.abi;
+	}
+
+	contract_cache::abi_ptr contract_cache::set_abi(const account_name_type& name, const digest_type& version, contract_abi abi)
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		auto& entry = get_entry(name, version);
+		entry.abi = std::make_shared< const contract_abi >(std::move(abi));
+		return entry.abi;
+	}
+
+	void contract_cache::erase(const account_name_type& name)
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		auto itr = _entries.find(name);
+		if (itr == _entries.end())
+			return;
+		if (itr->second.bytecode)
+			_stats.bytes -= itr->second.bytecode->size();
+		_entries.erase(itr);
+		_stats.entries = _entries.size();
+	}
+
+	void contract_cache::clear()
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		_entries.clear();
+		_stats.entries = 0;
+		_stats.bytes = 0;
+	}
+
+	contract_cache::cache_stats contract_cache::get_stats()const
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		return _stats;
+	}
+
+	digest_type contract_cache::compute_version(const std::string& code, const std::string& abi)
+	{
+		digest_type::encoder enc;
+		fc::raw::pack(enc, code);
+		fc::raw::pack(enc, abi);
+		return enc.result();
+	}
+
+}}
@@ -1,8 +1,6 @@
 #include <gamebank/chain/contract/contract_chain.hpp>
 #include <fc/log/logger.hpp>
-#include <gamebank/chain/contract/contract_object.hpp>
-#include <gamebank/chain/contract/contract_user_object.hpp>
-#include <gamebank/chain/database.hpp>
+#include <gamebank/chain/contract/contract_state.hpp>
 #include <gamebank/protocol/types.hpp>
 #include <gamebank/utilities/key_conversion.hpp>
 
@@ -21,8 +19,8 @@ namespace gamebank { namespace chain {
 	using fc::ripemd160;
 
 static int head_block_num(lua_State *L) {
-	chain::database* db = (chain::database*)(L->extend.pointer);
-	lua_Integer head_block_num = db->head_block_num();
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	lua_Integer head_block_num = state->head_block_num();
 	lua_pushinteger(L, head_block_num);
 	return 1;
 }
@@ -45,8 +43,8 @@ static int get_block_hash(lua_State *L) {
 		luaL_error(L, "block_count must > 0 && <= 100");
 		return 0;
 	}
-	chain::database* db = (chain::database*)(L->extend.pointer);
-	if (!(block_num > 0 && block_num <= db->head_block_num())) {
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	if (!(block_num > 0 && block_num <= state->head_block_num())) {
 		luaL_error(L, "block_num must > 0 && <= head_block_num");
 		return 0;
 	}
@@ -61,7 +59,7 @@ static int get_block_hash(lua_State *L) {
 	ripemd160 hash_result;
 	for ( int i=0; i<block_count; ++i)
 	{
-		optional<signed_block> block = db->fetch_block_by_number(block_num-i*interval);
+		optional<signed_block> block = state->fetch_block_by_number(block_num-i*interval);
 		if (!block) {
 			luaL_error(L, "block data not found");
 			return 0;
@@ -92,8 +90,8 @@ static int chain_is_account(lua_State *L) {
 	{
 		return 0;
 	}
-	chain::database* db = (chain::database*)(L->extend.pointer);
-	lua_pushboolean(L, db->find_account(user_name) != nullptr ? 1 : 0);
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	lua_pushboolean(L, state->is_account(user_name) ? 1 : 0);
 	return 1;
 }
 
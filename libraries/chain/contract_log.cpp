@@ -1,110 +1,38 @@
 #include <gamebank/chain/contract_log.hpp>
-#include <fstream>
+#include <gamebank/chain/util/mapped_log_file.hpp>
 #include <fc/io/raw.hpp>
 
-#include <boost/thread/mutex.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
-#include <boost/interprocess/sync/lock_options.hpp>
-
-#define LOG_READ  (std::ios::in | std::ios::binary)
-#define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
+#include <atomic>
 
 namespace gamebank { namespace chain {
 
-   typedef boost::interprocess::scoped_lock< boost::mutex > scoped_lock;
-
-   boost::interprocess::defer_lock_type defer_lock_l;
-
    namespace detail {
       class contract_log_impl {
          public:
+            contract_log_impl() : start_num( 0 ), head_num( 0 ) {}
+
             optional< signed_contract > head;
             block_id_type            head_id;
-            std::fstream             block_stream;
-            std::fstream             index_stream;
-            fc::path                 block_file;
-            fc::path                 index_file;
-            uint32_t                 start_num;
-            bool                     block_write = false;
-            bool                     index_write = false;
-
-            bool                     use_locking = true;
-
-            boost::mutex             mtx;
+            util::mapped_log_file    block_file;
+            util::mapped_log_file    index_file;
+            std::atomic< uint32_t >  start_num;   ///< block number before the first block in the log
+            std::atomic< uint32_t >  head_num;    ///< published after the index entry is written
 
             inline void read_start()
             {
                try
                {
-                  std::fstream tmp_stream;
-                  tmp_stream.open(block_file.generic_string().c_str(), LOG_READ);
-
                   signed_contract tmp;
-                  fc::raw::unpack(tmp_stream, tmp);
+                  block_file.unpack( 0, tmp );
                   start_num = tmp.block_num() - 1;
-
-                  tmp_stream.close();
-               }
-               FC_LOG_AND_RETHROW()
-            }
-
-
-            inline void check_block_read()
-            {
-               try
-               {
-                  if( block_write )
-                  {
-                     block_stream.close();
-                     block_stream.open( block_file.generic_string().c_str(), LOG_READ );
-                     block_write = false;
-                  }
-               }
-               FC_LOG_AND_RETHROW()
-            }
-
-            inline void check_block_write()
-            {
-               try
-               {
-                  if( !block_write )
-                  {
-                     block_stream.close();
-                     block_stream.open( block_file.generic_string().c_str(), LOG_WRITE );
-                     block_stream.seekg( 0, std::ios::end );
-                     block_write = true;
-                  }
-               }
-               FC_LOG_AND_RETHROW()
-            }
-
-            inline void check_index_read()
-            {
-               try
-               {
-                  if( index_write )
-                  {
-                     index_stream.close();
-                     index_stream.open( index_file.generic_string().c_str(), LOG_READ );
-                     index_write = false;
-                  }
                }
                FC_LOG_AND_RETHROW()
             }
 
-            inline void check_index_write()
+            /// position of the last block, stored in the last 8 bytes of both files
+            inline uint64_t last_pos( const util::mapped_log_file& f )const
             {
-               try
-               {
-                  if( !index_write )
-                  {
-                     index_stream.close();
-                     index_stream.open( index_file.generic_string().c_str(), LOG_WRITE );
-					 index_stream.seekg( 0, std::ios::end );
-                     index_write = true;
-                  }
-               }
-               FC_LOG_AND_RETHROW()
+               return f.read_pod< uint64_t >( f.size() - sizeof( uint64_t ) );
             }
       };
    }
@@ -112,8 +40,6 @@ namespace gamebank { namespace chain {
    contract_log::contract_log()
    :my( new detail::contract_log_impl() )
    {
-      my->block_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
-      my->index_stream.exceptions( std::fstream::failbit | std::fstream::badbit );
    }
 
    contract_log::~contract_log()
@@ -123,18 +49,8 @@ namespace gamebank { namespace chain {
 
    void contract_log::open( const fc::path& file )
    {
-      if( my->block_stream.is_open() )
-         my->block_stream.close();
-      if( my->index_stream.is_open() )
-         my->index_stream.close();
-
-      my->block_file = file;
-      my->index_file = fc::path( file.generic_string() + ".index" );
-
-      my->block_stream.open( my->block_file.generic_string().c_str(), LOG_WRITE );
-      my->index_stream.open( my->index_file.generic_string().c_str(), LOG_WRITE );
-      my->block_write = true;
-      my->index_write = true;
+      my->block_file.open( file );
+      my->index_file.open( fc::path( file.generic_string() + ".index" ) );
 
       /* On startup of the block log, there are several states the log file and the index file can be
        * in relation to eachother.
@@ -154,38 +70,22 @@ namespace gamebank { namespace chain {
        *  - If the index file head is not in the log file, delete the index and replay.
        *  - If the index file head is in the log, but not up to date, replay from index head.
        */
-      auto log_size = fc::file_size( my->block_file );
-      auto index_size = fc::file_size( my->index_file );
+      auto log_size = my->block_file.size();
+      auto index_size = my->index_file.size();
 
       if( log_size )
       {
          my->read_start();
          ilog( "Log is nonempty" );
-		 //block logȡǰhead
          my->head = read_head();
          my->head_id = my->head->id();
 
          if( index_size )
          {
-            my->check_block_read();
-            my->check_index_read();
-
             ilog( "Index is nonempty" );
-            uint64_t block_pos;
-			//ضλָblock logһPoshead blockpos
-            my->block_stream.seekg( -sizeof( uint64_t), std::ios::end );
-			//ȡpos
-            my->block_stream.read( (char*)&block_pos, sizeof( block_pos ) );
-
-            uint64_t index_pos;
-			//ضλָļһPos
-            my->index_stream.seekg( -sizeof( uint64_t), std::ios::end );
-			//ȡPos
-            my->index_stream.read( (char*)&index_pos, sizeof( index_pos ) );
+            uint64_t block_pos = my->last_pos( my->block_file );
+            uint64_t index_pos = my->last_pos( my->index_file );
 
-			//ֻļһposblock logһposȲȷ!
-
-			//ؽļ
             if( block_pos < index_pos )
             {
                ilog( "block_pos < index_pos, close and reopen index_stream" );
@@ -202,14 +102,13 @@ namespace gamebank { namespace chain {
             ilog( "Index is empty" );
             construct_index();
          }
+
+         my->head_num.store( my->head->block_num(), std::memory_order_release );
       }
       else if( index_size )
       {
          ilog( "Index is nonempty, remove and recreate it" );
-         my->index_stream.close();
-         fc::remove_all( my->index_file );
-         my->index_stream.open( my->index_file.generic_string().c_str(), LOG_WRITE );
-         my->index_write = true;
+         my->index_file.truncate();
       }
    }
 
@@ -220,104 +119,65 @@ namespace gamebank { namespace chain {
 
    bool contract_log::is_open()const
    {
-      return my->block_stream.is_open();
+      return my->block_file.is_open();
    }
 
    uint64_t contract_log::append( const signed_contract& b )
    {
       try
       {
-         scoped_lock lock( my->mtx, defer_lock_l);
+         uint64_t pos = my->block_file.size();
+         if( pos == 0 )
+            my->start_num = b.block_num() - 1;
 
-         if( my->use_locking )
-         {
-            lock.lock();;
-         }
-
-         my->check_block_write();
-         my->check_index_write();
-
-		 //صǰλ
-         uint64_t pos = my->block_stream.tellp();
-         if (pos == 0) {
-             my->start_num = b.block_num() - 1;
-         }
-         FC_ASSERT( static_cast<uint64_t>(my->index_stream.tellp()) == sizeof( uint64_t ) * ( b.block_num() - my->start_num - 1 ),
+         FC_ASSERT( my->index_file.size() == sizeof( uint64_t ) * ( b.block_num() - my->start_num - 1 ),
             "Append to index file occuring at wrong position.",
-            ( "position", (uint64_t) my->index_stream.tellp() )( "expected",( b.block_num() - my->start_num - 1 ) * sizeof( uint64_t ) ) );
+            ( "position", my->index_file.size() )( "expected",( b.block_num() - my->start_num - 1 ) * sizeof( uint64_t ) ) );
 
-		 //л
-		 auto data = fc::raw::pack_to_vector( b );
-		 
-         my->block_stream.write( data.data(), data.size() );		//д(Block)
-         my->block_stream.write( (char*)&pos, sizeof( pos ) );		//дλϢ(Pos of Block)
-         my->index_stream.write( (char*)&pos, sizeof( pos ) );		//дļ
+         // block followed by its own position, written in one go so readers never see half of it
+         auto data = fc::raw::pack_to_vector( b );
+         data.resize( data.size() + sizeof( pos ) );
+         memcpy( data.data() + data.size() - sizeof( pos ), &pos, sizeof( pos ) );
 
-		 my->head = b;
+         my->block_file.append( data.data(), data.size() );
+         my->index_file.append( (const char*)&pos, sizeof( pos ) );
+
+         my->head = b;
          my->head_id = b.id();
+         my->head_num.store( b.block_num(), std::memory_order_release );
 
          return pos;
       }
       FC_LOG_AND_RETHROW()
    }
 
-   //flush to disk
    void contract_log::flush()
    {
-      scoped_lock lock( my->mtx, defer_lock_l);
-
-            if( my->use_locking )
-            {
-               lock.lock();;
-            }
-
-      my->block_stream.flush();
-      my->index_stream.flush();
+      my->block_file.flush();
+      my->index_file.flush();
    }
-   
-  //أ pair<, ´ζȡλ> 
+
    std::pair< signed_contract, uint64_t > contract_log::read_block( uint64_t pos )const
    {
-      scoped_lock lock( my->mtx, defer_lock_l);
-
-      if( my->use_locking )
-      {
-         lock.lock();;
-      }
-
       return read_block_helper( pos );
    }
 
-   //posϢblock logжȡӦ
    std::pair< signed_contract, uint64_t > contract_log::read_block_helper( uint64_t pos )const
    {
       try
       {
-         my->check_block_read();
-
-         my->block_stream.seekg( pos );
-         std::pair<signed_contract,uint64_t> result;
-		 //block logл
-         fc::raw::unpack( my->block_stream, result.first );
-		 //עpos + 8ʾÿζԶıһӦPOS
-         result.second = uint64_t(my->block_stream.tellg()) + 8;
+         std::pair< signed_contract, uint64_t > result;
+         // skip the position stored after the block
+         result.second = my->block_file.unpack( pos, result.first ) + sizeof( uint64_t );
          return result;
       }
       FC_LOG_AND_RETHROW()
    }
 
-   //ͨblockŶȡblock
    optional< signed_contract > contract_log::read_block_by_num( uint32_t block_num )const
    {
       try
       {
-         scoped_lock lock( my->mtx, defer_lock_l);
-
-         if( my->use_locking )
-         {
-            lock.lock();;
-         }
-
          optional< signed_contract > b;
          uint64_t pos = get_block_pos_helper( block_num );
          if( pos != npos )
@@ -330,115 +190,70 @@ namespace gamebank { namespace chain {
       FC_LOG_AND_RETHROW()
    }
 
-   //ͨblockŴļжȡPOS
    uint64_t contract_log::get_block_pos( uint32_t block_num ) const
    {
-      scoped_lock lock( my->mtx, defer_lock_l);
-
-      if( my->use_locking )
-      {
-         lock.lock();;
-      }
-
       return get_block_pos_helper( block_num );
    }
 
-   //ͨblockŷblockӦposition
    uint64_t contract_log::get_block_pos_helper( uint32_t block_num ) const
    {
       try
       {
-         my->check_index_read();
-
-         if( !( my->head.valid() && block_num <= protocol::block_header::num_from_id( my->head_id ) && block_num - my->start_num > 0 ) )
+         uint32_t head_num = my->head_num.load( std::memory_order_acquire );
+         uint32_t start_num = my->start_num;
+         if( !( head_num != 0 && block_num <= head_num && block_num > start_num ) )
             return npos;
-		 //ضλǰλΪblock_numλ
-         my->index_stream.seekg( sizeof( uint64_t ) * ( block_num - my->start_num - 1 ) );
-         uint64_t pos;
-		 //ǰλöȡblock_numļжӦPosֵ.
-         my->index_stream.read( (char*)&pos, sizeof( pos ) );
-         return pos;
+         return my->index_file.read_pod< uint64_t >( sizeof( uint64_t ) * ( block_num - start_num - 1 ) );
       }
       FC_LOG_AND_RETHROW()
    }
 
-   //ȡhead blockӵblock
    signed_contract contract_log::read_head()const
    {
       try
       {
-         scoped_lock lock( my->mtx, defer_lock_l);
-
-         if( my->use_locking )
-         {
-            lock.lock();;
-         }
-
-         my->check_block_read();
-
-         uint64_t pos;
-		 //ضλblock logµposition, ָ[position of head block]ֶ
-         my->block_stream.seekg( -sizeof(pos), std::ios::end );
-		 //block logȡposition
-         my->block_stream.read( (char*)&pos, sizeof(pos) );
-		 //postionӦblockhead block
-         return read_block_helper( pos ).first;
+         return read_block_helper( my->last_pos( my->block_file ) ).first;
       }
       FC_LOG_AND_RETHROW()
    }
 
    const optional< signed_contract >& contract_log::head()const
    {
-      scoped_lock lock( my->mtx, defer_lock_l);
-
-      if( my->use_locking )
-      {
-         lock.lock();;
-      }
-
       return my->head;
    }
 
-//ؽindexļindexļŵblock logÿblockλϢ
-//ͨblock logȡÿpositionдindexļ
-//@see block_log.hpp ͷļ˵
    void contract_log::construct_index()
    {
       try
       {
          ilog( "Reconstructing Block Log Index..." );
-		 //رļɾļ
-         my->index_stream.close();
-         fc::remove_all( my->index_file );
-		 //ؽļ
-         my->index_stream.open( my->index_file.generic_string().c_str(), LOG_WRITE );
-         my->index_write = true;
+         my->index_file.truncate();
 
+         uint64_t end_pos = my->last_pos( my->block_file );
          uint64_t pos = 0;
-         uint64_t end_pos;
-         my->check_block_read();
-         //ضλblock logβǰƫ8ֽ,[position of head block]
-         my->block_stream.seekg( -sizeof( uint64_t), std::ios::end );
-		 //block logȡposition of head block,¼block logеposition
-         my->block_stream.read( (char*)&end_pos, sizeof( end_pos ) );
+         uint64_t block_pos = 0;
+         std::vector< uint64_t > positions;
          signed_contract tmp;
 
-		 //λblock logʼ
-         my->block_stream.seekg( pos );
-
-		 //block log
-         while( pos < end_pos )
+         do
          {
-            fc::raw::unpack( my->block_stream, tmp );	//лblock logȡblock
-            my->block_stream.read( (char*)&pos, sizeof( pos ) );	//ǰȡposition
-            my->index_stream.write( (char*)&pos, sizeof( pos ) );   //Ѵblock logжȡÿһpositionдļ
-         }
+            pos = my->block_file.unpack( pos, tmp );
+            block_pos = my->block_file.read_pod< uint64_t >( pos );
+            pos += sizeof( uint64_t );
+            positions.push_back( block_pos );
+
+            if( positions.size() == 1024 * 1024 || block_pos >= end_pos )
+            {
+               my->index_file.append( (const char*)positions.data(), positions.size() * sizeof( uint64_t ) );
+               positions.clear();
+            }
+         } while( block_pos < end_pos );
       }
       FC_LOG_AND_RETHROW()
    }
 
    void contract_log::set_locking( bool use_locking )
    {
-      my->use_locking = true;
+      // reads go through the mapped files and never lock, kept for the reindex path
    }
 } } // gamebank::chain
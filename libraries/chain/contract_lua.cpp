@@ -3,8 +3,10 @@
 #include <gamebank/chain/database.hpp>
 #include <gamebank/chain/contract/contract_lualib.hpp>
 #include <gamebank/chain/contract/contract_chain.hpp>
+#include <gamebank/chain/contract/contract_lua_pool.hpp>
+#include <gamebank/chain/contract/contract_lua_data.hpp>
 #include <gamebank/chain/contract/contract_object.hpp>
-#include <gamebank/chain/contract/contract_user_object.hpp>
+#include <gamebank/chain/contract/contract_state.hpp>
 
 extern "C"
 {
@@ -26,51 +28,60 @@ namespace gamebank { namespace chain {
 		class contract_lua_impl
 		{
 		public:
-			contract_lua_impl(contract_lua& _contract) : contract(_contract)
+			contract_lua_impl(contract_lua& _contract, contract_lua_pool* _pool) : contract(_contract), pool(_pool)
 			{
-				L = luaL_newstate();
-				luaL_openlibs(L);
-				luaL_openlibs_contract(L);
-				luaL_openlibs_chain(L);
-
-				// contract
-				sys_functions.insert("contract");
-				sys_functions.insert("chain");
-
-				// baselib
-				sys_functions.insert("assert");
-				sys_functions.insert("error");
-				sys_functions.insert("getmetatable");
-				sys_functions.insert("ipairs");
-				sys_functions.insert("next");
-				sys_functions.insert("pairs");
-				sys_functions.insert("print");
-				sys_functions.insert("rawequal");
-				sys_functions.insert("rawlen");
-				sys_functions.insert("rawget");
-				sys_functions.insert("rawset");
-				sys_functions.insert("select");
-				sys_functions.insert("setmetatable");
-				sys_functions.insert("tonumber");
-				sys_functions.insert("tostring");
-				sys_functions.insert("type");
-				sys_functions.insert("isinteger");
-
-				// tablib
-				sys_functions.insert("table");
-
-				// strlib
-				sys_functions.insert("string");
-
-				// math
-				sys_functions.insert("math");
-
-				// utf8
-				sys_functions.insert("utf8");
+				if (pool != nullptr)
+					L = pool->acquire();
+				else
+					L = contract_lua_pool::create_state();
 			}
 			~contract_lua_impl()
 			{
-				lua_close(L);
+				if (pool != nullptr)
+					pool->release(L);
+				else
+					lua_close(L);
+			}
+
+			static const std::set<std::string>& get_sys_functions()
+			{
+				static const std::set<std::string> sys_functions = {
+					// contract
+					"contract",
+					"chain",
+
+					// baselib
+					"assert",
+					"error",
+					"getmetatable",
+					"ipairs",
+					"next",
+					"pairs",
+					"print",
+					"rawequal",
+					"rawlen",
+					"rawget",
+					"rawset",
+					"select",
+					"setmetatable",
+					"tonumber",
+					"tostring",
+					"type",
+					"isinteger",
+
+					// tablib
+					"table",
+
+					// strlib
+					"string",
+
+					// math
+					"math",
+
+					// utf8
+					"utf8"
+				};
+				return sys_functions;
 			}
 
 			bool is_global_var(const char* upvalue_name)
@@ -85,17 +96,18 @@ namespace gamebank { namespace chain {
 
 			bool is_abi(const char* name)
 			{
-				return abi_method_names.find(name) != abi_method_names.end();
+				return abi_method_names != nullptr && abi_method_names->find(name) != abi_method_names->end();
 			}
 
 			bool is_sys_function(const char* name)
 			{
+				const auto& sys_functions = get_sys_functions();
 				return sys_functions.find(name) != sys_functions.end();
 			}
 
 			void set_abi(const std::set<std::string>& method_names)
 			{
-				abi_method_names = method_names;
+				abi_method_names = &method_names;
 			}
 
 			void set_extend(const string& contract_name, const string& caller_name)
@@ -120,6 +132,21 @@ namespace gamebank { namespace chain {
 				return L->extend.current_opcode_execute_count;
 			}
 
+			int get_memory_peak()
+			{
+				return L->extend.memory_peak;
+			}
+
+			int64_t get_storage_read_bytes()
+			{
+				return L->extend.storage_read_bytes;
+			}
+
+			int64_t get_storage_write_bytes()
+			{
+				return L->extend.storage_write_bytes;
+			}
+
 			bool compile_check(Proto* proto, Proto* parent_proto)
 			{
 				// opcodes
@@ -180,6 +207,8 @@ namespace gamebank { namespace chain {
 										FC_ASSERT(false, "cant access global var: ${var} line:${line}", ("var", cname)("line", line));
 										return false;
 									}
+									if (analysis != nullptr)
+										analysis->used_globals.insert(cname);
 								}
 								else {
 									FC_ASSERT(false, "cant access global var: ${var} line:${line}", ("var", upvalue_name)("line", line));
@@ -205,6 +234,8 @@ namespace gamebank { namespace chain {
 										FC_ASSERT(false, "cant modify global var: ${var} line:${line}", ("var", bname)("line", line));
 										return false;
 									}
+									if (analysis != nullptr)
+										analysis->defined_globals.insert(bname);
 									// todo: how to determine RK(C) is a function?
 									if (strcmp(bname, CONTRACT_ONDEPLOY_NAME) == 0
 										&& !has_ondeploy_method ) {
@@ -281,7 +312,82 @@ namespace gamebank { namespace chain {
 				}
 			}
 
+			static int bytecode_writer(lua_State* L, const void* p, size_t sz, void* ud)
+			{
+				((std::string*)ud)->append((const char*)p, sz);
+				return 0;
+			}
+
 			bool load(const std::string& data)
+			{
+				if (!compile(data))
+					return false;
+				return execute_chunk();
+			}
+
+			bool load(const std::string& data, const digest_type& version, contract_cache& cache)
+			{
+				auto bytecode = cache.get(contract.name, version);
+				if (bytecode) {
+					std::string contract_name = contract.name;
+					if (luaL_loadbufferx(L, bytecode->data(), bytecode->size(), contract_name.c_str(), "b") == 0)
+						return execute_chunk();
+					// a chunk we dumped ourselves should always load, fall back to the source
+					elog("contract cache load error: ${name}", ("name", contract.name));
+					lua_settop(L, 0);
+					cache.erase(contract.name);
+				}
+
+				if (!compile(data))
+					return false;
+
+				std::string dumped;
+				if (lua_dump(L, bytecode_writer, &dumped, 0) == 0 && dumped.size() > 0)
+					cache.set(contract.name, version, std::move(dumped));
+				return execute_chunk();
+			}
+
+			bool verify(const std::string& data, std::string& bytecode, contract_analysis& result)
+			{
+				if (!compile(data))
+					return false;
+
+				LClosure* lc = clLvalue(L->top - 1);
+				analysis = &result;
+				bool verified = lc != nullptr && lc->p != nullptr && compile_check(lc->p, nullptr);
+				analysis = nullptr;
+				result.has_on_deploy = has_ondeploy_method;
+
+				bytecode.clear();
+				if (verified)
+					verified = lua_dump(L, bytecode_writer, &bytecode, 0) == 0 && bytecode.size() > 0;
+				lua_settop(L, 0);
+				return verified;
+			}
+
+			bool load_verified(const char* bytecode, size_t size, const digest_type& version, contract_cache& cache)
+			{
+				auto cached = cache.get(contract.name, version);
+				if (cached) {
+					bytecode = cached->data();
+					size = cached->size();
+				}
+
+				std::string contract_name = contract.name;
+				if (luaL_loadbufferx(L, bytecode, size, contract_name.c_str(), "b") != 0) {
+					const char* str = lua_tostring(L, -1);
+					string errstr(str != nullptr ? str : "");
+					lua_settop(L, 0);
+					FC_ASSERT(false, "contract load error:${err}", ("err", errstr));
+					return false;
+				}
+				if (!cached)
+					cache.set(contract.name, version, std::string(bytecode, size));
+				// the chunk passed compile_check when it was deployed
+				return execute_chunk(false);
+			}
+
+			bool compile(const std::string& data)
 			{
 				//int stack_pos = lua_gettop(L);
 				//dlog("deploy 1 stack_pos=%d\n", stack_pos);
@@ -310,6 +416,11 @@ namespace gamebank { namespace chain {
 					FC_ASSERT(false, "contract compile error:${err}", ("err", ""));
 					return false;
 				}
+				return true;
+			}
+
+			bool execute_chunk(bool check = true)
+			{
 				//stack_pos = lua_gettop(L);
 				//int type = lua_type(L, -1);
 				//printf("deploy 2 stack_pos=%d type=%d\n", stack_pos, type);
@@ -319,13 +430,13 @@ namespace gamebank { namespace chain {
 					elog("clLvalue Error: lc == nullptr || lc->p == nullptr");
 					return false;
 				}
-				if (!compile_check(lc->p, nullptr))
+				if (check && !compile_check(lc->p, nullptr))
 				{
 					elog("compile_check Error");
 					return false;
 				}
 
-				ret = lua_pcall(L, 0, LUA_MULTRET, 0);
+				int ret = lua_pcall(L, 0, LUA_MULTRET, 0);
 				if (ret != 0)
 				{
 					if (L->extend.error_no != LUA_EXTEND_OK) {
@@ -366,6 +477,9 @@ namespace gamebank { namespace chain {
 
 			bool call_method(const std::string& method, const variants& args, std::string& result)
 			{
+				// the peak only covers this call, not loading the chunk
+				global_State* g = G(L);
+				L->extend.memory_peak = cast_int(gettotalbytes(g) >> 10);
 				int oldStackPos = lua_gettop(L);
 				lua_getglobal(L, method.c_str());
 				if (lua_isnil(L, -1))
@@ -492,7 +606,7 @@ namespace gamebank { namespace chain {
 
 			void save_modified_data()
 			{
-				chain::database* db = (chain::database*)(L->extend.pointer);
+				contract_state* state = (contract_state*)(L->extend.pointer);
 				lua_getglobal(L, LUA_CONTRACT_MODIFIED_DATA_TABLE_NAME);
 				FC_ASSERT(lua_istable(L, -1), "_contract_modified_data must be a table");
 				lua_pushnil(L);
@@ -505,30 +619,11 @@ namespace gamebank { namespace chain {
 
 					const char* key = lua_tostring(L, -2);
 					std::string user_name(key);
-					int datalen = 0;
-					char* json = json_encode_tostring(L, &datalen);
-					FC_ASSERT((json != nullptr) && (datalen > 0), "get user data from lua error");
-					//ilog("save contract_data ${contract_name}.${user_name}:${datalen}", ("contract_name", L->extend.contract_name)("user_name", user_name)("datalen", datalen));
-
-					auto contract_data = db->find<contract_user_object, by_contract_user>(boost::make_tuple(L->extend.contract_name, user_name));
-					if (contract_data == nullptr) {
-						db->create< contract_user_object >([&](contract_user_object& obj)
-						{
-							obj.contract_name = string(L->extend.contract_name);
-							obj.user_name = user_name;
-							//from_string(obj.data, json);
-							obj.data.assign(json, datalen);
-							obj.created = db->head_block_time();
-							obj.last_update = obj.created;
-						});
-					}
-					else {
-						db->modify(*contract_data, [&](contract_user_object& obj)
-						{
-							obj.data.assign(json, datalen);
-							obj.last_update = db->head_block_time();
-						});
-					}
+					data_buffer.clear();
+					contract_data_encode(L, data_buffer);
+					//ilog("save contract_data ${contract_name}.${user_name}:${datalen}", ("contract_name", L->extend.contract_name)("user_name", user_name)("datalen", data_buffer.size()));
+
+					L->extend.storage_write_bytes += state->save_user_data(L->extend.contract_name, user_name, data_buffer);
 
 					lua_pop(L, 1);
 				}
@@ -537,15 +632,18 @@ namespace gamebank { namespace chain {
 		public:
 			lua_State * L = nullptr;
 			contract_lua& contract;
-			std::set<std::string> abi_method_names;
-			std::set<std::string> sys_functions;
+			contract_lua_pool* pool = nullptr;
+			const std::set<std::string>* abi_method_names = nullptr;
+			contract_analysis* analysis = nullptr;
+			std::string data_buffer;
 			bool has_ondeploy_method = false;
+			std::unique_ptr< contract_database_state > database_state;
 		};
 	}
 
-	contract_lua::contract_lua(account_name_type n) : contract_interface(n)
+	contract_lua::contract_lua(account_name_type n, contract_lua_pool* pool) : contract_interface(n)
 	{
-		my = std::make_unique< detail::contract_lua_impl >(*this);
+		my = std::make_unique< detail::contract_lua_impl >(*this, pool);
 	}
 
 	contract_lua::~contract_lua()
@@ -562,6 +660,21 @@ namespace gamebank { namespace chain {
 		return my->load(data);
 	}
 
+	bool contract_lua::load(const std::string& data, const digest_type& version, contract_cache& cache)
+	{
+		return my->load(data, version, cache);
+	}
+
+	bool contract_lua::verify(const std::string& data, std::string& bytecode, contract_analysis& analysis)
+	{
+		return my->verify(data, bytecode, analysis);
+	}
+
+	bool contract_lua::load_verified(const char* bytecode, size_t size, const digest_type& version, contract_cache& cache)
+	{
+		return my->load_verified(bytecode, size, version, cache);
+	}
+
 	bool contract_lua::call_method(const std::string& method, const variants& args, std::string& result)
 	{
 		return my->call_method(method, args, result);
@@ -569,7 +682,13 @@ namespace gamebank { namespace chain {
 
 	void contract_lua::set_database(chain::database* db)
 	{
-		my->L->extend.pointer = db;
+		my->database_state.reset(new contract_database_state(*db));
+		my->L->extend.pointer = my->database_state.get();
+	}
+
+	void contract_lua::set_state(contract_state* state)
+	{
+		my->L->extend.pointer = state;
 	}
 
 	void contract_lua::set_abi(const std::set<std::string>& method_names)
@@ -592,4 +711,19 @@ namespace gamebank { namespace chain {
 		return my->get_current_opcount();
 	}
 
+	int contract_lua::get_memory_peak()
+	{
+		return my->get_memory_peak();
+	}
+
+	int64_t contract_lua::get_storage_read_bytes()
+	{
+		return my->get_storage_read_bytes();
+	}
+
+	int64_t contract_lua::get_storage_write_bytes()
+	{
+		return my->get_storage_write_bytes();
+	}
+
 }}
@@ -0,0 +1,324 @@
+#include <gamebank/chain/contract/contract_lua_data.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <cstring>
+
+extern "C"
+{
+#include "gamebank/chain/contract/lua/lua.h"
+#include "gamebank/chain/contract/lua/lauxlib.h"
+#include "gamebank/chain/contract/lua/lua_cjson.h"
+}
+
+namespace gamebank { namespace chain {
+
+// limits of the cjson defaults the format replaces
+#define CONTRACT_DATA_MAX_DEPTH    1000
+#define CONTRACT_DATA_SPARSE_RATIO 2
+#define CONTRACT_DATA_SPARSE_SAFE  10
+
+	namespace {
+
+		enum contract_data_tag
+		{
+			tag_null = 0,
+			tag_false,
+			tag_true,
+			tag_integer,
+			tag_float,
+			tag_string,
+			tag_array,
+			tag_object,
+			tag_invalid_number   ///< non finite float, cjson wrote it but could never read it back
+		};
+
+		void write_varint(std::string& out, uint64_t v)
+		{
+			while (v >= 0x80) {
+				out.push_back(char(v | 0x80));
+				v >>= 7;
+			}
+			out.push_back(char(v));
+		}
+
+		void write_integer(std::string& out, lua_Integer i)
+		{
+			out.push_back(char(tag_integer));
+			uint64_t u = uint64_t(i);
+			write_varint(out, (u << 1) ^ (i < 0 ? ~uint64_t(0) : 0));
+		}
+
+		void write_bytes(std::string& out, const char* s, size_t len)
+		{
+			write_varint(out, len);
+			out.append(s, len);
+		}
+
+		// same rules as lua_array_length in lua_cjson.c, -1 when the table is written as an object
+		int array_length(lua_State* L)
+		{
+			lua_Integer k;
+			int max = 0;
+			int items = 0;
+
+			lua_pushnil(L);
+			while (lua_next(L, -2) != 0) {
+				if (lua_type(L, -2) == LUA_TNUMBER && lua_isinteger(L, -2) && (k = lua_tointeger(L, -2))) {
+					if (k >= 1) {
+						if (k > max)
+							max = int(k);
+						items++;
+						lua_pop(L, 1);
+						continue;
+					}
+				}
+				lua_pop(L, 2);
+				return -1;
+			}
+
+			FC_ASSERT(!(max > items * CONTRACT_DATA_SPARSE_RATIO && max > CONTRACT_DATA_SPARSE_SAFE),
+				"Cannot serialise table: excessively sparse array");
+			return max;
+		}
+
+		void write_number(lua_State* L, std::string& out)
+		{
+			if (lua_isinteger(L, -1)) {
+				write_integer(out, lua_tointeger(L, -1));
+				return;
+			}
+
+			// floats were read back from their text form
+			char buff[64];
+			int len = luanumber2string(L, -1, buff, sizeof(buff) - 1);
+			buff[len] = '\0';
+			if (lua_stringtonumber(L, buff) == 0) {
+				out.push_back(char(tag_invalid_number));
+				return;
+			}
+			if (lua_isinteger(L, -1)) {
+				write_integer(out, lua_tointeger(L, -1));
+			}
+			else {
+				lua_Number n = lua_tonumber(L, -1);
+				out.push_back(char(tag_float));
+				out.append((const char*)&n, sizeof(n));
+			}
+			lua_pop(L, 1);
+		}
+
+		void write_value(lua_State* L, int depth, std::string& out)
+		{
+			switch (lua_type(L, -1))
+			{
+			case LUA_TSTRING:
+			{
+				size_t len = 0;
+				const char* s = lua_tolstring(L, -1, &len);
+				out.push_back(char(tag_string));
+				write_bytes(out, s, len);
+				break;
+			}
+			case LUA_TNUMBER:
+				write_number(L, out);
+				break;
+			case LUA_TBOOLEAN:
+				out.push_back(char(lua_toboolean(L, -1) ? tag_true : tag_false));
+				break;
+			case LUA_TTABLE:
+			{
+				depth++;
+				FC_ASSERT(depth <= CONTRACT_DATA_MAX_DEPTH && lua_checkstack(L, 3),
+					"Cannot serialise, excessive nesting (${d})", ("d", depth));
+				int len = array_length(L);
+				if (len > 0) {
+					out.push_back(char(tag_array));
+					write_varint(out, len);
+					for (int i = 1; i <= len; i++) {
+						lua_rawgeti(L, -1, i);
+						write_value(L, depth, out);
+						lua_pop(L, 1);
+					}
+				}
+				else {
+					uint64_t count = 0;
+					lua_pushnil(L);
+					while (lua_next(L, -2) != 0) {
+						lua_pop(L, 1);
+						++count;
+					}
+					out.push_back(char(tag_object));
+					write_varint(out, count);
+
+					lua_pushnil(L);
+					while (lua_next(L, -2) != 0) {
+						int keytype = lua_type(L, -2);
+						if (keytype == LUA_TNUMBER) {
+							char buff[64];
+							int keylen = luanumber2string(L, -2, buff, sizeof(buff));
+							write_bytes(out, buff, keylen);
+						}
+						else if (keytype == LUA_TSTRING) {
+							size_t keylen = 0;
+							const char* key = lua_tolstring(L, -2, &keylen);
+							write_bytes(out, key, keylen);
+						}
+						else {
+							FC_ASSERT(false, "Cannot serialise table: table key must be a number or string");
+						}
+						write_value(L, depth, out);
+						lua_pop(L, 1);
+					}
+				}
+				break;
+			}
+			case LUA_TNIL:
+				out.push_back(char(tag_null));
+				break;
+			case LUA_TLIGHTUSERDATA:
+				if (lua_touserdata(L, -1) == nullptr) {
+					out.push_back(char(tag_null));
+					break;
+				}
+			default:
+				FC_ASSERT(false, "Cannot serialise ${type}: type not supported", ("type", lua_typename(L, lua_type(L, -1))));
+			}
+		}
+
+		/* The reader raises Lua errors, keep it free of objects with destructors. */
+		struct data_reader
+		{
+			const char* ptr;
+			const char* end;
+		};
+
+		void malformed(lua_State* L)
+		{
+			luaL_error(L, "malformed contract data");
+		}
+
+		uint64_t read_varint(lua_State* L, data_reader& r)
+		{
+			uint64_t v = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				if (r.ptr == r.end)
+					malformed(L);
+				uint8_t b = uint8_t(*r.ptr++);
+				v |= uint64_t(b & 0x7f) << shift;
+				if (!(b & 0x80))
+					return v;
+			}
+			malformed(L);
+			return 0;
+		}
+
+		void read_string(lua_State* L, data_reader& r)
+		{
+			uint64_t len = read_varint(L, r);
+			if (uint64_t(r.end - r.ptr) < len)
+				malformed(L);
+			lua_pushlstring(L, r.ptr, size_t(len));
+			r.ptr += len;
+		}
+
+		void read_value(lua_State* L, data_reader& r, int depth)
+		{
+			if (r.ptr == r.end)
+				malformed(L);
+			if (depth > CONTRACT_DATA_MAX_DEPTH || !lua_checkstack(L, 3))
+				luaL_error(L, "Found too many nested data structures (%d)", depth);
+
+			switch (uint8_t(*r.ptr++))
+			{
+			case tag_null:
+				lua_pushlightuserdata(L, nullptr);
+				break;
+			case tag_false:
+				lua_pushboolean(L, 0);
+				break;
+			case tag_true:
+				lua_pushboolean(L, 1);
+				break;
+			case tag_integer:
+			{
+				uint64_t u = read_varint(L, r);
+				lua_pushinteger(L, lua_Integer((u >> 1) ^ (~(u & 1) + 1)));
+				break;
+			}
+			case tag_float:
+			{
+				lua_Number n;
+				if (size_t(r.end - r.ptr) < sizeof(n))
+					malformed(L);
+				memcpy(&n, r.ptr, sizeof(n));
+				r.ptr += sizeof(n);
+				lua_pushnumber(L, n);
+				break;
+			}
+			case tag_string:
+				read_string(L, r);
+				break;
+			case tag_array:
+			{
+				uint64_t len = read_varint(L, r);
+				if (uint64_t(r.end - r.ptr) < len)
+					malformed(L);
+				lua_createtable(L, int(len), 0);
+				for (uint64_t i = 1; i <= len; i++) {
+					read_value(L, r, depth + 1);
+					lua_rawseti(L, -2, lua_Integer(i));
+				}
+				break;
+			}
+			case tag_object:
+			{
+				uint64_t count = read_varint(L, r);
+				if (uint64_t(r.end - r.ptr) / 2 < count)
+					malformed(L);
+				lua_createtable(L, 0, int(count));
+				for (uint64_t i = 0; i < count; i++) {
+					read_string(L, r);
+					read_value(L, r, depth + 1);
+					lua_rawset(L, -3);
+				}
+				break;
+			}
+			case tag_invalid_number:
+				luaL_error(L, "invalid number");
+				break;
+			default:
+				malformed(L);
+			}
+		}
+
+	}
+
+	bool is_binary_contract_data(const char* data, size_t len)
+	{
+		return len >= 2 && data[0] == GAMEBANK_CONTRACT_DATA_BINARY_TAG;
+	}
+
+	void contract_data_encode(lua_State* L, std::string& out)
+	{
+		out.push_back(GAMEBANK_CONTRACT_DATA_BINARY_TAG);
+		out.push_back(char(GAMEBANK_CONTRACT_DATA_BINARY_VERSION));
+		write_value(L, 0, out);
+	}
+
+	int contract_data_decode(lua_State* L, const char* data, size_t len)
+	{
+		if (!is_binary_contract_data(data, len))
+			return json_decode_fromstring(L, data, int(len));
+
+		if (uint8_t(data[1]) != GAMEBANK_CONTRACT_DATA_BINARY_VERSION)
+			luaL_error(L, "unknown contract data version %d", int(uint8_t(data[1])));
+
+		data_reader r = { data + 2, data + len };
+		read_value(L, r, 1);
+		if (r.ptr != r.end)
+			malformed(L);
+		return 1;
+	}
+
+}}
@@ -0,0 +1,186 @@
+#include <gamebank/chain/contract/contract_lua_pool.hpp>
+#include <gamebank/chain/contract/contract_lualib.hpp>
+#include <gamebank/chain/contract/contract_chain.hpp>
+
+extern "C"
+{
+#include "gamebank/chain/contract/lua/lua.h"
+#include "gamebank/chain/contract/lua/lualib.h"
+#include "gamebank/chain/contract/lua/lauxlib.h"
+#include "gamebank/chain/contract/lua/lstate.h"
+}
+
+namespace gamebank { namespace chain {
+
+#define LUA_CONTRACT_PRISTINE_TABLE_NAME "_contract_pristine"
+#define LUA_CONTRACT_PRISTINE_MT_TABLE_NAME "_contract_pristine_mt"
+#define LUA_CONTRACT_PRISTINE_MEMORY_NAME "_contract_pristine_kb"
+
+// run a full gc on release once the heap is this many times larger than the pristine state
+#define LUA_CONTRACT_POOL_GC_FACTOR 4
+
+	// snapshot the table at the top of the stack and every table reachable from it
+	static void snapshot_table(lua_State* L, int snapshots, int metatables)
+	{
+		int t = lua_gettop(L);
+		lua_pushvalue(L, t);
+		if (lua_rawget(L, snapshots) != LUA_TNIL) {
+			lua_pop(L, 1);
+			return;
+		}
+		lua_pop(L, 1);
+
+		lua_newtable(L);
+		int copy = lua_gettop(L);
+		lua_pushvalue(L, t);
+		lua_pushvalue(L, copy);
+		lua_rawset(L, snapshots); // snapshots[t] = copy
+
+		lua_pushvalue(L, t);
+		if (!lua_getmetatable(L, t))
+			lua_pushboolean(L, 0);
+		lua_rawset(L, metatables); // metatables[t] = getmetatable(t) or false
+
+		lua_pushnil(L);
+		while (lua_next(L, t) != 0) {
+			lua_pushvalue(L, -2);
+			lua_pushvalue(L, -2);
+			lua_rawset(L, copy); // copy[k] = v
+			if (lua_type(L, -1) == LUA_TTABLE)
+				snapshot_table(L, snapshots, metatables);
+			lua_pop(L, 1);
+		}
+
+		if (lua_getmetatable(L, t)) {
+			snapshot_table(L, snapshots, metatables);
+			lua_pop(L, 1);
+		}
+		lua_pop(L, 1); // copy
+	}
+
+	lua_State* contract_lua_pool::create_state(bool with_snapshot)
+	{
+		lua_State* L = luaL_newstate();
+		luaL_openlibs(L);
+		luaL_openlibs_contract(L);
+		luaL_openlibs_chain(L);
+
+		if (with_snapshot) {
+			lua_newtable(L);
+			int snapshots = lua_gettop(L);
+			lua_newtable(L);
+			int metatables = lua_gettop(L);
+
+			lua_pushglobaltable(L);
+			snapshot_table(L, snapshots, metatables);
+			lua_pop(L, 1);
+
+			if (lua_getfield(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE) == LUA_TTABLE)
+				snapshot_table(L, snapshots, metatables);
+			lua_pop(L, 1);
+
+			lua_pushliteral(L, "");
+			if (lua_getmetatable(L, -1)) {
+				snapshot_table(L, snapshots, metatables);
+				lua_pop(L, 1);
+			}
+			lua_pop(L, 1);
+
+			lua_setfield(L, LUA_REGISTRYINDEX, LUA_CONTRACT_PRISTINE_MT_TABLE_NAME);
+			lua_setfield(L, LUA_REGISTRYINDEX, LUA_CONTRACT_PRISTINE_TABLE_NAME);
+
+			lua_gc(L, LUA_GCCOLLECT, 0);
+			lua_pushinteger(L, lua_gc(L, LUA_GCCOUNT, 0));
+			lua_setfield(L, LUA_REGISTRYINDEX, LUA_CONTRACT_PRISTINE_MEMORY_NAME);
+		}
+		return L;
+	}
+
+	bool contract_lua_pool::reset_state(lua_State* L)
+	{
+		if (L->extend.error_no != LUA_EXTEND_OK || L->extend.force_stop)
+			return false;
+
+		lua_settop(L, 0);
+		if (lua_getfield(L, LUA_REGISTRYINDEX, LUA_CONTRACT_PRISTINE_TABLE_NAME) != LUA_TTABLE)
+			return false;
+		lua_getfield(L, LUA_REGISTRYINDEX, LUA_CONTRACT_PRISTINE_MT_TABLE_NAME);
+
+		lua_pushnil(L);
+		while (lua_next(L, 1) != 0) {
+			/* snapshots, metatables, table, copy */
+			// drop every key that was not there when the state was created
+			lua_pushnil(L);
+			while (lua_next(L, 3) != 0) {
+				lua_pop(L, 1);
+				lua_pushvalue(L, -1);
+				if (lua_rawget(L, 4) == LUA_TNIL) {
+					lua_pushvalue(L, -2);
+					lua_pushnil(L);
+					lua_rawset(L, 3);
+				}
+				lua_pop(L, 1);
+			}
+			// restore the original values
+			lua_pushnil(L);
+			while (lua_next(L, 4) != 0) {
+				lua_pushvalue(L, -2);
+				lua_insert(L, -2);
+				lua_rawset(L, 3);
+			}
+			lua_pushvalue(L, 3);
+			if (lua_rawget(L, 2) != LUA_TTABLE) {
+				lua_pop(L, 1);
+				lua_pushnil(L);
+			}
+			lua_setmetatable(L, 3);
+
+			lua_pop(L, 1); // copy
+		}
+		lua_settop(L, 0);
+		init_extend(&(L->extend));
+
+		lua_getfield(L, LUA_REGISTRYINDEX, LUA_CONTRACT_PRISTINE_MEMORY_NAME);
+		lua_Integer pristine_kb = lua_tointeger(L, -1);
+		lua_pop(L, 1);
+		if (lua_gc(L, LUA_GCCOUNT, 0) > pristine_kb * LUA_CONTRACT_POOL_GC_FACTOR)
+			lua_gc(L, LUA_GCCOLLECT, 0);
+		return true;
+	}
+
+	contract_lua_pool::contract_lua_pool(size_t max_idle) : _max_idle(max_idle)
+	{
+	}
+
+	contract_lua_pool::~contract_lua_pool()
+	{
+		for (auto L : _idle)
+			lua_close(L);
+	}
+
+	lua_State* contract_lua_pool::acquire()
+	{
+		{
+			std::lock_guard< std::mutex > guard(_mutex);
+			if (!_idle.empty()) {
+				lua_State* L = _idle.back();
+				_idle.pop_back();
+				return L;
+			}
+		}
+		return create_state(true);
+	}
+
+	void contract_lua_pool::release(lua_State* L)
+	{
+		if (reset_state(L)) {
+			std::lock_guard< std::mutex > guard(_mutex);
+			if (_idle.size() < _max_idle) {
+				_idle.push_back(L);
+				return;
+			}
+		}
+		lua_close(L);
+	}
+
+}}
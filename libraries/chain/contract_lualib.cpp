@@ -1,8 +1,8 @@
 #include <gamebank/chain/contract/contract_lualib.hpp>
 #include <fc/log/logger.hpp>
-#include <gamebank/chain/contract/contract_object.hpp>
-#include <gamebank/chain/contract/contract_user_object.hpp>
-#include <gamebank/chain/database.hpp>
+#include <gamebank/chain/contract/contract_storage_object.hpp>
+#include <gamebank/chain/contract/contract_lua_data.hpp>
+#include <gamebank/chain/contract/contract_state.hpp>
 
 extern "C"
 {
@@ -78,14 +78,14 @@ static int contract_get_creator(lua_State *L) {
 		return 0;
 	}
 	const char* user_name = L->extend.contract_name;
-	chain::database* db = (chain::database*)(L->extend.pointer);
-	const contract_object* obj = db->find_contract(user_name);
-	if (obj == nullptr)
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	fc::optional< account_name_type > creator = state->get_contract_creator(user_name);
+	if (!creator)
 	{
 		luaL_error(L, "expected a real contract name");
 		return 0;
 	}
-	string str_creator = obj->creator;
+	string str_creator = *creator;
 	lua_pushstring(L, str_creator.c_str());
 	return 1;
 }
@@ -109,11 +109,16 @@ static int contract_get_data_by_username(lua_State *L, const char* user_name) {
 		return 0;
 	}
 
-	chain::database* db = (chain::database*)(L->extend.pointer);
-	auto contract_data = db->find<contract_user_object, by_contract_user>(boost::make_tuple(L->extend.contract_name, user_name));
-	std::string data = contract_data ? to_string(contract_data->data) : "{}";
-	//ilog("read contract_data ${contract_name}.${user_name}:${data}", ("contract_name", L->extend.contract_name)("user_name", user_name)("data", data));
-	int ret = json_decode_fromstring(L, data.c_str(), data.length()); // create datatable
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	const char* data = nullptr;
+	size_t size = 0;
+	int ret = 1;
+	if (state->find_user_data(L->extend.contract_name, user_name, data, size)) {
+		L->extend.storage_read_bytes += size;
+		ret = contract_data_decode(L, data, size); // create datatable
+	}
+	else
+		lua_newtable(L);
 
 	check_top = lua_gettop(L);
 	lua_getglobal(L, LUA_CONTRACT_MODIFIED_DATA_TABLE_NAME);
@@ -136,8 +141,8 @@ static int contract_get_data(lua_State *L) {
 		return 0;
 	}
 	const char* user_name = L->extend.contract_name;
-	chain::database* db = (chain::database*)(L->extend.pointer);
-	if (db->find_contract(user_name) == nullptr) {
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	if (!state->is_contract(user_name)) {
 		luaL_error(L, "expected a real contract name");
 		return 0;
 	}
@@ -160,14 +165,97 @@ static int contract_get_user_data(lua_State *L) {
 	{
 		return 0;
 	}
-	chain::database* db = (chain::database*)(L->extend.pointer);
-	if (db->find_account(user_name) == nullptr) {
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	if (!state->is_account(user_name)) {
 		luaL_error(L, "expected a real account name");
 		return 0;
 	}
 	return contract_get_data_by_username(L, user_name);
 }
 
+/*
+** contract.get/set/del(user, key[, value]) address a single key of the per-user storage,
+** user is either a real account or the contract itself.
+** Argument errors are raised before any C++ object is alive, lua errors longjmp over destructors.
+*/
+static const char* contract_storage_check_args(lua_State *L, int n, size_t* key_len) {
+	if (lua_gettop(L) != n)
+	{
+		luaL_error(L, "expected %d argument", n);
+		return nullptr;
+	}
+	luaL_argcheck(L, lua_type(L, 1) == LUA_TSTRING, 1, "string expected");
+	luaL_argcheck(L, lua_type(L, 2) == LUA_TSTRING, 2, "string expected");
+
+	size_t user_len = 0;
+	const char* user_name = lua_tolstring(L, 1, &user_len);
+	luaL_argcheck(L, user_len > 0 && user_len <= GAMEBANK_MAX_ACCOUNT_NAME_LENGTH, 1, "invalid user name");
+	const char* key = lua_tolstring(L, 2, key_len);
+	luaL_argcheck(L, *key_len > 0 && *key_len <= GAMEBANK_CONTRACT_STORAGE_MAX_KEY_LENGTH && strlen(key) == *key_len, 2, "invalid key");
+
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	if (strcmp(user_name, L->extend.contract_name) != 0 && !state->is_account(user_name)) {
+		luaL_error(L, "expected a real account name");
+		return nullptr;
+	}
+	return user_name;
+}
+
+static int contract_storage_get(lua_State *L) {
+	size_t key_len = 0;
+	const char* user_name = contract_storage_check_args(L, 2, &key_len);
+	contract_state* state = (contract_state*)(L->extend.pointer);
+	const char* value = nullptr;
+	size_t size = 0;
+	if (!state->find_storage(L->extend.contract_name, user_name, std::string(lua_tostring(L, 2), key_len), value, size)) {
+		lua_pushnil(L);
+		return 1;
+	}
+	L->extend.storage_read_bytes += size;
+	return contract_data_decode(L, value, size);
+}
+
+/* Writes or removes the key, leaves an error message on the stack if the database throws. */
+static bool contract_storage_write(lua_State *L, const char* user_name, size_t key_len, bool remove) {
+	try {
+		contract_state* state = (contract_state*)(L->extend.pointer);
+		std::string key(lua_tostring(L, 2), key_len);
+		if (remove) {
+			L->extend.storage_write_bytes += state->remove_storage(L->extend.contract_name, user_name, key);
+			return true;
+		}
+
+		std::string value;
+		contract_data_encode(L, value);
+		L->extend.storage_write_bytes += state->set_storage(L->extend.contract_name, user_name, key, value);
+		return true;
+	}
+	catch (const fc::exception& e) {
+		lua_pushstring(L, e.to_string().c_str());
+	}
+	catch (const std::exception& e) {
+		lua_pushstring(L, e.what());
+	}
+	return false;
+}
+
+static int contract_storage_set(lua_State *L) {
+	size_t key_len = 0;
+	const char* user_name = contract_storage_check_args(L, 3, &key_len);
+	// setting nil deletes the key
+	if (!contract_storage_write(L, user_name, key_len, lua_isnil(L, 3)))
+		return lua_error(L);
+	return 0;
+}
+
+static int contract_storage_del(lua_State *L) {
+	size_t key_len = 0;
+	const char* user_name = contract_storage_check_args(L, 2, &key_len);
+	if (!contract_storage_write(L, user_name, key_len, true))
+		return lua_error(L);
+	return 0;
+}
+
 static int contract_transfer(lua_State *L) {
     int n = lua_gettop(L);  /* number of arguments */
     if (n != 3)
@@ -186,11 +274,11 @@ static int contract_transfer(lua_State *L) {
     account_name_type from = from_account;
     account_name_type to = to_account;
     asset amount(num, GBC_SYMBOL);
-    chain::database* db = (chain::database*)(L->extend.pointer);
+    contract_state* state = (contract_state*)(L->extend.pointer);
 
     bool from_caller = false;
     if (strcmp(L->extend.caller_name, from_account) == 0) {
-        if (db->get_balance(from, amount.symbol) < amount) {
+        if (state->get_balance(from, amount.symbol) < amount) {
             luaL_error(L, "Account does not have sufficient funds for transfer");
             return 0;
         }
@@ -201,7 +289,7 @@ static int contract_transfer(lua_State *L) {
         from_caller = true;
     }
     else if (strcmp(L->extend.contract_name, from_account) == 0) {
-        if (db->get_contract_balance(from, amount.symbol) < amount) {
+        if (state->get_contract_balance(from, amount.symbol) < amount) {
             luaL_error(L, "contract account does not have sufficient funds for transfer");
             return 0;
         }
@@ -213,20 +301,20 @@ static int contract_transfer(lua_State *L) {
     }
 	
     if (from_caller) {
-        db->adjust_balance(from, -amount);
-		db->adjust_contract_balance(to, amount);
+        state->adjust_balance(from, -amount);
+		state->adjust_contract_balance(to, amount);
         
     }
     else {
-        db->adjust_contract_balance(from, -amount);
-        db->adjust_balance(to, amount);
+        state->adjust_contract_balance(from, -amount);
+        state->adjust_balance(to, amount);
     }
 
     contract_log_operation logs;
     logs.name = L->extend.contract_name;
 	logs.key = "transfer";
     logs.data = string("[\"") + from + string("\",\"") + to + string("\",\"") + to_string(amount) + string("\"]");
-    db->contract_operation(logs);
+    state->emit(logs);
 	return 0;
 }
 
@@ -247,13 +335,13 @@ static int contract_emit(lua_State *L) {
 	if (json != nullptr && datalen > 0)
 		data.assign(json, datalen);
 
-    chain::database* db = (chain::database*)(L->extend.pointer);
+    contract_state* state = (contract_state*)(L->extend.pointer);
 
     contract_log_operation logs;
     logs.name = L->extend.contract_name;
 	logs.key = key;
     logs.data = data;
-    db->contract_operation(logs);
+    state->emit(logs);
     return 0;
 }
 
@@ -275,6 +363,9 @@ static const luaL_Reg contractlib[] = {
 	{ "get_caller", contract_get_caller },
 	{ "get_data", contract_get_data },
 	{ "get_user_data", contract_get_user_data },
+	{ "get", contract_storage_get },
+	{ "set", contract_storage_set },
+	{ "del", contract_storage_del },
 	{ "transfer", contract_transfer },
     { "emit", contract_emit },
 	{ "jsonstr_to_table", contract_jsonstr_to_table },
@@ -0,0 +1,78 @@
+#include <gamebank/chain/contract/contract_profiler.hpp>
+
+namespace gamebank { namespace chain {
+
+	uint32_t contract_profiler::bucket(uint64_t value)
+	{
+		uint32_t b = 0;
+		while (value != 0 && b < GAMEBANK_CONTRACT_PROFILER_BUCKETS - 1) {
+			value >>= 1;
+			++b;
+		}
+		return b;
+	}
+
+	void contract_profiler::record(const contract_call_sample& sample)
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		auto& profile = _profiles[std::make_pair(sample.contract, sample.method)];
+		if (profile.opcode_histogram.empty()) {
+			profile.opcode_histogram.resize(GAMEBANK_CONTRACT_PROFILER_BUCKETS);
+			profile.memory_histogram.resize(GAMEBANK_CONTRACT_PROFILER_BUCKETS);
+			profile.wall_time_histogram.resize(GAMEBANK_CONTRACT_PROFILER_BUCKETS);
+		}
+
+		++profile.calls;
+		if (sample.failed)
+			++profile.failures;
+		profile.opcodes += sample.opcodes;
+		profile.max_opcodes = std::max(profile.max_opcodes, sample.opcodes);
+		profile.max_memory_kb = std::max(profile.max_memory_kb, sample.memory_kb);
+		profile.wall_time_us += sample.wall_time_us;
+		profile.max_wall_time_us = std::max(profile.max_wall_time_us, sample.wall_time_us);
+		profile.storage_read_bytes += sample.storage_read_bytes;
+		profile.storage_write_bytes += sample.storage_write_bytes;
+		++profile.opcode_histogram[bucket(sample.opcodes)];
+		++profile.memory_histogram[bucket(sample.memory_kb)];
+		++profile.wall_time_histogram[bucket(sample.wall_time_us)];
+
+		auto& totals = _recent[std::make_pair(sample.contract, sample.method)];
+		++totals.calls;
+		if (sample.failed)
+			++totals.failures;
+		totals.opcodes += sample.opcodes;
+		totals.max_memory_kb = std::max(totals.max_memory_kb, sample.memory_kb);
+		totals.wall_time_us += sample.wall_time_us;
+		totals.storage_read_bytes += sample.storage_read_bytes;
+		totals.storage_write_bytes += sample.storage_write_bytes;
+	}
+
+	contract_profiler::profile_map contract_profiler::get_profiles(const account_name_type& contract)const
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		if (contract == account_name_type())
+			return _profiles;
+
+		profile_map result;
+		for (auto itr = _profiles.lower_bound(std::make_pair(contract, std::string()));
+			itr != _profiles.end() && itr->first.first == contract; ++itr)
+			result.insert(*itr);
+		return result;
+	}
+
+	contract_profiler::totals_map contract_profiler::take_recent_totals()
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		totals_map result;
+		result.swap(_recent);
+		return result;
+	}
+
+	void contract_profiler::reset()
+	{
+		std::lock_guard< std::mutex > guard(_mutex);
+		_profiles.clear();
+		_recent.clear();
+	}
+
+}}
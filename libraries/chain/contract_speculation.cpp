@@ -0,0 +1,423 @@
+#include <gamebank/chain/contract/contract_speculation.hpp>
+#include <gamebank/chain/contract/contract_lua.hpp>
+#include <gamebank/chain/contract/contract_object.hpp>
+#include <gamebank/chain/contract/contract_user_object.hpp>
+#include <gamebank/chain/contract/contract_storage_object.hpp>
+#include <gamebank/chain/account_object.hpp>
+#include <gamebank/chain/database.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/bind.hpp>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace gamebank { namespace chain {
+
+	namespace {
+
+		template< typename T >
+		bool same(const fc::optional< T >& a, const fc::optional< T >& b)
+		{
+			return a.valid() == b.valid() && (!a.valid() || *a == *b);
+		}
+
+		fc::optional< account_name_type > read_creator(const database& db, const account_name_type& name)
+		{
+			const contract_object* obj = db.find_contract(name);
+			if (obj == nullptr)
+				return fc::optional< account_name_type >();
+			return obj->creator;
+		}
+
+		fc::optional< std::string > read_user_data(const database& db, const account_name_type& contract, const account_name_type& user)
+		{
+			auto obj = db.find< contract_user_object, by_contract_user >(boost::make_tuple(contract, user));
+			if (obj == nullptr)
+				return fc::optional< std::string >();
+			return std::string(obj->data.data(), obj->data.size());
+		}
+
+		fc::optional< std::string > read_storage(const database& db, const account_name_type& contract, const account_name_type& user, const std::string& key)
+		{
+			auto obj = db.find< contract_storage_object, by_contract_user_key >(boost::make_tuple(contract, user, key));
+			if (obj == nullptr)
+				return fc::optional< std::string >();
+			return std::string(obj->value.data(), obj->value.size());
+		}
+
+		fc::optional< asset > read_balance(const database& db, const account_name_type& name)
+		{
+			const account_object* obj = db.find_account(name);
+			if (obj == nullptr)
+				return fc::optional< asset >();
+			return obj->balance;
+		}
+
+		fc::optional< asset > read_contract_balance(const database& db, const account_name_type& name)
+		{
+			const contract_object* obj = db.find_contract(name);
+			if (obj == nullptr)
+				return fc::optional< asset >();
+			return obj->balance;
+		}
+
+	}
+
+	uint32_t speculative_contract_state::head_block_num()
+	{
+		// only changes after all transactions of the block are applied
+		return _db.head_block_num();
+	}
+
+	fc::optional< signed_block > speculative_contract_state::fetch_block_by_number(uint32_t num)
+	{
+		// the fork database can't be read from worker threads
+		_unsupported = true;
+		return fc::optional< signed_block >();
+	}
+
+	bool speculative_contract_state::is_account(const account_name_type& name)
+	{
+		auto itr = _accounts.find(name);
+		if (itr == _accounts.end())
+			itr = _accounts.emplace(name, _db.find_account(name) != nullptr).first;
+		return itr->second;
+	}
+
+	bool speculative_contract_state::is_contract(const account_name_type& name)
+	{
+		return get_contract_creator(name).valid();
+	}
+
+	fc::optional< account_name_type > speculative_contract_state::get_contract_creator(const account_name_type& name)
+	{
+		auto itr = _creators.find(name);
+		if (itr == _creators.end())
+			itr = _creators.emplace(name, read_creator(_db, name)).first;
+		return itr->second;
+	}
+
+	speculative_contract_state::tracked< fc::optional< std::string > >& speculative_contract_state::user_data(const account_name_type& contract, const account_name_type& user)
+	{
+		user_key key(contract, user);
+		auto itr = _user_data.find(key);
+		if (itr == _user_data.end()) {
+			auto value = read_user_data(_db, contract, user);
+			itr = _user_data.emplace(key, tracked< fc::optional< std::string > >{ value, value }).first;
+		}
+		return itr->second;
+	}
+
+	speculative_contract_state::tracked< fc::optional< std::string > >& speculative_contract_state::storage(const account_name_type& contract, const account_name_type& user, const std::string& key)
+	{
+		storage_key k(contract, user, key);
+		auto itr = _storage.find(k);
+		if (itr == _storage.end()) {
+			auto value = read_storage(_db, contract, user, key);
+			itr = _storage.emplace(k, tracked< fc::optional< std::string > >{ value, value }).first;
+		}
+		return itr->second;
+	}
+
+	speculative_contract_state::tracked< fc::optional< asset > >& speculative_contract_state::balance(const account_name_type& name)
+	{
+		auto itr = _balances.find(name);
+		if (itr == _balances.end()) {
+			auto value = read_balance(_db, name);
+			itr = _balances.emplace(name, tracked< fc::optional< asset > >{ value, value }).first;
+		}
+		return itr->second;
+	}
+
+	speculative_contract_state::tracked< fc::optional< asset > >& speculative_contract_state::contract_balance(const account_name_type& name)
+	{
+		auto itr = _contract_balances.find(name);
+		if (itr == _contract_balances.end()) {
+			auto value = read_contract_balance(_db, name);
+			itr = _contract_balances.emplace(name, tracked< fc::optional< asset > >{ value, value }).first;
+		}
+		return itr->second;
+	}
+
+	bool speculative_contract_state::find_user_data(const account_name_type& contract, const account_name_type& user, const char*& data, size_t& size)
+	{
+		const auto& value = user_data(contract, user).current;
+		if (!value)
+			return false;
+		data = value->data();
+		size = value->size();
+		return true;
+	}
+
+	int64_t speculative_contract_state::save_user_data(const account_name_type& contract, const account_name_type& user, const std::string& data)
+	{
+		auto& value = user_data(contract, user).current;
+		if (value && *value == data)
+			return 0;
+		value = data;
+		_writes.push_back([contract, user, data](contract_state& state) { state.save_user_data(contract, user, data); });
+		return data.size();
+	}
+
+	bool speculative_contract_state::find_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const char*& value, size_t& size)
+	{
+		const auto& current = storage(contract, user, key).current;
+		if (!current)
+			return false;
+		value = current->data();
+		size = current->size();
+		return true;
+	}
+
+	int64_t speculative_contract_state::set_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const std::string& value)
+	{
+		auto& current = storage(contract, user, key).current;
+		if (current && *current == value)
+			return 0;
+		current = value;
+		_writes.push_back([contract, user, key, value](contract_state& state) { state.set_storage(contract, user, key, value); });
+		return key.size() + value.size();
+	}
+
+	int64_t speculative_contract_state::remove_storage(const account_name_type& contract, const account_name_type& user, const std::string& key)
+	{
+		auto& current = storage(contract, user, key).current;
+		if (!current)
+			return 0;
+		current.reset();
+		_writes.push_back([contract, user, key](contract_state& state) { state.remove_storage(contract, user, key); });
+		return key.size();
+	}
+
+	asset speculative_contract_state::get_balance(const account_name_type& name, asset_symbol_type symbol)
+	{
+		const auto& current = balance(name).current;
+		if (symbol.asset_num != GAMEBANK_ASSET_NUM_GBC || !current) {
+			_unsupported = true;
+			return asset(0, symbol);
+		}
+		return *current;
+	}
+
+	asset speculative_contract_state::get_contract_balance(const account_name_type& name, asset_symbol_type symbol)
+	{
+		const auto& current = contract_balance(name).current;
+		if (symbol.asset_num != GAMEBANK_ASSET_NUM_GBC || !current) {
+			_unsupported = true;
+			return asset(0, symbol);
+		}
+		return *current;
+	}
+
+	void speculative_contract_state::adjust_balance(const account_name_type& name, const asset& delta)
+	{
+		auto& current = balance(name).current;
+		if (delta.symbol.asset_num != GAMEBANK_ASSET_NUM_GBC || !current) {
+			_unsupported = true;
+			return;
+		}
+		*current += delta;
+		// the database refuses negative balances, leave the error to the evaluator
+		if (current->amount < 0)
+			_unsupported = true;
+		_writes.push_back([name, delta](contract_state& state) { state.adjust_balance(name, delta); });
+	}
+
+	void speculative_contract_state::adjust_contract_balance(const account_name_type& name, const asset& delta)
+	{
+		auto& current = contract_balance(name).current;
+		if (delta.symbol.asset_num != GAMEBANK_ASSET_NUM_GBC || !current) {
+			_unsupported = true;
+			return;
+		}
+		*current += delta;
+		_writes.push_back([name, delta](contract_state& state) { state.adjust_contract_balance(name, delta); });
+	}
+
+	void speculative_contract_state::emit(const contract_log_operation& log)
+	{
+		_writes.push_back([log](contract_state& state) { state.emit(log); });
+	}
+
+	bool speculative_contract_state::validate(const database& db)const
+	{
+		for (const auto& a : _accounts)
+			if ((db.find_account(a.first) != nullptr) != a.second)
+				return false;
+		for (const auto& c : _creators)
+			if (!same(read_creator(db, c.first), c.second))
+				return false;
+		for (const auto& u : _user_data)
+			if (!same(read_user_data(db, u.first.first, u.first.second), u.second.read))
+				return false;
+		for (const auto& s : _storage)
+			if (!same(read_storage(db, std::get< 0 >(s.first), std::get< 1 >(s.first), std::get< 2 >(s.first)), s.second.read))
+				return false;
+		for (const auto& b : _balances)
+			if (!same(read_balance(db, b.first), b.second.read))
+				return false;
+		for (const auto& b : _contract_balances)
+			if (!same(read_contract_balance(db, b.first), b.second.read))
+				return false;
+		return true;
+	}
+
+	void speculative_contract_state::replay(contract_state& state)const
+	{
+		for (const auto& write : _writes)
+			write(state);
+	}
+
+	contract_speculator::contract_speculator(uint32_t threads, contract_cache& cache, contract_lua_pool& pool)
+		: _cache(cache), _pool(pool), _thread_count(threads), _work(new boost::asio::io_service::work(_ios))
+	{
+		for (uint32_t i = 0; i < threads; ++i)
+			_threads.create_thread(boost::bind(&boost::asio::io_service::run, &_ios));
+	}
+
+	contract_speculator::~contract_speculator()
+	{
+		_work.reset();
+		_ios.stop();
+		_threads.join_all();
+	}
+
+	void contract_speculator::run(const database& db, const protocol::signed_block& block)
+	{
+		clear();
+		for (const auto& trx : block.transactions)
+			for (const auto& op : trx.operations)
+				if (op.which() == operation::tag< contract_call_operation >::value)
+					_calls.push_back(std::make_shared< speculative_contract_call >(db, op.get< contract_call_operation >()));
+
+		// a single call gains nothing from running ahead
+		if (_calls.size() < 2) {
+			_calls.clear();
+			return;
+		}
+		++_stats.blocks;
+		_stats.calls += _calls.size();
+
+		std::atomic< size_t > next(0);
+		auto work = [&]()
+		{
+			for (size_t i = next++; i < _calls.size(); i = next++)
+				execute(db, *_calls[i]);
+		};
+
+		// the applying thread runs calls as well, and must not write before the workers are done
+		size_t helpers = std::min< size_t >(_thread_count, _calls.size() - 1);
+		std::mutex mutex;
+		std::condition_variable done;
+		size_t running = helpers;
+		for (size_t i = 0; i < helpers; ++i)
+			_ios.post([&]()
+			{
+				work();
+				std::lock_guard< std::mutex > guard(mutex);
+				if (--running == 0)
+					done.notify_one();
+			});
+		work();
+
+		std::unique_lock< std::mutex > lock(mutex);
+		done.wait(lock, [&]() { return running == 0; });
+	}
+
+	void contract_speculator::execute(const database& db, speculative_contract_call& call)
+	{
+		try
+		{
+			const auto& op = call.op;
+			// contracts deployed earlier in this block are not in the database yet
+			const contract_object* contract_data = db.find_contract(op.contract_name);
+			if (contract_data == nullptr)
+				return;
+
+			fc::variant v = fc::json::from_string(op.args);
+			if (!v.is_array())
+				return;
+			variants op_args = v.as< vector< fc::variant > >();
+
+			digest_type version = contract_data->version;
+			if (version == digest_type())
+				version = contract_cache::compute_version(to_string(contract_data->code), to_string(contract_data->abi));
+			auto abi = _cache.get_abi(op.contract_name, version);
+			if (!abi)
+				abi = _cache.set_abi(op.contract_name, version, contract_abi::from_string(to_string(contract_data->abi)));
+			abi->check_call(op.method, op_args);
+
+			auto start = fc::time_point::now();
+			contract_lua contract(op.contract_name, &_pool);
+			contract.set_state(&call.state);
+			contract.set_abi(abi->method_names);
+			contract.set_extend(op.contract_name, op.caller);
+			contract.set_extend_arg(0, GAMEBANK_CONTRACT_SPECULATIVE_OPCODE_LIMIT);
+			bool loaded = contract_data->bytecode.size() > 0
+				? contract.load_verified(contract_data->bytecode.data(), contract_data->bytecode.size(), version, _cache)
+				: contract.load(to_string(contract_data->code), version, _cache);
+			if (!loaded || !contract.call_method(op.method, op_args, call.result))
+				return;
+
+			call.version = version;
+			call.opcount = contract.get_current_opcount();
+			call.memory_peak = contract.get_memory_peak();
+			call.wall_time_us = (fc::time_point::now() - start).count();
+			call.storage_read_bytes = contract.get_storage_read_bytes();
+			call.storage_write_bytes = contract.get_storage_write_bytes();
+			call.succeeded = !call.state.unsupported();
+		}
+		catch (const fc::exception& e)
+		{
+			// the evaluator runs the call again and reports the error
+			dlog("speculative contract call failed: ${e}", ("e", e.to_string()));
+		}
+		catch (const std::exception& e)
+		{
+			dlog("speculative contract call failed: ${e}", ("e", e.what()));
+		}
+	}
+
+	std::shared_ptr< speculative_contract_call > contract_speculator::take(const contract_call_operation& op)
+	{
+		if (_next >= _calls.size())
+			return std::shared_ptr< speculative_contract_call >();
+
+		auto call = _calls[_next];
+		if (call->op.caller != op.caller || call->op.contract_name != op.contract_name
+			|| call->op.method != op.method || call->op.args != op.args) {
+			// not applying the block that was run, drop it
+			clear();
+			return std::shared_ptr< speculative_contract_call >();
+		}
+		++_next;
+		return call;
+	}
+
+	bool contract_speculator::commit(database& db, const speculative_contract_call& call, const digest_type& version, int opcode_limit)
+	{
+		// the call ran without the caller's limit, which only matters if it would have been reached
+		bool valid = call.succeeded && call.version == version
+			&& (opcode_limit <= 0 || call.opcount < opcode_limit)
+			&& call.state.validate(db);
+		if (!valid) {
+			++_stats.reexecuted;
+			return false;
+		}
+
+		contract_database_state state(db);
+		call.state.replay(state);
+		++_stats.committed;
+		return true;
+	}
+
+	void contract_speculator::clear()
+	{
+		_calls.clear();
+		_next = 0;
+	}
+
+}}
@@ -0,0 +1,141 @@
+#include <gamebank/chain/contract/contract_state.hpp>
+#include <gamebank/chain/contract/contract_object.hpp>
+#include <gamebank/chain/contract/contract_user_object.hpp>
+#include <gamebank/chain/contract/contract_storage_object.hpp>
+#include <gamebank/chain/database.hpp>
+
+namespace gamebank { namespace chain {
+
+	uint32_t contract_database_state::head_block_num()
+	{
+		return _db.head_block_num();
+	}
+
+	fc::optional< signed_block > contract_database_state::fetch_block_by_number(uint32_t num)
+	{
+		return _db.fetch_block_by_number(num);
+	}
+
+	bool contract_database_state::is_account(const account_name_type& name)
+	{
+		return _db.find_account(name) != nullptr;
+	}
+
+	bool contract_database_state::is_contract(const account_name_type& name)
+	{
+		return _db.find_contract(name) != nullptr;
+	}
+
+	fc::optional< account_name_type > contract_database_state::get_contract_creator(const account_name_type& name)
+	{
+		const contract_object* obj = _db.find_contract(name);
+		if (obj == nullptr)
+			return fc::optional< account_name_type >();
+		return obj->creator;
+	}
+
+	bool contract_database_state::find_user_data(const account_name_type& contract, const account_name_type& user, const char*& data, size_t& size)
+	{
+		auto obj = _db.find< contract_user_object, by_contract_user >(boost::make_tuple(contract, user));
+		if (obj == nullptr)
+			return false;
+		data = obj->data.data();
+		size = obj->data.size();
+		return true;
+	}
+
+	int64_t contract_database_state::save_user_data(const account_name_type& contract, const account_name_type& user, const std::string& data)
+	{
+		auto obj = _db.find< contract_user_object, by_contract_user >(boost::make_tuple(contract, user));
+		if (obj == nullptr) {
+			_db.create< contract_user_object >([&](contract_user_object& o)
+			{
+				o.contract_name = contract;
+				o.user_name = user;
+				o.data.assign(data.data(), data.size());
+				o.created = _db.head_block_time();
+				o.last_update = o.created;
+			});
+			return data.size();
+		}
+		// tables that were only read encode to the stored bytes and are not copied into the undo state
+		if (obj->data.size() == data.size() && memcmp(obj->data.data(), data.data(), data.size()) == 0)
+			return 0;
+		_db.modify(*obj, [&](contract_user_object& o)
+		{
+			o.data.assign(data.data(), data.size());
+			o.last_update = _db.head_block_time();
+		});
+		return data.size();
+	}
+
+	bool contract_database_state::find_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const char*& value, size_t& size)
+	{
+		auto obj = _db.find< contract_storage_object, by_contract_user_key >(boost::make_tuple(contract, user, key));
+		if (obj == nullptr)
+			return false;
+		value = obj->value.data();
+		size = obj->value.size();
+		return true;
+	}
+
+	int64_t contract_database_state::set_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const std::string& value)
+	{
+		auto obj = _db.find< contract_storage_object, by_contract_user_key >(boost::make_tuple(contract, user, key));
+		if (obj == nullptr) {
+			_db.create< contract_storage_object >([&](contract_storage_object& o)
+			{
+				o.contract_name = contract;
+				o.user_name = user;
+				o.key.assign(key.data(), key.size());
+				o.value.assign(value.data(), value.size());
+				o.created = _db.head_block_time();
+				o.last_update = o.created;
+			});
+			return key.size() + value.size();
+		}
+		if (obj->value.size() == value.size() && memcmp(obj->value.data(), value.data(), value.size()) == 0)
+			return 0;
+		_db.modify(*obj, [&](contract_storage_object& o)
+		{
+			o.value.assign(value.data(), value.size());
+			o.last_update = _db.head_block_time();
+		});
+		return key.size() + value.size();
+	}
+
+	int64_t contract_database_state::remove_storage(const account_name_type& contract, const account_name_type& user, const std::string& key)
+	{
+		auto obj = _db.find< contract_storage_object, by_contract_user_key >(boost::make_tuple(contract, user, key));
+		if (obj == nullptr)
+			return 0;
+		_db.remove(*obj);
+		return key.size();
+	}
+
+	asset contract_database_state::get_balance(const account_name_type& name, asset_symbol_type symbol)
+	{
+		return _db.get_balance(name, symbol);
+	}
+
+	asset contract_database_state::get_contract_balance(const account_name_type& name, asset_symbol_type symbol)
+	{
+		return _db.get_contract_balance(name, symbol);
+	}
+
+	void contract_database_state::adjust_balance(const account_name_type& name, const asset& delta)
+	{
+		_db.adjust_balance(name, delta);
+	}
+
+	void contract_database_state::adjust_contract_balance(const account_name_type& name, const asset& delta)
+	{
+		_db.adjust_contract_balance(name, delta);
+	}
+
+	void contract_database_state::emit(const contract_log_operation& log)
+	{
+		_db.contract_operation(log);
+	}
+
+}}
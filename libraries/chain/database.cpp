@@ -1,5 +1,6 @@
 #include <gamebank/protocol/gamebank_operations.hpp>
 
+#include <gamebank/chain/block_replay_pipeline.hpp>
 #include <gamebank/chain/block_summary_object.hpp>
 #include <gamebank/chain/compound.hpp>
 #include <gamebank/chain/custom_operation_interpreter.hpp>
@@ -14,12 +15,15 @@
 #include <gamebank/chain/gamebank_objects.hpp>
 #include <gamebank/chain/transaction_object.hpp>
 #include <gamebank/chain/shared_db_merkle.hpp>
+#include <gamebank/chain/signature_recovery.hpp>
 #include <gamebank/chain/operation_notification.hpp>
 #include <gamebank/chain/witness_schedule.hpp>
 #include <gamebank/chain/nonfungible_fund_object.hpp>
 #include <gamebank/chain/nonfungible_fund_on_sale_object.hpp>
 #include <gamebank/chain/contract/contract_object.hpp>
 #include <gamebank/chain/contract/contract_user_object.hpp>
+#include <gamebank/chain/contract/contract_storage_object.hpp>
+#include <gamebank/chain/contract/contract_speculation.hpp>
 
 #include <gamebank/chain/util/asset.hpp>
 #include <gamebank/chain/util/reward.hpp>
@@ -163,6 +167,12 @@ void database::open( const open_args& args )
 
       _shared_file_full_threshold = args.shared_file_full_threshold;
       _shared_file_scale_rate = args.shared_file_scale_rate;
+      update_shared_file_auto_grow();
+
+      if( args.contract_speculation_threads > 0 )
+         _contract_speculator.reset( new contract_speculator( args.contract_speculation_threads, _contract_cache, _contract_lua_pool ) );
+
+      std::atomic_store( &_signature_recovery, std::make_shared< signature_recovery >( args.signature_recovery_threads ) );
    }
    FC_CAPTURE_LOG_AND_RETHROW( (args.data_dir)(args.shared_mem_dir)(args.shared_file_size) )
 }
@@ -187,6 +197,22 @@ uint32_t database::reindex( const open_args& args )
       auto start = fc::time_point::now();
       GAMEBANK_ASSERT( _block_log.head(), block_log_exception, "No blocks in block log. Cannot reindex an empty chain." );
 
+      uint32_t first_block_num = 1;
+      if( args.state_snapshot.string().size() )
+      {
+         with_write_lock( [&]()
+         {
+            read_state_snapshot( *this, args.state_snapshot, args.state_snapshot_threads );
+            auto head_block = _block_log.read_block_by_num( head_block_num() );
+            FC_ASSERT( head_block.valid() && head_block->id() == head_block_id(),
+               "State snapshot head block ${b} is not in the block log", ("b", head_block_num()) );
+            set_revision( head_block_num() );
+            init_hardforks();
+         });
+         first_block_num = head_block_num() + 1;
+         note.last_block_number = head_block_num();
+      }
+
       ilog( "Replaying blocks..." );
 
       uint64_t skip_flags =
@@ -204,33 +230,55 @@ uint32_t database::reindex( const open_args& args )
       with_write_lock( [&]()
       {
          _block_log.set_locking( false );
-         auto itr = _block_log.read_block( 0 );
          auto last_block_num = _block_log.head()->block_num();
          if( args.stop_replay_at > 0 && args.stop_replay_at < last_block_num )
             last_block_num = args.stop_replay_at;
+         FC_ASSERT( first_block_num <= last_block_num + 1, "State snapshot is past the last block to replay",
+            ("snapshot", first_block_num - 1)("last", last_block_num) );
          if( args.benchmark.first > 0 )
          {
             args.benchmark.second( 0, get_abstract_index_cntr() );
          }
 
-         while( itr.first.block_num() != last_block_num )
+         auto replay_block = [&]( const signed_block& b, const block_id_type& id )
          {
-            auto cur_block_num = itr.first.block_num();
+            auto cur_block_num = b.block_num();
             if( cur_block_num % 100000 == 0 )
                std::cerr << "   " << double( cur_block_num * 100 ) / last_block_num << "%   " << cur_block_num << " of " << last_block_num <<
                "   (" << (get_free_memory() / (1024*1024)) << "M free)\n";
-            apply_block( itr.first, skip_flags );
+            apply_block( b, id, skip_flags );
+            note.last_block_number = cur_block_num;
 
             if( (args.benchmark.first > 0) && (cur_block_num % args.benchmark.first == 0) )
                args.benchmark.second( cur_block_num, get_abstract_index_cntr() );
-            itr = _block_log.read_block( itr.second );
-         }
+         };
+
+         if( args.replay_threads > 0 )
+         {
+            // blocks are read, decoded and hashed on the pipeline threads, this thread only applies them
+            BOOST_SCOPE_EXIT( this_ )
+            {
+               this_->_decoded_block = nullptr;
+            } BOOST_SCOPE_EXIT_END
 
-         apply_block( itr.first, skip_flags );
-         note.last_block_number = itr.first.block_num();
+            block_replay_pipeline pipeline( _block_log, first_block_num, last_block_num, args.replay_threads );
+            while( auto decoded = pipeline.next() )
+            {
+               _decoded_block = decoded.get();
+               replay_block( decoded->block, decoded->id );
+            }
+         }
+         else if( first_block_num <= last_block_num )
+         {
+            auto itr = _block_log.read_block( _block_log.get_block_pos( first_block_num ) );
+            replay_block( itr.first, itr.first.id() );
+            while( itr.first.block_num() != last_block_num )
+            {
+               itr = _block_log.read_block( itr.second );
+               replay_block( itr.first, itr.first.id() );
+            }
+         }
 
-         if( (args.benchmark.first > 0) && (note.last_block_number % args.benchmark.first == 0) )
-            args.benchmark.second( note.last_block_number, get_abstract_index_cntr() );
          set_revision( head_block_num() );
          _block_log.set_locking( true );
       });
@@ -239,7 +287,18 @@ uint32_t database::reindex( const open_args& args )
          _fork_db.start_block( *_block_log.head() );
 
       auto end = fc::time_point::now();
-      ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
+      double elapsed = double( std::max< int64_t >( (end-start).count(), 1 ) ) / 1000000.0;
+      ilog( "Done reindexing, elapsed time: ${t} sec, ${b} blocks/sec with ${n} replay threads",
+            ("t",elapsed)("b",uint64_t((note.last_block_number - first_block_num + 1) / elapsed))("n",args.replay_threads) );
+      if( first_block_num > 1 )
+         ilog( "Started from the state snapshot at block ${s}, replayed ${r} blocks", ("s",first_block_num - 1)("r",note.last_block_number - first_block_num + 1) );
+
+      if( _contract_speculator )
+      {
+         auto stats = _contract_speculator->get_stats();
+         ilog( "Contract speculation: ${c} calls in ${b} blocks run ahead, ${m} committed, ${r} run again",
+               ("c", stats.calls)("b", stats.blocks)("m", stats.committed)("r", stats.reexecuted) );
+      }
 
       note.reindex_success = true;
 
@@ -269,6 +328,10 @@ void database::close(bool rewind)
       // DB state (issue #336).
       clear_pending();
 
+      _contract_speculator.reset();
+      // p2p decode threads may still be recovering keys, they hold their own reference until done
+      std::atomic_store( &_signature_recovery, std::shared_ptr< signature_recovery >() );
+
       chainbase::database::flush();
       chainbase::database::close();
 
@@ -690,6 +753,9 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
          FC_CAPTURE_AND_RETHROW( (new_block) )
 
          check_free_memory( false, new_block.block_num() );
+
+         // before the pending transactions are applied again, readers see the state as of the head block
+         publish_snapshot();
       });
    });
 
@@ -700,13 +766,13 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
    return result;
 }
 
-void database::confirm_block(const signed_block& blk, uint32_t skip)
+void database::confirm_block(const signed_block_header& header, uint32_t skip)
 {
     try {
-        const witness_object& witness = validate_block_header( skip, blk );
-        update_confirm_witness(witness, blk);
+        const witness_object& witness = validate_block_header( skip, header );
+        update_confirm_witness(witness, header);
     }
-    FC_CAPTURE_LOG_AND_RETHROW((blk.block_num()))
+    FC_CAPTURE_LOG_AND_RETHROW((header.block_num()))
 }
 
 //height:ɵյnumer߶ȣ
@@ -745,11 +811,15 @@ bool database::_push_block(const signed_block& new_block)
    uint32_t skip = get_node_properties().skip_flags;
    //uint32_t skip_undo_db = skip & skip_undo_block;
 
+   // computed once here and passed to the fork database and apply_block
+   const block_id_type new_block_id = new_block.id();
+   ++apply_counters::get().block_ids;
+
   //ֲ
    if( !(skip&skip_fork_db) )
    {
    	  //pushforkDB
-      shared_ptr<fork_item> new_head = _fork_db.push_block(new_block);
+      shared_ptr<fork_item> new_head = _fork_db.push_block(new_block, new_block_id);
       _maybe_warn_multiple_production( new_head->num );
 
       //If the head block from the longest chain does not build off of the current head, we need to switch forks.
@@ -785,7 +855,7 @@ bool database::_push_block(const signed_block& new_block)
                    auto session = start_undo_session();
 				   //new head֧ϵ
 				   //ӷֲĺһ鿪ʼѹ
-                   apply_block( (*ritr)->data, skip );
+                   apply_block( (*ritr)->data, (*ritr)->id, skip );
                    session.push();
                 }
                 catch ( const fc::exception& e ) { except = e; }
@@ -813,7 +883,7 @@ bool database::_push_block(const signed_block& new_block)
                    for( auto ritr = branches.second.rbegin(); ritr != branches.second.rend(); ++ritr )
                    {
                       auto session = start_undo_session();
-                      apply_block( (*ritr)->data, skip );
+                      apply_block( (*ritr)->data, (*ritr)->id, skip );
                       session.push();
                    }
                    throw *except;
@@ -831,13 +901,13 @@ bool database::_push_block(const signed_block& new_block)
    	  // ӵ
 
       auto session = start_undo_session();
-      apply_block(new_block, skip);
+      apply_block(new_block, new_block_id, skip);
       session.push();
    }
    catch( const fc::exception& e )
    {
       elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
-      _fork_db.remove(new_block.id());
+      _fork_db.remove(new_block_id);
       throw;
    }
 
@@ -879,6 +949,18 @@ void database::push_transaction( const signed_transaction& trx, uint32_t skip )
    FC_CAPTURE_AND_RETHROW( (trx) )
 }
 
+void database::recover_signatures( const signed_block& b )
+{
+   if( auto recovery = std::atomic_load( &_signature_recovery ) )
+      recovery->recover( get_chain_id(), b );
+}
+
+void database::recover_signatures( const signed_transaction& trx )
+{
+   if( auto recovery = std::atomic_load( &_signature_recovery ) )
+      recovery->recover( get_chain_id(), trx );
+}
+
 //1 ִ_apply_transaction
 //2 յĽ׷_pending_tx齫
 void database::_push_transaction( const signed_transaction& trx )
@@ -2612,6 +2694,7 @@ void database::initialize_indexes()
    add_core_index< nonfungible_fund_on_sale_index          >(*this);
    add_core_index< contract_object_index				   >(*this);
    add_core_index< contract_user_object_index			   >(*this);
+   add_core_index< contract_storage_object_index           >(*this);
 
    _plugin_index_signal();
 }
@@ -2835,16 +2918,23 @@ void database::notify_changed_objects()
 
 }
 
-void database::set_flush_interval( uint32_t flush_blocks )
+void database::set_flush_interval( uint32_t flush_blocks, flush_mode mode )
 {
    _flush_blocks = flush_blocks;
    _next_flush_block = 0;
+   _flush_mode = mode;
 }
 
 //////////////////// private methods ////////////////////
 //
 //push_block -> _push_block -> apply_block -> _apply_block
 void database::apply_block( const signed_block& next_block, uint32_t skip )
+{
+   ++apply_counters::get().block_ids;
+   apply_block( next_block, next_block.id(), skip );
+}
+
+void database::apply_block( const signed_block& next_block, const block_id_type& id, uint32_t skip )
 { try {
    //fc::time_point begin_time = fc::time_point::now();
 
@@ -2853,7 +2943,7 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
    {
       auto itr = _checkpoints.find( block_num );
       if( itr != _checkpoints.end() )
-         FC_ASSERT( next_block.id() == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",next_block.id()) );
+         FC_ASSERT( id == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",id) );
 
       if( _checkpoints.rbegin()->first >= block_num )
          skip = skip_witness_signature
@@ -2874,7 +2964,7 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
    detail::with_skip_flags( *this, skip, [&]()
    {
    //// ڴ˵ʵʵ鷽
-      _apply_block( next_block );
+      _apply_block( next_block, id );
    } );
 
    /*try
@@ -2887,42 +2977,77 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
 
    //fc::time_point end_time = fc::time_point::now();
    //fc::microseconds dt = end_time - begin_time;
+   _last_flush_stall = fc::microseconds();
    if( _flush_blocks != 0 )
    {
-      if( _next_flush_block == 0 )
+      fc::time_point flush_start = fc::time_point::now();
+
+      if( _flush_mode == incremental_flush )
+      {
+         // a full pass over the file every _flush_blocks blocks, without stalling this one
+         chainbase::database::flush_async( get_max_memory() / _flush_blocks + 1 );
+      }
+      else
       {
-         uint32_t lep = block_num + 1 + _flush_blocks * 9 / 10;
-         uint32_t rep = block_num + 1 + _flush_blocks;
-
-         // use time_point::now() as RNG source to pick block randomly between lep and rep
-         //lep ~ repѡһ
-         uint32_t span = rep - lep;
-         uint32_t x = lep;
-         if( span > 0 )
+         if( _next_flush_block == 0 )
          {
-            uint64_t now = uint64_t( fc::time_point::now().time_since_epoch().count() );
-            x += now % span;
+            uint32_t lep = block_num + 1 + _flush_blocks * 9 / 10;
+            uint32_t rep = block_num + 1 + _flush_blocks;
+
+            // use time_point::now() as RNG source to pick block randomly between lep and rep
+            //lep ~ repѡһ
+            uint32_t span = rep - lep;
+            uint32_t x = lep;
+            if( span > 0 )
+            {
+               uint64_t now = uint64_t( fc::time_point::now().time_since_epoch().count() );
+               x += now % span;
+            }
+            _next_flush_block = x;
+            //ilog( "Next flush scheduled at block ${b}", ("b", x) );
          }
-         _next_flush_block = x;
-         //ilog( "Next flush scheduled at block ${b}", ("b", x) );
-      }
 
-      if( _next_flush_block == block_num )
-      {
-        //С? һѡһζdatabaseflush
-         _next_flush_block = 0;
-         //ilog( "Flushing database shared memory at block ${b}", ("b", block_num) );
-         chainbase::database::flush();
+         if( _next_flush_block == block_num )
+         {
+           //С? һѡһζdatabaseflush
+            _next_flush_block = 0;
+            //ilog( "Flushing database shared memory at block ${b}", ("b", block_num) );
+            chainbase::database::flush();
+         }
       }
+
+      _last_flush_stall = fc::time_point::now() - flush_start;
    }
 
 } FC_CAPTURE_AND_RETHROW( (next_block) ) }
 
+void database::update_shared_file_auto_grow()
+{
+   uint64_t max_mem = get_max_memory();
+   _last_shared_file_size = max_mem;
+
+   if( _shared_file_full_threshold == 0 || _shared_file_scale_rate == 0 )
+   {
+      set_auto_grow( 0, 0 );
+      return;
+   }
+
+   set_auto_grow( ( ( uint128_t( GAMEBANK_100_PERCENT - _shared_file_full_threshold ) * max_mem ) / GAMEBANK_100_PERCENT ).to_uint64(),
+                  ( uint128_t( max_mem * _shared_file_scale_rate ) / GAMEBANK_100_PERCENT ).to_uint64() );
+}
+
 void database::check_free_memory( bool force_print, uint32_t current_block_num )
 {
    uint64_t free_mem = get_free_memory();
    uint64_t max_mem = get_max_memory();
 
+   if( BOOST_UNLIKELY( max_mem != _last_shared_file_size ) )
+   {
+      // chainbase grew the file in place while the block was applied
+      wlog( "Memory was almost full, increased to ${mem}M at block ${b}", ("mem", max_mem / (1024*1024))("b", current_block_num) );
+      update_shared_file_auto_grow();
+   }
+
    if( BOOST_UNLIKELY( _shared_file_full_threshold != 0 && _shared_file_scale_rate != 0 && free_mem < ( ( uint128_t( GAMEBANK_100_PERCENT - _shared_file_full_threshold ) * max_mem ) / GAMEBANK_100_PERCENT ).to_uint64() ) )
    {
       uint64_t new_max = ( uint128_t( max_mem * _shared_file_scale_rate ) / GAMEBANK_100_PERCENT ).to_uint64() + max_mem;
@@ -2930,6 +3055,7 @@ void database::check_free_memory( bool force_print, uint32_t current_block_num )
       wlog( "Memory is almost full, increasing to ${mem}M", ("mem", new_max / (1024*1024)) );
 
       resize( new_max );
+      update_shared_file_auto_grow();
 
       uint32_t free_mb = uint32_t( get_free_memory() / (1024*1024) );
       wlog( "Free memory is now ${free}M", ("free", free_mb) );
@@ -2964,11 +3090,11 @@ void database::check_free_memory( bool force_print, uint32_t current_block_num )
 // 4 ȫеĵǰļ֤
 // 5 applyен
 // 6 ־ûȫֵ.......
-void database::_apply_block( const signed_block& next_block )
+void database::_apply_block( const signed_block& next_block, const block_id_type& id )
 { try {
 
    //block_notificationԱ: id,num,signed_block
-   block_notification note( next_block );
+   block_notification note( next_block, id );
 
    notify_pre_apply_block( note );	
 
@@ -3035,11 +3161,11 @@ void database::_apply_block( const signed_block& next_block )
    //֤merkle_root
    if( !( skip & skip_merkle_check ) )
    {
-      auto merkle_root = next_block.calculate_merkle_root();
+      auto merkle_root = _decoded_block ? _decoded_block->merkle_root : next_block.calculate_merkle_root();
 
       try
       {
-         FC_ASSERT( next_block.transaction_merkle_root == merkle_root, "Merkle check failed", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",merkle_root)("next_block",next_block)("id",next_block.id()) );
+         FC_ASSERT( next_block.transaction_merkle_root == merkle_root, "Merkle check failed", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",merkle_root)("next_block",next_block)("id",note.block_id) );
       }
       catch( fc::assert_exception& e )
       {
@@ -3055,7 +3181,7 @@ void database::_apply_block( const signed_block& next_block )
    const witness_object& signing_witness = validate_block_header(skip, next_block);
 
    const auto& gprops = get_dynamic_global_properties();
-   auto block_size = fc::raw::pack_size( next_block );
+   auto block_size = note.packed_size();
 
    FC_ASSERT( block_size <= gprops.maximum_block_size, "Block Size is too Big", ("next_block_num",next_block_num)("block_size", block_size)("max",gprops.maximum_block_size) );
 
@@ -3087,10 +3213,15 @@ void database::_apply_block( const signed_block& next_block )
    vector<contract_transaction> ctxs;
    signed_contract sc;
    sc.previous = next_block.previous;
-   sc.block_id = next_block.id();
-   sc.signing_key = next_block.signee();
+   sc.block_id = note.block_id;
+   sc.signing_key = _decoded_block ? _decoded_block->signee : public_key_type( next_block.signee() );
    _contract_operation.clear();
    _contract_return.clear();
+
+   // run the contract calls on worker threads first, their evaluators commit them below unless they conflict
+   if( _contract_speculator )
+      _contract_speculator->run( *this, next_block );
+
    //applyен
    for( const auto& trx : next_block.transactions )
    {
@@ -3100,8 +3231,15 @@ void database::_apply_block( const signed_block& next_block )
        * for transactions when validating broadcast transactions or
        * when building a block.
        */
-      _contract_trxid = trx.id();
-      apply_transaction( trx, skip );
+      if( _decoded_block )
+         _contract_trxid = _decoded_block->transaction_ids[ _current_trx_in_block ];
+      else
+      {
+         _contract_trxid = trx.id();
+         ++apply_counters::get().transaction_ids;
+      }
+      // the skip flags are already set by apply_block, hand the id down instead of hashing again
+      _apply_transaction( trx, _contract_trxid );
       ++_current_trx_in_block;
       contract_transaction ctx;
       ctx.transaction_id = _contract_trxid;
@@ -3110,6 +3248,8 @@ void database::_apply_block( const signed_block& next_block )
       ctx.operations.swap( _contract_operation );
       sc.transactions.push_back(ctx);
    }
+   if( _contract_speculator )
+      _contract_speculator->clear();
    _contract_block[next_block.block_num()] = sc;
    note.contract_return.swap(_contract_return);
 
@@ -3127,7 +3267,7 @@ void database::_apply_block( const signed_block& next_block )
    update_last_irreversible_block();
 
    //for TaPos
-   create_block_summary(next_block);
+   create_block_summary(next_block, note.block_id);
    //Ƴdbѹڵн
    clear_expired_transactions();
    clear_expired_orders();
@@ -3344,8 +3484,14 @@ void database::apply_transaction(const signed_transaction& trx, uint32_t skip)
 //5 ˻
 //6 do_applyаoperations
 void database::_apply_transaction(const signed_transaction& trx)
+{
+   ++apply_counters::get().transaction_ids;
+   _apply_transaction( trx, trx.id() );
+}
+
+void database::_apply_transaction(const signed_transaction& trx, const transaction_id_type& id)
 { try {
-   transaction_notification note(trx);
+   transaction_notification note( trx, id );
    _current_trx_id = note.transaction_id;
    const transaction_id_type& trx_id = note.transaction_id;
    _current_virtual_op = 0;
@@ -3375,7 +3521,13 @@ void database::_apply_transaction(const signed_transaction& trx)
       {
 		//֤ǩ,Ȩ
 		//call gamebank::protocol::verify_authority
-         trx.verify_authority( chain_id, get_active, get_owner, get_posting, GAMEBANK_MAX_SIG_CHECK_DEPTH );
+         // keys recovered by recover_signatures before the write lock was taken
+         flat_set< public_key_type > signature_keys;
+         auto recovery = std::atomic_load( &_signature_recovery );
+         if( recovery && recovery->find( trx_id, trx, signature_keys ) )
+            trx.verify_authority( signature_keys, get_active, get_owner, get_posting, GAMEBANK_MAX_SIG_CHECK_DEPTH );
+         else
+            trx.verify_authority( chain_id, get_active, get_owner, get_posting, GAMEBANK_MAX_SIG_CHECK_DEPTH );
       }
       catch( protocol::tx_missing_active_auth& e )
       {
@@ -3607,7 +3759,7 @@ boost::signals2::connection database::add_update_bandwidth_handler(const bandwid
 
 
 //@see _apply_block
-const witness_object& database::validate_block_header( uint32_t skip, const signed_block& next_block )const
+const witness_object& database::validate_block_header( uint32_t skip, const signed_block_header& next_block )const
 { try {
    FC_ASSERT( head_block_id() == next_block.previous, "", ("head_block_id",head_block_id())("next.prev",next_block.previous) );
    FC_ASSERT( head_block_time() < next_block.timestamp, "", ("head_block_time",head_block_time())("next",next_block.timestamp)("blocknum",next_block.block_num()) );
@@ -3633,11 +3785,11 @@ const witness_object& database::validate_block_header( uint32_t skip, const sign
    return witness;
 } FC_CAPTURE_AND_RETHROW() }
 
-void database::create_block_summary(const signed_block& next_block)
+void database::create_block_summary(const signed_block& next_block, const block_id_type& id)
 { try {
    block_summary_id_type sid( next_block.block_num() & 0xffff );
    modify( get< block_summary_object >( sid ), [&](block_summary_object& p) {
-         p.block_id = next_block.id();
+         p.block_id = id;
    });
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -3758,7 +3910,7 @@ void database::update_signing_witness(const witness_object& signing_witness, con
 
 } FC_CAPTURE_AND_RETHROW() }
 
-void database::update_confirm_witness(const witness_object& confirm_witness, const signed_block& new_block)
+void database::update_confirm_witness(const witness_object& confirm_witness, const signed_block_header& new_block)
 { try {
    if( confirm_witness.last_confirmed_block_num > new_block.block_num() )
       return;
@@ -8,6 +8,9 @@
 #include <gamebank/chain/util/reward.hpp>
 
 #include <gamebank/chain/contract/contract_lua.hpp>
+#include <gamebank/chain/contract/contract_abi.hpp>
+#include <gamebank/chain/contract/contract_profiler.hpp>
+#include <gamebank/chain/contract/contract_speculation.hpp>
 
 #include <fc/macros.hpp>
 
@@ -2503,10 +2506,12 @@ void contract_deploy_evaluator::do_apply(const contract_deploy_operation& op)
 			obj.name = op.name;
 			from_string(obj.code, op.code);
 			from_string(obj.abi, op.abi);
-			// version calc
+			obj.version = contract_cache::compute_version(op.code, op.abi);
 			obj.created = _db.head_block_time();
 			obj.last_update = obj.created;
 		});
+		const auto& contract_data = _db.get_contract(op.name);
+		_db.get_contract_cache().set_abi(op.name, contract_data.version, contract_abi::from_string(op.abi));
 
 		int memory_limit = note.remain_bandwidth / 10;
 		int opcode_limit = note.remain_bandwidth;
@@ -2518,6 +2523,20 @@ void contract_deploy_evaluator::do_apply(const contract_deploy_operation& op)
 		contract.set_extend_arg(memory_limit, opcode_limit);
 		FC_ASSERT(contract.deploy(op.code), "deploy error");
 
+		// keep the verified chunk, calls and replays load it without parsing and checking the source again
+		std::string bytecode;
+		contract_analysis analysis;
+		contract_lua artifact(op.name);
+		artifact.set_abi(abi_method_names);
+		FC_ASSERT(artifact.verify(op.code, bytecode, analysis), "deploy error");
+		_db.modify(contract_data, [&](contract_object& obj)
+		{
+			obj.bytecode.assign(bytecode.begin(), bytecode.end());
+			auto packed = fc::raw::pack_to_vector(analysis);
+			obj.analysis.assign(packed.begin(), packed.end());
+		});
+		_db.get_contract_cache().set(op.name, contract_data.version, std::move(bytecode));
+
 		// todo: update account bandwith
 		int current_opcount = contract.get_current_opcount();
 		if (current_opcount > 0) {
@@ -2538,49 +2557,83 @@ void contract_deploy_evaluator::do_apply(const contract_deploy_operation& op)
         [{"type":"function","name":"test","args":["uint64","uint64"]}]
 */
 
+namespace {
+
+/// Records the cost of a contract call applied from a block when profiling is enabled, also on failure
+struct contract_call_profile_scope
+{
+   contract_call_profile_scope( database& db, contract_lua& contract, const contract_call_operation& op )
+      : _profiler( db.get_contract_profiler() ), _contract( contract ), _op( op ),
+        _active( _profiler.enabled() && db.is_processing_block() ), _start( fc::time_point::now() ) {}
+
+   ~contract_call_profile_scope()
+   {
+      if( !_active )
+         return;
+      try
+      {
+         contract_call_sample sample;
+         sample.contract = _op.contract_name;
+         sample.method = _op.method;
+         sample.failed = std::uncaught_exception();
+         sample.opcodes = std::max( _contract.get_current_opcount(), 0 );
+         sample.memory_kb = std::max( _contract.get_memory_peak(), 0 );
+         sample.wall_time_us = ( fc::time_point::now() - _start ).count();
+         sample.storage_read_bytes = _contract.get_storage_read_bytes();
+         sample.storage_write_bytes = _contract.get_storage_write_bytes();
+         _profiler.record( sample );
+      }
+      catch( ... ) {}
+   }
+
+   contract_profiler&              _profiler;
+   contract_lua&                   _contract;
+   const contract_call_operation&  _op;
+   bool                            _active;
+   fc::time_point                  _start;
+};
+
+/// Same as contract_call_profile_scope for a call that ran ahead of its block
+void record_speculative_call( database& db, const speculative_contract_call& call )
+{
+   auto& profiler = db.get_contract_profiler();
+   if( !profiler.enabled() )
+      return;
+
+   contract_call_sample sample;
+   sample.contract = call.op.contract_name;
+   sample.method = call.op.method;
+   sample.failed = false;
+   sample.opcodes = std::max( call.opcount, 0 );
+   sample.memory_kb = std::max( call.memory_peak, 0 );
+   sample.wall_time_us = call.wall_time_us;
+   sample.storage_read_bytes = call.storage_read_bytes;
+   sample.storage_write_bytes = call.storage_write_bytes;
+   profiler.record( sample );
+}
+
+}
+
 void contract_call_evaluator::do_apply(const contract_call_operation& op)
 {
-    auto check_abi = [&](const fc::variant &arg_tp, const fc::string &abi_tp) -> bool{
-        if (arg_tp.is_uint64() && abi_tp == "uint64")
-            return true;
-        if (arg_tp.is_int64() && abi_tp == "int64")
-            return true;
-        if (arg_tp.is_string() && abi_tp == "string")
-            return true;
-        if (arg_tp.is_object() && abi_tp == "object")
-            return true;
-        if (arg_tp.is_array() && abi_tp == "array")
-            return true;
-        return false;
-    };
 	try {
 		const auto& contract_data = _db.get_contract(op.contract_name);
 
         fc::variant v = fc::json::from_string(op.args);
         FC_ASSERT(v.is_array(), "contract args not array");
         variants op_args = v.as< vector< fc::variant > >();
+
+		// contracts deployed before version was filled in are keyed by their code and abi
+		auto& cache = _db.get_contract_cache();
+		digest_type version = contract_data.version;
+		if (version == digest_type())
+			version = contract_cache::compute_version(to_string(contract_data.code), to_string(contract_data.abi));
+
         // check abi from args
-        fc::variant abiv = fc::json::from_string(to_string(contract_data.abi));
-        variants abis = abiv.as< vector< fc::variant > >();
-		std::set<std::string> abi_method_names;
-        bool check_name = false;
-        for (size_t i = 0; i < abis.size(); ++i)
-        {
-            fc::variant_object abi_obj = abis[i].get_object();
-			abi_method_names.insert(abi_obj["name"].as_string());
-            if (abi_obj["name"].as_string() == op.method)
-            {
-                check_name = true;
-                variants abi_args = abi_obj["args"].as< std::vector< fc::variant > >();
-                FC_ASSERT(abi_args.size() == op_args.size(), "contract args num error");
-                for (size_t j = 0; j < op_args.size(); ++j)
-                {
-                    //FC_ASSERT(!op_args[j].is_array(), "op abi args num ${n} array", ("n", j));
-                    FC_ASSERT(check_abi(op_args[j], abi_args[j].as_string()), "contract abi args err");
-                }
-            }
-        }
-        FC_ASSERT(check_name, "contract abi check op name error");
+		auto abi = cache.get_abi(op.contract_name, version);
+		if (!abi)
+			abi = cache.set_abi(op.contract_name, version, contract_abi::from_string(to_string(contract_data.abi)));
+		abi->check_call(op.method, op_args);
 
 		// check bandwith
 		bandwidth_notification note(op.caller);
@@ -2596,12 +2649,32 @@ void contract_call_evaluator::do_apply(const contract_call_operation& op)
 		int memory_limit = 0; /* note.remain_bandwidth / 10;*/
 		int opcode_limit = note.remain_bandwidth;
 
-		contract_lua contract(op.contract_name);
+		// a call run ahead of the block is committed if nothing it read has changed since
+		contract_speculator* speculator = _db.get_contract_speculator();
+		if (speculator != nullptr && _db.is_processing_block()) {
+			auto ahead = speculator->take(op);
+			if (ahead && speculator->commit(_db, *ahead, version, opcode_limit)) {
+				record_speculative_call(_db, *ahead);
+				_db.contract_return(ahead->result);
+				if (ahead->opcount > 0) {
+					note.update_bandwidth = ahead->opcount;
+					_db.notify_update_bandwidth(note);
+				}
+				return;
+			}
+		}
+
+		// calls run without a memory limit, so they can reuse a pooled lua_State
+		contract_lua contract(op.contract_name, &_db.get_contract_lua_pool());
+		contract_call_profile_scope profile(_db, contract, op);
 		contract.set_database(&_db);
-		contract.set_abi(abi_method_names);
+		contract.set_abi(abi->method_names);
 		contract.set_extend(op.contract_name, op.caller);
 		contract.set_extend_arg(memory_limit, opcode_limit);
-		FC_ASSERT(contract.load(to_string(contract_data.code)), "load contract error");
+		if (contract_data.bytecode.size() > 0)
+			FC_ASSERT(contract.load_verified(contract_data.bytecode.data(), contract_data.bytecode.size(), version, cache), "load contract error");
+		else
+			FC_ASSERT(contract.load(to_string(contract_data.code), version, cache), "load contract error");
 
 		std::string result;
 		FC_ASSERT( contract.call_method(op.method, op_args, result), "call method error" );
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace gamebank { namespace chain {
+
+/**
+ * Counts the block and transaction ids and packed sizes computed while applying blocks and
+ * transactions. Ids are computed once per pushed object and handed down to the notifications,
+ * sizes are computed lazily by the notifications, so each counter grows by at most one per
+ * applied block or transaction.
+ */
+struct apply_counters
+{
+   std::atomic< uint64_t > block_ids{ 0 };
+   std::atomic< uint64_t > block_sizes{ 0 };
+   std::atomic< uint64_t > transaction_ids{ 0 };
+   std::atomic< uint64_t > transaction_sizes{ 0 };
+
+   static apply_counters& get()
+   {
+      static apply_counters counters;
+      return counters;
+   }
+};
+
+} }
@@ -31,6 +31,9 @@ namespace gamebank { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * Both files are read through memory mappings (see util::mapped_log_file) with the index used as a
+    * uint64_t array, so API and P2P threads read blocks in parallel without a lock while blocks are appended.
     */
 
    class block_log {
@@ -55,8 +58,7 @@ namespace gamebank { namespace chain {
          const optional< signed_block >& head()const;
 
          /*
-          * Used by the database to skip locking when reindexing
-          * APIs don't work at this point, so there is no danger.
+          * Reads no longer lock, kept for the database reindex path.
           */
          void set_locking( bool );
 
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <gamebank/chain/apply_counters.hpp>
 #include <gamebank/protocol/block.hpp>
 
+#include <fc/io/raw.hpp>
+
 namespace gamebank { namespace chain {
 
 struct block_notification
@@ -9,13 +12,33 @@ struct block_notification
    block_notification( const gamebank::protocol::signed_block& b ) : block(b)
    {
       block_id = b.id();
+      ++apply_counters::get().block_ids;
+      block_num = block_header::num_from_id( block_id );
+   }
+
+   block_notification( const gamebank::protocol::signed_block& b, const gamebank::protocol::block_id_type& id ) : block_id(id), block(b)
+   {
       block_num = block_header::num_from_id( block_id );
    }
 
+   /// fc::raw::pack_size( block ), computed on first use
+   uint32_t packed_size()const
+   {
+      if( !_packed_size )
+      {
+         _packed_size = fc::raw::pack_size( block );
+         ++apply_counters::get().block_sizes;
+      }
+      return *_packed_size;
+   }
+
    gamebank::protocol::block_id_type          block_id;
    uint32_t                                   block_num = 0;
    const gamebank::protocol::signed_block&    block;
    flat_map<transaction_id_type, string>      contract_return;
+
+   private:
+      mutable optional< uint32_t >            _packed_size;
 };
 
 } }
@@ -0,0 +1,68 @@
+#pragma once
+#include <gamebank/chain/block_log.hpp>
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gamebank { namespace chain {
+
+   /**
+    * A block read from the block log together with the values apply_block would otherwise
+    * compute from it on the apply thread.
+    */
+   struct decoded_block
+   {
+      signed_block                    block;
+      block_id_type                   id;
+      public_key_type                 signee;
+      checksum_type                   merkle_root;
+      vector< transaction_id_type >   transaction_ids;
+   };
+
+   /**
+    * Reads and decodes blocks [first, last] of a block log on worker threads during replay.
+    *
+    * Each worker takes the next block number, unpacks the block straight from the mapped log
+    * and computes its id, signee, merkle root and transaction ids. Results land in a ring of
+    * queue_size slots, workers never get more than queue_size blocks ahead of the consumer.
+    * next() hands the blocks out strictly in order, so the apply thread only applies state.
+    */
+   class block_replay_pipeline
+   {
+      public:
+         block_replay_pipeline( const block_log& log, uint32_t first, uint32_t last, uint32_t threads, uint32_t queue_size = 1024 );
+         ~block_replay_pipeline();
+
+         /// Blocks until the next block is decoded, null once last has been returned. Rethrows decoding errors.
+         std::shared_ptr< const decoded_block > next();
+
+      private:
+         struct slot
+         {
+            uint32_t                                  block_num = 0;
+            std::shared_ptr< const decoded_block >    block;
+            std::exception_ptr                        error;
+         };
+
+         void work();
+         std::shared_ptr< const decoded_block > decode( uint32_t block_num )const;
+
+         const block_log&              _log;
+         const uint32_t                _last;
+         std::vector< slot >           _slots;
+
+         std::mutex                    _mutex;
+         std::condition_variable       _ready;      ///< a slot was filled
+         std::condition_variable       _space;      ///< the consumer took a block
+         uint32_t                      _next_decode;
+         uint32_t                      _next_apply;
+         bool                          _stop = false;
+
+         std::vector< std::thread >    _threads;
+   };
+
+} }
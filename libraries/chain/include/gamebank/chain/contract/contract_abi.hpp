@@ -0,0 +1,43 @@
+#pragma once
+
+#include <fc/container/flat.hpp>
+#include <fc/variant.hpp>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace gamebank { namespace chain {
+
+	enum contract_abi_arg_type
+	{
+		contract_abi_uint64,
+		contract_abi_int64,
+		contract_abi_string,
+		contract_abi_object,
+		contract_abi_array,
+		contract_abi_unknown
+	};
+
+	/**
+	 * Method table parsed once from the JSON abi stored in contract_object::abi.
+	 *
+	 * A method name may appear more than once in the abi. Every signature listed for
+	 * it has to accept the call arguments, matching the original linear abi walk.
+	 */
+	struct contract_abi
+	{
+		typedef std::vector< contract_abi_arg_type > signature_type;
+
+		fc::flat_map< std::string, std::vector< signature_type > > methods;
+		std::set< std::string > method_names;
+
+		static contract_abi from_string(const std::string& abi);
+		static contract_abi_arg_type arg_type_from_string(const std::string& type);
+		static bool check_arg(const fc::variant& arg, contract_abi_arg_type type);
+
+		/// Asserts that method exists and args match all of its signatures
+		void check_call(const std::string& method, const fc::variants& args)const;
+	};
+
+}}
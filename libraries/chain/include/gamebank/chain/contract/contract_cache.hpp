@@ -0,0 +1,68 @@
+#pragma once
+
+#include <gamebank/chain/contract/contract_abi.hpp>
+#include <gamebank/protocol/types.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace gamebank { namespace chain {
+
+	using gamebank::protocol::account_name_type;
+	using gamebank::protocol::digest_type;
+
+	/**
+	 * Per-node cache of precompiled contract chunks and parsed abi method tables.
+	 *
+	 * Entries are keyed by contract name and tagged with contract_object::version. A lookup
+	 * only hits when the stored version matches, so a redeployed contract, or one created on
+	 * a fork we later switched away from, misses and is replaced. The cache is not part of
+	 * the chain state and never needs to be undone.
+	 */
+	class contract_cache {
+	public:
+		struct cache_stats
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t abi_hits = 0;
+			uint64_t abi_misses = 0;
+			uint64_t entries = 0;
+			uint64_t bytes = 0;
+		};
+
+		typedef std::shared_ptr< const std::string > bytecode_ptr;
+		typedef std::shared_ptr< const contract_abi > abi_ptr;
+
+		/// Returns nullptr when the contract is not cached at this version
+		bytecode_ptr get(const account_name_type& name, const digest_type& version);
+		void set(const account_name_type& name, const digest_type& version, std::string bytecode);
+
+		abi_ptr get_abi(const account_name_type& name, const digest_type& version);
+		abi_ptr set_abi(const account_name_type& name, const digest_type& version, contract_abi abi);
+		void erase(const account_name_type& name);
+		void clear();
+
+		cache_stats get_stats()const;
+
+		/// The value stored in contract_object::version for a contract's code and abi
+		static digest_type compute_version(const std::string& code, const std::string& abi);
+
+	private:
+		struct cache_entry
+		{
+			digest_type version;
+			bytecode_ptr bytecode;
+			abi_ptr abi;
+		};
+
+		cache_entry& get_entry(const account_name_type& name, const digest_type& version);
+
+		mutable std::mutex _mutex;
+		std::map< account_name_type, cache_entry > _entries;
+		cache_stats _stats;
+	};
+
+}}
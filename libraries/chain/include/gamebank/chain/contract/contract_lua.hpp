@@ -1,6 +1,9 @@
 #pragma once
 
 #include <gamebank/chain/contract/contract_interface.hpp>
+#include <gamebank/chain/contract/contract_cache.hpp>
+#include <gamebank/chain/contract/contract_lua_pool.hpp>
+#include <gamebank/chain/contract/contract_object.hpp>
 #include <gamebank/chain/database.hpp>
 
 // 50M
@@ -8,23 +11,40 @@
 
 namespace gamebank { namespace chain {
 
+	class contract_state;
 	namespace detail { class contract_lua_impl; }
 
 	class contract_lua : public contract_interface {
 	public:
-		contract_lua(account_name_type n);
+		/// Takes its lua_State from pool when given, otherwise builds and closes a private one
+		contract_lua(account_name_type n, contract_lua_pool* pool = nullptr);
 		~contract_lua();
 
 		virtual bool deploy(const std::string& data);
 		bool load(const std::string& data);
+		/// Same as load(data), but reuses the precompiled chunk cached for this contract version
+		bool load(const std::string& data, const digest_type& version, contract_cache& cache);
+		/// Compiles and checks data without running it, returns the chunk to store and what it uses
+		bool verify(const std::string& data, std::string& bytecode, contract_analysis& analysis);
+		/// Loads a chunk produced by verify(), skipping the checks it already passed
+		bool load_verified(const char* bytecode, size_t size, const digest_type& version, contract_cache& cache);
 
 		virtual bool call_method(const std::string& method, const variants& args, std::string& result);
 
+		/// Calls read and write db directly
 		void set_database(chain::database* db);
+		/// Calls go through state instead, which must outlive the contract
+		void set_state(contract_state* state);
+		/// method_names is referenced, not copied, and must outlive the contract
 		void set_abi(const std::set<std::string>& method_names);
 		void set_extend(const account_name_type& contract_name, const account_name_type& caller_name );
 		void set_extend_arg(int memory_limit, int opcode_limit);
 		int get_current_opcount();
+		/// Peak lua_State memory in KB since the last call_method started
+		int get_memory_peak();
+		/// Bytes of contract user data and storage read and written since the state was reset
+		int64_t get_storage_read_bytes();
+		int64_t get_storage_write_bytes();
 
 	private:
 		std::unique_ptr< detail::contract_lua_impl > my;
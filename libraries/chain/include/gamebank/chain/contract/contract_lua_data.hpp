@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+struct lua_State;
+
+namespace gamebank { namespace chain {
+
+/**
+ * Binary format for contract_user_object::data.
+ *
+ * Blobs start with GAMEBANK_CONTRACT_DATA_BINARY_TAG followed by a format version. That
+ * byte can never start a JSON text, so blobs written before the binary format are still
+ * read as JSON and are converted the next time the contract writes them.
+ *
+ * The encoder applies the same normalization as a cjson encode/decode round trip: sequences
+ * become arrays, other tables become objects with number keys turned into strings, floats
+ * go through their "%.14g" text form and nil array slots become the null lightuserdata.
+ * Contracts therefore read back exactly what they did when data was stored as JSON.
+ */
+#define GAMEBANK_CONTRACT_DATA_BINARY_TAG     '\xC1'
+#define GAMEBANK_CONTRACT_DATA_BINARY_VERSION 1
+
+	bool is_binary_contract_data(const char* data, size_t len);
+
+	/// Appends the binary form of the table at the top of the stack to out, asserts on unsupported values
+	void contract_data_encode(lua_State* L, std::string& out);
+
+	/// Pushes the table stored in data, binary or legacy JSON. Raises a Lua error on malformed input.
+	int contract_data_decode(lua_State* L, const char* data, size_t len);
+
+}}
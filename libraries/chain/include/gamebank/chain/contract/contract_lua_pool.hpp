@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+struct lua_State;
+
+#define GAMEBANK_CONTRACT_LUA_POOL_SIZE 16
+
+namespace gamebank { namespace chain {
+
+	/**
+	 * Pool of pre-initialized, sandboxed lua_State instances for contract calls.
+	 *
+	 * Every pooled state takes a snapshot of all tables reachable from its globals right
+	 * after the contract libraries are opened. On release the state is rolled back to that
+	 * snapshot, so functions, globals and library changes made by one contract never leak
+	 * into the next call. States that stopped on an extend error are closed instead of reused.
+	 *
+	 * The snapshot itself lives in the Lua heap, so pooled states must not be used where
+	 * the Lua memory limit is enforced (contract deploy).
+	 */
+	class contract_lua_pool {
+	public:
+		contract_lua_pool(size_t max_idle = GAMEBANK_CONTRACT_LUA_POOL_SIZE);
+		~contract_lua_pool();
+
+		lua_State* acquire();
+		void release(lua_State* L);
+
+		/// Creates a new state with the contract libraries opened, optionally with a pristine snapshot
+		static lua_State* create_state(bool with_snapshot = false);
+		/// Rolls a state created with a snapshot back to it, returns false if it can't be reused
+		static bool reset_state(lua_State* L);
+
+	private:
+		std::mutex _mutex;
+		std::vector< lua_State* > _idle;
+		size_t _max_idle;
+	};
+
+}}
@@ -9,6 +9,14 @@ namespace gamebank { namespace chain {
 using namespace std;
 using namespace gamebank::protocol;
 
+/// Static analysis of a contract chunk, computed while it is verified at deploy
+struct contract_analysis
+{
+	set< string > used_globals;			/// globals read, system libraries and abi methods
+	set< string > defined_globals;		/// globals assigned anywhere in the chunk
+	bool          has_on_deploy = false;
+};
+
 class contract_object : public object < contract_object_type, contract_object >
 {
 	contract_object() = delete;
@@ -16,7 +24,7 @@ class contract_object : public object < contract_object_type, contract_object >
 public:
 	template< typename Constructor, typename Allocator >
 	contract_object(Constructor&& c, allocator< Allocator > a)
-		:code(a), abi(a)
+		:code(a), abi(a), bytecode(a), analysis(a)
 	{
 		c(*this);
 	}
@@ -28,6 +36,8 @@ public:
 	digest_type		  version;
 	shared_string     code;			/// contract code
 	shared_string     abi;			/// abi data
+	shared_string     bytecode;		/// chunk verified at deploy, empty for contracts deployed before it was kept
+	shared_string     analysis;		/// packed contract_analysis of bytecode
 
     asset             balance = asset(0, GBC_SYMBOL);
 	time_point_sec    last_update;
@@ -54,8 +64,12 @@ typedef multi_index_container<
 
 FC_REFLECT( gamebank::chain::contract_object,
              (id)(name)(creator)(version)
-             (code)(abi)
+             (code)(abi)(bytecode)(analysis)
              (balance)(last_update)(created)
           )
 
+FC_REFLECT( gamebank::chain::contract_analysis,
+             (used_globals)(defined_globals)(has_on_deploy)
+          )
+
 CHAINBASE_SET_INDEX_TYPE( gamebank::chain::contract_object, gamebank::chain::contract_object_index)
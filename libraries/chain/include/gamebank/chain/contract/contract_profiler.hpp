@@ -0,0 +1,110 @@
+#pragma once
+
+#include <gamebank/protocol/types.hpp>
+
+#include <fc/reflect/reflect.hpp>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gamebank { namespace chain {
+
+	using gamebank::protocol::account_name_type;
+
+#define GAMEBANK_CONTRACT_PROFILER_BUCKETS        32
+
+	/// Cost of one contract_call applied as part of a block
+	struct contract_call_sample
+	{
+		account_name_type contract;
+		std::string       method;
+		bool              failed = false;
+		uint64_t          opcodes = 0;
+		uint64_t          memory_kb = 0;             ///< peak lua_State memory during the call
+		uint64_t          wall_time_us = 0;
+		uint64_t          storage_read_bytes = 0;
+		uint64_t          storage_write_bytes = 0;
+	};
+
+	/// Sums of the samples of one contract method over a short period, one block for statsd
+	struct contract_call_totals
+	{
+		uint64_t calls = 0;
+		uint64_t failures = 0;
+		uint64_t opcodes = 0;
+		uint64_t max_memory_kb = 0;
+		uint64_t wall_time_us = 0;
+		uint64_t storage_read_bytes = 0;
+		uint64_t storage_write_bytes = 0;
+	};
+
+	/**
+	 * Totals for one contract method. Histogram bucket i counts samples with a value
+	 * in [2^(i-1), 2^i), bucket 0 counts zeros.
+	 */
+	struct contract_method_profile
+	{
+		uint64_t calls = 0;
+		uint64_t failures = 0;
+		uint64_t opcodes = 0;
+		uint64_t max_opcodes = 0;
+		uint64_t max_memory_kb = 0;
+		uint64_t wall_time_us = 0;
+		uint64_t max_wall_time_us = 0;
+		uint64_t storage_read_bytes = 0;
+		uint64_t storage_write_bytes = 0;
+		std::vector< uint64_t > opcode_histogram;
+		std::vector< uint64_t > memory_histogram;
+		std::vector< uint64_t > wall_time_histogram;
+	};
+
+	/**
+	 * Node-side execution profile of contract calls, keyed by contract and method.
+	 *
+	 * Nothing here is chain state. Recording is off until enable() and only calls applied
+	 * from a block are counted, so a transaction is not counted again when it is included.
+	 */
+	class contract_profiler
+	{
+	public:
+		typedef std::map< std::pair< account_name_type, std::string >, contract_method_profile > profile_map;
+		typedef std::map< std::pair< account_name_type, std::string >, contract_call_totals >    totals_map;
+
+		contract_profiler() : _enabled(false) {}
+
+		void enable(bool enabled) { _enabled = enabled; }
+		bool enabled()const { return _enabled; }
+
+		void record(const contract_call_sample& sample);
+
+		/// Profiles of contract, or of every contract when contract is empty
+		profile_map get_profiles(const account_name_type& contract = account_name_type())const;
+
+		/// Totals of every method called since the last call, one entry per method however many calls
+		totals_map take_recent_totals();
+
+		void reset();
+
+		static uint32_t bucket(uint64_t value);
+
+	private:
+		std::atomic< bool >                  _enabled;
+		mutable std::mutex                   _mutex;
+		profile_map                          _profiles;
+		totals_map                           _recent;
+	};
+
+}}
+
+FC_REFLECT( gamebank::chain::contract_call_sample,
+            (contract)(method)(failed)(opcodes)(memory_kb)(wall_time_us)(storage_read_bytes)(storage_write_bytes) )
+
+FC_REFLECT( gamebank::chain::contract_call_totals,
+            (calls)(failures)(opcodes)(max_memory_kb)(wall_time_us)(storage_read_bytes)(storage_write_bytes) )
+
+FC_REFLECT( gamebank::chain::contract_method_profile,
+            (calls)(failures)(opcodes)(max_opcodes)(max_memory_kb)(wall_time_us)(max_wall_time_us)
+            (storage_read_bytes)(storage_write_bytes)(opcode_histogram)(memory_histogram)(wall_time_histogram) )
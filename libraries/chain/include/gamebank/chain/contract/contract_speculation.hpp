@@ -0,0 +1,159 @@
+#pragma once
+
+#include <gamebank/protocol/block.hpp>
+#include <gamebank/chain/contract/contract_state.hpp>
+#include <gamebank/chain/contract/contract_cache.hpp>
+#include <gamebank/chain/contract/contract_lua_pool.hpp>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// calls running longer than this ahead of their block are left to the apply thread
+#define GAMEBANK_CONTRACT_SPECULATIVE_OPCODE_LIMIT 100000000
+
+namespace gamebank { namespace chain {
+
+	using gamebank::protocol::contract_call_operation;
+
+	/**
+	 * Runs a contract call against the database as it was before the block's transactions,
+	 * without changing it.
+	 *
+	 * The first value read for every account, contract, user data, storage key and balance is
+	 * recorded, later reads see the call's own writes. Writes are kept in the order they were
+	 * made. Anything that can't be done this way, like reading blocks, marks the call unsupported.
+	 */
+	class speculative_contract_state : public contract_state
+	{
+	public:
+		explicit speculative_contract_state(const database& db) : _db(db) {}
+
+		virtual uint32_t head_block_num() override;
+		virtual fc::optional< signed_block > fetch_block_by_number(uint32_t num) override;
+
+		virtual bool is_account(const account_name_type& name) override;
+		virtual bool is_contract(const account_name_type& name) override;
+		virtual fc::optional< account_name_type > get_contract_creator(const account_name_type& name) override;
+
+		virtual bool find_user_data(const account_name_type& contract, const account_name_type& user, const char*& data, size_t& size) override;
+		virtual int64_t save_user_data(const account_name_type& contract, const account_name_type& user, const std::string& data) override;
+
+		virtual bool find_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const char*& value, size_t& size) override;
+		virtual int64_t set_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const std::string& value) override;
+		virtual int64_t remove_storage(const account_name_type& contract, const account_name_type& user, const std::string& key) override;
+
+		virtual asset get_balance(const account_name_type& name, asset_symbol_type symbol) override;
+		virtual asset get_contract_balance(const account_name_type& name, asset_symbol_type symbol) override;
+		virtual void adjust_balance(const account_name_type& name, const asset& delta) override;
+		virtual void adjust_contract_balance(const account_name_type& name, const asset& delta) override;
+
+		virtual void emit(const contract_log_operation& log) override;
+
+		bool unsupported()const { return _unsupported; }
+		/// True if db still returns every value the call read
+		bool validate(const database& db)const;
+		/// Makes the call's writes on state, in the order the call made them
+		void replay(contract_state& state)const;
+
+	private:
+		typedef std::pair< account_name_type, account_name_type >                user_key;
+		typedef std::tuple< account_name_type, account_name_type, std::string >  storage_key;
+
+		/// The value the call first read and the value it sees now
+		template< typename T >
+		struct tracked
+		{
+			T read;
+			T current;
+		};
+
+		tracked< fc::optional< std::string > >& user_data(const account_name_type& contract, const account_name_type& user);
+		tracked< fc::optional< std::string > >& storage(const account_name_type& contract, const account_name_type& user, const std::string& key);
+		tracked< fc::optional< asset > >& balance(const account_name_type& name);
+		tracked< fc::optional< asset > >& contract_balance(const account_name_type& name);
+
+		const database&                                                      _db;
+		std::map< account_name_type, bool >                                  _accounts;
+		std::map< account_name_type, fc::optional< account_name_type > >     _creators;
+		std::map< user_key, tracked< fc::optional< std::string > > >         _user_data;
+		std::map< storage_key, tracked< fc::optional< std::string > > >      _storage;
+		std::map< account_name_type, tracked< fc::optional< asset > > >      _balances;
+		std::map< account_name_type, tracked< fc::optional< asset > > >      _contract_balances;
+		std::vector< std::function< void( contract_state& ) > >              _writes;
+		bool                                                                 _unsupported = false;
+	};
+
+	/// A contract_call_operation of the block being applied and the outcome of running it ahead
+	struct speculative_contract_call
+	{
+		speculative_contract_call(const database& db, const contract_call_operation& o) : op(o), state(db) {}
+
+		contract_call_operation      op;
+		speculative_contract_state   state;
+
+		bool                         succeeded = false;
+		digest_type                  version;
+		std::string                  result;
+		int                          opcount = 0;
+		int                          memory_peak = 0;
+		int64_t                      wall_time_us = 0;
+		int64_t                      storage_read_bytes = 0;
+		int64_t                      storage_write_bytes = 0;
+	};
+
+	/**
+	 * Runs the contract calls of a block on worker threads before its transactions are applied,
+	 * then lets the evaluators commit them in block order.
+	 *
+	 * While the calls run the database is only read, the apply thread helps and waits for all
+	 * of them before it goes on. A call is committed by replaying its writes if every value it
+	 * read is unchanged, a call that conflicts with an earlier one or with any other operation
+	 * of the block is run again by its evaluator. Either way the state is the same as when the
+	 * calls are only run by the evaluators.
+	 */
+	class contract_speculator
+	{
+	public:
+		struct speculation_stats
+		{
+			uint64_t blocks = 0;
+			uint64_t calls = 0;
+			uint64_t committed = 0;
+			uint64_t reexecuted = 0;
+		};
+
+		contract_speculator(uint32_t threads, contract_cache& cache, contract_lua_pool& pool);
+		~contract_speculator();
+
+		/// Runs every contract call in block against db, returns when all of them are done
+		void run(const database& db, const protocol::signed_block& block);
+		/// The next call of the block if it is op, calls must be taken in block order
+		std::shared_ptr< speculative_contract_call > take(const contract_call_operation& op);
+		/// Replays the writes of call on db if it ran the contract at version and nothing it read changed since
+		bool commit(database& db, const speculative_contract_call& call, const digest_type& version, int opcode_limit);
+		void clear();
+
+		speculation_stats get_stats()const { return _stats; }
+
+	private:
+		void execute(const database& db, speculative_contract_call& call);
+
+		contract_cache&                                                _cache;
+		contract_lua_pool&                                             _pool;
+		uint32_t                                                       _thread_count;
+		boost::asio::io_service                                        _ios;
+		std::unique_ptr< boost::asio::io_service::work >               _work;
+		boost::thread_group                                            _threads;
+
+		std::vector< std::shared_ptr< speculative_contract_call > >    _calls;
+		size_t                                                         _next = 0;
+		speculation_stats                                              _stats;
+	};
+
+}}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <gamebank/protocol/asset.hpp>
+#include <gamebank/protocol/block.hpp>
+#include <gamebank/protocol/gamebank_virtual_operations.hpp>
+
+#include <fc/optional.hpp>
+
+#include <string>
+
+namespace gamebank { namespace chain {
+
+	using gamebank::protocol::account_name_type;
+	using gamebank::protocol::asset;
+	using gamebank::protocol::asset_symbol_type;
+	using gamebank::protocol::contract_log_operation;
+	using gamebank::protocol::signed_block;
+
+	class database;
+
+	/**
+	 * The chain state a contract call reads and writes. The contract and chain lua libraries
+	 * go through it instead of using the database directly.
+	 *
+	 * contract_database_state works on the database. speculative_contract_state reads the
+	 * database without changing it and keeps the writes to apply them later.
+	 */
+	class contract_state
+	{
+	public:
+		virtual ~contract_state() {}
+
+		virtual uint32_t head_block_num() = 0;
+		virtual fc::optional< signed_block > fetch_block_by_number(uint32_t num) = 0;
+
+		virtual bool is_account(const account_name_type& name) = 0;
+		virtual bool is_contract(const account_name_type& name) = 0;
+		virtual fc::optional< account_name_type > get_contract_creator(const account_name_type& name) = 0;
+
+		/// Points data at what the contract saved for user, returns false if it saved nothing
+		virtual bool find_user_data(const account_name_type& contract, const account_name_type& user, const char*& data, size_t& size) = 0;
+		/// Returns the number of bytes written, 0 if data equals what is saved
+		virtual int64_t save_user_data(const account_name_type& contract, const account_name_type& user, const std::string& data) = 0;
+
+		/// Points value at a key of the contract's storage for user, returns false if the key is not set
+		virtual bool find_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const char*& value, size_t& size) = 0;
+		/// Both return the number of bytes written
+		virtual int64_t set_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const std::string& value) = 0;
+		virtual int64_t remove_storage(const account_name_type& contract, const account_name_type& user, const std::string& key) = 0;
+
+		virtual asset get_balance(const account_name_type& name, asset_symbol_type symbol) = 0;
+		virtual asset get_contract_balance(const account_name_type& name, asset_symbol_type symbol) = 0;
+		virtual void adjust_balance(const account_name_type& name, const asset& delta) = 0;
+		virtual void adjust_contract_balance(const account_name_type& name, const asset& delta) = 0;
+
+		virtual void emit(const contract_log_operation& log) = 0;
+	};
+
+	class contract_database_state : public contract_state
+	{
+	public:
+		explicit contract_database_state(database& db) : _db(db) {}
+
+		virtual uint32_t head_block_num() override;
+		virtual fc::optional< signed_block > fetch_block_by_number(uint32_t num) override;
+
+		virtual bool is_account(const account_name_type& name) override;
+		virtual bool is_contract(const account_name_type& name) override;
+		virtual fc::optional< account_name_type > get_contract_creator(const account_name_type& name) override;
+
+		virtual bool find_user_data(const account_name_type& contract, const account_name_type& user, const char*& data, size_t& size) override;
+		virtual int64_t save_user_data(const account_name_type& contract, const account_name_type& user, const std::string& data) override;
+
+		virtual bool find_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const char*& value, size_t& size) override;
+		virtual int64_t set_storage(const account_name_type& contract, const account_name_type& user, const std::string& key, const std::string& value) override;
+		virtual int64_t remove_storage(const account_name_type& contract, const account_name_type& user, const std::string& key) override;
+
+		virtual asset get_balance(const account_name_type& name, asset_symbol_type symbol) override;
+		virtual asset get_contract_balance(const account_name_type& name, asset_symbol_type symbol) override;
+		virtual void adjust_balance(const account_name_type& name, const asset& delta) override;
+		virtual void adjust_contract_balance(const account_name_type& name, const asset& delta) override;
+
+		virtual void emit(const contract_log_operation& log) override;
+
+	private:
+		database& _db;
+	};
+
+}}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <boost/multi_index/composite_key.hpp>
+#include <gamebank/chain/gamebank_object_types.hpp>
+#include <gamebank/chain/comment_object.hpp>
+
+
+namespace gamebank { namespace chain {
+
+using namespace std;
+
+#define GAMEBANK_CONTRACT_STORAGE_MAX_KEY_LENGTH 256
+
+/**
+ * One key of a contract's per-user storage, written through contract.set/get/del.
+ *
+ * Unlike contract_user_object, which holds the whole user table as a single blob,
+ * changing a key only copies that row into the undo state. The value is stored in
+ * the contract_lua_data binary format.
+ */
+class contract_storage_object : public object < contract_storage_object_type, contract_storage_object >
+{
+	contract_storage_object() = delete;
+
+public:
+	template< typename Constructor, typename Allocator >
+	contract_storage_object(Constructor&& c, allocator< Allocator > a)
+		:key(a), value(a)
+	{
+		c(*this);
+	}
+
+	id_type           id;
+
+	account_name_type contract_name;
+	account_name_type user_name;
+	shared_string     key;
+	shared_string     value;
+
+	time_point_sec    last_update;
+	time_point_sec    created;
+};
+
+typedef oid< contract_storage_object > contract_storage_object_id_type;
+
+struct by_contract_user_key;
+typedef multi_index_container<
+	contract_storage_object,
+	indexed_by<
+	ordered_unique< tag< by_id >, member< contract_storage_object, contract_storage_object_id_type, &contract_storage_object::id > >,
+	ordered_unique< tag< by_contract_user_key >,
+	composite_key< contract_storage_object,
+	member< contract_storage_object, account_name_type, &contract_storage_object::contract_name>,
+	member< contract_storage_object, account_name_type, &contract_storage_object::user_name>,
+	member< contract_storage_object, shared_string, &contract_storage_object::key>
+	>,
+	composite_key_compare< std::less< account_name_type >, std::less< account_name_type >, strcmp_less >
+	>
+	>,
+	allocator< contract_storage_object >
+> contract_storage_object_index;
+
+
+}}// gamebank::chain
+
+FC_REFLECT( gamebank::chain::contract_storage_object,
+             (id)(contract_name)(user_name)
+             (key)(value)
+             (last_update)(created)
+          )
+
+CHAINBASE_SET_INDEX_TYPE( gamebank::chain::contract_storage_object, gamebank::chain::contract_storage_object_index)
@@ -7,6 +7,9 @@ void init_extend(lua_Extend* extend) {
 	extend->current_opcode_execute_count = 0;
 	extend->force_stop = 0;
 	extend->memory_limit = 0;
+	extend->memory_peak = 0;
+	extend->storage_read_bytes = 0;
+	extend->storage_write_bytes = 0;
 	extend->opcode_execute_limit = 0;
 	extend->opcode_limit = 0;
 	extend->error_no = LUA_EXTEND_OK;
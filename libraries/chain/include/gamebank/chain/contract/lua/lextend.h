@@ -12,11 +12,14 @@ typedef struct lua_Extend {
 	int opcode_execute_limit;
 	int current_opcode_execute_count;
 	int memory_limit;
+	int memory_peak;
 	int force_stop;
 	int error_no;
 	char contract_name[17];
 	char caller_name[17];
 	void* pointer;
+	long long storage_read_bytes;
+	long long storage_write_bytes;
 } lua_Extend;
 
 void init_extend(lua_Extend* extend);
@@ -31,6 +31,9 @@ namespace gamebank { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * Both files are read through memory mappings (see util::mapped_log_file), so lookups by number
+    * never reopen files or take a lock and any number of API threads can read while blocks are appended.
     */
 
    class contract_log {
@@ -4,6 +4,9 @@
 #pragma once
 #include <gamebank/chain/block_log.hpp>
 #include <gamebank/chain/contract_log.hpp>
+#include <gamebank/chain/contract/contract_cache.hpp>
+#include <gamebank/chain/contract/contract_lua_pool.hpp>
+#include <gamebank/chain/contract/contract_profiler.hpp>
 #include <gamebank/chain/block_notification.hpp>
 #include <gamebank/chain/fork_database.hpp>
 #include <gamebank/chain/global_property_object.hpp>
@@ -38,6 +41,9 @@ namespace gamebank { namespace chain {
    using abstract_plugin = appbase::abstract_plugin;
 
    class database_impl;
+   class contract_speculator;
+   class signature_recovery;
+   struct decoded_block;
    class custom_operation_interpreter;
 
    namespace util {
@@ -105,9 +111,14 @@ namespace gamebank { namespace chain {
             uint32_t chainbase_flags = 0;
             bool do_validate_invariants = false;
             bool benchmark_is_enabled = false;
+            uint32_t contract_speculation_threads = 0;   ///< 0 runs contract calls only when their transaction is applied
+            uint32_t signature_recovery_threads = 0;  ///< 0 recovers signature keys on the thread calling recover_signatures
 
             // The following fields are only used on reindexing
             uint32_t stop_replay_at = 0;
+            uint32_t replay_threads = 0;   ///< 0 reads and decodes each block on the apply thread
+            fc::path state_snapshot;       ///< start from this snapshot and replay only the blocks after it
+            uint32_t state_snapshot_threads = 0;
             TBenchmark benchmark = TBenchmark(0, []( uint32_t, const abstract_index_cntr_t& ){});
          };
 
@@ -233,7 +244,15 @@ namespace gamebank { namespace chain {
 
          bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
          void push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
-         void confirm_block( const signed_block& blk, uint32_t skip = skip_nothing);
+
+         /**
+          * Recovers the signature keys of a block's or a transaction's signatures ahead of push_block or
+          * push_transaction, so applying them only checks authorities. Does not need the write lock and
+          * may be called from other threads while the database is closed, it does nothing then.
+          */
+         void recover_signatures( const signed_block& b );
+         void recover_signatures( const signed_transaction& trx );
+         void confirm_block( const signed_block_header& header, uint32_t skip = skip_nothing);
          void _maybe_warn_multiple_production( uint32_t height )const;
          bool _push_block( const signed_block& b );
          void _push_transaction( const signed_transaction& trx );
@@ -472,12 +491,32 @@ namespace gamebank { namespace chain {
 
          const std::string& get_json_schema() const;
 
-         void set_flush_interval( uint32_t flush_blocks );
+         enum flush_mode
+         {
+            full_flush,          ///< msync the whole file at a random block near the end of every interval
+            incremental_flush    ///< write back 1/flush_blocks of the file per block on a background thread
+         };
+
+         void set_flush_interval( uint32_t flush_blocks, flush_mode mode = full_flush );
+
+         /// Time apply_block spent flushing the shared memory file for the last block
+         fc::microseconds get_last_flush_stall()const { return _last_flush_stall; }
          void check_free_memory( bool force_print, uint32_t current_block_num );
+         /// Lets chainbase grow the file as soon as it crosses the full threshold, also in the middle of a block
+         void update_shared_file_auto_grow();
 
          void contract_operation( const operation &op ) { _contract_operation.push_back(op); }
          void contract_return(const string& ret) { _contract_return[_contract_trxid] = ret; }
 
+         contract_cache& get_contract_cache() { return _contract_cache; }
+         const contract_cache& get_contract_cache()const { return _contract_cache; }
+         contract_lua_pool& get_contract_lua_pool() { return _contract_lua_pool; }
+         contract_profiler& get_contract_profiler() { return _contract_profiler; }
+         const contract_profiler& get_contract_profiler()const { return _contract_profiler; }
+         /// nullptr unless open_args::contract_speculation_threads was set
+         contract_speculator* get_contract_speculator() { return _contract_speculator.get(); }
+         const contract_speculator* get_contract_speculator()const { return _contract_speculator.get(); }
+
 #ifdef IS_TEST_NET
          bool liquidity_rewards_enabled = true;
          bool skip_price_feed_limit_check = true;
@@ -494,23 +533,26 @@ namespace gamebank { namespace chain {
          optional< chainbase::database::session > _pending_tx_session;
 
          void apply_block( const signed_block& next_block, uint32_t skip = skip_nothing );
+         /// For a block whose id is already known, e.g. from the fork database
+         void apply_block( const signed_block& next_block, const block_id_type& id, uint32_t skip );
          void apply_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
-         void _apply_block( const signed_block& next_block );
+         void _apply_block( const signed_block& next_block, const block_id_type& id );
          void _apply_transaction( const signed_transaction& trx );
+         void _apply_transaction( const signed_transaction& trx, const transaction_id_type& id );
          void apply_operation( const operation& op );
 
 
          ///Steps involved in applying a new block
          ///@{
 
-         const witness_object& validate_block_header( uint32_t skip, const signed_block& next_block )const;
-         void create_block_summary(const signed_block& next_block);
+         const witness_object& validate_block_header( uint32_t skip, const signed_block_header& next_block )const;
+         void create_block_summary(const signed_block& next_block, const block_id_type& id);
 
          void clear_null_account_balance();
 
          void update_global_dynamic_data( const signed_block& b );
          void update_signing_witness(const witness_object& signing_witness, const signed_block& new_block);
-         void update_confirm_witness(const witness_object& confirm_witness, const signed_block& new_block);
+         void update_confirm_witness(const witness_object& confirm_witness, const signed_block_header& new_block);
          void update_last_irreversible_block();
          void clear_expired_transactions();
          void clear_expired_orders();
@@ -541,6 +583,11 @@ namespace gamebank { namespace chain {
          vector<operation>                        _contract_operation;
          flat_map<uint64_t, signed_contract>      _contract_block;
          flat_map<transaction_id_type, string>    _contract_return;
+         contract_cache                           _contract_cache;
+         contract_lua_pool                        _contract_lua_pool;
+         contract_profiler                        _contract_profiler;
+         std::unique_ptr< contract_speculator >   _contract_speculator;
+         std::shared_ptr< signature_recovery >    _signature_recovery;   ///< read and replaced with std::atomic_load/atomic_store, recover_signatures is called from other threads
 
          // this function needs access to _plugin_index_signal
          template< typename MultiIndexType >
@@ -553,6 +600,8 @@ namespace gamebank { namespace chain {
          uint16_t                      _current_virtual_op   = 0;
 
          optional< block_id_type >     _currently_processing_block_id;
+         /// set during a pipelined replay, holds the precomputed ids of the block being applied
+         const decoded_block*          _decoded_block = nullptr;
 
          flat_map<uint32_t,block_id_type>  _checkpoints;
 
@@ -560,8 +609,11 @@ namespace gamebank { namespace chain {
 
          uint32_t                      _flush_blocks = 0;
          uint32_t                      _next_flush_block = 0;
+         flush_mode                    _flush_mode = full_flush;
+         fc::microseconds              _last_flush_stall;
 
          uint32_t                      _last_free_gb_printed = 0;
+         uint64_t                      _last_shared_file_size = 0;
          
          uint32_t                      _next_available_nai = GB_MIN_NON_RESERVED_NAI;
 
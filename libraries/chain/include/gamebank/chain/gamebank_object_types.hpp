@@ -72,7 +72,8 @@ enum object_type
    nonfungible_fund_object_type,
    nonfungible_fund_on_sale_object_type,
    contract_object_type,
-   contract_user_object_type
+   contract_user_object_type,
+   contract_storage_object_type
 };
 
 class dynamic_global_property_object;
@@ -111,6 +112,7 @@ class nonfungible_fund_object;
 class nonfungible_fund_on_sale_object;
 class contract_object;
 class contract_user_object;
+class contract_storage_object;
 
 typedef oid< dynamic_global_property_object         > dynamic_global_property_id_type;
 typedef oid< account_object                         > account_id_type;
@@ -205,6 +207,63 @@ namespace fc
       } FC_RETHROW_EXCEPTIONS( warn, "error unpacking ${type}", ("type",fc::get_typename<T>::name() ) ) }
 #endif
    }
+
+   /*
+    * Packing whole objects (state snapshots) reaches members through the reflection visitors,
+    * which only see the fc::raw overloads declared before fc/io/raw.hpp. For any other class
+    * fc::raw falls back to these stream operators, found by argument dependent lookup.
+    */
+   template<typename ST, typename T>
+   inline datastream<ST>& operator<<( datastream<ST>& ds, const chainbase::oid<T>& id )
+   {
+      ds.write( (const char*)&id._id, sizeof(id._id) );
+      return ds;
+   }
+   template<typename ST, typename T>
+   inline datastream<ST>& operator>>( datastream<ST>& ds, chainbase::oid<T>& id )
+   {
+      ds.read( (char*)&id._id, sizeof(id._id) );
+      return ds;
+   }
+#ifndef ENABLE_STD_ALLOCATOR
+   template<typename ST>
+   inline datastream<ST>& operator<<( datastream<ST>& ds, const gamebank::chain::shared_string& ss )
+   {
+      fc::raw::pack( ds, unsigned_int( (uint32_t)ss.size() ) );
+      if( ss.size() )
+         ds.write( ss.data(), ss.size() );
+      return ds;
+   }
+   template<typename ST>
+   inline datastream<ST>& operator>>( datastream<ST>& ds, gamebank::chain::shared_string& ss )
+   {
+      unsigned_int size;
+      fc::raw::unpack( ds, size );
+      ss.resize( size.value );
+      if( size.value )
+         ds.read( &ss[0], size.value );
+      return ds;
+   }
+   template<typename ST, typename T, typename A>
+   inline datastream<ST>& operator<<( datastream<ST>& ds, const boost::interprocess::deque< T, A >& d )
+   {
+      fc::raw::pack( ds, unsigned_int( (uint32_t)d.size() ) );
+      for( const auto& item : d )
+         fc::raw::pack( ds, item );
+      return ds;
+   }
+   template<typename ST, typename T, typename A>
+   inline datastream<ST>& operator>>( datastream<ST>& ds, boost::interprocess::deque< T, A >& d )
+   {
+      unsigned_int size;
+      fc::raw::unpack( ds, size );
+      d.clear();
+      d.resize( size.value );
+      for( auto& item : d )
+         fc::raw::unpack( ds, item );
+      return ds;
+   }
+#endif
 }
 
 FC_REFLECT_ENUM( gamebank::chain::object_type,
@@ -244,6 +303,7 @@ FC_REFLECT_ENUM( gamebank::chain::object_type,
                  (nonfungible_fund_on_sale_object_type)
 				 (contract_object_type)
 	             (contract_user_object_type)
+	             (contract_storage_object_type)
 
                )
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gamebank/chain/database.hpp>
+#include <gamebank/chain/state_snapshot.hpp>
 
 namespace gamebank { namespace chain {
 
@@ -8,6 +9,7 @@ template< typename MultiIndexType >
 void _add_index_impl( database& db )
 {
    db.add_index< MultiIndexType >();
+   db.add_index_extension< MultiIndexType >( std::make_shared< state_snapshot_support_impl< MultiIndexType > >( db ) );
 }
 
 template< typename MultiIndexType >
@@ -0,0 +1,59 @@
+#pragma once
+#include <gamebank/protocol/block.hpp>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace gamebank { namespace chain {
+
+   using namespace gamebank::protocol;
+
+   /**
+    * Recovers the public keys of transaction signatures before the transactions reach the
+    * write thread, so _apply_transaction only checks authorities while the write lock is held.
+    *
+    * The keys of a block's transactions are recovered in parallel on a worker pool. Results are
+    * kept in a bounded cache keyed by transaction id together with the signatures they were
+    * recovered from, a transaction that is not found, or whose signatures changed, is recovered
+    * by verify_authority as before.
+    */
+   class signature_recovery
+   {
+      public:
+         /// With 0 threads keys are recovered on the calling thread
+         signature_recovery( uint32_t threads, uint32_t cache_size = 65536 );
+         ~signature_recovery();
+
+         /// Recovers the keys of every transaction in block and returns when all are cached
+         void recover( const chain_id_type& chain_id, const signed_block& block );
+         void recover( const chain_id_type& chain_id, const signed_transaction& trx );
+
+         /// Keys recovered for trx, false when they have to be recovered again
+         bool find( const transaction_id_type& id, const signed_transaction& trx, flat_set< public_key_type >& keys )const;
+
+      private:
+         struct entry
+         {
+            vector< signature_type >       signatures;
+            flat_set< public_key_type >    keys;
+         };
+
+         void recover_one( const chain_id_type& chain_id, const signed_transaction& trx );
+
+         const uint32_t                                        _cache_size;
+         mutable std::mutex                                    _mutex;
+         std::map< transaction_id_type, entry >                _cache;
+         std::deque< transaction_id_type >                     _order;   ///< insertion order, oldest evicted first
+
+         boost::asio::io_service                               _ios;
+         std::unique_ptr< boost::asio::io_service::work >      _work;
+         boost::thread_group                                   _threads;
+         uint32_t                                              _thread_count;
+   };
+
+} }
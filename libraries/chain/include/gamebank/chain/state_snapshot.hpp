@@ -0,0 +1,113 @@
+#pragma once
+
+#include <gamebank/chain/database.hpp>
+
+#include <fc/io/raw.hpp>
+
+namespace gamebank { namespace chain {
+
+   /**
+    * Index extension letting a state snapshot dump and load an index without knowing its type.
+    * index.hpp attaches one to every core and plugin index.
+    */
+   class state_snapshot_support : public chainbase::index_extension
+   {
+      public:
+         virtual ~state_snapshot_support() {}
+
+         virtual std::string name()const = 0;
+
+         /// Packs every object in id order, returns the number of objects
+         virtual uint64_t dump( std::vector< char >& out )const = 0;
+
+         /// The id the next created object gets, which can be past the last object if objects were removed
+         virtual int64_t next_id()const = 0;
+
+         /**
+          * Removes every object, must be called by the thread holding the write lock before load().
+          * The index is looked up here, the database must not be resized between clear() and load().
+          */
+         virtual void clear() = 0;
+
+         /// Unpacks count objects written by dump() and restores next_id, different indices may be loaded concurrently
+         virtual void load( const char* data, size_t size, uint64_t count, int64_t next_id ) = 0;
+   };
+
+   template< typename MultiIndexType >
+   class state_snapshot_support_impl : public state_snapshot_support
+   {
+      public:
+         typedef typename MultiIndexType::value_type value_type;
+
+         state_snapshot_support_impl( database& db ) : _db( db ) {}
+
+         virtual std::string name()const override
+         {
+            return fc::get_typename< value_type >::name();
+         }
+
+         virtual uint64_t dump( std::vector< char >& out )const override
+         {
+            const auto& idx = _db.get_index< MultiIndexType >().indices();
+
+            size_t size = 0;
+            for( const auto& o : idx )
+               size += fc::raw::pack_size( o );
+
+            out.resize( size );
+            fc::datastream< char* > ds( out.data(), out.size() );
+            for( const auto& o : idx )
+               fc::raw::pack( ds, o );
+
+            return idx.size();
+         }
+
+         virtual int64_t next_id()const override
+         {
+            return _db.get_index< MultiIndexType >().next_id()._id;
+         }
+
+         virtual void clear() override
+         {
+            _index = &_db.get_mutable_index< MultiIndexType >();
+            _index->clear();
+         }
+
+         virtual void load( const char* data, size_t size, uint64_t count, int64_t next_id ) override
+         {
+            FC_ASSERT( _index != nullptr, "${n} was not cleared before loading", ("n", name()) );
+
+            fc::datastream< const char* > ds( data, size );
+            for( uint64_t i = 0; i < count; ++i )
+               _index->load( [&]( value_type& o ) { fc::raw::unpack( ds, o ); } );
+
+            FC_ASSERT( ds.remaining() == 0, "${n} has ${r} bytes left after loading ${c} objects",
+               ("n", name())("r", ds.remaining())("c", count) );
+            _index->set_next_id( next_id );
+            _index = nullptr;
+         }
+
+      private:
+         database&                                 _db;
+         chainbase::generic_index< MultiIndexType >* _index = nullptr;
+   };
+
+   /**
+    * Writes the state of every index to file together with the chain id and head block.
+    *
+    * Indices are packed and hashed on up to threads threads and written in the order they
+    * finish. The caller must hold the read lock.
+    */
+   void write_state_snapshot( const database& db, const fc::path& file, uint32_t threads );
+
+   /**
+    * Replaces the state of every index with the contents of a file written by write_state_snapshot.
+    *
+    * The database must have no undo state and the caller must hold the write lock. Every section
+    * is verified before any index is cleared, so a corrupt or truncated file leaves the state as it
+    * was. Sections are verified and loaded on up to threads threads. Returns the head block number
+    * of the snapshot.
+    */
+   uint32_t read_state_snapshot( database& db, const fc::path& file, uint32_t threads );
+
+} } // gamebank::chain
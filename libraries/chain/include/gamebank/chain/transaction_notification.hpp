@@ -1,7 +1,10 @@
 #pragma once
 
+#include <gamebank/chain/apply_counters.hpp>
 #include <gamebank/protocol/block.hpp>
 
+#include <fc/io/raw.hpp>
+
 namespace gamebank { namespace chain {
 
 struct transaction_notification
@@ -9,10 +12,27 @@ struct transaction_notification
    transaction_notification( const gamebank::protocol::signed_transaction& tx ) : transaction(tx)
    {
       transaction_id = tx.id();
+      ++apply_counters::get().transaction_ids;
+   }
+
+   transaction_notification( const gamebank::protocol::signed_transaction& tx, const gamebank::protocol::transaction_id_type& id ) : transaction_id(id), transaction(tx) {}
+
+   /// fc::raw::pack_size( transaction ), computed on first use
+   uint32_t packed_size()const
+   {
+      if( !_packed_size )
+      {
+         _packed_size = fc::raw::pack_size( transaction );
+         ++apply_counters::get().transaction_sizes;
+      }
+      return *_packed_size;
    }
 
    gamebank::protocol::transaction_id_type          transaction_id;
    const gamebank::protocol::signed_transaction&    transaction;
+
+   private:
+      mutable optional< uint32_t >                  _packed_size;
 };
 
 } }
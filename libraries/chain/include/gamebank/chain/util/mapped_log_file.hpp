@@ -0,0 +1,103 @@
+#pragma once
+
+#include <fc/filesystem.hpp>
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace gamebank { namespace chain { namespace util {
+
+/**
+ * An append only file with one writer and lock free readers.
+ *
+ * Appends go through a write only stream and become visible to readers once append()
+ * returns. Readers access the file through a read only memory mapping which is replaced
+ * when they reach past its end. Mappings are reference counted, a reader keeps the one it
+ * started with alive until it is done, so remapping never invalidates data in use.
+ *
+ * Shrinking the file would turn reads through an existing mapping into SIGBUS, so truncate()
+ * waits until every mapping has been released before it touches the file.
+ */
+class mapped_log_file
+{
+   public:
+      struct region
+      {
+         boost::interprocess::file_mapping   file;
+         boost::interprocess::mapped_region  map;
+         const char*                         data = nullptr;
+         uint64_t                            size = 0;
+      };
+
+      typedef std::shared_ptr< const region > region_ptr;
+
+      /// Bytes [data, data + size) stay valid as long as the view is held
+      struct view
+      {
+         region_ptr     keep;
+         const char*    data = nullptr;
+         uint64_t       size = 0;
+      };
+
+      mapped_log_file() : _size( 0 ), _live_regions( std::make_shared< std::atomic< uint32_t > >( 0 ) ) {}
+
+      void open( const fc::path& file );
+      void close();
+      bool is_open()const { return _out.is_open(); }
+
+      /// Bytes appended so far, readers never see past this
+      uint64_t size()const { return _size.load( std::memory_order_acquire ); }
+
+      void append( const char* data, size_t len );
+      void flush();
+      /**
+       * Drops the contents of the file. Blocks until no reader holds a view, readers starting
+       * meanwhile wait for it to finish and then see an empty file. Must not be called from a
+       * thread that holds a view itself.
+       */
+      void truncate();
+
+      /// Everything from pos to the end of the file
+      view read( uint64_t pos )const;
+
+      template< typename T >
+      T read_pod( uint64_t pos )const
+      {
+         view v = read( pos );
+         FC_ASSERT( v.size >= sizeof( T ), "Read past the end of ${f}", ("f", _path.generic_string()) );
+         T result;
+         memcpy( &result, v.data, sizeof( T ) );
+         return result;
+      }
+
+      /// Unpacks a T stored at pos and returns the position just after it
+      template< typename T >
+      uint64_t unpack( uint64_t pos, T& result )const
+      {
+         view v = read( pos );
+         fc::datastream< const char* > ds( v.data, v.size );
+         fc::raw::unpack( ds, result );
+         return pos + ds.tellp();
+      }
+
+   private:
+      region_ptr map_at_least( uint64_t size )const;
+
+      fc::path                        _path;
+      std::ofstream                   _out;
+      std::atomic< uint64_t >         _size;
+
+      mutable std::mutex              _map_mutex;
+      mutable region_ptr              _region;
+      /// Mappings not yet unmapped, shared with them as views may outlive this object
+      std::shared_ptr< std::atomic< uint32_t > > _live_regions;
+};
+
+} } } // gamebank::chain::util
@@ -0,0 +1,109 @@
+#include <gamebank/chain/signature_recovery.hpp>
+
+#include <boost/bind.hpp>
+
+#include <atomic>
+#include <condition_variable>
+
+namespace gamebank { namespace chain {
+
+   signature_recovery::signature_recovery( uint32_t threads, uint32_t cache_size )
+   : _cache_size( std::max< uint32_t >( cache_size, 1 ) ), _work( new boost::asio::io_service::work( _ios ) ), _thread_count( threads )
+   {
+      for( uint32_t i = 0; i < threads; ++i )
+         _threads.create_thread( boost::bind( &boost::asio::io_service::run, &_ios ) );
+   }
+
+   signature_recovery::~signature_recovery()
+   {
+      _work.reset();
+      _ios.stop();
+      _threads.join_all();
+   }
+
+   void signature_recovery::recover( const chain_id_type& chain_id, const signed_block& block )
+   {
+      if( _thread_count == 0 || block.transactions.size() < 2 )
+      {
+         for( const auto& trx : block.transactions )
+            recover_one( chain_id, trx );
+         return;
+      }
+
+      std::mutex done_mutex;
+      std::condition_variable done;
+      size_t remaining = block.transactions.size();
+
+      for( const auto& trx : block.transactions )
+      {
+         _ios.post( [&]()
+         {
+            recover_one( chain_id, trx );
+
+            std::lock_guard< std::mutex > guard( done_mutex );
+            if( --remaining == 0 )
+               done.notify_one();
+         } );
+      }
+
+      std::unique_lock< std::mutex > lock( done_mutex );
+      done.wait( lock, [&]() { return remaining == 0; } );
+   }
+
+   void signature_recovery::recover( const chain_id_type& chain_id, const signed_transaction& trx )
+   {
+      recover_one( chain_id, trx );
+   }
+
+   bool signature_recovery::find( const transaction_id_type& id, const signed_transaction& trx, flat_set< public_key_type >& keys )const
+   {
+      std::lock_guard< std::mutex > guard( _mutex );
+      auto itr = _cache.find( id );
+      if( itr == _cache.end() || itr->second.signatures != trx.signatures )
+         return false;
+
+      keys = itr->second.keys;
+      return true;
+   }
+
+   void signature_recovery::recover_one( const chain_id_type& chain_id, const signed_transaction& trx )
+   {
+      entry e;
+      auto id = trx.id();
+      {
+         // already recovered, e.g. when the p2p layer decoded the transaction
+         std::lock_guard< std::mutex > guard( _mutex );
+         auto itr = _cache.find( id );
+         if( itr != _cache.end() && itr->second.signatures == trx.signatures )
+            return;
+      }
+
+      try
+      {
+         e.keys = trx.get_signature_keys( chain_id );
+      }
+      catch( const fc::exception& )
+      {
+         // duplicate or malformed signatures, verify_authority reports them on the write thread
+         return;
+      }
+      e.signatures = trx.signatures;
+
+      std::lock_guard< std::mutex > guard( _mutex );
+      auto itr = _cache.find( id );
+      if( itr != _cache.end() )
+      {
+         itr->second = std::move( e );
+         return;
+      }
+
+      _cache.emplace( id, std::move( e ) );
+      _order.push_back( id );
+      if( _order.size() > _cache_size )
+      {
+         _cache.erase( _order.front() );
+         _order.pop_front();
+      }
+   }
+
+} }
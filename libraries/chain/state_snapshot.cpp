@@ -0,0 +1,257 @@
+#include <gamebank/chain/state_snapshot.hpp>
+
+#include <fc/crypto/sha256.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace gamebank { namespace chain {
+
+   namespace detail {
+
+      const uint32_t state_snapshot_magic   = 0x534b4247;   // "GBKS"
+      const uint32_t state_snapshot_version = 3;
+
+      struct snapshot_header
+      {
+         uint32_t       magic = state_snapshot_magic;
+         uint32_t       version = state_snapshot_version;
+         chain_id_type  chain_id;
+         uint32_t       head_block_num = 0;
+         block_id_type  head_block_id;
+         uint32_t       section_count = 0;
+      };
+
+      /**
+       * One per index, followed by size bytes of packed objects. next_id is the id the next created object
+       * gets, it is past the last object when the highest ids were removed. checksum covers count, next_id
+       * and the objects
+       */
+      struct snapshot_section
+      {
+         std::string    name;
+         uint64_t       count = 0;
+         int64_t        next_id = 0;
+         uint64_t       size = 0;
+         fc::sha256     checksum;
+      };
+
+      /// Runs job( i ) for every i in [0, n) on up to threads threads and rethrows the first error
+      template< typename Job >
+      void run_parallel( size_t n, uint32_t threads, Job&& job )
+      {
+         std::atomic< size_t > next( 0 );
+         std::exception_ptr error;
+         std::mutex error_mutex;
+
+         auto work = [&]()
+         {
+            for( size_t i = next++; i < n; i = next++ )
+            {
+               try
+               {
+                  job( i );
+               }
+               catch( ... )
+               {
+                  std::lock_guard< std::mutex > guard( error_mutex );
+                  if( !error )
+                     error = std::current_exception();
+                  next = n;
+               }
+            }
+         };
+
+         std::vector< std::thread > workers;
+         for( uint32_t t = 1; t < std::min< size_t >( std::max< uint32_t >( threads, 1 ), n ); ++t )
+            workers.emplace_back( work );
+         work();
+         for( auto& w : workers )
+            w.join();
+
+         if( error )
+            std::rethrow_exception( error );
+      }
+
+      fc::sha256 section_checksum( uint64_t count, int64_t next_id, const char* data, size_t size )
+      {
+         fc::sha256::encoder enc;
+         fc::raw::pack( enc, count );
+         fc::raw::pack( enc, next_id );
+         // the encoder takes 32 bit lengths
+         for( size_t done = 0; done < size; )
+         {
+            uint32_t len = uint32_t( std::min< size_t >( size - done, 1u << 30 ) );
+            enc.write( data + done, len );
+            done += len;
+         }
+         return enc.result();
+      }
+
+      std::vector< std::shared_ptr< state_snapshot_support > > get_snapshot_indices( const database& db )
+      {
+         std::vector< std::shared_ptr< state_snapshot_support > > result;
+         db.for_each_index_extension< state_snapshot_support >( [&]( std::shared_ptr< state_snapshot_support > ext )
+         {
+            result.push_back( ext );
+         });
+         return result;
+      }
+   }
+
+} } // gamebank::chain
+
+FC_REFLECT( gamebank::chain::detail::snapshot_header, (magic)(version)(chain_id)(head_block_num)(head_block_id)(section_count) )
+FC_REFLECT( gamebank::chain::detail::snapshot_section, (name)(count)(next_id)(size)(checksum) )
+
+namespace gamebank { namespace chain {
+
+   void write_state_snapshot( const database& db, const fc::path& file, uint32_t threads )
+   {
+      try
+      {
+         auto start = fc::time_point::now();
+         auto indices = detail::get_snapshot_indices( db );
+
+         detail::snapshot_header header;
+         header.chain_id = db.get_chain_id();
+         header.head_block_num = db.head_block_num();
+         header.head_block_id = db.head_block_id();
+         header.section_count = indices.size();
+
+         fc::path temp = file.generic_string() + ".tmp";
+         std::ofstream out;
+         out.exceptions( std::ofstream::failbit | std::ofstream::badbit );
+         out.open( temp.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+
+         auto packed_header = fc::raw::pack_to_vector( header );
+         out.write( packed_header.data(), packed_header.size() );
+
+         std::mutex out_mutex;
+         uint64_t total = 0;
+
+         // sections go to the file in the order they finish, the reader matches them by name
+         detail::run_parallel( indices.size(), threads, [&]( size_t i )
+         {
+            std::vector< char > data;
+            detail::snapshot_section section;
+            section.name = indices[i]->name();
+            section.count = indices[i]->dump( data );
+            section.next_id = indices[i]->next_id();
+            section.size = data.size();
+            section.checksum = detail::section_checksum( section.count, section.next_id, data.data(), data.size() );
+
+            auto packed_section = fc::raw::pack_to_vector( section );
+
+            std::lock_guard< std::mutex > guard( out_mutex );
+            out.write( packed_section.data(), packed_section.size() );
+            out.write( data.data(), data.size() );
+            total += data.size();
+         });
+
+         out.close();
+         fc::rename( temp, file );
+
+         ilog( "Wrote state snapshot of block ${b} to ${f}, ${s} MB in ${t} ms",
+            ("b", header.head_block_num)("f", file.generic_string())("s", total / ( 1024 * 1024 ))
+            ("t", ( fc::time_point::now() - start ).count() / 1000) );
+      }
+      FC_CAPTURE_AND_RETHROW( (file) )
+   }
+
+   uint32_t read_state_snapshot( database& db, const fc::path& file, uint32_t threads )
+   {
+      try
+      {
+         namespace bip = boost::interprocess;
+
+         auto start = fc::time_point::now();
+         FC_ASSERT( fc::exists( file ), "State snapshot ${f} does not exist", ("f", file.generic_string()) );
+
+         bip::file_mapping mapping( file.generic_string().c_str(), bip::read_only );
+         bip::mapped_region region( mapping, bip::read_only );
+         fc::datastream< const char* > ds( static_cast< const char* >( region.get_address() ), region.get_size() );
+
+         detail::snapshot_header header;
+         fc::raw::unpack( ds, header );
+         FC_ASSERT( header.magic == detail::state_snapshot_magic, "${f} is not a state snapshot", ("f", file.generic_string()) );
+         FC_ASSERT( header.version == detail::state_snapshot_version, "Unsupported state snapshot version ${v}", ("v", header.version) );
+         FC_ASSERT( header.chain_id == db.get_chain_id(), "State snapshot is from a different chain",
+            ("snapshot", header.chain_id)("chain", db.get_chain_id()) );
+
+         std::map< std::string, std::shared_ptr< state_snapshot_support > > by_name;
+         for( auto& ext : detail::get_snapshot_indices( db ) )
+            by_name[ ext->name() ] = ext;
+
+         struct loaded_section
+         {
+            detail::snapshot_section                  section;
+            const char*                               data = nullptr;
+            std::shared_ptr< state_snapshot_support > index;
+         };
+
+         std::vector< loaded_section > sections( header.section_count );
+         uint64_t total = 0;
+         for( auto& s : sections )
+         {
+            fc::raw::unpack( ds, s.section );
+            FC_ASSERT( s.section.size <= size_t( ds.remaining() ), "State snapshot is truncated in ${n}", ("n", s.section.name) );
+
+            auto itr = by_name.find( s.section.name );
+            FC_ASSERT( itr != by_name.end(), "State snapshot contains ${n} which is not registered, was it written with other plugins enabled?",
+               ("n", s.section.name) );
+            s.index = itr->second;
+            by_name.erase( itr );
+
+            s.data = ds.pos();
+            ds.skip( s.section.size );
+            total += s.section.size;
+         }
+         FC_ASSERT( by_name.empty(), "State snapshot is missing ${n}", ("n", by_name.begin()->first) );
+
+         // nothing is touched before every section checked out, a bad snapshot leaves the state as it was
+         detail::run_parallel( sections.size(), threads, [&]( size_t i )
+         {
+            const auto& s = sections[i];
+            FC_ASSERT( detail::section_checksum( s.section.count, s.section.next_id, s.data, s.section.size ) == s.section.checksum,
+               "State snapshot section ${n} is corrupted", ("n", s.section.name) );
+         });
+
+         // objects take more room in shared memory than packed, grow the file once up front. Growing
+         // may remap the file, so the indices are only looked up by clear() afterwards
+         size_t needed = total * 3;
+         if( db.get_free_memory() < needed )
+         {
+            size_t new_size = db.get_max_memory() + needed - db.get_free_memory();
+            ilog( "Growing shared memory to ${s} MB to load the state snapshot", ("s", new_size / ( 1024 * 1024 )) );
+            db.resize( new_size );
+         }
+
+         for( auto& s : sections )
+            s.index->clear();
+
+         detail::run_parallel( sections.size(), threads, [&]( size_t i )
+         {
+            const auto& s = sections[i];
+            s.index->load( s.data, s.section.size, s.section.count, s.section.next_id );
+         });
+
+         FC_ASSERT( db.head_block_num() == header.head_block_num && db.head_block_id() == header.head_block_id,
+            "Loaded state does not match the state snapshot header" );
+
+         ilog( "Loaded state snapshot of block ${b}, ${s} MB in ${t} ms",
+            ("b", header.head_block_num)("s", total / ( 1024 * 1024 ))("t", ( fc::time_point::now() - start ).count() / 1000) );
+
+         return header.head_block_num;
+      }
+      FC_CAPTURE_AND_RETHROW( (file) )
+   }
+
+} } // gamebank::chain
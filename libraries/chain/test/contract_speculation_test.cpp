@@ -0,0 +1,113 @@
+#include <boost/test/unit_test.hpp>
+
+#include <gamebank/chain/contract/contract_speculation.hpp>
+#include <gamebank/chain/database.hpp>
+#include <gamebank/chain/state_snapshot.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace gamebank::chain;
+using namespace gamebank::protocol;
+
+static const uint32_t speculation_test_skip =
+   database::skip_witness_signature | database::skip_transaction_signatures | database::skip_tapos_check |
+   database::skip_authority_check | database::skip_transaction_dupe_check;
+
+static database::open_args speculation_test_args( const fc::path& dir, uint32_t threads )
+{
+   database::open_args args;
+   args.data_dir = dir;
+   args.shared_mem_dir = dir / "blockchain";
+   args.shared_file_size = 1024*1024*64;
+   args.contract_speculation_threads = threads;
+   return args;
+}
+
+static void push_operation( database& db, const operation& op, uint32_t n )
+{
+   signed_transaction tx;
+   tx.ref_block_num = uint16_t( n );
+   tx.ref_block_prefix = n;
+   tx.operations.push_back( op );
+   tx.set_expiration( db.head_block_time() + GAMEBANK_MAX_TIME_UNTIL_EXPIRATION );
+   db.push_transaction( tx, speculation_test_skip );
+}
+
+static void produce_block( database& db )
+{
+   auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "test" ) ) );
+   db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), key, speculation_test_skip );
+}
+
+static std::map< std::string, std::vector< char > > reindexed_state( const fc::path& dir, uint32_t threads, contract_speculator::speculation_stats& stats )
+{
+   database db;
+   db.reindex( speculation_test_args( dir, threads ) );
+   if( db.get_contract_speculator() != nullptr )
+      stats = db.get_contract_speculator()->get_stats();
+
+   std::map< std::string, std::vector< char > > result;
+   db.with_read_lock( [&]()
+   {
+      db.for_each_index_extension< state_snapshot_support >( [&]( std::shared_ptr< state_snapshot_support > ext )
+      {
+         ext->dump( result[ ext->name() ] );
+      });
+   });
+   db.close();
+   return result;
+}
+
+BOOST_AUTO_TEST_CASE( speculative_replay_matches_serial ) {
+   fc::temp_directory dir;
+   {
+      database db;
+      db.open( speculation_test_args( dir.path(), 0 ) );
+      db.with_write_lock( [&]()
+      {
+         contract_deploy_operation deploy;
+         deploy.creator = GAMEBANK_INIT_MINER_NAME;
+         deploy.name = "counter";
+         deploy.code =
+            "function add(key)\n"
+            "   local old = contract.get(contract.get_name(), key)\n"
+            "   contract.set(contract.get_name(), key, (old or 0) + 1)\n"
+            "   return tostring((old or 0) + 1)\n"
+            "end\n";
+         deploy.abi = "[{\"type\":\"function\",\"name\":\"add\",\"args\":[\"string\"]}]";
+         push_operation( db, deploy, 0 );
+         produce_block( db );
+
+         // every other call increments the same key, so it conflicts with the one before it
+         uint32_t n = 1;
+         for( uint32_t b = 0; b < 20; ++b )
+         {
+            for( uint32_t c = 0; c < 8; ++c, ++n )
+            {
+               contract_call_operation call;
+               call.caller = GAMEBANK_INIT_MINER_NAME;
+               call.contract_name = "counter";
+               call.method = "add";
+               call.args = n % 2 ? "[\"shared\"]" : "[\"key" + std::to_string( n ) + "\"]";
+               push_operation( db, call, n );
+            }
+            produce_block( db );
+         }
+      });
+      db.close();
+   }
+
+   contract_speculator::speculation_stats serial_stats, speculative_stats;
+   auto serial = reindexed_state( dir.path(), 0, serial_stats );
+   auto speculative = reindexed_state( dir.path(), 2, speculative_stats );
+
+   BOOST_REQUIRE( serial == speculative );
+   BOOST_REQUIRE_GT( speculative_stats.calls, 0u );
+   BOOST_REQUIRE_GT( speculative_stats.committed, 0u );
+   BOOST_REQUIRE_GT( speculative_stats.reexecuted, 0u );
+   BOOST_REQUIRE_EQUAL( speculative_stats.committed + speculative_stats.reexecuted, speculative_stats.calls );
+}
@@ -0,0 +1,216 @@
+#include <boost/test/unit_test.hpp>
+
+#include <gamebank/chain/contract/contract_storage_object.hpp>
+#include <gamebank/chain/database.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <string>
+
+using namespace gamebank::chain;
+using namespace gamebank::protocol;
+
+static const uint32_t storage_test_skip =
+   database::skip_witness_signature | database::skip_transaction_signatures | database::skip_tapos_check |
+   database::skip_authority_check | database::skip_transaction_dupe_check;
+
+/// A chain with a deployed contract exposing contract.get/set/del on its own storage
+struct storage_chain
+{
+   fc::temp_directory   dir;
+   database             db;
+   uint32_t             n = 0;
+
+   storage_chain()
+   {
+      database::open_args args;
+      args.data_dir = dir.path();
+      args.shared_mem_dir = dir.path() / "blockchain";
+      args.shared_file_size = 1024*1024*64;
+      db.open( args );
+
+      contract_deploy_operation deploy;
+      deploy.creator = GAMEBANK_INIT_MINER_NAME;
+      deploy.name = "store";
+      deploy.code =
+         "function set(key, value)\n"
+         "   contract.set(contract.get_name(), key, value)\n"
+         "end\n"
+         "function del(key)\n"
+         "   contract.del(contract.get_name(), key)\n"
+         "end\n"
+         "function copy(from, to)\n"
+         "   contract.set(contract.get_name(), to, contract.get(contract.get_name(), from))\n"
+         "end\n";
+      deploy.abi =
+         "[{\"type\":\"function\",\"name\":\"set\",\"args\":[\"string\",\"int64\"]},"
+         "{\"type\":\"function\",\"name\":\"del\",\"args\":[\"string\"]},"
+         "{\"type\":\"function\",\"name\":\"copy\",\"args\":[\"string\",\"string\"]}]";
+      push( deploy );
+      produce_block();
+   }
+
+   ~storage_chain()
+   {
+      db.close();
+   }
+
+   void push( const operation& op )
+   {
+      db.with_write_lock( [&]()
+      {
+         signed_transaction tx;
+         tx.ref_block_num = uint16_t( n );
+         tx.ref_block_prefix = n++;
+         tx.operations.push_back( op );
+         tx.set_expiration( db.head_block_time() + GAMEBANK_MAX_TIME_UNTIL_EXPIRATION );
+         db.push_transaction( tx, storage_test_skip );
+      });
+   }
+
+   void call( const std::string& method, const std::string& args )
+   {
+      contract_call_operation op;
+      op.caller = GAMEBANK_INIT_MINER_NAME;
+      op.contract_name = "store";
+      op.method = method;
+      op.args = args;
+      push( op );
+   }
+
+   void produce_block()
+   {
+      auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "test" ) ) );
+      db.with_write_lock( [&]()
+      {
+         db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), key, storage_test_skip );
+      });
+   }
+
+   /// The stored bytes of key, empty if the key does not exist
+   std::string value( const std::string& key )
+   {
+      std::string result;
+      db.with_read_lock( [&]()
+      {
+         const auto* obj = db.find< contract_storage_object, by_contract_user_key >(
+            boost::make_tuple( account_name_type( "store" ), account_name_type( "store" ), key ) );
+         if( obj != nullptr )
+            result.assign( obj->value.data(), obj->value.size() );
+      });
+      return result;
+   }
+
+   size_t size()
+   {
+      size_t result = 0;
+      db.with_read_lock( [&]() { result = db.get_index< contract_storage_object_index >().indices().size(); } );
+      return result;
+   }
+};
+
+BOOST_AUTO_TEST_CASE( storage_set_and_get ) {
+   storage_chain chain;
+   BOOST_REQUIRE_EQUAL( chain.size(), 0u );
+
+   chain.call( "set", "[\"a\",1]" );
+   chain.produce_block();
+   BOOST_REQUIRE_EQUAL( chain.size(), 1u );
+   BOOST_REQUIRE( !chain.value( "a" ).empty() );
+
+   // copy reads the key through contract.get and writes the same value back under another key
+   chain.call( "copy", "[\"a\",\"b\"]" );
+   chain.produce_block();
+   BOOST_REQUIRE_EQUAL( chain.size(), 2u );
+   BOOST_REQUIRE_EQUAL( chain.value( "b" ), chain.value( "a" ) );
+
+   // reading a missing key returns nil, which deletes the target
+   chain.call( "copy", "[\"missing\",\"b\"]" );
+   chain.produce_block();
+   BOOST_REQUIRE_EQUAL( chain.size(), 1u );
+   BOOST_REQUIRE( chain.value( "b" ).empty() );
+}
+
+BOOST_AUTO_TEST_CASE( storage_overwrite ) {
+   storage_chain chain;
+   chain.call( "set", "[\"a\",1]" );
+   chain.call( "set", "[\"b\",2]" );
+   chain.produce_block();
+   std::string one = chain.value( "a" );
+   std::string two = chain.value( "b" );
+   BOOST_REQUIRE( one != two );
+
+   chain.call( "set", "[\"a\",2]" );
+   chain.produce_block();
+   BOOST_REQUIRE_EQUAL( chain.size(), 2u );
+   BOOST_REQUIRE_EQUAL( chain.value( "a" ), two );
+
+   // writing the stored value again leaves the object untouched
+   contract_storage_object_id_type id;
+   fc::time_point_sec updated;
+   chain.db.with_read_lock( [&]()
+   {
+      const auto& obj = chain.db.get< contract_storage_object, by_contract_user_key >(
+         boost::make_tuple( account_name_type( "store" ), account_name_type( "store" ), std::string( "a" ) ) );
+      id = obj.id;
+      updated = obj.last_update;
+   });
+   chain.call( "set", "[\"a\",2]" );
+   chain.produce_block();
+   chain.db.with_read_lock( [&]()
+   {
+      const auto& obj = chain.db.get( id );
+      BOOST_REQUIRE( obj.last_update == updated );
+   });
+}
+
+BOOST_AUTO_TEST_CASE( storage_delete ) {
+   storage_chain chain;
+   chain.call( "set", "[\"a\",1]" );
+   chain.call( "set", "[\"b\",2]" );
+   chain.produce_block();
+   BOOST_REQUIRE_EQUAL( chain.size(), 2u );
+
+   chain.call( "del", "[\"a\"]" );
+   chain.produce_block();
+   BOOST_REQUIRE_EQUAL( chain.size(), 1u );
+   BOOST_REQUIRE( chain.value( "a" ).empty() );
+   BOOST_REQUIRE( !chain.value( "b" ).empty() );
+
+   // deleting a missing key is not an error
+   chain.call( "del", "[\"a\"]" );
+   chain.produce_block();
+   BOOST_REQUIRE_EQUAL( chain.size(), 1u );
+}
+
+BOOST_AUTO_TEST_CASE( storage_read_after_undo ) {
+   storage_chain chain;
+   chain.call( "set", "[\"a\",1]" );
+   chain.call( "set", "[\"b\",2]" );
+   chain.produce_block();
+   std::string a = chain.value( "a" );
+   std::string b = chain.value( "b" );
+
+   // a popped block restores the overwritten, deleted and not yet created keys
+   chain.call( "set", "[\"a\",3]" );
+   chain.call( "del", "[\"b\"]" );
+   chain.call( "set", "[\"c\",4]" );
+   chain.produce_block();
+   BOOST_REQUIRE( chain.value( "a" ) != a );
+   BOOST_REQUIRE( chain.value( "b" ).empty() );
+   BOOST_REQUIRE_EQUAL( chain.size(), 2u );
+
+   chain.db.with_write_lock( [&]() { chain.db.pop_block(); } );
+   BOOST_REQUIRE_EQUAL( chain.size(), 2u );
+   BOOST_REQUIRE_EQUAL( chain.value( "a" ), a );
+   BOOST_REQUIRE_EQUAL( chain.value( "b" ), b );
+   BOOST_REQUIRE( chain.value( "c" ).empty() );
+
+   // so does dropping pending transactions
+   chain.call( "set", "[\"a\",5]" );
+   chain.call( "del", "[\"b\"]" );
+   BOOST_REQUIRE( chain.value( "a" ) != a );
+   chain.db.with_write_lock( [&]() { chain.db.clear_pending(); } );
+   BOOST_REQUIRE_EQUAL( chain.value( "a" ), a );
+   BOOST_REQUIRE_EQUAL( chain.value( "b" ), b );
+}
@@ -0,0 +1,46 @@
+#include <boost/test/unit_test.hpp>
+
+#include <gamebank/chain/util/mapped_log_file.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using gamebank::chain::util::mapped_log_file;
+
+BOOST_AUTO_TEST_CASE( truncate_waits_for_views ) {
+   fc::temp_directory dir;
+   mapped_log_file log;
+   log.open( dir.path() / "log" );
+
+   std::string data( 1024*1024, 'x' );
+   log.append( data.data(), data.size() );
+
+   auto v = std::make_shared< mapped_log_file::view >( log.read( 0 ) );
+   BOOST_REQUIRE_EQUAL( v->size, data.size() );
+
+   std::atomic< bool > truncated( false );
+   std::thread writer( [&]()
+   {
+      log.truncate();
+      truncated = true;
+   });
+
+   // the whole mapping must stay readable until the view is dropped
+   std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+   BOOST_REQUIRE( !truncated );
+   BOOST_REQUIRE_EQUAL( v->data[ v->size - 1 ], 'x' );
+
+   v.reset();
+   writer.join();
+   BOOST_REQUIRE( truncated );
+   BOOST_REQUIRE_EQUAL( log.size(), 0u );
+   BOOST_REQUIRE_THROW( log.read( 0 ), fc::exception );
+
+   log.append( "y", 1 );
+   BOOST_REQUIRE_EQUAL( log.read_pod< char >( 0 ), 'y' );
+   log.close();
+}
@@ -0,0 +1,141 @@
+#define BOOST_TEST_MODULE chain test
+
+#include <boost/test/unit_test.hpp>
+
+#include <gamebank/chain/account_object.hpp>
+#include <gamebank/chain/database.hpp>
+#include <gamebank/chain/state_snapshot.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace gamebank::chain;
+
+struct temp_chain
+{
+   fc::temp_directory   dir;
+   database             db;
+
+   temp_chain()
+   {
+      database::open_args args;
+      args.data_dir = dir.path();
+      args.shared_mem_dir = dir.path() / "blockchain";
+      args.shared_file_size = 1024*1024*64;
+      db.open( args );
+   }
+
+   ~temp_chain()
+   {
+      db.close();
+   }
+
+   /// Every index packed by its state_snapshot_support, by name
+   std::map< std::string, std::vector< char > > state()
+   {
+      std::map< std::string, std::vector< char > > result;
+      db.with_read_lock( [&]()
+      {
+         db.for_each_index_extension< state_snapshot_support >( [&]( std::shared_ptr< state_snapshot_support > ext )
+         {
+            ext->dump( result[ ext->name() ] );
+         });
+      });
+      return result;
+   }
+};
+
+static account_id_type create_account( database& db, const std::string& name )
+{
+   account_id_type id;
+   db.with_write_lock( [&]()
+   {
+      id = db.create< account_object >( [&]( account_object& a ) { a.name = name; } ).id;
+   });
+   return id;
+}
+
+BOOST_AUTO_TEST_CASE( write_and_read ) {
+   temp_chain source;
+   create_account( source.db, "alice" );
+   create_account( source.db, "bob" );
+
+   fc::path file = source.dir.path() / "state.snapshot";
+   source.db.with_read_lock( [&]() { write_state_snapshot( source.db, file, 2 ); } );
+
+   temp_chain target;
+   BOOST_REQUIRE( target.state() != source.state() );
+   target.db.with_write_lock( [&]()
+   {
+      BOOST_REQUIRE_EQUAL( read_state_snapshot( target.db, file, 2 ), source.db.head_block_num() );
+   });
+
+   BOOST_REQUIRE( target.state() == source.state() );
+   target.db.with_read_lock( [&]()
+   {
+      BOOST_REQUIRE( ( target.db.find< account_object, by_name >( "bob" ) != nullptr ) );
+   });
+}
+
+BOOST_AUTO_TEST_CASE( next_id_survives_removed_objects ) {
+   temp_chain source;
+   create_account( source.db, "alice" );
+   create_account( source.db, "bob" );
+   create_account( source.db, "carol" );
+   source.db.with_write_lock( [&]()
+   {
+      source.db.remove( source.db.get< account_object, by_name >( "carol" ) );
+   });
+
+   fc::path file = source.dir.path() / "state.snapshot";
+   source.db.with_read_lock( [&]() { write_state_snapshot( source.db, file, 2 ); } );
+
+   temp_chain target;
+   target.db.with_write_lock( [&]() { read_state_snapshot( target.db, file, 2 ); } );
+
+   // the highest id was removed, the loaded index must not hand it out again
+   BOOST_REQUIRE( create_account( target.db, "dave" ) == create_account( source.db, "dave" ) );
+}
+
+BOOST_AUTO_TEST_CASE( corrupted_snapshot ) {
+   temp_chain source;
+   create_account( source.db, "alice" );
+
+   fc::path file = source.dir.path() / "state.snapshot";
+   source.db.with_read_lock( [&]() { write_state_snapshot( source.db, file, 2 ); } );
+
+   std::vector< char > good;
+   {
+      std::ifstream in( file.generic_string(), std::ios::binary );
+      good.assign( std::istreambuf_iterator< char >( in ), std::istreambuf_iterator< char >() );
+   }
+
+   temp_chain target;
+   const auto before = target.state();
+
+   auto try_read = [&]( const std::vector< char >& contents )
+   {
+      {
+         std::ofstream out( file.generic_string(), std::ios::binary | std::ios::trunc );
+         out.write( contents.data(), contents.size() );
+      }
+      target.db.with_write_lock( [&]()
+      {
+         BOOST_CHECK_THROW( read_state_snapshot( target.db, file, 2 ), fc::exception );
+      });
+      BOOST_REQUIRE( target.state() == before );          /// nothing was cleared
+   };
+
+   for( size_t offset : { good.size() / 3, good.size() / 2, good.size() - 1 } )
+   {
+      auto flipped = good;
+      flipped[ offset ] ^= 0x5a;
+      try_read( flipped );
+   }
+
+   try_read( std::vector< char >( good.begin(), good.begin() + good.size() / 2 ) );
+}
@@ -0,0 +1,102 @@
+#include <gamebank/chain/util/mapped_log_file.hpp>
+
+#include <chrono>
+#include <thread>
+
+namespace gamebank { namespace chain { namespace util {
+
+namespace bip = boost::interprocess;
+
+void mapped_log_file::open( const fc::path& file )
+{
+   close();
+   _path = file;
+   _out.exceptions( std::ofstream::failbit | std::ofstream::badbit );
+   _out.open( _path.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+   _size.store( fc::file_size( _path ), std::memory_order_release );
+}
+
+void mapped_log_file::close()
+{
+   if( _out.is_open() )
+   {
+      _out.flush();
+      _out.close();
+   }
+   std::atomic_store( &_region, region_ptr() );
+   _size.store( 0, std::memory_order_release );
+}
+
+void mapped_log_file::append( const char* data, size_t len )
+{
+   _out.write( data, len );
+   // readers map the file, the data has to reach the page cache before they are told about it
+   _out.flush();
+   _size.fetch_add( len, std::memory_order_release );
+}
+
+void mapped_log_file::flush()
+{
+   _out.flush();
+}
+
+void mapped_log_file::truncate()
+{
+   // readers without a mapping block in map_at_least until the file is empty
+   std::lock_guard< std::mutex > guard( _map_mutex );
+   std::atomic_store( &_region, region_ptr() );
+   while( _live_regions->load( std::memory_order_acquire ) > 0 )
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+   _out.close();
+   _out.open( _path.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+   _out.close();
+   _out.open( _path.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+   std::atomic_store( &_region, region_ptr() );
+   _size.store( 0, std::memory_order_release );
+}
+
+mapped_log_file::view mapped_log_file::read( uint64_t pos )const
+{
+   uint64_t end = size();
+   FC_ASSERT( pos < end, "Read past the end of ${f}", ("f", _path.generic_string())("pos", pos)("size", end) );
+
+   view v;
+   v.keep = std::atomic_load( &_region );
+   if( !v.keep || v.keep->size <= pos )
+      v.keep = map_at_least( end );
+
+   v.data = v.keep->data + pos;
+   v.size = v.keep->size - pos;
+   return v;
+}
+
+mapped_log_file::region_ptr mapped_log_file::map_at_least( uint64_t size )const
+{
+   std::lock_guard< std::mutex > guard( _map_mutex );
+   region_ptr current = std::atomic_load( &_region );
+   if( current && current->size >= size )
+      return current;
+   // the file was truncated while this reader waited for the mutex
+   FC_ASSERT( this->size() >= size, "Read past the end of ${f}", ("f", _path.generic_string())("size", this->size()) );
+
+   // map everything appended so far, not just what this reader needs
+   std::unique_ptr< region > fresh( new region() );
+   auto live = _live_regions;
+   live->fetch_add( 1, std::memory_order_relaxed );
+   std::shared_ptr< region > r( fresh.release(), [live]( region* p )
+   {
+      delete p;
+      live->fetch_sub( 1, std::memory_order_release );
+   } );
+   r->file = bip::file_mapping( _path.generic_string().c_str(), bip::read_only );
+   r->map = bip::mapped_region( r->file, bip::read_only, 0, this->size() );
+   r->data = static_cast< const char* >( r->map.get_address() );
+   r->size = r->map.get_size();
+
+   region_ptr result = r;
+   std::atomic_store( &_region, result );
+   return result;
+}
+
+} } } // gamebank::chain::util
@@ -23,10 +23,16 @@
 #include <chainbase/allocators.hpp>
 #include <chainbase/util/object_id.hpp>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <cassert>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <typeindex>
 #include <typeinfo>
@@ -137,26 +143,84 @@ namespace chainbase {
    template<typename Constructor, typename Allocator> \
    OBJECT_TYPE( Constructor&& c, Allocator&&  ) { c(*this); }
 
+   /**
+    *  The changes made to one index during one undo session.
+    *
+    *  Objects created during the session are not recorded, ids are handed out in increasing order
+    *  so every object with an id >= old_next_id is new. The previous values of modified and removed
+    *  objects are appended to an arena of fixed size blocks, which keeps each saved object in one
+    *  contiguous allocation instead of a tree node.
+    *
+    *  Their entries are appended to a vector whose front is kept sorted by id. Once the unsorted tail
+    *  grows past the square root of the whole it is sorted and merged into the front, so saving an
+    *  entry never shifts the others and finding one is a binary search plus a scan of a short tail.
+    *  squash sorts both sessions and merges them in a single pass.
+    */
    template< typename value_type >
    class undo_state
    {
       public:
          typedef typename value_type::id_type                      id_type;
-         typedef allocator< std::pair<const id_type, value_type> > id_value_allocator_type;
-         typedef allocator< id_type >                              id_allocator_type;
+
+         struct entry
+         {
+            id_type     id;
+            uint32_t    slot = 0;        ///< position of the saved value in values
+            bool        removed = false; ///< removed during the session, otherwise modified
+
+            friend bool operator < ( const entry& e, const id_type& id ) { return e.id < id; }
+            friend bool operator < ( const entry& a, const entry& b ) { return a.id < b.id; }
+         };
+
+         typedef t_vector< entry >                                 entry_vector;
+         typedef t_deque< value_type >                             value_arena;
 
          template<typename T>
          undo_state( allocator<T> al )
-         :old_values( id_value_allocator_type( al ) ),
-          removed_values( id_value_allocator_type( al ) ),
-          new_ids( id_allocator_type( al ) ){}
+         :entries( allocator< entry >( al ) ),
+          values( allocator< value_type >( al ) ){}
 
-         typedef boost::interprocess::map< id_type, value_type, std::less<id_type>, id_value_allocator_type >  id_value_type_map;
-         typedef boost::interprocess::set< id_type, std::less<id_type>, id_allocator_type >                    id_type_set;
+         bool is_new( const id_type& id )const { return !( id < old_next_id ); }
 
-         id_value_type_map            old_values;
-         id_value_type_map            removed_values;
-         id_type_set                  new_ids;
+         /// The entry saved for id, or nullptr
+         entry* find( const id_type& id )
+         {
+            auto sorted_end = entries.begin() + sorted_size;
+            auto itr = std::lower_bound( entries.begin(), sorted_end, id );
+            if( itr != sorted_end && itr->id == id )
+               return &*itr;
+            for( itr = sorted_end; itr != entries.end(); ++itr )
+               if( itr->id == id )
+                  return &*itr;
+            return nullptr;
+         }
+
+         /// Saves v before it is modified or removed, v must not have an entry yet
+         void save( const value_type& v, bool removed )
+         {
+            entry e;
+            e.id = v.id;
+            e.slot = values.size();
+            e.removed = removed;
+            values.push_back( v );
+            entries.push_back( e );
+
+            size_t unsorted = entries.size() - sorted_size;
+            if( unsorted > 16 && unsorted * unsorted > entries.size() )
+               sort_entries();
+         }
+
+         /// Sorts the entries saved since the last call and merges them into the sorted front
+         void sort_entries()
+         {
+            std::sort( entries.begin() + sorted_size, entries.end() );
+            std::inplace_merge( entries.begin(), entries.begin() + sorted_size, entries.end() );
+            sorted_size = entries.size();
+         }
+
+         entry_vector                 entries;      ///< [0, sorted_size) sorted by id, the rest in the order they were saved
+         uint32_t                     sorted_size = 0;
+         value_arena                  values;
          id_type                      old_next_id = 0;
          int64_t                      revision = 0;
    };
@@ -204,10 +268,12 @@ namespace chainbase {
          typedef undo_state< value_type >                              undo_state_type;
 
          generic_index( allocator<value_type> a )
-         :_stack(a),_indices( a ),_size_of_value_type( sizeof(typename MultiIndexType::node_type) ),_size_of_this(sizeof(*this)){}
+         :_stack(a),_indices( a ),_size_of_value_type( sizeof(typename MultiIndexType::node_type) ),_size_of_this(sizeof(*this)),
+          _size_of_undo_state( sizeof(undo_state_type) ){}
 
          void validate()const {
-            if( sizeof(typename MultiIndexType::node_type) != _size_of_value_type || sizeof(*this) != _size_of_this )
+            if( sizeof(typename MultiIndexType::node_type) != _size_of_value_type || sizeof(*this) != _size_of_this
+                || sizeof(undo_state_type) != _size_of_undo_state )
                BOOST_THROW_EXCEPTION( std::runtime_error("content of memory does not match data expected by executable") );
          }
 
@@ -235,6 +301,52 @@ namespace chainbase {
             return *insert_result.first;
          }
 
+         /**
+          * Inserts an object read back from a state snapshot, keeping the id the constructor gives
+          * it. Objects have to come in id order and the index must not have undo state. Each one
+          * goes to the end of the id index, which makes loading a sorted dump linear there.
+          */
+         template<typename Constructor>
+         const value_type& load( Constructor&& c ) {
+            if( _stack.size() )
+               BOOST_THROW_EXCEPTION( std::logic_error( "cannot load objects into an index with undo state" ) );
+
+            auto size = _indices.size();
+            auto itr = _indices.emplace_hint( _indices.end(), c, _indices.get_allocator() );
+            if( _indices.size() == size || itr->id < _next_id ) {
+               if( _indices.size() != size )
+                  _indices.erase( itr );
+               BOOST_THROW_EXCEPTION( std::logic_error( "could not load object, ids out of order or a uniqueness constraint was violated" ) );
+            }
+
+            _next_id = itr->id;
+            ++_next_id;
+            return *itr;
+         }
+
+         /// Removes every object, the index must not have undo state
+         void clear() {
+            if( _stack.size() )
+               BOOST_THROW_EXCEPTION( std::logic_error( "cannot clear an index with undo state" ) );
+            _indices.clear();
+            _next_id = 0;
+         }
+
+         /// The id the next created object gets, removing objects doesn't lower it
+         typename value_type::id_type next_id()const { return _next_id; }
+
+         /**
+          * Restores the next id of an index read back from a state snapshot. The index must not have
+          * undo state and the id can't go below the one after the last loaded object.
+          */
+         void set_next_id( typename value_type::id_type next_id ) {
+            if( _stack.size() )
+               BOOST_THROW_EXCEPTION( std::logic_error( "cannot set the next id of an index with undo state" ) );
+            if( next_id < _next_id )
+               BOOST_THROW_EXCEPTION( std::logic_error( "next id is below the id of a loaded object" ) );
+            _next_id = next_id;
+         }
+
          template<typename Modifier>
          void modify( const value_type& obj, Modifier&& m ) {
             on_modify( obj );
@@ -323,23 +435,28 @@ namespace chainbase {
          void undo() {
             if( !enabled() ) return;
 
-            const auto& head = _stack.back();
+            auto& head = _stack.back();
 
-            for( auto& item : head.old_values ) {
-               auto ok = _indices.modify( _indices.find( item.second.id ), [&]( value_type& v ) {
-                  v = std::move( item.second );
+            for( const auto& e : head.entries ) {
+               if( e.removed ) continue;
+               auto ok = _indices.modify( _indices.find( e.id ), [&]( value_type& v ) {
+                  v = std::move( head.values[ e.slot ] );
                });
                if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
             }
 
-            for( const auto& id : head.new_ids )
+            // objects created during the session, those removed again are already gone
+            for( auto id = head.old_next_id; id < _next_id; ++id )
             {
-               _indices.erase( _indices.find( id ) );
+               auto itr = _indices.find( id );
+               if( itr != _indices.end() )
+                  _indices.erase( itr );
             }
             _next_id = head.old_next_id;
 
-            for( auto& item : head.removed_values ) {
-               bool ok = _indices.emplace( std::move( item.second ) ).second;
+            for( const auto& e : head.entries ) {
+               if( !e.removed ) continue;
+               bool ok = _indices.emplace( std::move( head.values[ e.slot ] ) ).second;
                if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not restore object, most likely a uniqueness constraint was violated" ) );
             }
 
@@ -365,10 +482,10 @@ namespace chainbase {
             auto& prev_state = _stack[_stack.size()-2];
 
             // An object's relationship to a state can be:
-            // in new_ids            : new
-            // in old_values (was=X) : upd(was=X)
-            // in removed (was=X)    : del(was=X)
-            // not in any of above   : nop
+            // id >= old_next_id          : new
+            // entry, not removed (was=X) : upd(was=X)
+            // entry, removed (was=X)     : del(was=X)
+            // not in any of above        : nop
             //
             // When merging A=prev_state and B=state we have a 4x4 matrix of all possibilities:
             //
@@ -404,52 +521,65 @@ namespace chainbase {
             // (a serious logic error which should never happen).
             //
 
-            // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three containers.
-
-            for( const auto& item : state.old_values )
+            // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to walk B's entries.
+            // Both entry vectors are sorted by id and walked together. Type C changes A's entry in place, type B
+            // entries are counted and then merged into A's vector from the back, so it grows in place instead of
+            // being rebuilt for every squashed transaction.
+            //
+            // new is implicit: an object is new in A iff its id >= prev_state.old_next_id, which covers every
+            // object created in B as well. That makes *+new a no-op and new+del nop, the object is simply gone.
+
+            const uint32_t not_added = std::numeric_limits< uint32_t >::max();
+            state.sort_entries();
+            prev_state.sort_entries();
+
+            auto& merged = prev_state.entries;
+            size_t a_size = merged.size();
+            size_t a = 0;
+            size_t added = 0;
+            for( auto& b : state.entries )
             {
-               if( prev_state.new_ids.find( item.second.id ) != prev_state.new_ids.end() )
+               while( a < a_size && merged[a].id < b.id )
+                  ++a;
+
+               if( prev_state.is_new( b.id ) )
                {
                   // new+upd -> new, type A
+                  // new+del -> nop, type C
+                  b.slot = not_added;
                   continue;
                }
-               if( prev_state.old_values.find( item.second.id ) != prev_state.old_values.end() )
+
+               if( a < a_size && merged[a].id == b.id )
                {
+                  // del+upd, del+del -> N/A
+                  assert( !merged[a].removed );
                   // upd(was=X) + upd(was=Y) -> upd(was=X), type A
+                  // upd(was=X) + del(was=Y) -> del(was=X), type C
+                  merged[a].removed = b.removed;
+                  b.slot = not_added;
                   continue;
                }
-               // del+upd -> N/A
-               assert( prev_state.removed_values.find(item.second.id) == prev_state.removed_values.end() );
-               // nop+upd(was=Y) -> upd(was=Y), type B
-               prev_state.old_values.emplace( std::move(item) );
-            }
 
-            // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
-            for( const auto& id : state.new_ids )
-               prev_state.new_ids.insert(id);
+               // nop+upd(was=Y) -> upd(was=Y), nop+del(was=Y) -> del(was=Y), type B
+               auto slot = prev_state.values.size();
+               prev_state.values.push_back( std::move( state.values[ b.slot ] ) );
+               b.slot = slot;
+               ++added;
+            }
 
-            // *+del
-            for( auto& obj : state.removed_values )
+            merged.resize( a_size + added );
+            size_t w = merged.size();
+            a = a_size;
+            for( auto b = state.entries.rbegin(); b != state.entries.rend(); ++b )
             {
-               if( prev_state.new_ids.find(obj.second.id) != prev_state.new_ids.end() )
-               {
-                  // new + del -> nop (type C)
-                  prev_state.new_ids.erase(obj.second.id);
+               if( b->slot == not_added )
                   continue;
-               }
-               auto it = prev_state.old_values.find(obj.second.id);
-               if( it != prev_state.old_values.end() )
-               {
-                  // upd(was=X) + del(was=Y) -> del(was=X)
-                  prev_state.removed_values.emplace( std::move(*it) );
-                  prev_state.old_values.erase(obj.second.id);
-                  continue;
-               }
-               // del + del -> N/A
-               assert( prev_state.removed_values.find( obj.second.id ) == prev_state.removed_values.end() );
-               // nop + del(was=Y) -> del(was=Y)
-               prev_state.removed_values.emplace( std::move(obj) ); //[obj.second->id] = std::move(obj.second);
+               while( a > 0 && b->id < merged[a-1].id )
+                  merged[--w] = merged[--a];
+               merged[--w] = *b;
             }
+            prev_state.sorted_size = merged.size();
 
             _stack.pop_back();
             --_revision;
@@ -475,6 +605,12 @@ namespace chainbase {
                undo();
          }
 
+         /// True if undo() would change the objects in the index
+         bool has_undo_changes()const
+         {
+            return enabled() && ( _stack.back().entries.size() || _stack.back().old_next_id != _next_id );
+         }
+
          void set_revision( int64_t revision )
          {
             if( _stack.size() != 0 ) BOOST_THROW_EXCEPTION( std::logic_error("cannot set revision while there is an existing undo stack") );
@@ -489,43 +625,30 @@ namespace chainbase {
 
             auto& head = _stack.back();
 
-            if( head.new_ids.find( v.id ) != head.new_ids.end() )
-               return;
-
-            auto itr = head.old_values.find( v.id );
-            if( itr != head.old_values.end() )
+            if( head.is_new( v.id ) || head.find( v.id ) )
                return;
 
-            head.old_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) );
+            head.save( v, false );
          }
 
          void on_remove( const value_type& v ) {
             if( !enabled() ) return;
 
             auto& head = _stack.back();
-            if( head.new_ids.count(v.id) ) {
-               head.new_ids.erase( v.id );
+            if( head.is_new( v.id ) )
                return;
-            }
 
-            auto itr = head.old_values.find( v.id );
-            if( itr != head.old_values.end() ) {
-               head.removed_values.emplace( std::move( *itr ) );
-               head.old_values.erase( v.id );
+            if( auto e = head.find( v.id ) ) {
+               // keeps the value saved before the first modification
+               e->removed = true;
                return;
             }
 
-            if( head.removed_values.count( v.id ) )
-               return;
-
-            head.removed_values.emplace( std::pair< typename value_type::id_type, const value_type& >( v.id, v ) );
+            head.save( v, true );
          }
 
          void on_create( const value_type& v ) {
-            if( !enabled() ) return;
-            auto& head = _stack.back();
-
-            head.new_ids.insert( v.id );
+            // new objects are recognized by id, see undo_state
          }
 
          boost::interprocess::deque< undo_state_type, allocator<undo_state_type> > _stack;
@@ -541,6 +664,7 @@ namespace chainbase {
          index_type                      _indices;
          uint32_t                        _size_of_value_type = 0;
          uint32_t                        _size_of_this = 0;
+         uint32_t                        _size_of_undo_state = 0;
    };
 
    class abstract_session {
@@ -590,6 +714,7 @@ namespace chainbase {
          virtual void    squash()const = 0;
          virtual void    commit( int64_t revision )const = 0;
          virtual void    undo_all()const = 0;
+         virtual bool    has_undo_changes()const = 0;
          virtual uint32_t type_id()const  = 0;
 
          virtual statistic_info get_statistics(bool onlyStaticInfo) const = 0;
@@ -620,6 +745,7 @@ namespace chainbase {
          virtual void     squash()const  override { _base.squash(); }
          virtual void     commit( int64_t revision )const  override { _base.commit(revision); }
          virtual void     undo_all() const override {_base.undo_all(); }
+         virtual bool     has_undo_changes()const override { return _base.has_undo_changes(); }
          virtual uint32_t type_id()const override { return BaseIndex::value_type::type_id; }
 
          virtual statistic_info get_statistics(bool onlyStaticInfo) const override final
@@ -681,11 +807,114 @@ namespace chainbase {
       virtual const char* what() const noexcept { return "Unable to acquire database lock"; }
    };
 
+   /**
+    *  An immutable copy of some indices of a database, published by the writer with
+    *  database::publish_snapshot(). Readers pin one with database::get_snapshot() and query it
+    *  without any lock, it does not change while they hold it.
+    *
+    *  Only indices added with database::add_snapshot_index() are part of a snapshot. An index
+    *  is copied when it changed since the previous snapshot and shared with it otherwise. The
+    *  copies are allocated in the database's shared memory. A copy a reader releases is only
+    *  freed later by the writer, and copies left behind by a crash are freed when the database
+    *  is opened again.
+    */
+   class snapshot
+   {
+      public:
+         /// Revision of the database when the snapshot was published
+         int64_t revision()const { return _revision; }
+
+         template< typename MultiIndexType >
+         bool has_index()const
+         {
+            const auto type_id = MultiIndexType::value_type::type_id;
+            return _indices.size() > type_id && _indices[ type_id ];
+         }
+
+         template< typename MultiIndexType, typename ByIndex >
+         auto get_index()const -> decltype( ((const MultiIndexType*)nullptr)->template get< ByIndex >() )
+         {
+            return indices< MultiIndexType >().template get< ByIndex >();
+         }
+
+         template< typename ObjectType, typename IndexedByType, typename CompatibleKey >
+         const ObjectType* find( CompatibleKey&& key )const
+         {
+            typedef typename get_index_type< ObjectType >::type index_type;
+            const auto& idx = indices< index_type >().template get< IndexedByType >();
+            auto itr = idx.find( std::forward< CompatibleKey >( key ) );
+            if( itr == idx.end() ) return nullptr;
+            return &*itr;
+         }
+
+         template< typename ObjectType >
+         const ObjectType* find( oid< ObjectType > key = oid< ObjectType >() )const
+         {
+            typedef typename get_index_type< ObjectType >::type index_type;
+            const auto& idx = indices< index_type >();
+            auto itr = idx.find( key );
+            if( itr == idx.end() ) return nullptr;
+            return &*itr;
+         }
+
+         template< typename ObjectType, typename IndexedByType, typename CompatibleKey >
+         const ObjectType& get( CompatibleKey&& key )const
+         {
+            auto obj = find< ObjectType, IndexedByType >( std::forward< CompatibleKey >( key ) );
+            if( !obj ) BOOST_THROW_EXCEPTION( std::out_of_range( "unknown key" ) );
+            return *obj;
+         }
+
+         template< typename ObjectType >
+         const ObjectType& get( const oid< ObjectType >& key = oid< ObjectType >() )const
+         {
+            auto obj = find< ObjectType >( key );
+            if( !obj ) BOOST_THROW_EXCEPTION( std::out_of_range( "unknown key" ) );
+            return *obj;
+         }
+
+      private:
+         friend class database;
+
+         template< typename MultiIndexType >
+         const MultiIndexType& indices()const
+         {
+            if( !has_index< MultiIndexType >() )
+            {
+               std::string type_name = boost::core::demangle( typeid( typename MultiIndexType::value_type ).name() );
+               BOOST_THROW_EXCEPTION( std::runtime_error( "index for " + type_name + " is not part of the snapshot" ) );
+            }
+            return *static_cast< const MultiIndexType* >( _indices[ MultiIndexType::value_type::type_id ].get() );
+         }
+
+         int64_t                                   _revision = -1;
+         std::vector< std::shared_ptr< const void > > _indices;   ///< by type_id
+   };
+
+   class background_flush;
+
    /**
     *  This class
     */
    class database
    {
+      public:
+         /**
+          * How readers are kept apart from the writer.
+          *
+          * global_locking: with_read_lock and with_write_lock share one read_write_mutex.
+          *
+          * index_locking: every index has its own mutex. Within with_write_lock an index is locked
+          * the first time it is modified, or undone, and stays locked until the callback returns.
+          * with_index_read_lock only waits for a writer that holds one of the indices it names,
+          * with_read_lock locks every index. A reader must only access the indices it locked.
+          */
+         enum lock_mode
+         {
+            global_locking,
+            index_locking
+         };
+
       private:
          class abstract_index_type
          {
@@ -706,11 +935,52 @@ namespace chainbase {
          };
 
       public:
+         database();
+         ~database();
+
          void open( const bfs::path& dir, uint32_t flags = 0, size_t shared_file_size = 0 );
          void close();
          void flush();
+
+         /**
+          * Writes back the next `bytes` of the shared memory file, rounded up to whole pages, on
+          * a background thread and returns immediately. Each call continues where the previous one stopped and wraps
+          * around at the end of the file, so a full pass can be spread over many calls. msync
+          * only writes the dirty pages of a range, clean ranges cost next to nothing.
+          *
+          * Requests made while the thread is busy are added to its backlog, which never exceeds
+          * one pass over the file. close(), wipe() and resize() drop the backlog.
+          */
+         void flush_async( size_t bytes );
+
+         /**
+          * Blocks until every range requested through flush_async has been written back. Throws
+          * if writing back a range failed since the last call, failures are also logged as they
+          * happen.
+          */
+         void wait_for_flush();
+
+         /// Offset in the file the next flush_async starts at, always a multiple of the page size
+         size_t flush_cursor()const;
+
          void wipe( const bfs::path& dir );
+
+         /**
+          * Grows the shared memory file. As long as the new size fits in the address range
+          * reserved at open, the file is extended and the new pages mapped right after the old
+          * ones, so nothing moves and this works inside undo sessions and while readers hold
+          * snapshots. Otherwise the file is remapped, which is not allowed inside an undo session.
+          */
          void resize( size_t new_shared_file_size );
+
+         /**
+          * Grows the file in place by `increment` bytes whenever an object is created or
+          * modified with less than `min_free` bytes free, including in the middle of a block.
+          * Growth that does not fit the reserved address range is left to resize(). An increment
+          * of 0 disables it.
+          */
+         void set_auto_grow( size_t min_free, size_t increment );
+
          void set_require_locking( bool enable_require_locking );
 
 #ifdef CHAINBASE_CHECK_LOCKING
@@ -734,7 +1004,8 @@ namespace chainbase {
                session( session&& s )
                   : _index_sessions( std::move(s._index_sessions) ),
                     _revision( s._revision ),
-                    _session_incrementer( s._session_incrementer )
+                    _session_incrementer( s._session_incrementer ),
+                    _db( s._db )
                {}
 
                session( vector<std::unique_ptr<abstract_session>>&& s, int32_t& session_count )
@@ -762,6 +1033,7 @@ namespace chainbase {
 
                void undo()
                {
+                  if( _db && _index_sessions.size() ) _db->before_undo();
                   for( auto& i : _index_sessions ) i->undo();
                   _index_sessions.clear();
                }
@@ -774,6 +1046,7 @@ namespace chainbase {
                vector< std::unique_ptr<abstract_session> > _index_sessions;
                int64_t _revision = -1;
                int_incrementer _session_incrementer;
+               database* _db = nullptr;
          };
 
          session start_undo_session();
@@ -900,6 +1173,10 @@ namespace chainbase {
                BOOST_THROW_EXCEPTION( std::runtime_error( "unable to find index for " + type_name + " in database" ) );
             }
 
+            if( _lock_mode == index_locking )
+               lock_index_for_write( index_type::value_type::type_id );
+            _snapshot_dirty[ index_type::value_type::type_id ] = true;
+
             return *index_type_ptr( _index_map[index_type::value_type::type_id]->get() );
          }
 
@@ -948,6 +1225,7 @@ namespace chainbase {
          {
              CHAINBASE_REQUIRE_WRITE_LOCK("modify", ObjectType);
              typedef typename get_index_type<ObjectType>::type index_type;
+             check_auto_grow();
              get_mutable_index<index_type>().modify( obj, m );
          }
 
@@ -964,6 +1242,7 @@ namespace chainbase {
          {
              CHAINBASE_REQUIRE_WRITE_LOCK("create", ObjectType);
              typedef typename get_index_type<ObjectType>::type index_type;
+             check_auto_grow();
              return get_mutable_index<index_type>().emplace( std::forward<Constructor>(con) );
          }
 
@@ -974,9 +1253,20 @@ namespace chainbase {
             return get_index< index_type >().indices().size();
          }
 
+         void set_lock_mode( lock_mode mode ) { _lock_mode = mode; }
+         lock_mode get_lock_mode()const { return _lock_mode; }
+
          template< typename Lambda >
          auto with_read_lock( Lambda&& callback, uint64_t wait_micro = 1000000 ) -> decltype( (*(Lambda*)nullptr)() )
          {
+            if( _lock_mode == index_locking )
+            {
+               std::vector< uint16_t > type_ids;
+               for( const abstract_index* idx : _index_list )
+                  type_ids.push_back( idx->type_id() );
+               return with_read_locks( std::move( type_ids ), std::forward< Lambda >( callback ), wait_micro );
+            }
+
 #ifndef ENABLE_STD_ALLOCATOR
             read_lock lock( _rw_manager.current_lock(), bip::defer_lock_type() );
 #else
@@ -1001,9 +1291,40 @@ namespace chainbase {
             return callback();
          }
 
+         /**
+          * Calls callback holding shared locks on the indices of MultiIndexTypes only. Same as
+          * with_read_lock when the database uses global_locking.
+          */
+         template< typename... MultiIndexTypes, typename Lambda >
+         auto with_index_read_lock( Lambda&& callback, uint64_t wait_micro = 1000000 ) -> decltype( (*(Lambda*)nullptr)() )
+         {
+            if( _lock_mode != index_locking )
+               return with_read_lock( std::forward< Lambda >( callback ), wait_micro );
+
+            std::vector< uint16_t > type_ids{ generic_index< MultiIndexTypes >::value_type::type_id... };
+            for( uint16_t id : type_ids )
+            {
+               if( id >= _index_map.size() || !_index_map[ id ] )
+                  BOOST_THROW_EXCEPTION( std::runtime_error( "unable to find index for type_id " + std::to_string( id ) + " in database" ) );
+            }
+            return with_read_locks( std::move( type_ids ), std::forward< Lambda >( callback ), wait_micro );
+         }
+
          template< typename Lambda >
          auto with_write_lock( Lambda&& callback, uint64_t wait_micro = 1000000 ) -> decltype( (*(Lambda*)nullptr)() )
          {
+            if( _lock_mode == index_locking )
+            {
+               // writers only wait for each other here, readers are kept out index by index
+               write_lock lock( _writer_mutex );
+#ifdef CHAINBASE_CHECK_LOCKING
+               BOOST_ATTRIBUTE_UNUSED
+               int_incrementer ii( _write_lock_count );
+#endif
+               index_write_scope scope( *this );
+               return callback();
+            }
+
             write_lock lock( _rw_manager.current_lock(), boost::defer_lock_t() );
 #ifdef CHAINBASE_CHECK_LOCKING
             BOOST_ATTRIBUTE_UNUSED
@@ -1027,6 +1348,58 @@ namespace chainbase {
             return callback();
          }
 
+         /**
+          * Makes the index part of the snapshots published from now on. Call it with the write
+          * lock held, the writer thread may be publishing.
+          */
+         template< typename MultiIndexType >
+         void add_snapshot_index()
+         {
+            typedef generic_index< MultiIndexType > index_type;
+            const uint16_t type_id = index_type::value_type::type_id;
+
+            if( !has_index< MultiIndexType >() )
+            {
+               std::string type_name = boost::core::demangle( typeid( typename index_type::value_type ).name() );
+               BOOST_THROW_EXCEPTION( std::runtime_error( "unable to find index for " + type_name + " in database" ) );
+            }
+
+            if( type_id >= _snapshot_copiers.size() )
+               _snapshot_copiers.resize( type_id + 1 );
+
+            _snapshot_copiers[ type_id ] = [this, type_id]()
+            {
+               const auto& live = static_cast< index_type* >( _index_map[ type_id ]->get() )->indices();
+#ifndef ENABLE_STD_ALLOCATOR
+               MultiIndexType* copy = _segment->construct< MultiIndexType >( bip::anonymous_instance )( live );
+               try
+               {
+                  _snapshot_copy_list->push_back( snapshot_copy_record{ type_id, copy } );
+               }
+               catch( ... )
+               {
+                  _segment->destroy_ptr( copy );
+                  throw;
+               }
+#else
+               MultiIndexType* copy = new MultiIndexType( live );
+#endif
+               ++_snapshot_copies;
+               // readers may drop the last reference on any thread, the writer frees the copy
+               return std::shared_ptr< const void >( copy, [this, type_id]( const void* released )
+               {
+                  release_snapshot_copy( type_id, const_cast< void* >( released ) );
+               });
+            };
+            _snapshot_dirty[ type_id ] = true;
+         }
+
+         /// Publishes the current state of the snapshot indices, called by the writer between blocks
+         void publish_snapshot();
+
+         /// The last published snapshot, null if there is none
+         std::shared_ptr< const snapshot > get_snapshot()const { return std::atomic_load( &_snapshot ); }
+
          template< typename IndexExtensionType, typename Lambda >
          void for_each_index_extension( Lambda&& callback )const
          {
@@ -1048,6 +1421,74 @@ namespace chainbase {
             { return _index_list; }
 
       private:
+         /// Shared locks on a set of indices, only held all at once so a reader never waits while holding one
+         class index_read_locks
+         {
+            public:
+               index_read_locks( const std::vector< read_write_mutex* >& mutexes, uint64_t wait_micro );
+
+            private:
+               std::vector< read_lock > _locks;
+         };
+
+         /// Releases the index locks taken by the writer when with_write_lock returns
+         class index_write_scope
+         {
+            public:
+               index_write_scope( database& db ) : _db( db ) { _db._in_index_write_scope = true; }
+               ~index_write_scope() { _db.release_index_write_locks(); }
+
+            private:
+               database& _db;
+         };
+
+         template< typename Lambda >
+         auto with_read_locks( std::vector< uint16_t >&& type_ids, Lambda&& callback, uint64_t wait_micro ) -> decltype( (*(Lambda*)nullptr)() )
+         {
+            // always lock in type_id order
+            std::sort( type_ids.begin(), type_ids.end() );
+            type_ids.erase( std::unique( type_ids.begin(), type_ids.end() ), type_ids.end() );
+
+            std::vector< read_write_mutex* > mutexes;
+            mutexes.reserve( type_ids.size() );
+            for( uint16_t id : type_ids )
+               mutexes.push_back( _index_locks[ id ].get() );
+
+#ifdef CHAINBASE_CHECK_LOCKING
+            BOOST_ATTRIBUTE_UNUSED
+            int_incrementer ii( _read_lock_count );
+#endif
+
+            index_read_locks locks( mutexes, wait_micro );
+            return callback();
+         }
+
+         void lock_index_for_write( uint16_t type_id );
+         /// Locks and marks for the next snapshot the indices the head undo session changed
+         void before_undo();
+         void release_index_write_locks();
+         /// Unpublishes the snapshot and waits until readers released every copy in shared memory
+         void drop_snapshots();
+
+         /// Called when the last reference to a snapshot copy is dropped, on any thread
+         void release_snapshot_copy( uint16_t type_id, void* copy );
+         /// Frees the copies readers released, only the writer allocates and frees in shared memory
+         void free_released_snapshot_copies();
+         /// Frees the copies of an index left in the file by a process that did not close it
+         void free_orphaned_snapshot_copies( uint16_t type_id );
+
+         void check_auto_grow()
+         {
+            if( BOOST_UNLIKELY( _auto_grow_increment != 0 ) && get_free_memory() < _auto_grow_min_free )
+               grow_in_place( _file_size + _auto_grow_increment );
+         }
+
+         /// Maps the segment at the start of a reserved address range, or anywhere if none can be reserved
+         void map_segment( const bfs::path& file );
+         /// Extends the file and maps the new part after the old one, false if it does not fit the reservation
+         bool grow_in_place( size_t new_size );
+         void release_address_space();
+
          template<typename MultiIndexType>
          void add_index_helper() {
              const uint16_t type_id = generic_index<MultiIndexType>::value_type::type_id;
@@ -1071,12 +1512,38 @@ namespace chainbase {
              if( type_id >= _index_map.size() )
                 _index_map.resize( type_id + 1 );
 
+             // index locks outlive resize(), which recreates the index wrappers
+             if( type_id >= _index_locks.size() )
+             {
+                _index_locks.resize( type_id + 1 );
+                _index_write_locked.resize( type_id + 1, false );
+                _snapshot_dirty.resize( type_id + 1, true );
+             }
+             if( !_index_locks[ type_id ] )
+                _index_locks[ type_id ].reset( new read_write_mutex() );
+
              auto new_index = new index<index_type>( *idx_ptr );
              _index_map[ type_id ].reset( new_index );
              _index_list.push_back( new_index );
+
+             if( type_id >= _snapshot_copy_destroyers.size() )
+                _snapshot_copy_destroyers.resize( type_id + 1 );
+#ifndef ENABLE_STD_ALLOCATOR
+             _snapshot_copy_destroyers[ type_id ] = [this]( void* copy ) { _segment->destroy_ptr( static_cast< MultiIndexType* >( copy ) ); };
+#else
+             _snapshot_copy_destroyers[ type_id ] = []( void* copy ) { delete static_cast< MultiIndexType* >( copy ); };
+#endif
+             free_orphaned_snapshot_copies( type_id );
          }
 
          read_write_mutex_manager                                    _rw_manager;
+
+         lock_mode                                                   _lock_mode = global_locking;
+         read_write_mutex                                            _writer_mutex;
+         vector< unique_ptr< read_write_mutex > >                    _index_locks;         ///< by type_id, index_locking only
+         vector< bool >                                              _index_write_locked;  ///< by type_id, held by the writer
+         vector< uint16_t >                                          _write_locked_ids;
+         bool                                                        _in_index_write_scope = false;
 #ifndef ENABLE_STD_ALLOCATOR
          unique_ptr<bip::managed_mapped_file>                        _segment;
          unique_ptr<bip::managed_mapped_file>                        _meta;
@@ -1103,6 +1570,32 @@ namespace chainbase {
 
          int32_t                                                     _undo_session_count = 0;
          size_t                                                      _file_size = 0;
+
+         char*                                                       _reserved_base = nullptr;   ///< the segment is mapped at the start of this range
+         size_t                                                      _reserved_size = 0;
+         size_t                                                      _mapped_size = 0;           ///< mapped by _segment, the rest of _file_size by grow_in_place
+         size_t                                                      _auto_grow_min_free = 0;
+         size_t                                                      _auto_grow_increment = 0;
+
+#ifndef ENABLE_STD_ALLOCATOR
+         struct snapshot_copy_record
+         {
+            uint16_t                                                 type_id;
+            bip::offset_ptr< void >                                  copy;
+         };
+         typedef bip::vector< snapshot_copy_record, allocator< snapshot_copy_record > > snapshot_copy_list;
+
+         snapshot_copy_list*                                         _snapshot_copy_list = nullptr;   ///< in the segment, every copy not freed yet
+#endif
+         vector< std::function< std::shared_ptr< const void >() > >  _snapshot_copiers;    ///< by type_id
+         vector< std::function< void( void* ) > >                    _snapshot_copy_destroyers;   ///< by type_id
+         std::mutex                                                  _released_snapshot_copies_mutex;
+         vector< std::pair< uint16_t, void* > >                      _released_snapshot_copies;
+         vector< bool >                                              _snapshot_dirty;      ///< by type_id, changed since the last snapshot
+         std::atomic< int64_t >                                      _snapshot_copies{ 0 };
+         std::shared_ptr< const snapshot >                           _snapshot;
+
+         unique_ptr< background_flush >                              _background_flush;
    };
 
    template<typename Object, typename... Args>
@@ -1,7 +1,20 @@
 #include <chainbase/chainbase.hpp>
 #include <boost/array.hpp>
 
+#ifdef _WIN32
+#include <boost/interprocess/detail/win32_api.hpp>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 namespace chainbase {
 
@@ -33,6 +46,124 @@ namespace chainbase {
       bool                    windows = false;
    };
 
+   /// Address space kept free after the segment so it can grow without moving, at least 4x the file
+   static const uint64_t min_address_reserve = uint64_t( 1 ) << 40;
+
+   /// Small enough that stopping a background flush never waits long on a chunk
+   static const size_t flush_chunk_size = 16 * 1024 * 1024;
+
+   /**
+    * Walks the mapped file in chunks on its own thread. The mapping must outlive the object,
+    * the destructor stops after the chunk in progress and drops the rest of the backlog.
+    *
+    * msync needs a page aligned address, so chunks are rounded up to whole pages and the
+    * cursor always stays on a page boundary whatever byte counts are requested.
+    */
+   class background_flush
+   {
+      public:
+         background_flush( char* base, size_t size ) :
+            _base( base ), _size( size ), _page( bip::mapped_region::get_page_size() )
+         {
+            _thread = std::thread( [this]() { run(); } );
+         }
+
+         ~background_flush()
+         {
+            {
+               std::lock_guard< std::mutex > guard( _mutex );
+               _stop = true;
+            }
+            _cv.notify_all();
+            _thread.join();
+         }
+
+         void request( size_t bytes )
+         {
+            {
+               std::lock_guard< std::mutex > guard( _mutex );
+               _pending = std::min( _pending + bytes, _size );
+            }
+            _cv.notify_all();
+         }
+
+         /// Returns the first error since the last call, 0 if every chunk was written back
+         int wait()
+         {
+            std::unique_lock< std::mutex > guard( _mutex );
+            _cv.wait( guard, [this]() { return _pending == 0 || _stop; } );
+            int error = _error;
+            _error = 0;
+            return error;
+         }
+
+         size_t cursor()
+         {
+            std::lock_guard< std::mutex > guard( _mutex );
+            return _cursor;
+         }
+
+      private:
+         void run()
+         {
+            std::unique_lock< std::mutex > guard( _mutex );
+            while( true )
+            {
+               _cv.wait( guard, [this]() { return _pending > 0 || _stop; } );
+               if( _stop )
+                  return;
+
+               size_t offset = _cursor;
+               size_t len = std::min( _pending, flush_chunk_size );
+               len = std::min( ( len + _page - 1 ) / _page * _page, _size - offset );
+               guard.unlock();
+               int error = 0;
+#ifdef _WIN32
+               if( !bip::winapi::flush_view_of_file( _base + offset, len ) )
+                  error = EIO;
+#else
+               if( msync( _base + offset, len, MS_SYNC ) != 0 )
+                  error = errno;
+#endif
+               if( error )
+                  std::cerr << "background flush of " << len << " bytes at offset " << offset
+                            << " failed: " << std::strerror( error ) << std::endl;
+               guard.lock();
+
+               if( error && !_error )
+                  _error = error;
+               _cursor = offset + len >= _size ? 0 : offset + len;
+               _pending -= std::min( _pending, len );
+               if( _pending == 0 )
+                  _cv.notify_all();
+            }
+         }
+
+         char*                      _base;
+         size_t                     _size;
+         size_t                     _page;
+         size_t                     _cursor = 0;
+         size_t                     _pending = 0;
+         int                        _error = 0;
+         bool                       _stop = false;
+         std::mutex                 _mutex;
+         std::condition_variable    _cv;
+         std::thread                _thread;
+   };
+
+   database::database() {}
+
+   database::~database()
+   {
+      drop_snapshots();
+      // the flush thread must be gone before the mapping is
+      _background_flush.reset();
+#ifndef ENABLE_STD_ALLOCATOR
+      _segment.reset();
+      release_address_space();
+#endif
+   }
+
    void database::open( const bfs::path& dir, uint32_t flags, size_t shared_file_size )
    {
       bfs::create_directories( dir );
@@ -53,23 +184,23 @@ namespace chainbase {
 
             _file_size = shared_file_size;
          }
-
-         _segment.reset( new bip::managed_mapped_file( bip::open_only,
-                                                       abs_path.generic_string().c_str()
-                                                       ) );
-
-         auto env = _segment->find< environment_check >( "environment" );
-         if( !env.first || !( *env.first == environment_check()) ) {
-            BOOST_THROW_EXCEPTION( std::runtime_error( "database created by a different compiler, build, or operating system" ) );
-         }
       } else {
          _file_size = shared_file_size;
-         _segment.reset( new bip::managed_mapped_file( bip::create_only,
-                                                       abs_path.generic_string().c_str(), shared_file_size
-                                                       ) );
-         _segment->find_or_construct< environment_check >( "environment" )();
+         // mapped wherever the OS likes just to initialize it, map_segment maps it for real
+         bip::managed_mapped_file segment( bip::create_only, abs_path.generic_string().c_str(), shared_file_size );
+         segment.find_or_construct< environment_check >( "environment" )();
+      }
+
+      map_segment( abs_path );
+
+      auto env = _segment->find< environment_check >( "environment" );
+      if( !env.first || !( *env.first == environment_check()) ) {
+         BOOST_THROW_EXCEPTION( std::runtime_error( "database created by a different compiler, build, or operating system" ) );
       }
 
+      _snapshot_copy_list = _segment->find_or_construct< snapshot_copy_list >( "snapshot_copies" )
+         ( allocator< snapshot_copy_record >( _segment->get_segment_manager() ) );
+
       _flock = bip::file_lock( abs_path.generic_string().c_str() );
       if( !_flock.try_lock() )
          BOOST_THROW_EXCEPTION( std::runtime_error( "could not gain write access to the shared memory file" ) );
@@ -83,23 +214,162 @@ namespace chainbase {
          _segment->flush();		//managed_mapped_file::flush
       if( _meta )
          _meta->flush();		//managed_mapped_file::flush
+#ifndef _WIN32
+      if( _segment && _file_size > _mapped_size )
+         msync( _reserved_base + _mapped_size, _file_size - _mapped_size, MS_SYNC );
+#endif
 #endif
    }
 
+   void database::map_segment( const bfs::path& file )
+   {
+#ifndef ENABLE_STD_ALLOCATOR
+      _segment.reset();
+      release_address_space();
+
+#ifndef _WIN32
+      if( sizeof( size_t ) >= 8 )
+      {
+         size_t reserve = size_t( std::max< uint64_t >( uint64_t( _file_size ) * 4, min_address_reserve ) );
+         void* base = mmap( nullptr, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+         if( base != MAP_FAILED )
+         {
+            /* The segment can only be given a hint, which the OS may skip unless it has room to spare
+             * around it, so the whole range is freed for it. The rest is reserved again right after,
+             * if another thread took part of it in between the segment just cannot grow in place.
+             */
+            munmap( base, reserve );
+            try
+            {
+               _segment.reset( new bip::managed_mapped_file( bip::open_only, file.generic_string().c_str(), base ) );
+            }
+            catch( const bip::interprocess_exception& ) {}
+
+            size_t page = bip::mapped_region::get_page_size();
+            size_t mapped = ( _file_size + page - 1 ) / page * page;
+            if( _segment && mapped < reserve )
+            {
+               char* rest = static_cast< char* >( base ) + mapped;
+               void* result = mmap( rest, reserve - mapped, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+               if( result == rest )
+               {
+                  _reserved_base = static_cast< char* >( base );
+                  _reserved_size = reserve;
+               }
+               else if( result != MAP_FAILED )
+               {
+                  munmap( result, reserve - mapped );
+               }
+            }
+         }
+      }
+#endif
+
+      if( !_segment )
+         _segment.reset( new bip::managed_mapped_file( bip::open_only, file.generic_string().c_str() ) );
+      _mapped_size = _file_size;
+#endif
+   }
+
+   bool database::grow_in_place( size_t new_size )
+   {
+#if !defined( ENABLE_STD_ALLOCATOR ) && !defined( _WIN32 )
+      size_t page = bip::mapped_region::get_page_size();
+      new_size = ( new_size + page - 1 ) / page * page;
+
+      if( !_segment || _segment->get_address() != _reserved_base || new_size <= _file_size
+         || new_size > _reserved_size || _file_size % page != 0 )
+         return false;
+
+      auto abs_path = bfs::absolute( _data_dir / "shared_memory.bin" );
+      int fd = ::open( abs_path.generic_string().c_str(), O_RDWR );
+      if( fd < 0 )
+         return false;
+
+      // MAP_FIXED replaces the reserved pages, the mapping stays contiguous and nothing moves
+      bool mapped = ::ftruncate( fd, new_size ) == 0
+         && mmap( _reserved_base + _file_size, new_size - _file_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_FIXED, fd, _file_size ) != MAP_FAILED;
+      ::close( fd );
+
+      // a file longer than the segment is harmless, the segment manager only uses what it was told about
+      if( !mapped )
+         return false;
+
+      _background_flush.reset();
+      // growing rewrites the allocator's free tree, nothing else may be freeing in the segment
+      free_released_snapshot_copies();
+      _segment->get_segment_manager()->grow( new_size - _file_size );
+      _file_size = new_size;
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   void database::release_address_space()
+   {
+#ifndef _WIN32
+      if( _reserved_base )
+         munmap( _reserved_base, _reserved_size );
+#endif
+      _reserved_base = nullptr;
+      _reserved_size = 0;
+   }
+
+   void database::set_auto_grow( size_t min_free, size_t increment )
+   {
+      _auto_grow_min_free = min_free;
+      _auto_grow_increment = increment;
+   }
+
+   void database::flush_async( size_t bytes )
+   {
+#ifndef ENABLE_STD_ALLOCATOR
+      if( !_segment || bytes == 0 )
+         return;
+
+      if( !_background_flush )
+         _background_flush.reset( new background_flush( static_cast< char* >( _segment->get_address() ), _file_size ) );
+      _background_flush->request( bytes );
+#endif
+   }
+
+   void database::wait_for_flush()
+   {
+      int error = _background_flush ? _background_flush->wait() : 0;
+      if( error )
+         BOOST_THROW_EXCEPTION( std::runtime_error( std::string( "background flush failed: " ) + std::strerror( error ) ) );
+   }
+
+   size_t database::flush_cursor()const
+   {
+      return _background_flush ? _background_flush->cursor() : 0;
+   }
+
    void database::close()
    {
+      drop_snapshots();
+      _background_flush.reset();
 #ifndef ENABLE_STD_ALLOCATOR
+      _snapshot_copy_list = nullptr;
       _segment.reset();
       _meta.reset();
+      release_address_space();
       _data_dir = bfs::path();
 #endif
    }
 
    void database::wipe( const bfs::path& dir )
    {
+      drop_snapshots();
+      _background_flush.reset();
+      _snapshot_copiers.clear();
 #ifndef ENABLE_STD_ALLOCATOR
+      _snapshot_copy_list = nullptr;
       _segment.reset();
       _meta.reset();
+      release_address_space();
       bfs::remove_all( dir / "shared_memory.bin" );
       bfs::remove_all( dir / "shared_memory.meta" );
       _data_dir = bfs::path();
@@ -110,9 +380,27 @@ namespace chainbase {
 
    void database::resize( size_t new_shared_file_size )
    {
+      if( grow_in_place( new_shared_file_size ) )
+         return;
+
       if( _undo_session_count )
          BOOST_THROW_EXCEPTION( std::runtime_error( "Cannot resize shared memory file while undo session is active" ) );
 
+      // every index is about to move, keep the readers out of all of them
+      if( _lock_mode == index_locking )
+      {
+         for( const auto& idx : _index_list )
+            lock_index_for_write( idx->type_id() );
+      }
+      drop_snapshots();
+      _background_flush.reset();
+
+      // the index wrappers are recreated below, the extensions attached to them are carried over
+      vector< index_extensions > extensions( _index_map.size() );
+      for( const auto& idx : _index_list )
+         extensions[ idx->type_id() ] = idx->get_index_extensions();
+
+      _snapshot_copy_list = nullptr;
       _segment.reset();
       _meta.reset();
 
@@ -125,6 +413,10 @@ namespace chainbase {
       {
          index_type->add_index( *this );
       }
+
+      for( size_t type_id = 0; type_id < extensions.size(); ++type_id )
+         for( const auto& ext : extensions[ type_id ] )
+            _index_map[ type_id ]->add_index_extension( ext );
    }
 
    void database::set_require_locking( bool enable_require_locking )
@@ -143,8 +435,167 @@ namespace chainbase {
    }
 #endif
 
+   database::index_read_locks::index_read_locks( const std::vector< read_write_mutex* >& mutexes, uint64_t wait_micro )
+   {
+      auto deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds( wait_micro );
+      _locks.reserve( mutexes.size() );
+
+      size_t i = 0;
+      while( i < mutexes.size() )
+      {
+#ifndef ENABLE_STD_ALLOCATOR
+         _locks.emplace_back( *mutexes[i], bip::defer_lock_type() );
+#else
+         _locks.emplace_back( *mutexes[i], boost::defer_lock_t() );
+#endif
+         if( _locks.back().try_lock() )
+         {
+            ++i;
+            continue;
+         }
+
+         // The writer may be waiting for one of the indices already locked, so let go of them
+         // before waiting for this one and start over once it is free.
+         _locks.clear();
+#ifndef ENABLE_STD_ALLOCATOR
+         read_lock busy( *mutexes[i], bip::defer_lock_type() );
+#else
+         read_lock busy( *mutexes[i], boost::defer_lock_t() );
+#endif
+         if( !wait_micro )
+            busy.lock();
+         else if( !busy.timed_lock( deadline ) )
+            BOOST_THROW_EXCEPTION( lock_exception() );
+         busy.unlock();
+         i = 0;
+      }
+   }
+
+   void database::lock_index_for_write( uint16_t type_id )
+   {
+      // outside of with_write_lock nobody else is expected to touch the database, as with global_locking
+      if( !_in_index_write_scope || _index_write_locked[ type_id ] )
+         return;
+
+      _index_locks[ type_id ]->lock();
+      _index_write_locked[ type_id ] = true;
+      _write_locked_ids.push_back( type_id );
+   }
+
+   void database::before_undo()
+   {
+      for( const auto& idx : _index_list )
+      {
+         if( !idx->has_undo_changes() )
+            continue;
+
+         if( _lock_mode == index_locking )
+            lock_index_for_write( idx->type_id() );
+         _snapshot_dirty[ idx->type_id() ] = true;
+      }
+   }
+
+   void database::publish_snapshot()
+   {
+      free_released_snapshot_copies();
+      if( _snapshot_copiers.empty() )
+         return;
+
+      auto prev = std::atomic_load( &_snapshot );
+      auto next = std::make_shared< snapshot >();
+      next->_revision = revision();
+      next->_indices.resize( _snapshot_copiers.size() );
+
+      for( size_t id = 0; id < _snapshot_copiers.size(); ++id )
+      {
+         if( !_snapshot_copiers[ id ] )
+            continue;
+
+         if( !_snapshot_dirty[ id ] && prev && prev->_indices.size() > id && prev->_indices[ id ] )
+            next->_indices[ id ] = prev->_indices[ id ];
+         else
+            next->_indices[ id ] = _snapshot_copiers[ id ]();
+         _snapshot_dirty[ id ] = false;
+      }
+
+      std::atomic_store( &_snapshot, std::shared_ptr< const snapshot >( std::move( next ) ) );
+   }
+
+   void database::drop_snapshots()
+   {
+      std::atomic_store( &_snapshot, std::shared_ptr< const snapshot >() );
+      while( _snapshot_copies.load() > 0 )
+         boost::this_thread::sleep_for( boost::chrono::milliseconds( 1 ) );
+      free_released_snapshot_copies();
+      _snapshot_dirty.assign( _snapshot_dirty.size(), true );
+   }
+
+   void database::release_snapshot_copy( uint16_t type_id, void* copy )
+   {
+      {
+         std::lock_guard< std::mutex > guard( _released_snapshot_copies_mutex );
+         _released_snapshot_copies.emplace_back( type_id, copy );
+      }
+      --_snapshot_copies;
+   }
+
+   void database::free_released_snapshot_copies()
+   {
+      vector< std::pair< uint16_t, void* > > released;
+      {
+         std::lock_guard< std::mutex > guard( _released_snapshot_copies_mutex );
+         released.swap( _released_snapshot_copies );
+      }
+
+      for( const auto& item : released )
+      {
+#ifndef ENABLE_STD_ALLOCATOR
+         if( _snapshot_copy_list )
+         {
+            auto record = std::find_if( _snapshot_copy_list->begin(), _snapshot_copy_list->end(),
+               [&item]( const snapshot_copy_record& r ) { return r.copy.get() == item.second; } );
+            if( record != _snapshot_copy_list->end() )
+               _snapshot_copy_list->erase( record );
+         }
+#endif
+         _snapshot_copy_destroyers[ item.first ]( item.second );
+      }
+   }
+
+   void database::free_orphaned_snapshot_copies( uint16_t type_id )
+   {
+#ifndef ENABLE_STD_ALLOCATOR
+      if( !_snapshot_copy_list )
+         return;
+
+      for( auto record = _snapshot_copy_list->begin(); record != _snapshot_copy_list->end(); )
+      {
+         if( record->type_id == type_id )
+         {
+            void* copy = record->copy.get();
+            record = _snapshot_copy_list->erase( record );
+            _snapshot_copy_destroyers[ type_id ]( copy );
+         }
+         else
+            ++record;
+      }
+#endif
+   }
+
+   void database::release_index_write_locks()
+   {
+      for( uint16_t id : _write_locked_ids )
+      {
+         _index_locks[ id ]->unlock();
+         _index_write_locked[ id ] = false;
+      }
+      _write_locked_ids.clear();
+      _in_index_write_scope = false;
+   }
+
    void database::undo()
    {
+      before_undo();
       for( auto& item : _index_list )
       {
          item->undo();
@@ -169,6 +620,13 @@ namespace chainbase {
 
    void database::undo_all()
    {
+      for( const auto& idx : _index_list )
+      {
+         if( _lock_mode == index_locking )
+            lock_index_for_write( idx->type_id() );
+         _snapshot_dirty[ idx->type_id() ] = true;
+      }
+
       for( auto& item : _index_list )
       {
          item->undo_all();
@@ -182,7 +640,9 @@ namespace chainbase {
       for( auto& item : _index_list ) {
          _sub_sessions.push_back( item->start_undo_session() );
       }
-      return session( std::move( _sub_sessions ), _undo_session_count );
+      session s( std::move( _sub_sessions ), _undo_session_count );
+      s._db = this;
+      return s;
    }
 
 }  // namespace chainbase
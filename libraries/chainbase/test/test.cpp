@@ -7,7 +7,11 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include <future>
 #include <iostream>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 using namespace chainbase;
 using namespace boost::multi_index;
@@ -38,6 +42,27 @@ typedef multi_index_container<
 
 CHAINBASE_SET_INDEX_TYPE( book, book_index )
 
+struct author : public chainbase::object<1, author> {
+
+   template<typename Constructor, typename Allocator>
+    author(  Constructor&& c, Allocator&& a ) {
+       c(*this);
+    }
+
+    id_type id;
+    int books = 0;
+};
+
+typedef multi_index_container<
+  author,
+  indexed_by<
+     ordered_unique< member<author,author::id_type,&author::id> >
+  >,
+  chainbase::allocator<author>
+> author_index;
+
+CHAINBASE_SET_INDEX_TYPE( author, author_index )
+
 
 BOOST_AUTO_TEST_CASE( open_and_create ) {
    boost::filesystem::path temp = boost::filesystem::unique_path();
@@ -136,4 +161,467 @@ BOOST_AUTO_TEST_CASE( open_and_create ) {
    }
 }
 
+static std::vector< std::tuple< int64_t, int, int > > dump_books( const chainbase::database& db )
+{
+   std::vector< std::tuple< int64_t, int, int > > result;
+   for( const auto& b : db.get_index< book_index >().indices() )
+      result.emplace_back( b.id._id, b.a, b.b );
+   return result;
+}
+
+BOOST_AUTO_TEST_CASE( undo_modify_remove_create ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      for( int i = 0; i < 10; ++i )
+         db.create<book>( [&]( book& b ) { b.a = i; b.b = i; } );
+      const auto before = dump_books( db );
+
+      {
+         auto session = db.start_undo_session();
+         db.modify( db.get( book::id_type(3) ), [&]( book& b ) { b.a = 100; } );
+         db.modify( db.get( book::id_type(3) ), [&]( book& b ) { b.a = 101; } );
+         db.modify( db.get( book::id_type(5) ), [&]( book& b ) { b.b = 102; } );
+         db.remove( db.get( book::id_type(5) ) );            /// modified then removed
+         db.remove( db.get( book::id_type(1) ) );
+         const auto& created = db.create<book>( [&]( book& b ) { b.a = 103; } );
+         db.modify( created, [&]( book& b ) { b.b = 104; } );
+         db.create<book>( [&]( book& b ) { b.a = 105; } );
+         db.remove( db.get( book::id_type(10) ) );           /// created then removed
+         BOOST_REQUIRE_EQUAL( db.get_index< book_index >().indices().size(), 9u );
+      }
+      BOOST_REQUIRE( dump_books( db ) == before );
+
+      const auto& next = db.create<book>( [&]( book& b ) { b.a = 106; } );
+      BOOST_REQUIRE_EQUAL( next.id._id, 10 );                /// ids handed out during the session are reused
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( squash_sessions ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      for( int i = 0; i < 10; ++i )
+         db.create<book>( [&]( book& b ) { b.a = i; b.b = i; } );
+      const auto before = dump_books( db );
+
+      auto outer = db.start_undo_session();
+      db.modify( db.get( book::id_type(2) ), [&]( book& b ) { b.a = 200; } );
+      db.modify( db.get( book::id_type(4) ), [&]( book& b ) { b.a = 201; } );
+      db.create<book>( [&]( book& b ) { b.a = 202; } );
+      db.create<book>( [&]( book& b ) { b.a = 203; } );
+      {
+         auto inner = db.start_undo_session();
+         db.modify( db.get( book::id_type(2) ), [&]( book& b ) { b.a = 300; } );   /// upd + upd
+         db.remove( db.get( book::id_type(4) ) );                                /// upd + del
+         db.modify( db.get( book::id_type(10) ), [&]( book& b ) { b.b = 301; } );  /// new + upd
+         db.remove( db.get( book::id_type(11) ) );                               /// new + del
+         db.modify( db.get( book::id_type(0) ), [&]( book& b ) { b.a = 302; } );   /// nop + upd
+         db.remove( db.get( book::id_type(9) ) );                                /// nop + del
+         db.create<book>( [&]( book& b ) { b.a = 303; } );                       /// nop + new
+         inner.squash();
+      }
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(2) ).a, 300 );
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(10) ).b, 301 );
+      BOOST_REQUIRE( db.find( book::id_type(4) ) == nullptr );
+      BOOST_REQUIRE( db.find( book::id_type(11) ) == nullptr );
+
+      {
+         auto inner = db.start_undo_session();
+         db.modify( db.get( book::id_type(0) ), [&]( book& b ) { b.a = 400; } );   /// upd + upd across a second squash
+         db.modify( db.get( book::id_type(7) ), [&]( book& b ) { b.a = 401; } );
+         inner.squash();
+      }
+
+      outer.undo();
+      BOOST_REQUIRE( dump_books( db ) == before );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( squash_unsorted_sessions ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*32 );
+      db.add_index< book_index >();
+
+      const int count = 2000;
+      for( int i = 0; i < count; ++i )
+         db.create<book>( [&]( book& b ) { b.a = i; b.b = i; } );
+      const auto before = dump_books( db );
+
+      // ids in a scattered order, so entries are saved out of order and the sorted front is merged many times
+      uint32_t seed = 1;
+      auto next_id = [&]() { seed = seed * 1103515245 + 12345; return book::id_type( ( seed >> 8 ) % count ); };
+
+      auto outer = db.start_undo_session();
+      for( int i = 0; i < 500; ++i )
+         db.modify( db.get( next_id() ), [&]( book& b ) { b.a += 1; } );
+
+      for( int t = 0; t < 20; ++t )
+      {
+         auto inner = db.start_undo_session();
+         for( int i = 0; i < 100; ++i )
+         {
+            auto id = next_id();
+            if( db.find( id ) == nullptr )
+               continue;
+            if( i % 10 == 0 )
+               db.remove( db.get( id ) );
+            else
+               db.modify( db.get( id ), [&]( book& b ) { b.b += 1; } );
+         }
+         db.create<book>( [&]( book& b ) { b.a = -t; } );
+         inner.squash();
+      }
+
+      {
+         const auto squashed = dump_books( db );
+         auto inner = db.start_undo_session();
+         for( int i = 0; i < 300; ++i )
+         {
+            auto id = next_id();
+            if( db.find( id ) != nullptr )
+               db.modify( db.get( id ), [&]( book& b ) { b.a = -1; } );
+         }
+         inner.undo();
+         BOOST_REQUIRE( dump_books( db ) == squashed );
+      }
+
+      outer.undo();
+      BOOST_REQUIRE( dump_books( db ) == before );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( index_locking ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+      db.add_index< author_index >();
+      db.set_lock_mode( chainbase::database::index_locking );
+
+      db.with_write_lock( [&]()
+      {
+         db.create<book>( []( book& b ) { b.a = 1; } );
+         db.create<author>( []( author& a ) { a.books = 1; } );
+      });
+
+      std::promise< void > modified, checked;
+      std::thread writer( [&]()
+      {
+         db.with_write_lock( [&]()
+         {
+            db.modify( db.get( book::id_type(0) ), []( book& b ) { b.a = 2; } );
+            modified.set_value();
+            checked.get_future().wait();
+         });
+      });
+      modified.get_future().wait();
+
+      /// the writer only holds the book index
+      int books = db.with_index_read_lock< author_index >( [&]() { return db.get( author::id_type(0) ).books; }, 1000 );
+      BOOST_REQUIRE_EQUAL( books, 1 );
+      BOOST_CHECK_THROW( ( db.with_index_read_lock< author_index, book_index >( [](){}, 1000 ) ), chainbase::lock_exception );
+      BOOST_CHECK_THROW( db.with_read_lock( [](){}, 1000 ), chainbase::lock_exception );
+
+      checked.set_value();
+      writer.join();
+
+      int a = db.with_index_read_lock< book_index >( [&]() { return db.get( book::id_type(0) ).a; }, 1000 );
+      BOOST_REQUIRE_EQUAL( a, 2 );
+
+      /// undoing a session locks the indices it changes
+      auto session = db.start_undo_session();
+      db.modify( db.get( author::id_type(0) ), []( author& a ) { a.books = 2; } );
+      db.with_write_lock( [&]()
+      {
+         session.undo();
+         BOOST_CHECK_THROW( db.with_index_read_lock< author_index >( [](){}, 1000 ), chainbase::lock_exception );
+      });
+      BOOST_REQUIRE_EQUAL( db.with_index_read_lock< author_index >( [&]() { return db.get( author::id_type(0) ).books; } ), 1 );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( snapshots ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+      db.add_index< author_index >();
+
+      BOOST_REQUIRE( !db.get_snapshot() );
+      db.publish_snapshot();                                  /// nothing to publish yet
+      BOOST_REQUIRE( !db.get_snapshot() );
+
+      db.add_snapshot_index< book_index >();
+      db.add_snapshot_index< author_index >();
+
+      db.create<book>( []( book& b ) { b.a = 1; } );
+      db.create<author>( []( author& a ) { a.books = 1; } );
+      db.publish_snapshot();
+      auto first = db.get_snapshot();
+      BOOST_REQUIRE( first );
+
+      db.modify( db.get( book::id_type(0) ), []( book& b ) { b.a = 2; } );
+      db.create<book>( []( book& b ) { b.a = 3; } );
+      BOOST_REQUIRE_EQUAL( first->get( book::id_type(0) ).a, 1 );
+      BOOST_REQUIRE( first->find( book::id_type(1) ) == nullptr );
+
+      db.publish_snapshot();
+      auto second = db.get_snapshot();
+      BOOST_REQUIRE_EQUAL( second->get( book::id_type(0) ).a, 2 );
+      BOOST_REQUIRE_EQUAL( second->get( book::id_type(1) ).a, 3 );
+      BOOST_REQUIRE_EQUAL( first->get( book::id_type(0) ).a, 1 );
+
+      /// the unchanged author index is shared, the book index was copied
+      BOOST_REQUIRE( &first->get( author::id_type(0) ) == &second->get( author::id_type(0) ) );
+      BOOST_REQUIRE( &first->get( book::id_type(0) ) != &second->get( book::id_type(0) ) );
+
+      {
+         auto session = db.start_undo_session();
+         db.modify( db.get( author::id_type(0) ), []( author& a ) { a.books = 5; } );
+         db.publish_snapshot();
+         BOOST_REQUIRE_EQUAL( db.get_snapshot()->get( author::id_type(0) ).books, 5 );
+      }
+      db.publish_snapshot();                                  /// the undo changed the author index again
+      BOOST_REQUIRE_EQUAL( db.get_snapshot()->get( author::id_type(0) ).books, 1 );
+
+      first.reset();
+      second.reset();
+      db.close();
+      BOOST_REQUIRE( !db.get_snapshot() );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( snapshot_copies_freed_by_writer ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   boost::filesystem::path crashed = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+      db.add_snapshot_index< book_index >();
+
+      for( int i = 0; i < 1000; ++i )
+         db.create<book>( [i]( book& b ) { b.a = i; } );
+      db.publish_snapshot();
+      auto first = db.get_snapshot();
+
+      db.modify( db.get( book::id_type(0) ), []( book& b ) { b.a = -1; } );
+      db.publish_snapshot();
+      const size_t free_with_both = db.get_free_memory();
+
+      /// a reader drops the last reference, the writer frees the copy when it publishes next
+      std::thread( [&]() { first.reset(); } ).join();
+      BOOST_REQUIRE_EQUAL( db.get_free_memory(), free_with_both );
+      db.publish_snapshot();
+      BOOST_REQUIRE_GT( db.get_free_memory(), free_with_both );
+      const size_t free_with_one = db.get_free_memory();
+
+      /// a copy of the file taken while a snapshot is published looks like a crashed process
+      db.flush();
+      bfs::create_directories( crashed );
+      bfs::copy_file( temp / "shared_memory.bin", crashed / "shared_memory.bin" );
+
+      chainbase::database db2;
+      db2.open( crashed );
+      BOOST_REQUIRE_EQUAL( db2.get_free_memory(), free_with_one );
+      db2.add_index< book_index >();                          /// frees the orphaned copy
+      BOOST_REQUIRE_GT( db2.get_free_memory(), free_with_one );
+      BOOST_REQUIRE_EQUAL( db2.get( book::id_type(0) ).a, -1 );
+      BOOST_REQUIRE_EQUAL( db2.get_index< book_index >().indices().size(), 1000u );
+      db2.close();
+      db.close();
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      bfs::remove_all( crashed );
+      throw;
+   }
+   bfs::remove_all( temp );
+   bfs::remove_all( crashed );
+}
+
+BOOST_AUTO_TEST_CASE( flush_async ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      db.wait_for_flush();                                    /// nothing requested yet
+      for( int i = 0; i < 100; ++i )
+      {
+         db.create<book>( [i]( book& b ) { b.a = i; } );
+         db.flush_async( 1024*1024 );
+      }
+      db.wait_for_flush();
+
+      db.flush_async( 1024*1024*64 );                         /// capped at one pass over the file
+      db.resize( 1024*1024*16 );                              /// drops the backlog
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(99) ).a, 99 );
+
+      db.flush_async( 1024*1024*16 );
+      db.wait_for_flush();
+      db.flush_async( 1024*1024*16 );
+      db.close();
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( flush_async_unaligned ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      const size_t page = boost::interprocess::mapped_region::get_page_size();
+      const size_t bytes = db.get_max_memory() / 7 + 1;      /// what apply_block asks for, not a page multiple
+      const size_t chunk = ( bytes + page - 1 ) / page * page;
+
+      db.create<book>( []( book& b ) { b.a = 1; } );
+      db.flush_async( bytes );
+      db.wait_for_flush();
+      BOOST_REQUIRE_EQUAL( db.flush_cursor(), chunk );
+
+      for( int i = 0; i < 3; ++i )
+      {
+         db.create<book>( [i]( book& b ) { b.a = i; } );
+         db.flush_async( bytes );
+         BOOST_REQUIRE_NO_THROW( db.wait_for_flush() );       /// every later chunk starts on a page boundary
+         BOOST_REQUIRE_EQUAL( db.flush_cursor(), chunk * ( i + 2 ) );
+      }
+      BOOST_REQUIRE_EQUAL( db.flush_cursor() % page, 0u );
+      db.close();
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( clear_and_load ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+
+      for( int i = 0; i < 10; ++i )
+         db.create<book>( [i]( book& b ) { b.a = i; } );
+
+      {
+         auto session = db.start_undo_session();
+         BOOST_CHECK_THROW( db.get_mutable_index< book_index >().clear(), std::logic_error );   /// undo state
+      }
+
+      auto& idx = db.get_mutable_index< book_index >();
+      idx.clear();
+      BOOST_REQUIRE_EQUAL( idx.indices().size(), 0u );
+
+      idx.load( []( book& b ) { b.id = book::id_type(3); b.a = 3; } );
+      idx.load( []( book& b ) { b.id = book::id_type(7); b.a = 7; } );
+      BOOST_CHECK_THROW( idx.load( []( book& b ) { b.id = book::id_type(5); } ), std::logic_error );   /// out of order
+      BOOST_REQUIRE_EQUAL( idx.indices().size(), 2u );
+
+      const auto& created = db.create<book>( []( book& b ) { b.a = 8; } );   /// ids continue after the last loaded
+      BOOST_REQUIRE( created.id == book::id_type(8) );
+      BOOST_REQUIRE_EQUAL( db.get( book::id_type(7) ).a, 7 );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( grow_under_undo_session ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db;
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+      db.set_auto_grow( 1024*1024, 1024*1024*4 );
+
+      const size_t initial_size = db.get_max_memory();
+      const auto& first = db.create<book>( []( book& b ) { b.a = -1; } );
+      db.set_revision( 1 );
+
+      {
+         auto session = db.start_undo_session();
+         db.modify( first, []( book& b ) { b.a = -2; } );
+         for( int i = 0; i < 200000; ++i )                    /// far more than fits in 8MB
+            db.create<book>( [i]( book& b ) { b.a = i; } );
+
+         BOOST_REQUIRE_GT( db.get_max_memory(), initial_size );
+         BOOST_REQUIRE_EQUAL( db.get( book::id_type(200000) ).a, 199999 );
+         BOOST_REQUIRE( &first == &db.get( book::id_type(0) ) );   /// nothing moved
+
+         size_t grown_size = db.get_max_memory();
+         db.resize( grown_size + 1024*1024*8 );               /// explicit growth works inside the session too
+         BOOST_REQUIRE_EQUAL( db.get_max_memory(), grown_size + 1024*1024*8 );
+      }
+
+      BOOST_REQUIRE_EQUAL( db.get_index<book_index>().indices().size(), 1 );
+      BOOST_REQUIRE_EQUAL( first.a, -1 );
+
+      {
+         auto session = db.start_undo_session();
+         for( int i = 0; i < 200000; ++i )
+            db.create<book>( [i]( book& b ) { b.a = i; } );
+         session.push();
+      }
+      db.commit( db.revision() );
+      db.flush();
+
+      size_t final_size = db.get_max_memory();
+      db.close();
+
+      chainbase::database db2;
+      db2.open( temp );
+      db2.add_index< book_index >();
+      BOOST_REQUIRE_EQUAL( db2.get_max_memory(), final_size );
+      BOOST_REQUIRE_EQUAL( db2.get_index<book_index>().indices().size(), 200001 );
+      BOOST_REQUIRE_EQUAL( db2.get( book::id_type(200000) ).a, 199999 );
+
+      db2.create<book>( []( book& b ) { b.a = 5; } );      /// the grown part is usable after reopening
+      db2.close();
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
 // BOOST_AUTO_TEST_SUITE_END()
@@ -46,6 +46,28 @@ namespace graphene { namespace net {
   const core_message_type_enum check_firewall_reply_message::type            = core_message_type_enum::check_firewall_reply_message_type;
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum get_block_transactions_message::type          = core_message_type_enum::get_block_transactions_message_type;
+  const core_message_type_enum block_transactions_message::type              = core_message_type_enum::block_transactions_message_type;
+
+  compact_block_message::compact_block_message(const block_message& full, const item_hash_t& hash) :
+    block_message_hash(hash),
+    header(full.block)
+  {
+    short_ids.reserve(full.block.transactions.size());
+    for (const signed_transaction& trx : full.block.transactions)
+      short_ids.push_back(short_transaction_id(trx.id()));
+  }
+
+  bool get_block_transactions_message::indexes_fit_block(size_t transaction_count) const
+  {
+    if (indexes.size() > transaction_count)
+      return false;
+    for (size_t i = 0; i < indexes.size(); ++i)
+      if (indexes[i] >= transaction_count || (i > 0 && indexes[i] <= indexes[i - 1]))
+        return false;
+    return true;
+  }
 
 } } // graphene::net
 
@@ -23,7 +23,19 @@
  */
 #pragma once
 
-#define GRAPHENE_NET_PROTOCOL_VERSION                        106
+#define GRAPHENE_NET_PROTOCOL_VERSION                        108
+
+/**
+ * First protocol version sending confirm_message as signed block headers, older peers send
+ * whole blocks. Confirmations are neither advertised to nor fetched from older peers.
+ */
+#define GRAPHENE_NET_COMPACT_CONFIRM_PROTOCOL_VERSION        107
+
+/**
+ * First protocol version understanding compact_block_message. Blocks requested by these peers
+ * are sent as the header and short transaction ids when the block is still in the message cache.
+ */
+#define GRAPHENE_NET_COMPACT_BLOCK_PROTOCOL_VERSION          108
 
 /**
  * Define this to enable debugging code in the p2p network interface.
@@ -54,6 +66,7 @@
 #define GRAPHENE_NET_DEFAULT_P2P_PORT                        1776
 #define GRAPHENE_NET_DEFAULT_DESIRED_CONNECTIONS             20
 #define GRAPHENE_NET_DEFAULT_MAX_CONNECTIONS                 200
+#define GRAPHENE_NET_DEFAULT_MESSAGE_DECODE_THREADS          4
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
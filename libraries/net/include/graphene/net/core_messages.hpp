@@ -37,6 +37,7 @@
 #include <fc/io/enum_type.hpp>
 
 
+#include <cstring>
 #include <vector>
 
 namespace graphene { namespace net {
@@ -44,6 +45,7 @@ namespace graphene { namespace net {
   using gamebank::protocol::block_id_type;
   using gamebank::protocol::transaction_id_type;
   using gamebank::protocol::signed_block;
+  using gamebank::protocol::signed_block_header;
 
   typedef fc::ecc::public_key_data node_id_t;
   typedef fc::ripemd160 item_hash_t;
@@ -87,6 +89,9 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    get_block_transactions_message_type          = 5019,
+    block_transactions_message_type              = 5020,
     core_message_type_last                       = 5099
   };
 
@@ -116,17 +121,78 @@ namespace graphene { namespace net {
 
    };
 
+   /**
+    * Confirms blocks the sender has applied. Only the signed headers are sent, they are all
+    * confirm_block needs to check the producer and its signature, the blocks themselves travel
+    * in block_message. Blocks applied back to back are confirmed together in one message.
+    *
+    * A header packs to 111 bytes plus the witness name, so a confirmation no longer grows with
+    * the transactions of the block. For an empty block it is as large as the old message.
+    */
    struct confirm_message
    {
        static const core_message_type_enum type;
 
        confirm_message() {}
-       confirm_message(const signed_block& blk)
-           :block(blk), block_id(blk.id()) {}
+       confirm_message(const signed_block_header& header)
+           :headers(1, header) {}
+       confirm_message(std::vector<signed_block_header> h)
+           :headers(std::move(h)) {}
 
-       signed_block    block;
-       block_id_type   block_id;
+       std::vector<signed_block_header>   headers;
+   };
+
+   /// Identifies a transaction in a compact_block_message by the first 8 bytes of its id
+   inline uint64_t short_transaction_id(const transaction_id_type& id)
+   {
+      uint64_t result;
+      memcpy(&result, id.data(), sizeof(result));
+      return result;
+   }
+
+   /**
+    * Sent instead of a requested block_message to peers that understand it. The receiver
+    * takes the transactions from the ones it has already seen and asks for the rest with
+    * get_block_transactions_message, then handles the block as if the block_message had
+    * arrived.
+    */
+   struct compact_block_message
+   {
+      static const core_message_type_enum type;
+
+      compact_block_message() {}
+      compact_block_message(const block_message& full, const item_hash_t& hash);
+
+      item_hash_t              block_message_hash;   ///< id of the block_message this stands for
+      signed_block_header      header;
+      std::vector<uint64_t>    short_ids;            ///< short_transaction_id of every transaction in order
+   };
+
+   struct get_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      get_block_transactions_message() {}
+      get_block_transactions_message(const item_hash_t& block_message_hash, std::vector<uint32_t> indexes) :
+        block_message_hash(block_message_hash),
+        indexes(std::move(indexes))
+      {}
+
+      /// true if indexes are strictly increasing and all in a block of transaction_count transactions,
+      /// so the reply can't be larger than the block
+      bool indexes_fit_block(size_t transaction_count) const;
+
+      item_hash_t              block_message_hash;
+      std::vector<uint32_t>    indexes;
+   };
+
+   /// Reply to get_block_transactions_message, transactions are in the order they were requested
+   struct block_transactions_message
+   {
+      static const core_message_type_enum type;
 
+      item_hash_t                       block_message_hash;
+      std::vector<signed_transaction>   transactions;
    };
 
   struct item_ids_inventory_message
@@ -436,11 +502,17 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (get_block_transactions_message_type)
+                 (block_transactions_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
 FC_REFLECT( graphene::net::block_message, (block)(block_id) )
-FC_REFLECT( graphene::net::confirm_message, (block)(block_id) )
+FC_REFLECT( graphene::net::confirm_message, (headers) )
+FC_REFLECT( graphene::net::compact_block_message, (block_message_hash)(header)(short_ids) )
+FC_REFLECT( graphene::net::get_block_transactions_message, (block_message_hash)(indexes) )
+FC_REFLECT( graphene::net::block_transactions_message, (block_message_hash)(transactions) )
 
 FC_REFLECT( graphene::net::item_id, (item_type)
                                (item_hash) )
@@ -29,6 +29,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+
 namespace graphene { namespace net {
 
   /**
@@ -52,14 +54,15 @@ namespace graphene { namespace net {
   struct message : public message_header
   {
      std::vector<char> data;
+     std::shared_ptr<const void> unpacked; ///< data already unpacked by unpack_ahead, its type follows msg_type
 
      message(){}
 
      message( message&& m )
-     :message_header(m),data( std::move(m.data) ){}
+     :message_header(m),data( std::move(m.data) ),unpacked( std::move(m.unpacked) ){}
 
      message( const message& m )
-     :message_header(m),data( m.data ){}
+     :message_header(m),data( m.data ),unpacked( m.unpacked ){}
 
      /**
       *  Assumes that T::type specifies the message type
@@ -106,6 +109,27 @@ namespace graphene { namespace net {
               ("msg_type", msg_type)
               );
      }
+
+     /**
+      *  Unpacks data as T on the calling thread, so get() doesn't unpack it again.  Used by the
+      *  threads decoding received messages, data must not change afterwards.
+      */
+     template<typename T>
+     void unpack_ahead()
+     {
+        unpacked = std::make_shared<const T>( as<T>() );
+     }
+
+     /**
+      *  Same as as(), but without copying when unpack_ahead was called
+      */
+     template<typename T>
+     std::shared_ptr<const T> get()const
+     {
+        if( unpacked && msg_type == T::type )
+           return std::static_pointer_cast<const T>( unpacked );
+        return std::make_shared<const T>( as<T>() );
+     }
   };
 
 
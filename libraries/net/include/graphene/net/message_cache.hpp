@@ -0,0 +1,80 @@
+#pragma once
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
+#include <graphene/net/node.hpp>
+#include <graphene/net/config.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/tag.hpp>
+
+namespace graphene { namespace net {
+
+  /**
+   * Blocks and transactions the node has received recently, kept for the last
+   * GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS blocks to serve them to peers and to
+   * rebuild compact blocks from.
+   */
+  class blockchain_tied_message_cache
+  {
+  private:
+    static const uint32_t cache_duration_in_blocks = GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS;
+
+    struct message_hash_index{};
+    struct message_contents_hash_index{};
+    struct block_clock_index{};
+    struct message_info
+    {
+      message_hash_type message_hash;
+      message           message_body;
+      uint32_t          block_clock_when_received;
+
+      // for network performance stats
+      message_propagation_data propagation_data;
+      fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
+
+      message_info( const message_hash_type& message_hash,
+                    const message&           message_body,
+                    uint32_t                 block_clock_when_received,
+                    const message_propagation_data& propagation_data,
+                    fc::uint160_t            message_contents_hash ) :
+        message_hash( message_hash ),
+        message_body( message_body ),
+        block_clock_when_received( block_clock_when_received ),
+        propagation_data( propagation_data ),
+        message_contents_hash( message_contents_hash )
+      {
+        // only the bytes are kept, like for messages this node created
+        this->message_body.unpacked.reset();
+      }
+    };
+    typedef boost::multi_index_container
+      < message_info,
+          boost::multi_index::indexed_by< boost::multi_index::ordered_unique< boost::multi_index::tag<message_hash_index>,
+                                            boost::multi_index::member<message_info, message_hash_type, &message_info::message_hash> >,
+                                          boost::multi_index::ordered_non_unique< boost::multi_index::tag<message_contents_hash_index>,
+                                            boost::multi_index::member<message_info, fc::uint160_t, &message_info::message_contents_hash> >,
+                                          boost::multi_index::ordered_non_unique< boost::multi_index::tag<block_clock_index>,
+                                            boost::multi_index::member<message_info, uint32_t, &message_info::block_clock_when_received> > >
+      > message_cache_container;
+
+    message_cache_container _message_cache;
+
+    uint32_t block_clock;
+
+  public:
+    blockchain_tied_message_cache() :
+      block_clock( 0 )
+    {}
+    void block_accepted();
+    void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
+                      const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
+    message get_message( const message_hash_type& hash_of_message_to_lookup );
+    message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
+    /// The cached transaction whose id starts with short_id, nothing if none or more than one does
+    fc::optional<signed_transaction> find_transaction( uint64_t short_id ) const;
+    size_t size() const { return _message_cache.size(); }
+  };
+
+} } // graphene::net
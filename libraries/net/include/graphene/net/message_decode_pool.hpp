@@ -0,0 +1,40 @@
+#pragma once
+#include <graphene/net/message.hpp>
+
+#include <fc/crypto/aes.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   * Threads decrypting received messages and preparing them for the node, so the thread
+   * running the node only has to handle them. A connection waits for its message to be
+   * decoded before reading the next one, messages from one peer stay in order while other
+   * peers' messages are decoded on the other threads.
+   */
+  class message_decode_pool
+  {
+  public:
+    /// prepare_message is called on a pool thread for every decoded message, usually to unpack it, and must be thread safe
+    message_decode_pool(uint32_t thread_count, std::function<void(message&)> prepare_message);
+    ~message_decode_pool();
+
+    /**
+     * Decrypts received->data from offset on with decoder, truncates it to received->size and
+     * prepares it. Yields the calling fc task until done. The job keeps decoder and received
+     * alive, so the caller may be canceled while waiting.
+     */
+    void decode(const std::shared_ptr<fc::aes_decoder>& decoder, const std::shared_ptr<message>& received, size_t offset);
+
+  private:
+    std::vector<std::unique_ptr<fc::thread> > _threads;
+    std::function<void(message&)>             _prepare_message;
+    std::atomic<uint32_t>                     _next_thread;
+  };
+
+} } // graphene::net
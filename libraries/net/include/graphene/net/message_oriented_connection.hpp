@@ -24,6 +24,7 @@
 #pragma once
 #include <fc/network/tcp_socket.hpp>
 #include <graphene/net/message.hpp>
+#include <graphene/net/message_decode_pool.hpp>
 
 namespace graphene { namespace net {
 
@@ -37,6 +38,9 @@ namespace graphene { namespace net {
   public:
     virtual void on_message(message_oriented_connection* originating_connection, const message& received_message) = 0;
     virtual void on_connection_closed(message_oriented_connection* originating_connection) = 0;
+    /** returns the pool to decrypt and prepare the message with this header on, or nullptr
+     *  to decrypt it on the connection's own thread */
+    virtual message_decode_pool* get_message_decode_pool(const message_header& header) { return nullptr; }
   };
 
   /** uses a secure socket to create a connection that reads and writes a stream of `fc::net::message` objects */
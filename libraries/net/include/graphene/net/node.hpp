@@ -94,6 +94,16 @@ namespace graphene { namespace net {
           */
          virtual void handle_transaction( const graphene::net::trx_message& trx_msg ) = 0;
 
+         /**
+          *  @brief Called on a message decode thread for every block and transaction received, before
+          *         handle_block or handle_transaction is called for it on the p2p thread
+          *
+          *  Lets the client do thread safe work ahead of time, like recovering signature keys.  The
+          *  message is already unpacked, get() returns it without unpacking again.  It has not been
+          *  validated yet, errors thrown here are ignored.
+          */
+         virtual void prepare_message( const message& message_to_prepare ) {}
+
          /**
           *  @brief Called when a new message comes in from the network other than a
           *         block or a transaction.  Currently there are no other possible
@@ -25,6 +25,7 @@
 
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_database.hpp>
+#include <graphene/net/message_cache.hpp>
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
@@ -61,6 +62,26 @@ namespace graphene { namespace net
       node_id_t        requesting_peer;
     };
 
+    /// A compact_block_message waiting for the transactions we didn't have
+    struct partial_compact_block
+    {
+      partial_compact_block() {}
+      /// Takes the transactions of the block found in cache, the others are missing
+      partial_compact_block( const compact_block_message& block, const blockchain_tied_message_cache& cache );
+
+      /// Stores the transactions the peer sent for missing_indexes, false if it sent a different number
+      bool add_missing_transactions( const std::vector<signed_transaction>& missing_transactions );
+      /// The block_message made of the header and the transactions, nothing if it doesn't hash to the advertised one
+      fc::optional<message> rebuild() const;
+      /// Forgets every transaction so the whole block is fetched from the peer
+      void request_all();
+
+      compact_block_message            compact_block;
+      std::vector<signed_transaction>  transactions;     // same order as compact_block.short_ids
+      std::vector<uint32_t>            missing_indexes;  // indexes we asked the peer for
+      bool                             requested_all = false;
+    };
+
     class peer_connection;
     class peer_connection_delegate
     {
@@ -69,6 +90,7 @@ namespace graphene { namespace net
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
       virtual message get_message_for_item(const item_id& item) = 0;
+      virtual message_decode_pool* get_message_decode_pool(const message_header& header) { return nullptr; }
     };
 
     class peer_connection;
@@ -259,6 +281,7 @@ namespace graphene { namespace net
       timestamped_items_set_type inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+      std::map<item_hash_t, partial_compact_block> partial_compact_blocks; /// compact blocks from this peer we're fetching transactions for, by block_message hash
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -289,6 +312,7 @@ namespace graphene { namespace net
 
       void on_message(message_oriented_connection* originating_connection, const message& received_message) override;
       void on_connection_closed(message_oriented_connection* originating_connection) override;
+      message_decode_pool* get_message_decode_pool(const message_header& header) override;
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
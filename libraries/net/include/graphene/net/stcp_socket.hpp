@@ -45,6 +45,19 @@ class stcp_socket : public virtual fc::iostream
 
     virtual size_t   readsome( char* buffer, size_t max );
     virtual size_t   readsome( const std::shared_ptr<char>& buf, size_t len, size_t offset );
+    /** reads len bytes into buf + offset and decrypts them there with one decode call,
+     *  without going through the 4k read buffer.  len must be a multiple of 16 */
+    void             read_decrypted( const std::shared_ptr<char>& buf, size_t len, size_t offset = 0 );
+    /** reads len bytes without decrypting them, they must be decrypted with get_decoder()
+     *  before anything else is read.  len must be a multiple of 16 */
+    void             read_encrypted( const std::shared_ptr<char>& buf, size_t len, size_t offset = 0 );
+    const std::shared_ptr<fc::aes_decoder>& get_decoder() const { return _recv_aes; }
+
+    typedef std::pair<const char*, size_t> buffer_piece;
+    /** encrypts the pieces one after the other, zero padded to a multiple of 16, straight into one
+     *  buffer and sends it with a single write.  Returns the number of bytes sent.  What the peer
+     *  receives is the same as writing the padded concatenation with write() */
+    size_t           write_encrypted( const std::vector<buffer_piece>& pieces );
     virtual bool     eof()const;
 
     virtual size_t   writesome( const char* buffer, size_t len );
@@ -65,7 +78,7 @@ class stcp_socket : public virtual fc::iostream
     //uint32_t             _buf_len;
     fc::tcp_socket       _sock;
     fc::aes_encoder      _send_aes;
-    fc::aes_decoder      _recv_aes;
+    std::shared_ptr<fc::aes_decoder> _recv_aes; // shared with a message_decode_pool job decrypting on another thread
     std::shared_ptr<char> _read_buffer;
     std::shared_ptr<char> _write_buffer;
 #ifndef NDEBUG
@@ -0,0 +1,43 @@
+#pragma once
+#include <graphene/net/core_messages.hpp>
+
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   * Sync blocks the node has received but can't pass to the client yet, in a ring indexed by block number.
+   * The slot for block n is n % capacity and holds every block numbered n we've received, usually one,
+   * more if peers are on different forks.
+   *
+   * Only blocks less than capacity past the lowest block still needed on any branch are stored, so no two
+   * stored block numbers share a slot.  A slot holding another number holds either a block below the lowest
+   * one needed, which nobody needs anymore, or one left past the window after the lowest block needed went
+   * down (a peer on a lower fork showed up), which is dropped to be fetched again.
+   */
+  class sync_block_buffer
+  {
+  private:
+    struct slot
+    {
+      uint32_t                  block_number = 0;
+      std::vector<block_message> blocks;
+    };
+    std::vector<slot> _slots;
+    size_t            _size;
+
+  public:
+    explicit sync_block_buffer( uint32_t capacity ) :
+      _slots( std::max<uint32_t>( capacity, 1 ) ),
+      _size( 0 )
+    {}
+    void set_capacity( uint32_t capacity, uint32_t lowest_block_needed );
+    /// returns false if block_number is outside the window starting at lowest_block_needed, the block has to be fetched again later
+    bool insert( uint32_t block_number, const block_message& block, uint32_t lowest_block_needed );
+    const block_message* find( uint32_t block_number, const item_hash_t& block_id ) const;
+    void erase( uint32_t block_number, const item_hash_t& block_id );
+    uint32_t capacity() const { return _slots.size(); }
+    size_t size() const { return _size; }
+  };
+
+} } // graphene::net
@@ -0,0 +1,70 @@
+#include <graphene/net/message_cache.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <cstring>
+
+namespace graphene { namespace net {
+
+  void blockchain_tied_message_cache::block_accepted()
+  {
+    ++block_clock;
+    if( block_clock > cache_duration_in_blocks )
+      _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
+                                                    _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
+  }
+
+  void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
+                                                   const message_hash_type& hash_of_message_to_cache,
+                                                   const message_propagation_data& propagation_data,
+                                                   const fc::uint160_t& message_content_hash )
+  {
+    _message_cache.insert( message_info(hash_of_message_to_cache,
+                                       message_to_cache,
+                                       block_clock,
+                                       propagation_data,
+                                       message_content_hash ) );
+  }
+
+  message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
+  {
+    message_cache_container::index<message_hash_index>::type::const_iterator iter =
+       _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
+    if( iter != _message_cache.get<message_hash_index>().end() )
+      return iter->message_body;
+    FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
+  }
+
+  message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
+  {
+    if( hash_of_message_contents_to_lookup != fc::uint160_t() )
+    {
+      message_cache_container::index<message_contents_hash_index>::type::const_iterator iter =
+         _message_cache.get<message_contents_hash_index>().find(hash_of_message_contents_to_lookup );
+      if( iter != _message_cache.get<message_contents_hash_index>().end() )
+        return iter->propagation_data;
+    }
+    FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
+  }
+
+  fc::optional<signed_transaction> blockchain_tied_message_cache::find_transaction( uint64_t short_id ) const
+  {
+    // every id starting with the short id sorts at or after the short id followed by zeros
+    fc::uint160_t first_possible_id;
+    memcpy( first_possible_id._hash, &short_id, sizeof(short_id) );
+
+    fc::optional<signed_transaction> result;
+    const auto& index = _message_cache.get<message_contents_hash_index>();
+    for( auto iter = index.lower_bound( first_possible_id );
+         iter != index.end() && short_transaction_id( iter->message_contents_hash ) == short_id; ++iter )
+    {
+      if( iter->message_body.msg_type != trx_message_type )
+        continue;
+      if( result ) // two transactions share the short id, let the peer send the right one
+        return fc::optional<signed_transaction>();
+      result = iter->message_body.as<trx_message>().trx;
+    }
+    return result;
+  }
+
+} } // graphene::net
@@ -0,0 +1,51 @@
+#include <graphene/net/message_decode_pool.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <string>
+
+#ifdef DEFAULT_LOGGER
+# undef DEFAULT_LOGGER
+#endif
+#define DEFAULT_LOGGER "p2p"
+
+namespace graphene { namespace net {
+
+  message_decode_pool::message_decode_pool(uint32_t thread_count, std::function<void(message&)> prepare_message) :
+    _prepare_message(std::move(prepare_message)),
+    _next_thread(0)
+  {
+    FC_ASSERT(thread_count > 0);
+    for (uint32_t i = 0; i < thread_count; ++i)
+      _threads.emplace_back(new fc::thread("p2p decode " + std::to_string(i)));
+  }
+
+  message_decode_pool::~message_decode_pool()
+  {
+    for (auto& thread : _threads)
+      thread->quit();
+  }
+
+  void message_decode_pool::decode(const std::shared_ptr<fc::aes_decoder>& decoder, const std::shared_ptr<message>& received, size_t offset)
+  {
+    fc::thread& thread = *_threads[_next_thread++ % _threads.size()];
+    thread.async([this, decoder, received, offset]()
+    {
+      char* body = received->data.data() + offset;
+      decoder->decode(body, received->data.size() - offset, body);
+      received->data.resize(received->size); // truncate off the padding bytes
+
+      try
+      {
+        if (_prepare_message)
+          _prepare_message(*received);
+      }
+      catch (const fc::exception& e)
+      {
+        // the node rejects the message when it handles it
+        dlog("error preparing message of type ${type}: ${e}", ("type", received->msg_type)("e", e.to_string()));
+      }
+    }, "decode message").wait();
+  }
+
+} } // graphene::net
@@ -152,12 +152,14 @@ namespace graphene { namespace net {
 
       try
       {
-        message m;
         while( true )
         {
           char buffer[BUFFER_SIZE];
           _sock.read(buffer, BUFFER_SIZE);
           _bytes_received += BUFFER_SIZE;
+          // shared with the socket read and the decode pool, so we can be canceled while they still use it
+          std::shared_ptr<message> received = std::make_shared<message>();
+          message& m = *received;
           memcpy((char*)&m, buffer, sizeof(message_header));
 
           FC_ASSERT( m.size <= MAX_MESSAGE_SIZE, "", ("m.size",m.size)("MAX_MESSAGE_SIZE",MAX_MESSAGE_SIZE) );
@@ -167,7 +169,15 @@ namespace graphene { namespace net {
           std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), m.data.begin());
           if (remaining_bytes_with_padding)
           {
-            _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
+            std::shared_ptr<char> body(received, &m.data[LEFTOVER]);
+            message_decode_pool* decode_pool = _delegate->get_message_decode_pool(m);
+            if (decode_pool)
+            {
+              _sock.read_encrypted(body, remaining_bytes_with_padding);
+              decode_pool->decode(_sock.get_decoder(), received, LEFTOVER);
+            }
+            else
+              _sock.read_decrypted(body, remaining_bytes_with_padding);
             _bytes_received += remaining_bytes_with_padding;
           }
           m.data.resize(m.size); // truncate off the padding bytes
@@ -255,20 +265,11 @@ namespace graphene { namespace net {
 
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size;
         if( message_to_send.size > MAX_MESSAGE_SIZE )
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
-        //pad the message we send to a multiple of 16 bytes
-        size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
-
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        char* paddingSpace = padded_message.get() + sizeof(message_header) + message_to_send.size;
-        size_t toClean = size_with_padding - size_of_message_and_header;
-        memset(paddingSpace, 0, toClean);
-
-        _sock.write(padded_message.get(), size_with_padding);
+        // encrypted straight from the header and data, padded to a multiple of 16 bytes
+        size_t size_with_padding = _sock.write_encrypted({ stcp_socket::buffer_piece((const char*)&message_to_send, sizeof(message_header)),
+                                                           stcp_socket::buffer_piece(message_to_send.data.data(), message_to_send.size) });
         _sock.flush();
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
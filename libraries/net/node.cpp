@@ -30,6 +30,7 @@
 #include <forward_list>
 #include <iostream>
 #include <algorithm>
+#include <limits>
 #include <tuple>
 #include <boost/tuple/tuple.hpp>
 #include <boost/circular_buffer.hpp>
@@ -77,6 +78,7 @@
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/peer_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/sync_block_buffer.hpp>
 #include <graphene/net/config.hpp>
 #include <graphene/net/exceptions.hpp>
 
@@ -126,103 +128,6 @@ namespace graphene { namespace net {
   namespace detail
   {
     namespace bmi = boost::multi_index;
-    class blockchain_tied_message_cache
-    {
-    private:
-      static const uint32_t cache_duration_in_blocks = GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS;
-
-      struct message_hash_index{};
-      struct message_contents_hash_index{};
-      struct block_clock_index{};
-      struct message_info
-      {
-        message_hash_type message_hash;
-        message           message_body;
-        uint32_t          block_clock_when_received;
-
-        // for network performance stats
-        message_propagation_data propagation_data;
-        fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
-
-        message_info( const message_hash_type& message_hash,
-                      const message&           message_body,
-                      uint32_t                 block_clock_when_received,
-                      const message_propagation_data& propagation_data,
-                      fc::uint160_t            message_contents_hash ) :
-          message_hash( message_hash ),
-          message_body( message_body ),
-          block_clock_when_received( block_clock_when_received ),
-          propagation_data( propagation_data ),
-          message_contents_hash( message_contents_hash )
-        {}
-      };
-      typedef boost::multi_index_container
-        < message_info,
-            bmi::indexed_by< bmi::ordered_unique< bmi::tag<message_hash_index>,
-                                                  bmi::member<message_info, message_hash_type, &message_info::message_hash> >,
-                             bmi::ordered_non_unique< bmi::tag<message_contents_hash_index>,
-                                                      bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash> >,
-                             bmi::ordered_non_unique< bmi::tag<block_clock_index>,
-                                                      bmi::member<message_info, uint32_t, &message_info::block_clock_when_received> > >
-        > message_cache_container;
-
-      message_cache_container _message_cache;
-
-      uint32_t block_clock;
-
-    public:
-      blockchain_tied_message_cache() :
-        block_clock( 0 )
-      {}
-      void block_accepted();
-      void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
-                        const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
-      message get_message( const message_hash_type& hash_of_message_to_lookup );
-      message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
-      size_t size() const { return _message_cache.size(); }
-    };
-
-    void blockchain_tied_message_cache::block_accepted()
-    {
-      ++block_clock;
-      if( block_clock > cache_duration_in_blocks )
-        _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
-                                                      _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
-    }
-
-    void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
-                                                     const message_hash_type& hash_of_message_to_cache,
-                                                     const message_propagation_data& propagation_data,
-                                                     const fc::uint160_t& message_content_hash )
-    {
-      _message_cache.insert( message_info(hash_of_message_to_cache,
-                                         message_to_cache,
-                                         block_clock,
-                                         propagation_data,
-                                         message_content_hash ) );
-    }
-
-    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
-    {
-      message_cache_container::index<message_hash_index>::type::const_iterator iter =
-         _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
-      if( iter != _message_cache.get<message_hash_index>().end() )
-        return iter->message_body;
-      FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
-    }
-
-    message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
-    {
-      if( hash_of_message_contents_to_lookup != fc::uint160_t() )
-      {
-        message_cache_container::index<message_contents_hash_index>::type::const_iterator iter =
-           _message_cache.get<message_contents_hash_index>().find(hash_of_message_contents_to_lookup );
-        if( iter != _message_cache.get<message_contents_hash_index>().end() )
-          return iter->propagation_data;
-      }
-      FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
-    }
-
     // when requesting items from peers, we want to prioritize any blocks before
     // transactions, but otherwise request items in the order we heard about them
     struct prioritized_item_id
@@ -360,6 +265,7 @@ namespace graphene { namespace net {
       bool handle_confirm( const graphene::net::confirm_message& confirm_message) override;
       bool handle_block( const graphene::net::block_message& block_message, bool sync_mode, std::vector<fc::uint160_t>& contained_transaction_message_ids ) override;
       void handle_transaction( const graphene::net::trx_message& transaction_message ) override;
+      void prepare_message( const message& message_to_prepare ) override;
       std::vector<item_hash_t> get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
                                              uint32_t& remaining_item_count,
                                              uint32_t limit = 2000) override;
@@ -421,8 +327,7 @@ namespace graphene { namespace net {
       typedef std::unordered_map<graphene::net::block_id_type, fc::time_point> active_sync_requests_map;
 
       active_sync_requests_map              _active_sync_requests; /// list of sync blocks we've asked for from peers but have not yet received
-      std::list<graphene::net::block_message> _new_received_sync_items; /// list of sync blocks we've just received but haven't yet tried to process
-      std::list<graphene::net::block_message> _received_sync_items; /// list of sync blocks we've received, but can't yet process because we are still missing blocks that come earlier in the chain
+      sync_block_buffer                     _received_sync_items; /// sync blocks we've received, but can't yet process because we are still missing blocks that come earlier in the chain
       // @}
 
       fc::future<void> _process_backlog_of_sync_blocks_done;
@@ -492,6 +397,8 @@ namespace graphene { namespace net {
       std::vector<uint32_t> _hard_fork_block_numbers; /// list of all block numbers where there are hard forks
 
       blockchain_tied_message_cache _message_cache; /// cache message we have received and might be required to provide to other peers via inventory requests
+      std::unique_ptr<message_decode_pool> _message_decode_pool; /// created with the first message it decodes, from _node_configuration.message_decode_threads
+      fc::optional<compact_block_message> _last_compact_block_message; /// the last block sent compact, every peer fetching a new block asks for the same one
 
       fc::rate_limiting_group _rate_limiter;
 
@@ -550,6 +457,7 @@ namespace graphene { namespace net {
       void trigger_p2p_network_connect_loop();
 
       bool have_already_received_sync_item( const item_hash_t& item_hash );
+      uint32_t get_lowest_sync_block_needed();
       void request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request );
       void request_sync_items_from_peer( const peer_connection_ptr& peer, const std::vector<item_hash_t>& items_to_request );
       void fetch_sync_items_loop();
@@ -617,6 +525,19 @@ namespace graphene { namespace net {
       void on_item_ids_inventory_message( peer_connection* originating_peer,
                                           const item_ids_inventory_message& item_ids_inventory_message_received );
 
+      message get_compact_block_message( const message& full_block_message, const item_hash_t& block_message_hash );
+
+      void on_compact_block_message( peer_connection* originating_peer,
+                                     const compact_block_message& compact_block_message_received );
+
+      void on_get_block_transactions_message( peer_connection* originating_peer,
+                                              const get_block_transactions_message& get_block_transactions_message_received );
+
+      void on_block_transactions_message( peer_connection* originating_peer,
+                                          const block_transactions_message& block_transactions_message_received );
+
+      void process_rebuilt_compact_block( peer_connection* originating_peer, partial_compact_block partial_block );
+
       void on_closing_connection_message( peer_connection* originating_peer,
                                           const closing_connection_message& closing_connection_message_received );
 
@@ -642,6 +563,8 @@ namespace graphene { namespace net {
 
       void on_connection_closed(peer_connection* originating_peer) override;
 
+      message_decode_pool* get_message_decode_pool(const message_header& header) override;
+
       void send_sync_block_to_node_delegate(const graphene::net::block_message& block_message_to_send);
       void process_backlog_of_sync_blocks();
       void trigger_process_backlog_of_sync_blocks();
@@ -813,6 +736,7 @@ namespace graphene { namespace net {
       _is_firewalled(firewalled_state::unknown),
       _potential_peer_database_updated(false),
       _sync_items_to_fetch_updated(false),
+      _received_sync_items(GRAPHENE_NET_MAX_NUMBER_OF_BLOCKS_TO_PREFETCH),
       _suspend_fetching_sync_blocks(false),
       _items_to_fetch_updated(false),
       _items_to_fetch_sequence_counter(0),
@@ -1013,10 +937,19 @@ namespace graphene { namespace net {
     bool node_impl::have_already_received_sync_item( const item_hash_t& item_hash )
     {
       VERIFY_CORRECT_THREAD();
-      return std::find_if(_received_sync_items.begin(), _received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _received_sync_items.end() ||
-             std::find_if(_new_received_sync_items.begin(), _new_received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _new_received_sync_items.end();                          ;
+      return _received_sync_items.find(_delegate->get_block_number(item_hash), item_hash) != nullptr;
+    }
+
+    // the lowest numbered block at the front of any peer's list of items to get, on whichever branch it is.
+    // Sync blocks are only fetched and stored less than the buffer's capacity past it
+    uint32_t node_impl::get_lowest_sync_block_needed()
+    {
+      VERIFY_CORRECT_THREAD();
+      uint32_t lowest_block_needed = std::numeric_limits<uint32_t>::max();
+      for( const peer_connection_ptr& peer : _active_connections )
+        if( !peer->ids_of_items_to_get.empty() )
+          lowest_block_needed = std::min(lowest_block_needed, _delegate->get_block_number(peer->ids_of_items_to_get.front()));
+      return lowest_block_needed;
     }
 
     void node_impl::request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request )
@@ -1059,6 +992,17 @@ namespace graphene { namespace net {
             ASSERT_TASK_NOT_PREEMPTED();
             std::set<item_hash_t> sync_items_to_request;
 
+            // blocks further than the buffer's capacity past the lowest block we still need would have nowhere
+            // to go.  Split that window into contiguous ranges so every peer we're syncing with fetches a
+            // different part of it at the same time
+            uint32_t number_of_syncing_peers = 0;
+            for( const peer_connection_ptr& peer : _active_connections )
+              if( peer->we_need_sync_items_from_peer && !peer->ids_of_items_to_get.empty() )
+                ++number_of_syncing_peers;
+            uint64_t end_of_window = uint64_t(get_lowest_sync_block_needed()) + _received_sync_items.capacity();
+            uint32_t range_size = std::min(_node_configuration.maximum_blocks_per_peer_during_syncing,
+                                           std::max<uint32_t>(1, _received_sync_items.capacity() / std::max<uint32_t>(1, number_of_syncing_peers)));
+
             // for each idle peer that we're syncing with
             for( const peer_connection_ptr& peer : _active_connections )
             {
@@ -1068,22 +1012,30 @@ namespace graphene { namespace net {
               {
                 if (!peer->inhibit_fetching_sync_blocks)
                 {
-                  // loop through the items it has that we don't yet have on our blockchain
+                  // loop through the items it has that we don't yet have on our blockchain, looking for the
+                  // first range of them nobody is fetching
+                  std::vector<item_hash_t> range_to_request;
                   for( unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i )
                   {
                     item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
+                    if( _delegate->get_block_number(item_to_potentially_request) >= end_of_window )
+                      break;
                     // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
                     if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
                         sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
                         _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
                     {
                       // then schedule a request from this peer
-                      sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
+                      range_to_request.push_back(item_to_potentially_request);
                       sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _node_configuration.maximum_blocks_per_peer_during_syncing)
+                      if (range_to_request.size() >= range_size)
                         break;
                     }
+                    else if (!range_to_request.empty())
+                      break; // the range ends where another peer's range starts
                   }
+                  if (!range_to_request.empty())
+                    sync_item_requests_to_send[peer] = std::move(range_to_request);
                 }
               }
             }
@@ -1293,6 +1245,10 @@ namespace graphene { namespace net {
               //if (peer->inventory_peer_advertised_to_us.find(item_to_advertise) != peer->inventory_peer_advertised_to_us.end() )
               //   wdump((*peer->inventory_peer_advertised_to_us.find(item_to_advertise)));
 
+              if (item_to_advertise.item_type == confirm_message_type &&
+                  peer->core_protocol_version < GRAPHENE_NET_COMPACT_CONFIRM_PROTOCOL_VERSION)
+                continue;
+
               if (peer->inventory_advertised_to_peer.find(item_to_advertise) == peer->inventory_advertised_to_peer.end() &&
                   peer->inventory_peer_advertised_to_us.find(item_to_advertise) == peer->inventory_peer_advertised_to_us.end())
               {
@@ -1836,6 +1792,15 @@ namespace graphene { namespace net {
       case core_message_type_enum::confirm_message_type:
         process_confirm_message(originating_peer, received_message, message_hash);
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, *received_message.get<compact_block_message>());
+        break;
+      case core_message_type_enum::get_block_transactions_message_type:
+        on_get_block_transactions_message(originating_peer, received_message.as<get_block_transactions_message>());
+        break;
+      case core_message_type_enum::block_transactions_message_type:
+        on_block_transactions_message(originating_peer, *received_message.get<block_transactions_message>());
+        break;
       case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
         break;
@@ -2796,6 +2761,41 @@ namespace graphene { namespace net {
       return item_not_available_message(item);
     }
 
+    message_decode_pool* node_impl::get_message_decode_pool(const message_header& header)
+    {
+      VERIFY_CORRECT_THREAD();
+      // the rest are small enough to decrypt here faster than another thread could be woken
+      if (header.msg_type != trx_message_type &&
+          header.msg_type != block_message_type &&
+          header.msg_type != compact_block_message_type &&
+          header.msg_type != block_transactions_message_type)
+        return nullptr;
+
+      if (!_message_decode_pool && _node_configuration.message_decode_threads > 0)
+        _message_decode_pool.reset(new message_decode_pool(_node_configuration.message_decode_threads,
+                                                           [this](message& message_to_prepare) {
+                                                             // the handlers on the p2p thread get() what is unpacked here
+                                                             switch (message_to_prepare.msg_type)
+                                                             {
+                                                             case trx_message_type:
+                                                               message_to_prepare.unpack_ahead<trx_message>();
+                                                               _delegate->prepare_message(message_to_prepare);
+                                                               break;
+                                                             case block_message_type:
+                                                               message_to_prepare.unpack_ahead<graphene::net::block_message>();
+                                                               _delegate->prepare_message(message_to_prepare);
+                                                               break;
+                                                             case compact_block_message_type:
+                                                               message_to_prepare.unpack_ahead<compact_block_message>();
+                                                               break;
+                                                             case block_transactions_message_type:
+                                                               message_to_prepare.unpack_ahead<block_transactions_message>();
+                                                               break;
+                                                             }
+                                                           }));
+      return _message_decode_pool.get();
+    }
+
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
     {
       VERIFY_CORRECT_THREAD();
@@ -2815,9 +2815,17 @@ namespace graphene { namespace net {
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
                ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
+          {
             last_block_message_sent = requested_message;
+            // a block still in the cache is new, the peer has most likely seen its transactions already
+            if (originating_peer->core_protocol_version >= GRAPHENE_NET_COMPACT_BLOCK_PROTOCOL_VERSION)
+            {
+              reply_messages.push_back(get_compact_block_message(requested_message, item_hash));
+              continue;
+            }
+          }
+          reply_messages.push_back(requested_message);
           continue;
         }
         catch (fc::key_not_found_exception&)
@@ -2871,6 +2879,7 @@ namespace graphene { namespace net {
       if (regular_item_iter != originating_peer->items_requested_from_peer.end())
       {
         originating_peer->items_requested_from_peer.erase( regular_item_iter );
+        originating_peer->partial_compact_blocks.erase( requested_item.item_hash );
         originating_peer->inventory_peer_advertised_to_us.erase( requested_item );
         if (is_item_in_any_peers_inventory(requested_item))
           _items_to_fetch.insert(prioritized_item_id(requested_item, _items_to_fetch_sequence_counter++));
@@ -2898,6 +2907,137 @@ namespace graphene { namespace net {
       dlog("Peer doesn't have an item we're looking for, which is fine because we weren't looking for it");
     }
 
+    message node_impl::get_compact_block_message(const message& full_block_message, const item_hash_t& block_message_hash)
+    {
+      VERIFY_CORRECT_THREAD();
+      if (!_last_compact_block_message || _last_compact_block_message->block_message_hash != block_message_hash)
+        _last_compact_block_message = compact_block_message(full_block_message.as<graphene::net::block_message>(), block_message_hash);
+      return *_last_compact_block_message;
+    }
+
+    void node_impl::on_compact_block_message(peer_connection* originating_peer, const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = compact_block_message_received.block_message_hash;
+      if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_hash)) == originating_peer->items_requested_from_peer.end() ||
+          originating_peer->partial_compact_blocks.find(block_message_hash) != originating_peer->partial_compact_blocks.end())
+      {
+        wlog("received a compact block ${block_id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("block_id", compact_block_message_received.header.id()));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me a compact block that I didn't ask for, block_id: ${block_id}",
+                                                    ("block_id", compact_block_message_received.header.id())));
+        disconnect_from_peer(originating_peer, "You sent me a compact block that I didn't ask for", true, detailed_error);
+        return;
+      }
+
+      partial_compact_block partial_block(compact_block_message_received, _message_cache);
+
+      dlog("received compact block ${block_id} from peer ${endpoint}, missing ${missing} of ${count} transactions",
+           ("block_id", compact_block_message_received.header.id())
+           ("endpoint", originating_peer->get_remote_endpoint())
+           ("missing", partial_block.missing_indexes.size())
+           ("count", partial_block.transactions.size()));
+
+      if (partial_block.missing_indexes.empty())
+        process_rebuilt_compact_block(originating_peer, std::move(partial_block));
+      else
+      {
+        originating_peer->send_message(get_block_transactions_message(block_message_hash, partial_block.missing_indexes));
+        originating_peer->partial_compact_blocks[block_message_hash] = std::move(partial_block);
+      }
+    }
+
+    void node_impl::on_get_block_transactions_message(peer_connection* originating_peer, const get_block_transactions_message& get_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = get_block_transactions_message_received.block_message_hash;
+      graphene::net::block_message block;
+      try
+      {
+        block = _message_cache.get_message(block_message_hash).as<graphene::net::block_message>();
+      }
+      catch (fc::key_not_found_exception&)
+      {
+        // the block left the cache since we sent it, the peer will fetch it again
+        originating_peer->send_message(item_not_available_message(item_id(block_message_type, block_message_hash)));
+        return;
+      }
+
+      // repeated indexes would let a small request get a reply many times the size of the block
+      if (!get_block_transactions_message_received.indexes_fit_block(block.block.transactions.size()))
+      {
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You asked for ${requested} transactions of a block with ${count} transactions, "
+                                                           "indexes must be increasing and in the block",
+                                                    ("requested", get_block_transactions_message_received.indexes.size())
+                                                    ("count", block.block.transactions.size())));
+        disconnect_from_peer(originating_peer, "You asked for transactions that are not in the block", true, detailed_error);
+        return;
+      }
+
+      block_transactions_message reply;
+      reply.block_message_hash = block_message_hash;
+      reply.transactions.reserve(get_block_transactions_message_received.indexes.size());
+      for (uint32_t index : get_block_transactions_message_received.indexes)
+        reply.transactions.push_back(block.block.transactions[index]);
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_block_transactions_message(peer_connection* originating_peer, const block_transactions_message& block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      auto iter = originating_peer->partial_compact_blocks.find(block_transactions_message_received.block_message_hash);
+      if (iter == originating_peer->partial_compact_blocks.end())
+      {
+        dlog("received transactions for a compact block we're not rebuilding from peer ${endpoint}, ignoring them",
+             ("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+      }
+      partial_compact_block partial_block = std::move(iter->second);
+      originating_peer->partial_compact_blocks.erase(iter);
+
+      size_t requested = partial_block.missing_indexes.size();
+      if (!partial_block.add_missing_transactions(block_transactions_message_received.transactions))
+      {
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me ${sent} transactions when I asked for ${requested}",
+                                                    ("sent", block_transactions_message_received.transactions.size())
+                                                    ("requested", requested)));
+        disconnect_from_peer(originating_peer, "You sent me the wrong number of block transactions", true, detailed_error);
+        return;
+      }
+      process_rebuilt_compact_block(originating_peer, std::move(partial_block));
+    }
+
+    void node_impl::process_rebuilt_compact_block(peer_connection* originating_peer, partial_compact_block partial_block)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t block_message_hash = partial_block.compact_block.block_message_hash;
+
+      fc::optional<message> full_block_message = partial_block.rebuild();
+      if (!full_block_message)
+      {
+        const block_id_type block_id = partial_block.compact_block.header.id();
+        if (!partial_block.requested_all)
+        {
+          // a short id matched a different transaction than the one in the block, fetch the whole block
+          wlog("compact block ${block_id} from peer ${endpoint} didn't match the transactions I had, fetching all of them",
+               ("block_id", block_id)
+               ("endpoint", originating_peer->get_remote_endpoint()));
+          partial_block.request_all();
+          originating_peer->send_message(get_block_transactions_message(block_message_hash, partial_block.missing_indexes));
+          originating_peer->partial_compact_blocks[block_message_hash] = std::move(partial_block);
+          return;
+        }
+
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "The transactions you sent for compact block ${block_id} don't make up the block",
+                                                    ("block_id", block_id)));
+        disconnect_from_peer(originating_peer, "You sent me a compact block that doesn't match its transactions", true, detailed_error);
+        return;
+      }
+
+      process_block_message(originating_peer, *full_block_message, block_message_hash);
+    }
+
     void node_impl::on_item_ids_inventory_message(peer_connection* originating_peer, const item_ids_inventory_message& item_ids_inventory_message_received)
     {
       VERIFY_CORRECT_THREAD();
@@ -2905,6 +3045,10 @@ namespace graphene { namespace net {
       // expire old inventory so we'll be making decisions our about whether to fetch blocks below based only on recent inventory
       originating_peer->clear_old_inventory();
 
+      if (item_ids_inventory_message_received.item_type == confirm_message_type &&
+          originating_peer->core_protocol_version < GRAPHENE_NET_COMPACT_CONFIRM_PROTOCOL_VERSION)
+        return;
+
       dlog( "received inventory of ${count} items from peer ${endpoint}",
            ( "count", item_ids_inventory_message_received.item_hashes_available.size() )("endpoint", originating_peer->get_remote_endpoint() ) );
       for( const item_hash_t& item_hash : item_ids_inventory_message_received.item_hashes_available )
@@ -3341,84 +3485,88 @@ namespace graphene { namespace net {
 
       do
       {
-        std::copy(std::make_move_iterator(_new_received_sync_items.begin()),
-                  std::make_move_iterator(_new_received_sync_items.end()),
-                  std::front_inserter(_received_sync_items));
-        _new_received_sync_items.clear();
         dlog("currently ${count} sync items to consider", ("count", _received_sync_items.size()));
 
         block_processed_this_iteration = false;
-        for (auto received_block_iter = _received_sync_items.begin();
-             received_block_iter != _received_sync_items.end();
-             ++received_block_iter)
+
+        // the next block on the active chain or one of the forks is at the front of a peer's list of
+        // items to get, look those up by number instead of checking every block we've received
+        fc::optional<graphene::net::block_message> received_block;
+        for (const peer_connection_ptr& peer : _active_connections)
         {
+          ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+          if (!peer->ids_of_items_to_get.empty())
+          {
+            const item_hash_t& first_item = peer->ids_of_items_to_get.front();
+            const graphene::net::block_message* first_block = _received_sync_items.find(_delegate->get_block_number(first_item), first_item);
+            if (first_block)
+            {
+              received_block = *first_block;
+              break;
+            }
+          }
+        }
 
-          // find out if this block is the next block on the active chain or one of the forks
-          bool potential_first_block = false;
+        // if there is one, process it, remove it from all sync peers lists
+        if (received_block)
+        {
           for (const peer_connection_ptr& peer : _active_connections)
           {
             ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
             if (!peer->ids_of_items_to_get.empty() &&
-                peer->ids_of_items_to_get.front() == received_block_iter->block_id)
+                peer->ids_of_items_to_get.front() == received_block->block_id)
             {
-              potential_first_block = true;
               peer->ids_of_items_to_get.pop_front();
-              peer->ids_of_items_being_processed.insert(received_block_iter->block_id);
+              peer->ids_of_items_being_processed.insert(received_block->block_id);
             }
           }
-
-          // if it is, process it, remove it from all sync peers lists
-          if (potential_first_block)
+          _received_sync_items.erase(_delegate->get_block_number(received_block->block_id), received_block->block_id);
+
+          // we can get into an interesting situation near the end of synchronization.  We can be in
+          // sync with one peer who is sending us the last block on the chain via a regular inventory
+          // message, while at the same time still be synchronizing with a peer who is sending us the
+          // block through the sync mechanism.  Further, we must request both blocks because
+          // we don't know they're the same (for the peer in normal operation, it has only told us the
+          // message id, for the peer in the sync case we only known the block_id).
+          if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
+                        received_block->block_id) == _most_recent_blocks_accepted.end())
           {
-            // we can get into an interesting situation near the end of synchronization.  We can be in
-            // sync with one peer who is sending us the last block on the chain via a regular inventory
-            // message, while at the same time still be synchronizing with a peer who is sending us the
-            // block through the sync mechanism.  Further, we must request both blocks because
-            // we don't know they're the same (for the peer in normal operation, it has only told us the
-            // message id, for the peer in the sync case we only known the block_id).
-            if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
-                          received_block_iter->block_id) == _most_recent_blocks_accepted.end())
-            {
-              graphene::net::block_message block_message_to_process = *received_block_iter;
-              _received_sync_items.erase(received_block_iter);
-              _handle_message_calls_in_progress.emplace_back(async_task([this, block_message_to_process](){
-                send_sync_block_to_node_delegate(block_message_to_process);
-              }, "send_sync_block_to_node_delegate"));
-              ++blocks_processed;
-              block_processed_this_iteration = true;
-            }
-            else
+            graphene::net::block_message block_message_to_process = *received_block;
+            _handle_message_calls_in_progress.emplace_back(async_task([this, block_message_to_process](){
+              send_sync_block_to_node_delegate(block_message_to_process);
+            }, "send_sync_block_to_node_delegate"));
+            ++blocks_processed;
+            block_processed_this_iteration = true;
+          }
+          else
+          {
+            dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
+            std::vector< peer_connection_ptr > peers_needing_next_batch;
+            for (const peer_connection_ptr& peer : _active_connections)
             {
-              dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
-              std::vector< peer_connection_ptr > peers_needing_next_batch;
-              for (const peer_connection_ptr& peer : _active_connections)
+              auto items_being_processed_iter = peer->ids_of_items_being_processed.find(received_block->block_id);
+              if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
               {
-                auto items_being_processed_iter = peer->ids_of_items_being_processed.find(received_block_iter->block_id);
-                if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
+                peer->ids_of_items_being_processed.erase(items_being_processed_iter);
+                dlog("Removed item from ${endpoint}'s list of items being processed, still processing ${len} blocks",
+                     ("endpoint", peer->get_remote_endpoint())("len", peer->ids_of_items_being_processed.size()));
+
+                // if we just processed the last item in our list from this peer, we will want to
+                // send another request to find out if we are now in sync (this is normally handled in
+                // send_sync_block_to_node_delegate)
+                if (peer->ids_of_items_to_get.empty() &&
+                    peer->number_of_unfetched_item_ids == 0 &&
+                    peer->ids_of_items_being_processed.empty())
                 {
-                  peer->ids_of_items_being_processed.erase(items_being_processed_iter);
-                  dlog("Removed item from ${endpoint}'s list of items being processed, still processing ${len} blocks",
-                       ("endpoint", peer->get_remote_endpoint())("len", peer->ids_of_items_being_processed.size()));
-
-                  // if we just processed the last item in our list from this peer, we will want to
-                  // send another request to find out if we are now in sync (this is normally handled in
-                  // send_sync_block_to_node_delegate)
-                  if (peer->ids_of_items_to_get.empty() &&
-                      peer->number_of_unfetched_item_ids == 0 &&
-                      peer->ids_of_items_being_processed.empty())
-                  {
-                    dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check", ("endpoint", peer->get_remote_endpoint()));
-                    peers_needing_next_batch.push_back( peer );
-                  }
+                  dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check", ("endpoint", peer->get_remote_endpoint()));
+                  peers_needing_next_batch.push_back( peer );
                 }
               }
-              for( const peer_connection_ptr& peer : peers_needing_next_batch )
-                fetch_next_batch_of_item_ids_from_peer(peer.get());
             }
-
-            break; // start iterating _received_sync_items from the beginning
-          } // end if potential_first_block
-        } // end for each block in _received_sync_items
+            for( const peer_connection_ptr& peer : peers_needing_next_batch )
+              fetch_next_batch_of_item_ids_from_peer(peer.get());
+          }
+        } // end if received_block
 
         if (_handle_message_calls_in_progress.size() >= _node_configuration.maximum_number_of_blocks_to_handle_at_one_time)
         {
@@ -3450,9 +3598,11 @@ namespace graphene { namespace net {
     {
       dlog( "received a sync block from peer ${endpoint}", ("endpoint", originating_peer->get_remote_endpoint() ) );
 
-      // add it to the front of _received_sync_items, then process _received_sync_items to try to
-      // pass as many messages as possible to the client.
-      _new_received_sync_items.push_front( block_message_to_process );
+      // store it by block number, then process _received_sync_items to try to pass as many messages
+      // as possible to the client.
+      if( !_received_sync_items.insert( _delegate->get_block_number( block_message_to_process.block_id ), block_message_to_process,
+                                        get_lowest_sync_block_needed() ) )
+        dlog( "no room for sync block #${num} yet, it will be fetched again", ("num", block_message_to_process.block.block_num() ) );
       trigger_process_backlog_of_sync_blocks();
     }
 
@@ -3627,7 +3777,8 @@ namespace graphene { namespace net {
       // (it's possible that we request an item during normal operation and then get kicked into sync
       // mode before we receive and process the item.  In that case, we should process the item as a normal
       // item to avoid confusing the sync code)
-      graphene::net::block_message block_message_to_process(message_to_process.as<graphene::net::block_message>());
+      std::shared_ptr<const graphene::net::block_message> unpacked_block = message_to_process.get<graphene::net::block_message>();
+      const graphene::net::block_message& block_message_to_process = *unpacked_block;
       auto item_iter = originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, message_hash));
       if (item_iter != originating_peer->items_requested_from_peer.end())
       {
@@ -4011,9 +4162,9 @@ namespace graphene { namespace net {
         {
           if (message_to_process.msg_type == trx_message_type)
           {
-            trx_message transaction_message_to_process = message_to_process.as<trx_message>();
-            dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process.trx.id()));
-            _delegate->handle_transaction(transaction_message_to_process);
+            std::shared_ptr<const trx_message> transaction_message_to_process = message_to_process.get<trx_message>();
+            dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process->trx.id()));
+            _delegate->handle_transaction(*transaction_message_to_process);
           }
           else
             _delegate->handle_message( message_to_process );
@@ -4903,7 +5054,6 @@ namespace graphene { namespace net {
       ilog( "--------- MEMORY USAGE ------------" );
       ilog( "node._active_sync_requests size: ${size}", ("size", _active_sync_requests.size() ) );
       ilog( "node._received_sync_items size: ${size}", ("size", _received_sync_items.size() ) );
-      ilog( "node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size() ) );
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
       ilog( "node._new_inventory size: ${size}", ("size", _new_inventory.size() ) );
       ilog( "node._message_cache size: ${size}", ("size", _message_cache.size() ) );
@@ -5147,6 +5297,8 @@ namespace graphene { namespace net {
          _node_configuration.private_key = fc::ecc::private_key::generate();
       }
 
+      _received_sync_items.set_capacity( _node_configuration.maximum_number_of_sync_blocks_to_prefetch, get_lowest_sync_block_needed() );
+
       // Private key could have been overridden at this point. Update public key just in case
       _node_public_key = _node_configuration.private_key.get_public_key().serialize();
 
@@ -5703,6 +5855,12 @@ namespace graphene { namespace net {
       INVOKE_AND_COLLECT_STATISTICS(error_encountered, message, error);
     }
 
+    void statistics_gathering_node_delegate_wrapper::prepare_message( const message& message_to_prepare )
+    {
+      // called on the decode threads, so not dispatched to _thread
+      _node_delegate->prepare_message(message_to_prepare);
+    }
+
 #undef INVOKE_AND_COLLECT_STATISTICS
 
   } // end namespace detail
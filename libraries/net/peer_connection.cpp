@@ -281,6 +281,12 @@ namespace graphene { namespace net
       _node->on_connection_closed( this );
     }
 
+    message_decode_pool* peer_connection::get_message_decode_pool( const message_header& header )
+    {
+      VERIFY_CORRECT_THREAD();
+      return _node->get_message_decode_pool( header );
+    }
+
     void peer_connection::send_queued_messages_task()
     {
       VERIFY_CORRECT_THREAD();
@@ -526,4 +532,49 @@ namespace graphene { namespace net
       return fc::optional<fc::ip::endpoint>();
     }
 
+    partial_compact_block::partial_compact_block(const compact_block_message& block, const blockchain_tied_message_cache& cache) :
+      compact_block(block)
+    {
+      transactions.resize(block.short_ids.size());
+      for (uint32_t i = 0; i < block.short_ids.size(); ++i)
+      {
+        fc::optional<signed_transaction> trx = cache.find_transaction(block.short_ids[i]);
+        if (trx)
+          transactions[i] = std::move(*trx);
+        else
+          missing_indexes.push_back(i);
+      }
+    }
+
+    bool partial_compact_block::add_missing_transactions(const std::vector<signed_transaction>& missing_transactions)
+    {
+      if (missing_transactions.size() != missing_indexes.size())
+        return false;
+      for (uint32_t i = 0; i < missing_indexes.size(); ++i)
+        transactions[missing_indexes[i]] = missing_transactions[i];
+      missing_indexes.clear();
+      return true;
+    }
+
+    fc::optional<message> partial_compact_block::rebuild() const
+    {
+      signed_block block;
+      static_cast<signed_block_header&>(block) = compact_block.header;
+      block.transactions = transactions;
+      message full_block_message = graphene::net::block_message(block);
+      if (full_block_message.id() != compact_block.block_message_hash)
+        return fc::optional<message>();
+      return full_block_message;
+    }
+
+    void partial_compact_block::request_all()
+    {
+      requested_all = true;
+      transactions.clear();
+      transactions.resize(compact_block.short_ids.size());
+      missing_indexes.resize(transactions.size());
+      for (uint32_t i = 0; i < missing_indexes.size(); ++i)
+        missing_indexes[i] = i;
+    }
+
 } } // end namespace graphene::net
@@ -38,8 +38,9 @@ namespace graphene { namespace net {
 
 stcp_socket::stcp_socket()
 //:_buf_len(0)
+   : _recv_aes(std::make_shared<fc::aes_decoder>())
 #ifndef NDEBUG
-   : _read_buffer_in_use(false),
+   , _read_buffer_in_use(false),
      _write_buffer_in_use(false)
 #endif
 {
@@ -64,7 +65,7 @@ void stcp_socket::do_key_exchange()
 //    ilog("shared secret ${s}", ("s", shared_secret) );
   _send_aes.init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
                   fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
-  _recv_aes.init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
+  _recv_aes->init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
                   fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
 }
 
@@ -112,7 +113,7 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
       _sock.read(_read_buffer, 16 - (s%16), s);
       s += 16-(s%16);
     }
-    _recv_aes.decode( _read_buffer.get(), s, buffer );
+    _recv_aes->decode( _read_buffer.get(), s, buffer );
     return s;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
@@ -121,6 +122,20 @@ size_t stcp_socket::readsome( const std::shared_ptr<char>& buf, size_t len, size
   return readsome(buf.get() + offset, len);
 }
 
+void stcp_socket::read_decrypted( const std::shared_ptr<char>& buf, size_t len, size_t offset )
+{ try {
+    assert( (len % 16) == 0 );
+    _sock.read( buf, len, offset );
+    // one call over the whole message lets the cipher decrypt several blocks at a time
+    _recv_aes->decode( buf.get() + offset, len, buf.get() + offset );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+
+void stcp_socket::read_encrypted( const std::shared_ptr<char>& buf, size_t len, size_t offset )
+{ try {
+    assert( (len % 16) == 0 );
+    _sock.read( buf, len, offset );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+
 bool stcp_socket::eof()const
 {
   return _sock.eof();
@@ -163,6 +178,52 @@ size_t stcp_socket::writesome( const std::shared_ptr<const char>& buf, size_t le
   return writesome(buf.get() + offset, len);
 }
 
+size_t stcp_socket::write_encrypted( const std::vector<buffer_piece>& pieces )
+{ try {
+    size_t len = 0;
+    for( const buffer_piece& piece : pieces )
+      len += piece.second;
+    size_t len_with_padding = 16 * ((len + 15) / 16);
+    std::shared_ptr<char> ciphertext(new char[len_with_padding], [](char* p){ delete[] p; });
+
+    // whole blocks are encrypted straight from the pieces, only the blocks spanning two
+    // pieces and the padded last block are assembled here first
+    char block[16];
+    size_t block_used = 0;
+    char* out = ciphertext.get();
+    for( const buffer_piece& piece : pieces )
+    {
+      const char* in = piece.first;
+      size_t remaining = piece.second;
+      if( block_used )
+      {
+        size_t n = std::min<size_t>( remaining, sizeof(block) - block_used );
+        memcpy( block + block_used, in, n );
+        block_used += n;
+        in += n;
+        remaining -= n;
+        if( block_used < sizeof(block) )
+          continue;
+        out += _send_aes.encode( block, sizeof(block), out );
+        block_used = 0;
+      }
+      size_t whole_blocks = remaining - remaining % sizeof(block);
+      if( whole_blocks )
+        out += _send_aes.encode( in, whole_blocks, out );
+      block_used = remaining - whole_blocks;
+      memcpy( block, in + whole_blocks, block_used );
+    }
+    if( block_used )
+    {
+      memset( block + block_used, 0, sizeof(block) - block_used );
+      out += _send_aes.encode( block, sizeof(block), out );
+    }
+    assert( out == ciphertext.get() + len_with_padding );
+
+    _sock.write( ciphertext, len_with_padding );
+    return len_with_padding;
+} FC_RETHROW_EXCEPTIONS( warn, "", ("pieces",pieces.size()) ) }
+
 void stcp_socket::flush()
 {
   _sock.flush();
@@ -0,0 +1,63 @@
+#include <graphene/net/sync_block_buffer.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace net {
+
+  void sync_block_buffer::set_capacity( uint32_t capacity, uint32_t lowest_block_needed )
+  {
+    capacity = std::max<uint32_t>( capacity, 1 );
+    if( capacity == _slots.size() )
+      return;
+    std::vector<slot> old_slots( capacity );
+    old_slots.swap( _slots );
+    _size = 0;
+    for( const slot& old_slot : old_slots )
+      for( const block_message& block : old_slot.blocks )
+        insert( old_slot.block_number, block, lowest_block_needed );
+  }
+
+  bool sync_block_buffer::insert( uint32_t block_number, const block_message& block, uint32_t lowest_block_needed )
+  {
+    if( block_number < lowest_block_needed || uint64_t( block_number ) >= uint64_t( lowest_block_needed ) + _slots.size() )
+      return false;
+    slot& block_slot = _slots[block_number % _slots.size()];
+    if( !block_slot.blocks.empty() && block_slot.block_number != block_number )
+    {
+      _size -= block_slot.blocks.size();
+      block_slot.blocks.clear();
+    }
+    block_slot.block_number = block_number;
+    for( const block_message& stored_block : block_slot.blocks )
+      if( stored_block.block_id == block.block_id )
+        return true;
+    block_slot.blocks.push_back( block );
+    ++_size;
+    return true;
+  }
+
+  const block_message* sync_block_buffer::find( uint32_t block_number, const item_hash_t& block_id ) const
+  {
+    const slot& block_slot = _slots[block_number % _slots.size()];
+    if( block_slot.block_number == block_number )
+      for( const block_message& block : block_slot.blocks )
+        if( block.block_id == block_id )
+          return &block;
+    return nullptr;
+  }
+
+  void sync_block_buffer::erase( uint32_t block_number, const item_hash_t& block_id )
+  {
+    slot& block_slot = _slots[block_number % _slots.size()];
+    if( block_slot.block_number != block_number )
+      return;
+    auto iter = std::find_if( block_slot.blocks.begin(), block_slot.blocks.end(),
+                              [&block_id]( const block_message& block ) { return block.block_id == block_id; } );
+    if( iter != block_slot.blocks.end() )
+    {
+      block_slot.blocks.erase( iter );
+      --_size;
+    }
+  }
+
+} } // graphene::net
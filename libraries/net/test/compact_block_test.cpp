@@ -0,0 +1,131 @@
+#define BOOST_TEST_MODULE net test
+
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message_cache.hpp>
+#include <graphene/net/peer_connection.hpp>
+
+#include <vector>
+
+using namespace graphene::net;
+
+static signed_transaction make_transaction( uint32_t n )
+{
+   signed_transaction trx;
+   trx.ref_block_num = uint16_t( n );
+   trx.ref_block_prefix = n;
+   trx.set_expiration( fc::time_point_sec( 1451606400 + n ) );
+   return trx;
+}
+
+static message make_block_message( uint32_t transaction_count )
+{
+   signed_block block;
+   block.timestamp = fc::time_point_sec( 1451606400 );
+   block.witness = "initminer";
+   for( uint32_t i = 0; i < transaction_count; ++i )
+      block.transactions.push_back( make_transaction( i ) );
+   return graphene::net::block_message( block );
+}
+
+static void cache_transaction( blockchain_tied_message_cache& cache, const signed_transaction& trx, const transaction_id_type& contents_hash )
+{
+   message m = trx_message( trx );
+   cache.cache_message( m, m.id(), message_propagation_data(), contents_hash );
+}
+
+BOOST_AUTO_TEST_CASE( rebuild_with_missing_transactions ) {
+   message full = make_block_message( 8 );
+   graphene::net::block_message block = full.as< graphene::net::block_message >();
+   compact_block_message compact( block, full.id() );
+
+   blockchain_tied_message_cache cache;
+   for( uint32_t i = 0; i < 8; i += 2 )
+      cache_transaction( cache, block.block.transactions[i], block.block.transactions[i].id() );
+   // a block whose id starts like a missing transaction sorts next to it and must be skipped
+   message other_block = make_block_message( 0 );
+   cache.cache_message( other_block, other_block.id(), message_propagation_data(), block.block.transactions[1].id() );
+
+   partial_compact_block partial( compact, cache );
+   BOOST_REQUIRE_EQUAL( partial.missing_indexes.size(), 4u );
+   for( uint32_t i = 0; i < 4; ++i )
+      BOOST_REQUIRE_EQUAL( partial.missing_indexes[i], i * 2 + 1 );
+   BOOST_REQUIRE( !partial.rebuild() );
+
+   std::vector< signed_transaction > sent;
+   BOOST_REQUIRE( !partial.add_missing_transactions( sent ) );
+   for( uint32_t index : partial.missing_indexes )
+      sent.push_back( block.block.transactions[index] );
+   BOOST_REQUIRE( partial.add_missing_transactions( sent ) );
+
+   fc::optional< message > rebuilt = partial.rebuild();
+   BOOST_REQUIRE( rebuilt );
+   BOOST_REQUIRE( rebuilt->id() == full.id() );
+   BOOST_REQUIRE( rebuilt->data == full.data );
+}
+
+BOOST_AUTO_TEST_CASE( ambiguous_short_id_is_fetched ) {
+   message full = make_block_message( 2 );
+   graphene::net::block_message block = full.as< graphene::net::block_message >();
+   compact_block_message compact( block, full.id() );
+
+   // two cached transactions answer to the short id of the first one
+   blockchain_tied_message_cache cache;
+   cache_transaction( cache, block.block.transactions[0], block.block.transactions[0].id() );
+   cache_transaction( cache, make_transaction( 100 ), block.block.transactions[0].id() );
+   cache_transaction( cache, block.block.transactions[1], block.block.transactions[1].id() );
+
+   partial_compact_block partial( compact, cache );
+   BOOST_REQUIRE_EQUAL( partial.missing_indexes.size(), 1u );
+   BOOST_REQUIRE_EQUAL( partial.missing_indexes[0], 0u );
+}
+
+BOOST_AUTO_TEST_CASE( wrong_transaction_falls_back_to_whole_block ) {
+   message full = make_block_message( 4 );
+   graphene::net::block_message block = full.as< graphene::net::block_message >();
+   compact_block_message compact( block, full.id() );
+
+   // the cache holds a different transaction under the id of transaction 2, as if their short ids collided
+   blockchain_tied_message_cache cache;
+   for( uint32_t i = 0; i < 4; ++i )
+      cache_transaction( cache, i == 2 ? make_transaction( 100 ) : block.block.transactions[i], block.block.transactions[i].id() );
+
+   partial_compact_block partial( compact, cache );
+   BOOST_REQUIRE( partial.missing_indexes.empty() );
+   BOOST_REQUIRE( !partial.rebuild() );
+
+   partial.request_all();
+   BOOST_REQUIRE( partial.requested_all );
+   BOOST_REQUIRE_EQUAL( partial.missing_indexes.size(), 4u );
+   BOOST_REQUIRE( partial.add_missing_transactions( block.block.transactions ) );
+
+   fc::optional< message > rebuilt = partial.rebuild();
+   BOOST_REQUIRE( rebuilt );
+   BOOST_REQUIRE( rebuilt->id() == full.id() );
+}
+
+BOOST_AUTO_TEST_CASE( transaction_request_must_fit_block ) {
+   message full = make_block_message( 4 );
+   graphene::net::block_message block = full.as< graphene::net::block_message >();
+   compact_block_message compact( block, full.id() );
+
+   // what the node asks for when rebuilding a block is always accepted
+   blockchain_tied_message_cache cache;
+   cache_transaction( cache, block.block.transactions[1], block.block.transactions[1].id() );
+   partial_compact_block partial( compact, cache );
+   BOOST_REQUIRE( get_block_transactions_message( full.id(), partial.missing_indexes ).indexes_fit_block( 4 ) );
+   partial.request_all();
+   BOOST_REQUIRE( get_block_transactions_message( full.id(), partial.missing_indexes ).indexes_fit_block( 4 ) );
+   BOOST_REQUIRE( get_block_transactions_message( full.id(), {} ).indexes_fit_block( 4 ) );
+
+   // repeated indexes would make the reply larger than the block
+   BOOST_REQUIRE( !get_block_transactions_message( full.id(), { 0, 0 } ).indexes_fit_block( 4 ) );
+   BOOST_REQUIRE( !get_block_transactions_message( full.id(), std::vector< uint32_t >( 100, 0 ) ).indexes_fit_block( 4 ) );
+   BOOST_REQUIRE( !get_block_transactions_message( full.id(), { 0, 1, 2, 3, 3 } ).indexes_fit_block( 4 ) );
+
+   // unsorted and out of range
+   BOOST_REQUIRE( !get_block_transactions_message( full.id(), { 2, 1 } ).indexes_fit_block( 4 ) );
+   BOOST_REQUIRE( !get_block_transactions_message( full.id(), { 0, 3, 2 } ).indexes_fit_block( 4 ) );
+   BOOST_REQUIRE( !get_block_transactions_message( full.id(), { 4 } ).indexes_fit_block( 4 ) );
+}
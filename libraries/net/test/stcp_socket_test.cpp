@@ -0,0 +1,111 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/net/stcp_socket.hpp>
+
+#include <fc/network/ip.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace graphene::net;
+
+/// Two stcp_sockets connected over loopback, with their keys exchanged
+struct connected_stcp_sockets
+{
+   fc::tcp_server    server;
+   stcp_socket       sender;
+   stcp_socket       receiver;
+
+   connected_stcp_sockets()
+   {
+      server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+      auto accepted = fc::async( [&]()
+      {
+         server.accept( receiver.get_socket() );
+         receiver.accept();
+      });
+      sender.connect_to( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), server.get_port() ) );
+      accepted.wait();
+   }
+};
+
+static const std::vector< size_t > round_trip_sizes = { 1, 15, 16, 17, 31, 100, 4095, 4096, 4097, 10000, 65537 };
+
+static std::string make_data( size_t size, char seed )
+{
+   std::string data( size, '\0' );
+   for( size_t i = 0; i < size; ++i )
+      data[i] = char( seed + i * 7 );
+   return data;
+}
+
+static std::string padded( std::string data )
+{
+   data.resize( 16 * ( ( data.size() + 15 ) / 16 ), '\0' );
+   return data;
+}
+
+BOOST_AUTO_TEST_CASE( per_chunk_write_one_call_read ) {
+   connected_stcp_sockets sockets;
+   for( size_t size : round_trip_sizes )
+   {
+      std::string expected = padded( make_data( size, char( size ) ) );
+      auto sent = fc::async( [&]()
+      {
+         sockets.sender.write( expected.data(), expected.size() );
+         sockets.sender.flush();
+      });
+
+      std::shared_ptr< char > received( new char[ expected.size() ], []( char* p ){ delete[] p; } );
+      sockets.receiver.read_decrypted( received, expected.size() );
+      sent.wait();
+      BOOST_REQUIRE_MESSAGE( std::string( received.get(), expected.size() ) == expected, "size " << size );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( one_call_write_per_chunk_read ) {
+   connected_stcp_sockets sockets;
+   for( size_t size : round_trip_sizes )
+   {
+      // pieces shaped like a message header, its data and a trailing odd piece
+      std::string header = make_data( 8, 'h' );
+      std::string data = make_data( size, char( size ) );
+      std::string tail = make_data( 3, 't' );
+      std::string expected = padded( header + data + tail );
+
+      auto sent = fc::async( [&]()
+      {
+         std::vector< stcp_socket::buffer_piece > pieces = {
+            { header.data(), header.size() }, { data.data(), data.size() }, { tail.data(), tail.size() } };
+         BOOST_REQUIRE_EQUAL( sockets.sender.write_encrypted( pieces ), expected.size() );
+         sockets.sender.flush();
+      });
+
+      std::vector< char > received( expected.size() );
+      sockets.receiver.read( received.data(), received.size() );
+      sent.wait();
+      BOOST_REQUIRE_MESSAGE( std::string( received.data(), received.size() ) == expected, "size " << size );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( one_call_write_one_call_read ) {
+   connected_stcp_sockets sockets;
+   for( size_t size : round_trip_sizes )
+   {
+      std::string data = make_data( size, char( size ) );
+      std::string expected = padded( data );
+      auto sent = fc::async( [&]()
+      {
+         sockets.sender.write_encrypted( { { data.data(), data.size() } } );
+         sockets.sender.flush();
+      });
+
+      std::shared_ptr< char > received( new char[ expected.size() ], []( char* p ){ delete[] p; } );
+      sockets.receiver.read_decrypted( received, expected.size() );
+      sent.wait();
+      BOOST_REQUIRE_MESSAGE( std::string( received.get(), expected.size() ) == expected, "size " << size );
+   }
+}
@@ -0,0 +1,65 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/net/sync_block_buffer.hpp>
+
+using namespace graphene::net;
+
+/// A block standing for block number n on the given branch, only its id matters to the buffer
+static block_message make_sync_block( uint32_t n, uint32_t branch )
+{
+   signed_block block;
+   block.timestamp = fc::time_point_sec( 1451606400 + n * 3 + branch );
+   block.witness = "initminer";
+   return block_message( block );
+}
+
+BOOST_AUTO_TEST_CASE( sync_buffer_refuses_blocks_outside_window ) {
+   sync_block_buffer buffer( 4 );
+   for( uint32_t n = 10; n < 14; ++n )
+      BOOST_REQUIRE( buffer.insert( n, make_sync_block( n, 0 ), 10 ) );
+   BOOST_REQUIRE( !buffer.insert( 9, make_sync_block( 9, 0 ), 10 ) );
+   BOOST_REQUIRE( !buffer.insert( 14, make_sync_block( 14, 0 ), 10 ) );
+   BOOST_REQUIRE_EQUAL( buffer.size(), 4u );
+   for( uint32_t n = 10; n < 14; ++n )
+      BOOST_REQUIRE( buffer.find( n, make_sync_block( n, 0 ).block_id ) != nullptr );
+}
+
+BOOST_AUTO_TEST_CASE( sync_buffer_keeps_fork_blocks_still_needed ) {
+   sync_block_buffer buffer( 4 );
+   block_message fork_block = make_sync_block( 10, 1 );
+   BOOST_REQUIRE( buffer.insert( 10, fork_block, 10 ) );
+   for( uint32_t n = 10; n < 14; ++n )
+      BOOST_REQUIRE( buffer.insert( n, make_sync_block( n, 0 ), 10 ) );
+   BOOST_REQUIRE_EQUAL( buffer.size(), 5u );
+
+   // the main branch block 10 is passed on, the fork block 10 still waits for its peer
+   buffer.erase( 10, make_sync_block( 10, 0 ).block_id );
+
+   // block 14 shares the slot with block 10 and must not push the fork block out
+   BOOST_REQUIRE( !buffer.insert( 14, make_sync_block( 14, 0 ), 10 ) );
+   BOOST_REQUIRE( buffer.find( 10, fork_block.block_id ) != nullptr );
+
+   // once the fork block is passed on too, the window moves and block 14 fits
+   buffer.erase( 10, fork_block.block_id );
+   BOOST_REQUIRE( buffer.insert( 14, make_sync_block( 14, 0 ), 11 ) );
+   BOOST_REQUIRE_EQUAL( buffer.size(), 4u );
+}
+
+BOOST_AUTO_TEST_CASE( sync_buffer_drops_blocks_past_a_lower_window ) {
+   sync_block_buffer buffer( 4 );
+   for( uint32_t n = 10; n < 14; ++n )
+      BOOST_REQUIRE( buffer.insert( n, make_sync_block( n, 0 ), 10 ) );
+
+   // a peer on a fork from block 8 shows up, block 12 is now past the window and gives way to block 8
+   block_message fork_block = make_sync_block( 8, 1 );
+   BOOST_REQUIRE( buffer.insert( 8, fork_block, 8 ) );
+   BOOST_REQUIRE( buffer.find( 8, fork_block.block_id ) != nullptr );
+   BOOST_REQUIRE( buffer.find( 12, make_sync_block( 12, 0 ).block_id ) == nullptr );
+   BOOST_REQUIRE_EQUAL( buffer.size(), 4u );
+
+   // shrinking the buffer keeps the blocks nearest the lowest one needed
+   buffer.set_capacity( 2, 8 );
+   BOOST_REQUIRE_EQUAL( buffer.capacity(), 2u );
+   BOOST_REQUIRE( buffer.find( 8, fork_block.block_id ) != nullptr );
+   BOOST_REQUIRE_EQUAL( buffer.size(), 1u );
+}
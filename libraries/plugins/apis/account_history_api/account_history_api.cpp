@@ -35,7 +35,7 @@ class account_history_api_chainbase_impl : public abstract_account_history_api_i
 
 DEFINE_API_IMPL( account_history_api_chainbase_impl, get_ops_in_block )
 {
-   return _db.with_read_lock( [&]()
+   return _db.with_index_read_lock< chain::operation_index >( [&]()
    {
       const auto& idx = _db.get_index< chain::operation_index, chain::by_location >();
       auto itr = idx.lower_bound( args.block_num );
@@ -90,7 +90,7 @@ DEFINE_API_IMPL( account_history_api_chainbase_impl, get_account_history )
    FC_ASSERT( args.limit <= 10000, "limit of ${l} is greater than maxmimum allowed", ("l",args.limit) );
    FC_ASSERT( args.start >= args.limit, "start must be greater than limit" );
 
-   return _db.with_read_lock( [&]()
+   return _db.with_index_read_lock< chain::account_history_index, chain::operation_index >( [&]()
    {
       const auto& idx = _db.get_index< chain::account_history_index, chain::by_account >();
       auto itr = idx.lower_bound( boost::make_tuple( args.account, args.start ) );
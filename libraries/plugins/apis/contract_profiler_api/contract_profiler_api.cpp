@@ -0,0 +1,60 @@
+#include <gamebank/plugins/contract_profiler_api/contract_profiler_api_plugin.hpp>
+#include <gamebank/plugins/contract_profiler_api/contract_profiler_api.hpp>
+
+namespace gamebank { namespace plugins { namespace contract_profiler {
+
+namespace detail {
+
+class contract_profiler_api_impl
+{
+   public:
+      contract_profiler_api_impl( bool allow_reset ) :
+         _db( appbase::app().get_plugin< gamebank::plugins::chain::chain_plugin >().db() ),
+         _allow_reset( allow_reset ) {}
+
+      DECLARE_API_IMPL(
+         (get_contract_profiles)
+         (reset_contract_profiles)
+      )
+
+      chain::database& _db;
+      bool             _allow_reset;
+};
+
+DEFINE_API_IMPL( contract_profiler_api_impl, get_contract_profiles )
+{
+   get_contract_profiles_return result;
+   const auto& profiler = _db.get_contract_profiler();
+   result.enabled = profiler.enabled();
+
+   auto profiles = profiler.get_profiles( args.contract );
+   result.profiles.reserve( profiles.size() );
+   for( const auto& p : profiles )
+      result.profiles.emplace_back( p.first.first, p.first.second, p.second );
+
+   return result;
+}
+
+DEFINE_API_IMPL( contract_profiler_api_impl, reset_contract_profiles )
+{
+   FC_ASSERT( _allow_reset, "reset_contract_profiles is disabled, enable it with contract-profiler-api-allow-reset" );
+   _db.get_contract_profiler().reset();
+   return reset_contract_profiles_return();
+}
+
+} // detail
+
+contract_profiler_api::contract_profiler_api( bool allow_reset ): my( new detail::contract_profiler_api_impl( allow_reset ) )
+{
+   JSON_RPC_REGISTER_API( GAMEBANK_CONTRACT_PROFILER_API_PLUGIN_NAME );
+}
+
+contract_profiler_api::~contract_profiler_api() {}
+
+// the profiler is not chain state and has its own lock
+DEFINE_LOCKLESS_APIS( contract_profiler_api,
+   (get_contract_profiles)
+   (reset_contract_profiles)
+)
+
+} } } // gamebank::plugins::contract_profiler
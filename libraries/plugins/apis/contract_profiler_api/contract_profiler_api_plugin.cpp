@@ -0,0 +1,27 @@
+#include <gamebank/plugins/contract_profiler_api/contract_profiler_api_plugin.hpp>
+#include <gamebank/plugins/contract_profiler_api/contract_profiler_api.hpp>
+
+
+namespace gamebank { namespace plugins { namespace contract_profiler {
+
+contract_profiler_api_plugin::contract_profiler_api_plugin() {}
+contract_profiler_api_plugin::~contract_profiler_api_plugin() {}
+
+void contract_profiler_api_plugin::set_program_options( options_description& cli, options_description& cfg )
+{
+   cfg.add_options()
+      ("contract-profiler-api-allow-reset", bpo::value< bool >()->default_value( false ),
+         "Allow reset_contract_profiles, which clears the contract profiles of the whole node for every API user" )
+      ;
+}
+
+void contract_profiler_api_plugin::plugin_initialize( const variables_map& options )
+{
+   allow_reset = options.at( "contract-profiler-api-allow-reset" ).as< bool >();
+   api = std::make_shared< contract_profiler_api >( allow_reset );
+}
+
+void contract_profiler_api_plugin::plugin_startup() {}
+void contract_profiler_api_plugin::plugin_shutdown() {}
+
+} } } // gamebank::plugins::contract_profiler
@@ -0,0 +1,69 @@
+#pragma once
+#include <gamebank/plugins/json_rpc/utility.hpp>
+
+#include <gamebank/chain/contract/contract_profiler.hpp>
+
+#include <gamebank/protocol/types.hpp>
+
+#include <fc/optional.hpp>
+#include <fc/variant.hpp>
+#include <fc/vector.hpp>
+
+namespace gamebank { namespace plugins { namespace contract_profiler {
+
+namespace detail
+{
+   class contract_profiler_api_impl;
+}
+
+struct api_contract_method_profile : public chain::contract_method_profile
+{
+   api_contract_method_profile() {}
+   api_contract_method_profile( const protocol::account_name_type& c, const std::string& m, const chain::contract_method_profile& p ) :
+      chain::contract_method_profile( p ), contract( c ), method( m ) {}
+
+   protocol::account_name_type   contract;
+   std::string                   method;
+};
+
+/// An empty contract returns the profile of every contract method called so far
+struct get_contract_profiles_args
+{
+   protocol::account_name_type   contract;
+};
+
+struct get_contract_profiles_return
+{
+   bool                                         enabled = false;
+   std::vector< api_contract_method_profile >   profiles;
+};
+
+typedef json_rpc::void_type reset_contract_profiles_args;
+typedef json_rpc::void_type reset_contract_profiles_return;
+
+class contract_profiler_api
+{
+   public:
+      /// reset_contract_profiles clears node-wide state and only works when allow_reset is set
+      contract_profiler_api( bool allow_reset );
+      ~contract_profiler_api();
+
+      DECLARE_API(
+         (get_contract_profiles)
+         (reset_contract_profiles)
+      )
+
+   private:
+      std::unique_ptr< detail::contract_profiler_api_impl > my;
+};
+
+} } } // gamebank::plugins::contract_profiler
+
+FC_REFLECT_DERIVED( gamebank::plugins::contract_profiler::api_contract_method_profile, (gamebank::chain::contract_method_profile),
+            (contract)(method) )
+
+FC_REFLECT( gamebank::plugins::contract_profiler::get_contract_profiles_args,
+            (contract) )
+
+FC_REFLECT( gamebank::plugins::contract_profiler::get_contract_profiles_return,
+            (enabled)(profiles) )
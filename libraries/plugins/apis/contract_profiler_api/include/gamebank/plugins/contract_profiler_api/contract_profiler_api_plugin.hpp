@@ -0,0 +1,37 @@
+#pragma once
+#include <gamebank/plugins/chain/chain_plugin.hpp>
+#include <gamebank/plugins/json_rpc/json_rpc_plugin.hpp>
+
+#include <appbase/application.hpp>
+
+#define GAMEBANK_CONTRACT_PROFILER_API_PLUGIN_NAME "contract_profiler_api"
+
+
+namespace gamebank { namespace plugins { namespace contract_profiler {
+
+using namespace appbase;
+
+class contract_profiler_api_plugin : public appbase::plugin< contract_profiler_api_plugin >
+{
+public:
+   APPBASE_PLUGIN_REQUIRES(
+      (gamebank::plugins::chain::chain_plugin)
+      (gamebank::plugins::json_rpc::json_rpc_plugin)
+   )
+
+   contract_profiler_api_plugin();
+   virtual ~contract_profiler_api_plugin();
+
+   static const std::string& name() { static std::string name = GAMEBANK_CONTRACT_PROFILER_API_PLUGIN_NAME; return name; }
+
+   virtual void set_program_options( options_description& cli, options_description& cfg ) override;
+
+   virtual void plugin_initialize( const variables_map& options ) override;
+   virtual void plugin_startup() override;
+   virtual void plugin_shutdown() override;
+
+   std::shared_ptr< class contract_profiler_api > api;
+   bool                                           allow_reset = false;
+};
+
+} } } // gamebank::plugins::contract_profiler
@@ -18,16 +18,7 @@ class database_api_impl
       DECLARE_API_IMPL
       (
          (get_config)
-         (get_dynamic_global_properties)
-         (get_witness_schedule)
-         (get_hardfork_properties)
-         (get_reward_funds)
-         (get_current_price_feed)
-         (get_feed_history)
-         (list_witnesses)
-         (find_witnesses)
          (list_witness_votes)
-         (get_active_witnesses)
          (list_accounts)
          (find_accounts)
          (list_owner_histories)
@@ -65,6 +56,21 @@ class database_api_impl
          (verify_signatures)
       )
 
+      // globals and witnesses, small indices that can be read from snapshots. Witness votes grow with
+      // the number of voters, list_witness_votes reads them under the read lock
+      DECLARE_SNAPSHOT_API_IMPL
+      (
+         (get_dynamic_global_properties)
+         (get_witness_schedule)
+         (get_hardfork_properties)
+         (get_reward_funds)
+         (get_current_price_feed)
+         (get_feed_history)
+         (list_witnesses)
+         (find_witnesses)
+         (get_active_witnesses)
+      )
+
 
       template< typename ResultType >
       static ResultType on_push_default( const ResultType& r ) { return r; }
@@ -72,7 +78,13 @@ class database_api_impl
       template< typename IndexType, typename OrderType, typename ValueType, typename ResultType, typename OnPush >
       void iterate_results( ValueType start, vector< ResultType >& result, uint32_t limit, OnPush&& on_push = &database_api_impl::on_push_default< ResultType > )
       {
-         const auto& idx = _db.get_index< IndexType, OrderType >();
+         iterate_results< IndexType, OrderType >( _db, start, result, limit, std::forward< OnPush >( on_push ) );
+      }
+
+      template< typename IndexType, typename OrderType, typename State, typename ValueType, typename ResultType, typename OnPush >
+      void iterate_results( const State& state, ValueType start, vector< ResultType >& result, uint32_t limit, OnPush&& on_push )
+      {
+         const auto& idx = state.template get_index< IndexType, OrderType >();
          auto itr = idx.lower_bound( start );
          auto end = idx.end();
 
@@ -117,26 +129,26 @@ DEFINE_API_IMPL( database_api_impl, get_config )
    return gamebank::protocol::get_config();
 }
 
-DEFINE_API_IMPL( database_api_impl, get_dynamic_global_properties )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, get_dynamic_global_properties )
 {
-   return _db.get_dynamic_global_properties();
+   return state.template get< dynamic_global_property_object >();
 }
 
-DEFINE_API_IMPL( database_api_impl, get_witness_schedule )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, get_witness_schedule )
 {
-   return api_witness_schedule_object( _db.get_witness_schedule_object() );
+   return api_witness_schedule_object( state.template get< witness_schedule_object >() );
 }
 
-DEFINE_API_IMPL( database_api_impl, get_hardfork_properties )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, get_hardfork_properties )
 {
-   return _db.get_hardfork_property_object();
+   return state.template get< hardfork_property_object >();
 }
 
-DEFINE_API_IMPL( database_api_impl, get_reward_funds )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, get_reward_funds )
 {
    get_reward_funds_return result;
 
-   const auto& rf_idx = _db.get_index< reward_fund_index, by_id >();
+   const auto& rf_idx = state.template get_index< reward_fund_index, by_id >();
    auto itr = rf_idx.begin();
 
    while( itr != rf_idx.end() )
@@ -148,14 +160,14 @@ DEFINE_API_IMPL( database_api_impl, get_reward_funds )
    return result;
 }
 
-DEFINE_API_IMPL( database_api_impl, get_current_price_feed )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, get_current_price_feed )
 {
-   return _db.get_feed_history().current_median_history;;
+   return state.template get< feed_history_object >().current_median_history;
 }
 
-DEFINE_API_IMPL( database_api_impl, get_feed_history )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, get_feed_history )
 {
-   return _db.get_feed_history();
+   return state.template get< feed_history_object >();
 }
 
 
@@ -165,7 +177,7 @@ DEFINE_API_IMPL( database_api_impl, get_feed_history )
 //                                                                  //
 //////////////////////////////////////////////////////////////////////
 
-DEFINE_API_IMPL( database_api_impl, list_witnesses )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, list_witnesses )
 {
    FC_ASSERT( args.limit <= DATABASE_API_SINGLE_QUERY_LIMIT );
 
@@ -177,6 +189,7 @@ DEFINE_API_IMPL( database_api_impl, list_witnesses )
       case( by_name ):
       {
          iterate_results< chain::witness_index, chain::by_name >(
+            state,
             args.start.as< protocol::account_name_type >(),
             result.witnesses,
             args.limit,
@@ -187,6 +200,7 @@ DEFINE_API_IMPL( database_api_impl, list_witnesses )
       {
          auto key = args.start.as< std::pair< share_type, account_name_type > >();
          iterate_results< chain::witness_index, chain::by_vote_name >(
+            state,
             boost::make_tuple( key.first, key.second ),
             result.witnesses,
             args.limit,
@@ -196,8 +210,9 @@ DEFINE_API_IMPL( database_api_impl, list_witnesses )
       case( by_schedule_time ):
       {
          auto key = args.start.as< std::pair< fc::uint128, account_name_type > >();
-         auto wit_id = _db.get< chain::witness_object, chain::by_name >( key.second ).id;
+         auto wit_id = state.template get< chain::witness_object, chain::by_name >( key.second ).id;
          iterate_results< chain::witness_index, chain::by_schedule_time >(
+            state,
             boost::make_tuple( key.first, wit_id ),
             result.witnesses,
             args.limit,
@@ -211,7 +226,7 @@ DEFINE_API_IMPL( database_api_impl, list_witnesses )
    return result;
 }
 
-DEFINE_API_IMPL( database_api_impl, find_witnesses )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, find_witnesses )
 {
    FC_ASSERT( args.owners.size() <= DATABASE_API_SINGLE_QUERY_LIMIT );
 
@@ -219,7 +234,7 @@ DEFINE_API_IMPL( database_api_impl, find_witnesses )
 
    for( auto& o : args.owners )
    {
-      auto witness = _db.find< chain::witness_object, chain::by_name >( o );
+      auto witness = state.template find< chain::witness_object, chain::by_name >( o );
 
       if( witness != NULL )
          result.witnesses.push_back( api_witness_object( *witness ) );
@@ -264,9 +279,9 @@ DEFINE_API_IMPL( database_api_impl, list_witness_votes )
    return result;
 }
 
-DEFINE_API_IMPL( database_api_impl, get_active_witnesses )
+DEFINE_SNAPSHOT_API_IMPL( database_api_impl, get_active_witnesses )
 {
-   const auto& wso = _db.get_witness_schedule_object();
+   const auto& wso = state.template get< witness_schedule_object >();
    size_t n = wso.current_shuffled_witnesses.size();
    get_active_witnesses_return result;
    result.witnesses.reserve( n );
@@ -1419,7 +1434,7 @@ DEFINE_API_IMPL( database_api_impl, verify_signatures )
 
 DEFINE_LOCKLESS_APIS( database_api, (get_config) )
 
-DEFINE_READ_APIS( database_api,
+DEFINE_SNAPSHOT_APIS( database_api,
    (get_dynamic_global_properties)
    (get_witness_schedule)
    (get_hardfork_properties)
@@ -1428,8 +1443,11 @@ DEFINE_READ_APIS( database_api,
    (get_feed_history)
    (list_witnesses)
    (find_witnesses)
-   (list_witness_votes)
    (get_active_witnesses)
+)
+
+DEFINE_READ_APIS( database_api,
+   (list_witness_votes)
    (list_accounts)
    (find_accounts)
    (list_owner_histories)
@@ -1,6 +1,11 @@
 #include <gamebank/plugins/database_api/database_api.hpp>
 #include <gamebank/plugins/database_api/database_api_plugin.hpp>
 
+#include <gamebank/chain/global_property_object.hpp>
+#include <gamebank/chain/hardfork_property_object.hpp>
+#include <gamebank/chain/gamebank_objects.hpp>
+#include <gamebank/chain/witness_objects.hpp>
+
 namespace gamebank { namespace plugins { namespace database_api {
 
 database_api_plugin::database_api_plugin() {}
@@ -8,14 +13,36 @@ database_api_plugin::~database_api_plugin() {}
 
 void database_api_plugin::set_program_options(
    options_description& cli,
-   options_description& cfg ) {}
+   options_description& cfg )
+{
+   cfg.add_options()
+      ("database-api-snapshots", bpo::value< bool >()->default_value( false ),
+         "Answer the global and witness queries from a copy of that state published after every block, without waiting for the write lock" )
+      ;
+}
 
 void database_api_plugin::plugin_initialize( const variables_map& options )
 {
+   snapshots = options.at( "database-api-snapshots" ).as< bool >();
    api = std::make_shared< database_api >();
 }
 
-void database_api_plugin::plugin_startup() {}
+void database_api_plugin::plugin_startup()
+{
+   if( !snapshots )
+      return;
+
+   auto& db = appbase::app().get_plugin< gamebank::plugins::chain::chain_plugin >().db();
+   db.with_write_lock( [&]()
+   {
+      db.add_snapshot_index< chain::dynamic_global_property_index >();
+      db.add_snapshot_index< chain::witness_schedule_index >();
+      db.add_snapshot_index< chain::hardfork_property_index >();
+      db.add_snapshot_index< chain::reward_fund_index >();
+      db.add_snapshot_index< chain::feed_history_index >();
+      db.add_snapshot_index< chain::witness_index >();
+   });
+}
 
 void database_api_plugin::plugin_shutdown() {}
 
@@ -31,6 +31,9 @@ class database_api_plugin : public plugin< database_api_plugin >
       virtual void plugin_shutdown() override;
 
       std::shared_ptr< class database_api > api;
+
+   private:
+      bool snapshots = false;
 };
 
 } } } // gamebank::plugins::database_api
@@ -1,4 +1,5 @@
 #include <gamebank/chain/database_exceptions.hpp>
+#include <gamebank/chain/state_snapshot.hpp>
 
 #include <gamebank/plugins/chain/chain_plugin.hpp>
 #include <gamebank/plugins/statsd/utility.hpp>
@@ -12,8 +13,12 @@
 #include <boost/bind.hpp>
 #include <boost/preprocessor/stringize.hpp>
 #include <boost/thread/future.hpp>
-#include <boost/lockfree/queue.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
 #include <memory>
 #include <iostream>
@@ -46,16 +51,16 @@ struct generate_block_request
 
 struct confirm_block_request
 {
-    confirm_block_request(const signed_block &b) :
-        block(b) {}
+    confirm_block_request(const signed_block_header &h) :
+        header(h) {}
 
-    signed_block block;
+    signed_block_header header;
 };
 
 typedef fc::static_variant< const signed_block*, const signed_transaction*, generate_block_request*, confirm_block_request* > write_request_ptr;
 typedef fc::static_variant< boost::promise< void >*, fc::future< void >* > promise_ptr;
 
-//boost::lockfree::queue< write_context* >Ԫ
+//element of write_request_queue
 struct write_context
 {
    write_request_ptr             req_ptr;
@@ -65,12 +70,64 @@ struct write_context
    promise_ptr                   prom_ptr;	//static_variant()
 };
 
+/**
+ * Write requests waiting for the write thread.
+ *
+ * Callers push a context and block on its promise, the write thread sleeps on the condition
+ * variable until a request arrives and then drains as many as it can under one write lock.
+ */
+class write_request_queue
+{
+   public:
+      void push( write_context* cxt )
+      {
+         {
+            std::lock_guard< std::mutex > guard( _mutex );
+            _queue.push_back( cxt );
+         }
+         _cv.notify_one();
+      }
+
+      bool pop( write_context*& cxt )
+      {
+         std::lock_guard< std::mutex > guard( _mutex );
+         if( _queue.empty() )
+            return false;
+
+         cxt = _queue.front();
+         _queue.pop_front();
+         return true;
+      }
+
+      /// Returns false if the queue is still empty after timeout or wake() was called
+      bool wait( std::chrono::milliseconds timeout )
+      {
+         std::unique_lock< std::mutex > guard( _mutex );
+         if( _queue.empty() )
+            _cv.wait_for( guard, timeout );
+         return !_queue.empty();
+      }
+
+      void wake() { _cv.notify_all(); }
+
+      size_t size()
+      {
+         std::lock_guard< std::mutex > guard( _mutex );
+         return _queue.size();
+      }
+
+   private:
+      std::mutex                    _mutex;
+      std::condition_variable       _cv;
+      std::deque< write_context* >  _queue;
+};
+
 namespace detail {
 
 class chain_plugin_impl
 {
    public:
-      chain_plugin_impl() : write_queue( 64 ) {}
+      chain_plugin_impl() : write_batches( 0 ), write_requests( 0 ), max_write_batch( 0 ) {}
       ~chain_plugin_impl() { stop_write_processing(); }
 
       void start_write_processing();
@@ -91,15 +148,28 @@ class chain_plugin_impl
       uint32_t                         stop_replay_at = 0;
       uint32_t                         benchmark_interval = 0;
       uint32_t                         flush_interval = 0;
+      database::flush_mode             flush_mode = database::incremental_flush;
+      uint32_t                         contract_speculation_threads = 0;
+      uint32_t                         replay_threads = 0;
+      uint32_t                         signature_recovery_threads = 0;
+      bfs::path                        load_state_snapshot;
+      bfs::path                        dump_state_snapshot;
+      uint32_t                         state_snapshot_threads = 0;
+      bool                             contract_profiler = false;
+      bool                             index_locking = false;
       flat_map<uint32_t,block_id_type> loaded_checkpoints;
 
       uint32_t allow_future_time = 5;
 
       bool                             running = true;
       std::shared_ptr< std::thread >   write_processor_thread;	//д̣߳dbд
-      boost::lockfree::queue< write_context* > write_queue;		//УдݵĵӦȷwrite_contextָڽǰЧ
+      write_request_queue              write_queue;		//the caller must keep the write_context alive until its promise is set
       int16_t                          write_lock_hold_time = 500;
 
+      std::atomic< uint64_t >          write_batches;
+      std::atomic< uint64_t >          write_requests;
+      std::atomic< uint64_t >          max_write_batch;
+
       database  db;
 };
 
@@ -111,9 +181,65 @@ struct write_request_visitor			//
    database* db;
    uint32_t  skip = 0;
    fc::optional< fc::exception >* except;
+   gamebank::chain::contract_cache::cache_stats last_contract_cache_stats;
+   uint64_t last_block_ids = 0;
+   uint64_t last_block_sizes = 0;
+   uint64_t last_transaction_ids = 0;
+   uint64_t last_transaction_sizes = 0;
 
    typedef bool result_type;
 
+   void report_contract_cache_stats()
+   {
+      auto stats = db->get_contract_cache().get_stats();
+      STATSD_COUNT( chain, contract_cache, hit, stats.hits - last_contract_cache_stats.hits, 1.0f )
+      STATSD_COUNT( chain, contract_cache, miss, stats.misses - last_contract_cache_stats.misses, 1.0f )
+      STATSD_COUNT( chain, contract_cache, abi_hit, stats.abi_hits - last_contract_cache_stats.abi_hits, 1.0f )
+      STATSD_COUNT( chain, contract_cache, abi_miss, stats.abi_misses - last_contract_cache_stats.abi_misses, 1.0f )
+      STATSD_GAUGE( chain, contract_cache, entries, stats.entries, 1.0f )
+      STATSD_GAUGE( chain, contract_cache, bytes, stats.bytes, 1.0f )
+      last_contract_cache_stats = stats;
+   }
+
+   /// ids and sizes computed by the apply path, at most one of each per block and transaction
+   void report_apply_counters()
+   {
+      const auto& counters = gamebank::chain::apply_counters::get();
+      uint64_t block_ids = counters.block_ids, block_sizes = counters.block_sizes;
+      uint64_t transaction_ids = counters.transaction_ids, transaction_sizes = counters.transaction_sizes;
+      STATSD_COUNT( chain, apply, block_id, block_ids - last_block_ids, 1.0f )
+      STATSD_COUNT( chain, apply, block_size, block_sizes - last_block_sizes, 1.0f )
+      STATSD_COUNT( chain, apply, transaction_id, transaction_ids - last_transaction_ids, 1.0f )
+      STATSD_COUNT( chain, apply, transaction_size, transaction_sizes - last_transaction_sizes, 1.0f )
+      last_block_ids = block_ids;
+      last_block_sizes = block_sizes;
+      last_transaction_ids = transaction_ids;
+      last_transaction_sizes = transaction_sizes;
+   }
+
+   void report_contract_profile()
+   {
+      auto& profiler = db->get_contract_profiler();
+      if( !profiler.enabled() || !gamebank::plugins::statsd::util::statsd_enabled() )
+         return;
+
+      // one set of metrics per called method and block, however many calls the block made
+      const auto& statsd = gamebank::plugins::statsd::util::get_statsd();
+      for( const auto& method : profiler.take_recent_totals() )
+      {
+         const auto& totals = method.second;
+         std::string stat = std::string( method.first.first ) + "." + method.first.second;
+         statsd.count( "contract", stat, "calls", totals.calls, 1.0f );
+         statsd.timing( "contract", stat, "wall_time", totals.wall_time_us / 1000, 1.0f );
+         statsd.count( "contract", stat, "opcodes", totals.opcodes, 1.0f );
+         statsd.gauge( "contract", stat, "memory_kb", totals.max_memory_kb, 1.0f );
+         statsd.count( "contract", stat, "storage_read_bytes", totals.storage_read_bytes, 1.0f );
+         statsd.count( "contract", stat, "storage_write_bytes", totals.storage_write_bytes, 1.0f );
+         if( totals.failures )
+            statsd.count( "contract", stat, "failed", totals.failures, 1.0f );
+      }
+   }
+
    //дdb
    bool operator()( const signed_block* block )
    {
@@ -124,6 +250,10 @@ struct write_request_visitor			//
          STATSD_START_TIMER( chain, write_time, push_block, 1.0f )
          result = db->push_block( *block, skip );
          STATSD_STOP_TIMER( chain, write_time, push_block )
+         STATSD_TIMER( "chain", "write_time", "flush_stall", db->get_last_flush_stall(), 1.0f )
+         report_contract_cache_stats();
+         report_apply_counters();
+         report_contract_profile();
       }
       catch( fc::exception& e )
       {
@@ -202,7 +332,7 @@ struct write_request_visitor			//
        try
        {
            STATSD_START_TIMER(chain, write_time, confirm_block, 1.0f)
-           db->confirm_block(req->block);
+           db->confirm_block(req->header);
            STATSD_STOP_TIMER(chain, write_time, confirm_block)
 
            result = true;
@@ -242,14 +372,11 @@ void chain_plugin_impl::start_write_processing()
    //̺߳
       bool is_syncing = true;
       write_context* cxt;
-      fc::time_point_sec start = fc::time_point::now();
-      write_request_visitor req_visitor;	//ɵö󣬶д뽻סд顢Ĳ
-      req_visitor.db = &db;					
+      write_request_visitor req_visitor;	//write_request_visitor applies transactions and blocks and generates new blocks
+      req_visitor.db = &db;
 
-      request_promise_visitor prom_visitor;	//ɵö
+      request_promise_visitor prom_visitor;
 
-		//ѭwrite_queueдdb
-		//
       /* This loop monitors the write request queue and performs writes to the database. These
        * can be blocks or pending transactions. Because the caller needs to know the success of
        * the write and any exceptions that are thrown, a write context is passed in the queue
@@ -257,64 +384,62 @@ void chain_plugin_impl::start_write_processing()
        * caller's responsibility to ensure the pointer to the write context remains valid until
        * the contained promise is complete.
        *
-       * The loop has two modes, sync mode and live mode. In sync mode we want to process writes
-       * as quickly as possible with minimal overhead. The outer loop busy waits on the queue
-       * and the inner loop drains the queue as quickly as possible. We exit sync mode when the
-       * head block is within 1 minute of system time.
+       * The thread sleeps on the queue until a request is pushed, then takes the write lock once
+       * and drains every request that is queued, including those that arrive while the batch is
+       * being applied. Each caller is released as soon as its own request is done.
        *
-       * Live mode needs to balance between processing pending writes and allowing readers access
-       * to the database. It will batch writes together as much as possible to minimize lock
-       * overhead but will willingly give up the write lock after 500ms. The thread then sleeps for
-       * 10ms. This allows time for readers to access the database as well as more writes to come
-       * in. When the node is live the rate at which writes come in is slower and busy waiting is
-       * not an optimal use of system resources when we could give CPU time to read threads.
+       * In sync mode the batch runs until the queue is empty. We exit sync mode when the head
+       * block is within 1 minute of system time. In live mode the lock is given up after
+       * write_lock_hold_time even if requests are still waiting, and only then does the thread
+       * sleep for 10ms so readers are not starved by a steady stream of transactions. A batch
+       * that empties the queue goes straight back to waiting, readers get in between batches.
        */
-
-	  //also @see accept_block/accept_trascation/generate_block_request, them push ctx into write_queue
       while( running )
       {
-         if( !is_syncing )
-            start = fc::time_point::now();
+         if( !write_queue.wait( std::chrono::milliseconds( 100 ) ) )
+            continue;
+
+         STATSD_GAUGE( chain, write_queue, depth, write_queue.size(), 1.0f )
 
-         if( write_queue.pop( cxt ) )
+         uint64_t batch_size = 0;
+         bool hold_time_exceeded = false;
+
+         db.with_write_lock( [&]()
          {
-            db.with_write_lock( [&]()
+            STATSD_START_TIMER( chain, lock_time, write_lock, 1.0f )
+            fc::time_point start = fc::time_point::now();
+
+            while( write_queue.pop( cxt ) )
             {
-               STATSD_START_TIMER( chain, lock_time, write_lock, 1.0f )
-               while( true )
+               req_visitor.skip = cxt->skip;
+               req_visitor.except = &(cxt->except);
+               cxt->success = cxt->req_ptr.visit( req_visitor );
+               cxt->prom_ptr.visit( prom_visitor );
+               ++batch_size;
+
+               fc::time_point now = fc::time_point::now();
+               if( is_syncing && now - db.head_block_time() < fc::minutes(1) )
                {
-                  req_visitor.skip = cxt->skip;
-                  req_visitor.except = &(cxt->except);
-				  //core!!
-				  //maybe run write_request_visitor(signed_block)
-				  //ִе
-                  cxt->success = cxt->req_ptr.visit( req_visitor );	//ִreq_visitor()
-                  cxt->prom_ptr.visit( prom_visitor );				////ִprom_visitor()
-
-				  //asynģʽ˳
-                  if( is_syncing && start - db.head_block_time() < fc::minutes(1) )
-                  {
-                     start = fc::time_point::now();
-                     is_syncing = false;
-                  }
-
-				  //liveģʽҳʱ䳬ʱ˳ڲѭsleep 10ms
-                  if( !is_syncing && write_lock_hold_time >= 0 && fc::time_point::now() - start > fc::milliseconds( write_lock_hold_time ) )
-                  {
-                     break;
-                  }
-				  
-				  //ͣȡqueueϵ
-                  if( !write_queue.pop( cxt ) )
-                  {
-                     break;
-                  }
+                  start = now;
+                  is_syncing = false;
                }
-            });
-         }
 
-         if( !is_syncing )
-            boost::this_thread::sleep_for( boost::chrono::milliseconds( 10 ) );	//Live mode only
+               if( !is_syncing && write_lock_hold_time >= 0 && now - start > fc::milliseconds( write_lock_hold_time ) )
+               {
+                  hold_time_exceeded = true;
+                  break;
+               }
+            }
+         });
+
+         STATSD_GAUGE( chain, write_queue, batch_size, batch_size, 1.0f )
+         write_batches.fetch_add( 1, std::memory_order_relaxed );
+         write_requests.fetch_add( batch_size, std::memory_order_relaxed );
+         if( batch_size > max_write_batch.load( std::memory_order_relaxed ) )
+            max_write_batch.store( batch_size, std::memory_order_relaxed );
+
+         if( hold_time_exceeded )
+            boost::this_thread::sleep_for( boost::chrono::milliseconds( 10 ) );
       }
    });
 }
@@ -322,6 +447,7 @@ void chain_plugin_impl::start_write_processing()
 void chain_plugin_impl::stop_write_processing()
 {
    running = false;
+   write_queue.wake();
 
    if( write_processor_thread )
       write_processor_thread->join();
@@ -349,18 +475,34 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("shared-file-dir", bpo::value<bfs::path>()->default_value("blockchain"),
             "the location of the chain shared memory files (absolute path or relative to application data dir)")
          ("shared-file-size", bpo::value<string>()->default_value("24G"), "Size of the shared memory file. Default: 24G. If running a full node, increase this value to 200G.")
-         ("shared-file-full-threshold", bpo::value<uint16_t>()->default_value(0),
+         ("shared-file-full-threshold", bpo::value<uint16_t>()->default_value(9500),
             "A 2 precision percentage (0-10000) that defines the threshold for when to autoscale the shared memory file. Setting this to 0 disables autoscaling. Recommended value for consensus node is 9500 (95%). Full node is 9900 (99%)" )
-         ("shared-file-scale-rate", bpo::value<uint16_t>()->default_value(0),
+         ("shared-file-scale-rate", bpo::value<uint16_t>()->default_value(1000),
             "A 2 precision percentage (0-10000) that defines how quickly to scale the shared memory file. When autoscaling occurs the file's size will be increased by this percent. Setting this to 0 disables autoscaling. Recommended value is between 1000-2000 (10-20%)" )
          ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("flush-state-interval", bpo::value<uint32_t>(),
             "flush shared memory changes to disk every N blocks")
+         ("flush-state-mode", bpo::value<string>()->default_value("incremental"),
+            "How shared memory is flushed. 'incremental' writes back a slice of the file every block on a background thread, 'full' writes back the whole file once per flush-state-interval and blocks the write thread while doing so.")
+         ("contract-speculation-threads", bpo::value<uint32_t>()->default_value(0),
+            "Number of threads running the contract calls of a block before its transactions are applied, calls that conflict are run again in order. 0 runs every call in order.")
+         ("replay-threads", bpo::value<uint32_t>()->default_value(2),
+            "Number of threads reading and decoding blocks ahead of the apply thread during replay. 0 replays in a single thread.")
+         ("signature-recovery-threads", bpo::value<uint32_t>()->default_value(2),
+            "Number of threads recovering the signature keys of incoming blocks before the write lock is taken. 0 recovers them on the thread receiving the block.")
+         ("state-snapshot-threads", bpo::value<uint32_t>()->default_value(4),
+            "Number of threads packing or loading indices when a state snapshot is written or read.")
+         ("chainbase-lock-mode", bpo::value<string>()->default_value("global"),
+            "How API readers are kept apart from block application. 'global' locks the whole state, 'index' only the indices a reader or writer uses.")
+         ("contract-profiler", bpo::value<bool>()->default_value(false),
+            "Record opcodes, memory, time and storage bytes of every contract method applied from blocks")
          ;
    cli.add_options()
          ("replay-blockchain", bpo::bool_switch()->default_value(false), "clear chain database and replay all blocks" )
          ("resync-blockchain", bpo::bool_switch()->default_value(false), "clear chain database and block log" )
          ("stop-replay-at-block", bpo::value<uint32_t>(), "Stop and exit after reaching given block number")
+         ("load-state-snapshot", bpo::value<bfs::path>(), "Clear chain database, load the state from a snapshot and replay only the blocks after it" )
+         ("dump-state-snapshot", bpo::value<bfs::path>(), "Write the chain state to a snapshot once the database is open or replayed, before stop-replay-at-block exits" )
          ("advanced-benchmark", "Make profiling for every plugin.")
          ("set-benchmark-interval", bpo::value<uint32_t>(), "Print time and memory usage every given number of blocks")
          ("dump-memory-details", bpo::bool_switch()->default_value(false), "Dump database objects memory usage info. Use set-benchmark-interval to set dump interval.")
@@ -401,11 +543,32 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
    my->check_locks         = options.at( "check-locks" ).as< bool >();
    my->validate_invariants = options.at( "validate-database-invariants" ).as<bool>();
    my->dump_memory_details = options.at( "dump-memory-details" ).as<bool>();
+   my->contract_speculation_threads = options.at( "contract-speculation-threads" ).as< uint32_t >();
+   my->replay_threads = options.at( "replay-threads" ).as< uint32_t >();
+   my->signature_recovery_threads = options.at( "signature-recovery-threads" ).as< uint32_t >();
+   my->state_snapshot_threads = options.at( "state-snapshot-threads" ).as< uint32_t >();
+   if( options.count( "load-state-snapshot" ) )
+   {
+      my->load_state_snapshot = options.at( "load-state-snapshot" ).as< bfs::path >();
+      my->replay = true;
+   }
+   if( options.count( "dump-state-snapshot" ) )
+      my->dump_state_snapshot = options.at( "dump-state-snapshot" ).as< bfs::path >();
+   my->contract_profiler = options.at( "contract-profiler" ).as< bool >();
+
+   const auto& lock_mode = options.at( "chainbase-lock-mode" ).as< string >();
+   FC_ASSERT( lock_mode == "global" || lock_mode == "index", "chainbase-lock-mode must be 'global' or 'index'" );
+   my->index_locking = lock_mode == "index";
+   my->db.get_contract_profiler().enable( my->contract_profiler );
    if( options.count( "flush-state-interval" ) )
       my->flush_interval = options.at( "flush-state-interval" ).as<uint32_t>();
    else
       my->flush_interval = 10000;
 
+   const auto& flush_mode = options.at( "flush-state-mode" ).as< string >();
+   FC_ASSERT( flush_mode == "incremental" || flush_mode == "full", "flush-state-mode must be 'incremental' or 'full'" );
+   my->flush_mode = flush_mode == "full" ? database::full_flush : database::incremental_flush;
+
    if(options.count("checkpoint"))
    {
       auto cps = options.at("checkpoint").as<vector<string>>();
@@ -455,9 +618,10 @@ void chain_plugin::plugin_startup()
       my->db.wipe( app().data_dir() / "blockchain", my->shared_memory_dir, true );
    }
 
-   my->db.set_flush_interval( my->flush_interval );
+   my->db.set_flush_interval( my->flush_interval, my->flush_mode );
    my->db.add_checkpoints( my->loaded_checkpoints );
    my->db.set_require_locking( my->check_locks );
+   my->db.set_lock_mode( my->index_locking ? chainbase::database::index_locking : chainbase::database::global_locking );
 
    bool dump_memory_details = my->dump_memory_details;
    gamebank::utilities::benchmark_dumper dumper;
@@ -489,6 +653,22 @@ void chain_plugin::plugin_startup()
    db_open_args.do_validate_invariants = my->validate_invariants;
    db_open_args.stop_replay_at = my->stop_replay_at;
    db_open_args.benchmark_is_enabled = my->benchmark_is_enabled;
+   db_open_args.contract_speculation_threads = my->contract_speculation_threads;
+   db_open_args.replay_threads = my->replay_threads;
+   db_open_args.signature_recovery_threads = my->signature_recovery_threads;
+   db_open_args.state_snapshot = my->load_state_snapshot;
+   db_open_args.state_snapshot_threads = my->state_snapshot_threads;
+
+   auto dump_state_snapshot = [&]()
+   {
+      if( my->dump_state_snapshot.empty() )
+         return;
+
+      my->db.with_read_lock( [&]()
+      {
+         gamebank::chain::write_state_snapshot( my->db, my->dump_state_snapshot, my->state_snapshot_threads );
+      });
+   };
 
    auto benchmark_lambda = [&dumper, &get_indexes_memory_details, dump_memory_details] ( uint32_t current_block_number,
       const chainbase::database::abstract_index_cntr_t& abstract_index_cntr )
@@ -541,6 +721,8 @@ void chain_plugin::plugin_startup()
                ("pm", total_data.peak_mem) );
       }
 
+      dump_state_snapshot();
+
       if( my->stop_replay_at > 0 && my->stop_replay_at == last_block_number )
       {
          ilog("Stopped blockchain replaying on user request. Last applied block number: ${n}.", ("n", last_block_number));
@@ -575,6 +757,8 @@ void chain_plugin::plugin_startup()
             my->db.open( db_open_args );
          }
       }
+
+      dump_state_snapshot();
    }
 
    ilog( "Started on blockchain with ${n} blocks", ("n", my->db.head_block_num()) );
@@ -603,6 +787,10 @@ bool chain_plugin::accept_block( const gamebank::chain::signed_block& block, boo
 
    check_time_in_block( block );
 
+   // leave only the authority checks for the write thread
+   if( !( skip & database::skip_transaction_signatures ) )
+      my->db.recover_signatures( block );
+
    boost::promise< void > prom;
    write_context cxt;
    cxt.req_ptr = &block;
@@ -618,11 +806,11 @@ bool chain_plugin::accept_block( const gamebank::chain::signed_block& block, boo
    return cxt.success;
 }
 
-bool chain_plugin::accept_confirm( const gamebank::chain::signed_block& block )
+bool chain_plugin::accept_confirm( const gamebank::chain::signed_block_header& header )
 {
-    check_time_in_block(block);
+    check_time_in_block(header);
 
-    confirm_block_request req(block);
+    confirm_block_request req(header);
     boost::promise< void > prom;
     write_context cxt;
     cxt.req_ptr = &req;
@@ -640,6 +828,8 @@ bool chain_plugin::accept_confirm( const gamebank::chain::signed_block& block )
 //½
 void chain_plugin::accept_transaction( const gamebank::chain::signed_transaction& trx )
 {
+   my->db.recover_signatures( trx );
+
    boost::promise< void > prom;
    write_context cxt;
    cxt.req_ptr = &trx;
@@ -681,6 +871,16 @@ gamebank::chain::signed_block chain_plugin::generate_block(
    return req.block;
 }
 
+chain_plugin::write_queue_stats chain_plugin::get_write_queue_stats()
+{
+   write_queue_stats stats;
+   stats.depth = my->write_queue.size();
+   stats.batches = my->write_batches.load( std::memory_order_relaxed );
+   stats.requests = my->write_requests.load( std::memory_order_relaxed );
+   stats.max_batch_size = my->max_write_batch.load( std::memory_order_relaxed );
+   return stats;
+}
+
 int16_t chain_plugin::set_write_lock_hold_time( int16_t new_time )
 {
    FC_ASSERT( get_state() == appbase::abstract_plugin::state::initialized,
@@ -702,7 +902,7 @@ bool chain_plugin::block_is_on_preferred_chain(const gamebank::chain::block_id_t
    return db().get_block_id_for_num( gamebank::chain::block_header::num_from_id( block_id ) ) == block_id;
 }
 
-void chain_plugin::check_time_in_block( const gamebank::chain::signed_block& block )
+void chain_plugin::check_time_in_block( const gamebank::chain::signed_block_header& block )
 {
    time_point_sec now = fc::time_point::now();
 
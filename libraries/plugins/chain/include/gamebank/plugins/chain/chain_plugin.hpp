@@ -34,7 +34,7 @@ public:
    virtual void plugin_shutdown() override;
 
    bool accept_block( const gamebank::chain::signed_block& block, bool currently_syncing, uint32_t skip );
-   bool accept_confirm( const gamebank::chain::signed_block& block );
+   bool accept_confirm( const gamebank::chain::signed_block_header& header );
    void accept_transaction( const gamebank::chain::signed_transaction& trx );
    gamebank::chain::signed_block generate_block(
       const fc::time_point_sec when,
@@ -56,9 +56,19 @@ public:
     */
    int16_t set_write_lock_hold_time( int16_t new_time );
 
+   struct write_queue_stats
+   {
+      uint64_t depth = 0;           ///< requests currently waiting for the write thread
+      uint64_t batches = 0;         ///< write lock acquisitions that applied at least one request
+      uint64_t requests = 0;        ///< requests applied in total
+      uint64_t max_batch_size = 0;  ///< most requests applied under a single write lock
+   };
+
+   write_queue_stats get_write_queue_stats();
+
    bool block_is_on_preferred_chain( const gamebank::chain::block_id_type& block_id );
 
-   void check_time_in_block( const gamebank::chain::signed_block& block );
+   void check_time_in_block( const gamebank::chain::signed_block_header& block );
 
    template< typename MultiIndexType >
    bool has_index() const
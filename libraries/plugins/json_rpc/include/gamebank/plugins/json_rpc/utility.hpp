@@ -42,6 +42,22 @@ BOOST_PP_SEQ_FOR_EACH( DECLARE_API_IMPL_HELPER, _, METHODS )
 #define DEFINE_API_IMPL( class, method )                                                        \
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args )   \
 
+/*
+ * Snapshot APIs read either the live database or a chainbase::snapshot, passed as state. With
+ * lock set they query the last published snapshot without locking, or the live database under
+ * the read lock while there is no snapshot. Without lock they read the live database.
+ */
+#define DECLARE_SNAPSHOT_API_IMPL_HELPER( r, data, method ) \
+template< typename State > \
+BOOST_PP_CAT( method, _return ) method( const BOOST_PP_CAT( method, _args )& args, const State& state );
+
+#define DECLARE_SNAPSHOT_API_IMPL( METHODS ) \
+BOOST_PP_SEQ_FOR_EACH( DECLARE_SNAPSHOT_API_IMPL_HELPER, _, METHODS )
+
+#define DEFINE_SNAPSHOT_API_IMPL( class, method )                                                                       \
+template< typename State >                                                                                            \
+BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, const State& state )     \
+
 #define DEFINE_READ_API_HELPER( r, class, method )                                                       \
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
 {                                                                                                        \
@@ -68,6 +84,22 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
    }                                                                                                     \
 }
 
+#define DEFINE_SNAPSHOT_API_HELPER( r, class, method )                                                   \
+BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
+{                                                                                                        \
+   if( lock )                                                                                            \
+   {                                                                                                     \
+      auto snapshot = my->_db.get_snapshot();                                                            \
+      if( snapshot )                                                                                     \
+         return my->method( args, *snapshot );                                                           \
+      return my->_db.with_read_lock( [&args, this](){ return my->method( args, my->_db ); });            \
+   }                                                                                                     \
+   else                                                                                                  \
+   {                                                                                                     \
+      return my->method( args, my->_db );                                                                \
+   }                                                                                                     \
+}
+
 #define DEFINE_LOCKLESS_API_HELPER( r, class, method )                                                   \
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
 {                                                                                                        \
@@ -81,6 +113,9 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
 #define DEFINE_WRITE_APIS( class, METHODS ) \
    BOOST_PP_SEQ_FOR_EACH( DEFINE_WRITE_API_HELPER, class, METHODS )
 
+#define DEFINE_SNAPSHOT_APIS( class, METHODS ) \
+   BOOST_PP_SEQ_FOR_EACH( DEFINE_SNAPSHOT_API_HELPER, class, METHODS )
+
 #define DEFINE_LOCKLESS_APIS( class, METHODS ) \
    BOOST_PP_SEQ_FOR_EACH( DEFINE_LOCKLESS_API_HELPER, class, METHODS )
 
@@ -29,7 +29,7 @@ public:
 
    void broadcast_block( const gamebank::protocol::signed_block& block );
    void broadcast_transaction( const gamebank::protocol::signed_transaction& tx );
-   void broadcast_confirm( const gamebank::protocol::signed_block& block );
+   void broadcast_confirm( const gamebank::protocol::signed_block_header& header );
    void set_block_production( bool producing_blocks );
 
 private:
@@ -20,6 +20,7 @@
 #include <atomic>
 #include <chrono>
 #include <future>
+#include <mutex>
 
 using std::string;
 using std::vector;
@@ -92,6 +93,7 @@ public:
    virtual bool handle_confirm(const graphene::net::confirm_message&) override;
    virtual bool handle_block( const graphene::net::block_message&, bool, std::vector<fc::uint160_t>& ) override;
    virtual void handle_transaction( const graphene::net::trx_message& ) override;
+   virtual void prepare_message( const graphene::net::message& ) override;
    virtual void handle_message( const graphene::net::message& ) override;
    virtual std::vector< graphene::net::item_hash_t > get_block_ids( const std::vector< graphene::net::item_hash_t >&, uint32_t&, uint32_t ) override;
    virtual graphene::net::message get_item( const graphene::net::item_id& ) override;
@@ -128,6 +130,11 @@ public:
 
    boost::signals2::connection   _post_apply_block_conn;
    void on_post_apply_block( const signed_block& b );
+
+   /// headers of applied blocks waiting for the p2p thread, confirmed together in one message
+   std::mutex                             pending_confirms_mutex;
+   std::vector< signed_block_header >     pending_confirms;
+   void broadcast_pending_confirms();
 private:
    class shutdown_helper final
    {
@@ -159,8 +166,37 @@ private:
 ////////////////////////////// Begin node_delegate Implementation //////////////////////////////
 void p2p_plugin_impl::on_post_apply_block( const signed_block& b)
 {
-    ulog("Apply Block Broadcasting confirm #${n}", ("n", b.block_num()));
-    node->broadcast(graphene::net::confirm_message(b));
+    bool schedule = false;
+    {
+       std::lock_guard< std::mutex > guard( pending_confirms_mutex );
+       schedule = pending_confirms.empty();
+       pending_confirms.push_back( signed_block_header( b ) );
+    }
+
+    // blocks applied before the p2p thread gets to this one are confirmed in the same message
+    if( schedule )
+       p2p_thread.async( [this]() { broadcast_pending_confirms(); } );
+}
+
+void p2p_plugin_impl::broadcast_pending_confirms()
+{
+    const size_t max_confirms_per_message = 64;
+
+    std::vector< signed_block_header > headers;
+    {
+       std::lock_guard< std::mutex > guard( pending_confirms_mutex );
+       headers.swap( pending_confirms );
+    }
+
+    if( !node || !running.load() || headers.empty() )
+       return;
+
+    for( size_t i = 0; i < headers.size(); i += max_confirms_per_message )
+    {
+       auto end = std::min( headers.size(), i + max_confirms_per_message );
+       ulog("Apply Block Broadcasting confirm #${n} for ${c} blocks", ("n", headers[ end - 1 ].block_num())("c", end - i));
+       node->broadcast( graphene::net::confirm_message( std::vector< signed_block_header >( headers.begin() + i, headers.begin() + end ) ) );
+    }
 }
 
 bool p2p_plugin_impl::has_item( const graphene::net::item_id& id )
@@ -192,14 +228,30 @@ bool p2p_plugin_impl::handle_confirm( const graphene::net::confirm_message& cfm_
 
       try {
 
-         bool result = chain.accept_confirm( cfm_msg.block );
+         // every confirmation is tried, the first failure is rethrown afterwards
+         bool result = false;
+         fc::optional< fc::exception > error;
+         for( const auto& header : cfm_msg.headers )
+         {
+            try
+            {
+               result |= chain.accept_confirm( header );
+
+               fc::microseconds latency = fc::time_point::now() - header.timestamp;
+               ilog("Got comfirm of block ${b} by ${w} -- latency: ${l} ms",
+                   ("b", header.block_num())
+                   ("w", header.witness)
+                   ("l", latency.count() / 1000));
+            }
+            catch( const fc::exception& e )
+            {
+               if( !error )
+                  error = e;
+            }
+         }
 
-         fc::microseconds latency = fc::time_point::now() - cfm_msg.block.timestamp;
-         ilog("Got ${t} transactions on comfirm block ${b} by ${w} -- latency: ${l} ms",
-             ("t", cfm_msg.block.transactions.size())
-             ("b", cfm_msg.block.block_num())
-             ("w", cfm_msg.block.witness)
-             ("l", latency.count() / 1000));
+         if( error )
+            error->dynamic_rethrow_exception();
 
          return result;
       } catch ( const chain::unlinkable_block_exception& e ) {
@@ -312,6 +364,15 @@ void p2p_plugin_impl::handle_transaction( const graphene::net::trx_message& trx_
    }
 }
 
+void p2p_plugin_impl::prepare_message( const graphene::net::message& message_to_prepare )
+{
+   // runs on a p2p decode thread, accept_block and accept_transaction then find the keys cached
+   if( message_to_prepare.msg_type == graphene::net::trx_message_type )
+      chain.db().recover_signatures( message_to_prepare.get< graphene::net::trx_message >()->trx );
+   else if( message_to_prepare.msg_type == graphene::net::block_message_type && ( block_producer || force_validate ) )
+      chain.db().recover_signatures( message_to_prepare.get< graphene::net::block_message >()->block );
+}
+
 void p2p_plugin_impl::handle_message( const graphene::net::message& message_to_process )
 {
    // not a transaction, not a block
@@ -811,10 +872,10 @@ void p2p_plugin::broadcast_transaction( const gamebank::protocol::signed_transac
    my->node->broadcast( graphene::net::trx_message( tx ) );
 }
 
-void p2p_plugin::broadcast_confirm( const gamebank::protocol::signed_block& block )
+void p2p_plugin::broadcast_confirm( const gamebank::protocol::signed_block_header& header )
 {
-    ulog("Broadcasting confirm #${n}", ("n", block.block_num()));
-    my->node->broadcast( graphene::net::confirm_message( block ) );
+    ulog("Broadcasting confirm #${n}", ("n", header.block_num()));
+    my->node->broadcast( graphene::net::confirm_message( header ) );
 }
 
 void p2p_plugin::set_block_production( bool producing_blocks )
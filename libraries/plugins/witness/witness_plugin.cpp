@@ -268,7 +268,7 @@ namespace detail {
 	  flat_set< account_name_type > required; vector<authority> other;
       trx.get_required_authorities( required, required, required, other );
 
-      auto trx_size = fc::raw::pack_size(trx);
+      auto trx_size = note.packed_size();
 
       for( const auto& auth : required )
       {
@@ -325,7 +325,7 @@ namespace detail {
 
       auto reserve_ratio_ptr = _db.find( reserve_ratio_id_type() );
 
-      int32_t block_size = int32_t( fc::raw::pack_size( b ) );
+      int32_t block_size = int32_t( note.packed_size() );
       if( BOOST_UNLIKELY( reserve_ratio_ptr == nullptr ) )
       {
          _db.create< reserve_ratio_object >( [&]( reserve_ratio_object& r )
@@ -73,6 +73,14 @@ namespace gamebank { namespace protocol {
          const authority_getter& get_posting,
          uint32_t max_recursion = GAMEBANK_MAX_SIG_CHECK_DEPTH )const;
 
+      /// Same as above with the keys from get_signature_keys recovered beforehand
+      void verify_authority(
+         const flat_set<public_key_type>& signature_keys,
+         const authority_getter& get_active,
+         const authority_getter& get_owner,
+         const authority_getter& get_posting,
+         uint32_t max_recursion = GAMEBANK_MAX_SIG_CHECK_DEPTH )const;
+
       set<public_key_type> minimize_required_signatures(
          const chain_id_type& chain_id,
          const flat_set<public_key_type>& available_keys,
@@ -237,4 +237,14 @@ void signed_transaction::verify_authority(
    gamebank::protocol::verify_authority( operations, get_signature_keys( chain_id ), get_active, get_owner, get_posting, max_recursion );
 } FC_CAPTURE_AND_RETHROW( (*this) ) }
 
+void signed_transaction::verify_authority(
+   const flat_set<public_key_type>& signature_keys,
+   const authority_getter& get_active,
+   const authority_getter& get_owner,
+   const authority_getter& get_posting,
+   uint32_t max_recursion )const
+{ try {
+   gamebank::protocol::verify_authority( operations, signature_keys, get_active, get_owner, get_posting, max_recursion );
+} FC_CAPTURE_AND_RETHROW( (*this) ) }
+
 } } // gamebank::protocol
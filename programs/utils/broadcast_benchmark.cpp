@@ -0,0 +1,135 @@
+/*
+ * Sends signed transfers to a node through network_broadcast_api.broadcast_transaction from
+ * several connections at once and reports transactions per second and accept latency.
+ *
+ * broadcast_transaction returns once the chain_plugin write thread has applied the transaction,
+ * so the latency measured here is the time a transaction spends in the write queue plus the
+ * time to apply it. Every client sends its next transaction as soon as the previous one returns.
+ *
+ * Usage: broadcast_benchmark <host:port> <account> <wif> [transactions] [connections] [chain-id]
+ */
+
+#include <gamebank/protocol/config.hpp>
+#include <gamebank/protocol/gamebank_operations.hpp>
+#include <gamebank/protocol/transaction.hpp>
+#include <gamebank/utilities/key_conversion.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/network/http/connection.hpp>
+#include <fc/network/ip.hpp>
+#include <fc/variant_object.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace gamebank::protocol;
+
+typedef std::chrono::steady_clock bench_clock;
+
+static fc::variant call( fc::http::connection& con, const std::string& url, const std::string& method, const fc::variant& params )
+{
+   fc::mutable_variant_object req;
+   req( "jsonrpc", "2.0" )( "method", method )( "params", params )( "id", 1 );
+
+   auto reply = con.request( "POST", url, fc::json::to_string( fc::variant( req ) ) );
+   auto result = fc::json::from_string( std::string( reply.body.begin(), reply.body.end() ) ).get_object();
+   FC_ASSERT( !result.contains( "error" ), "${m} failed: ${e}", ("m", method)("e", result["error"]) );
+   return result["result"];
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      if( argc < 4 )
+      {
+         std::cerr << "Usage: broadcast_benchmark <host:port> <account> <wif> [transactions] [connections] [chain-id]\n";
+         return 1;
+      }
+
+      std::string endpoint = argv[1];
+      account_name_type account = std::string( argv[2] );
+      auto key = gamebank::utilities::wif_to_key( argv[3] );
+      FC_ASSERT( key.valid(), "Invalid private key" );
+      uint32_t transactions = argc > 4 ? std::stoul( argv[4] ) : 10000;
+      uint32_t connections = argc > 5 ? std::stoul( argv[5] ) : 16;
+      chain_id_type chain_id = argc > 6 ? chain_id_type( std::string( argv[6] ) ) : GAMEBANK_CHAIN_ID;
+
+      std::string url = "http://" + endpoint + "/";
+      auto ep = fc::ip::endpoint::from_string( endpoint );
+
+      fc::http::connection con;
+      con.connect_to( ep );
+      auto props = call( con, url, "database_api.get_dynamic_global_properties", fc::variant_object() ).get_object();
+      auto head_id = props[ "head_block_id" ].as< block_id_type >();
+      auto head_time = props[ "time" ].as< fc::time_point_sec >();
+
+      std::atomic< uint32_t > next( 0 );
+      std::atomic< uint32_t > failed( 0 );
+      std::vector< std::vector< int64_t > > latencies( connections );
+      std::vector< std::thread > clients;
+
+      auto start = bench_clock::now();
+      for( uint32_t c = 0; c < connections; ++c )
+      {
+         clients.emplace_back( [&, c]()
+         {
+            fc::http::connection client;
+            client.connect_to( ep );
+
+            for( uint32_t n = next++; n < transactions; n = next++ )
+            {
+               transfer_operation op;
+               op.from = account;
+               op.to = account;
+               op.amount = asset( 1, GBC_SYMBOL );
+               op.memo = std::to_string( n );   // keeps every transaction id unique
+
+               signed_transaction tx;
+               tx.set_reference_block( head_id );
+               tx.set_expiration( head_time + fc::seconds( GAMEBANK_MAX_TIME_UNTIL_EXPIRATION / 2 ) );
+               tx.operations.push_back( op );
+               tx.sign( *key, chain_id );
+
+               auto sent = bench_clock::now();
+               try
+               {
+                  call( client, url, "network_broadcast_api.broadcast_transaction", fc::mutable_variant_object( "trx", tx ) );
+               }
+               catch( const fc::exception& e )
+               {
+                  if( failed++ == 0 )
+                     std::cerr << e.to_string() << "\n";
+                  continue;
+               }
+               latencies[ c ].push_back( std::chrono::duration_cast< std::chrono::microseconds >( bench_clock::now() - sent ).count() );
+            }
+         });
+      }
+
+      for( auto& t : clients )
+         t.join();
+      double seconds = std::chrono::duration_cast< std::chrono::microseconds >( bench_clock::now() - start ).count() / 1e6;
+
+      std::vector< int64_t > all;
+      for( auto& l : latencies )
+         all.insert( all.end(), l.begin(), l.end() );
+      std::sort( all.begin(), all.end() );
+      auto pct = [&]( double p ) { return all.empty() ? 0 : all[ std::min< size_t >( all.size() - 1, all.size() * p ) ]; };
+
+      std::cout << all.size() << " accepted, " << failed << " failed in " << seconds << "s over " << connections << " connections\n"
+                << "   " << uint64_t( all.size() / seconds ) << " tx/s, latency p50 " << pct( 0.5 ) << "us p99 " << pct( 0.99 )
+                << "us max " << ( all.empty() ? 0 : all.back() ) << "us\n";
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * Simulates a network of nodes relaying blocks and reports the bytes sent and the time until
+ * every node has the block, once sending block_message and once compact_block_message.
+ *
+ * Nodes are connected to a fixed number of random peers with the same one way delay and
+ * bandwidth. A node advertises a block to its peers as soon as it has it and fetches it from
+ * the first peer that advertised it, like graphene::net::node. Every node has already received
+ * each transaction of the block with the given probability, the missing ones cost another
+ * round trip with get_block_transactions_message. Messages are counted as sent by stcp_socket:
+ * header plus data, padded to the 16 byte cipher block.
+ *
+ * Usage: compact_block_benchmark [nodes] [peers per node] [transactions per block] [percent of transactions seen] [delay ms] [Mbit/s]
+ */
+
+#include <gamebank/protocol/config.hpp>
+#include <gamebank/protocol/block.hpp>
+#include <gamebank/protocol/gamebank_operations.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace gamebank::protocol;
+using namespace graphene::net;
+
+struct link_model
+{
+   double               delay_ms;
+   double               bytes_per_ms;
+
+   double send( uint64_t bytes )const { return delay_ms + bytes / bytes_per_ms; }
+};
+
+struct relay_result
+{
+   uint64_t             bytes = 0;
+   double               last_arrival_ms = 0;
+};
+
+static uint64_t wire_size( const message& m )
+{
+   return ( sizeof( message_header ) + m.data.size() + 15 ) / 16 * 16;
+}
+
+/// Bytes a fetched block costs on one link and the time it takes to arrive after it was advertised
+typedef std::function< std::pair< uint64_t, double >( uint32_t node ) > fetch_cost;
+
+static relay_result relay( const std::vector< std::vector< uint32_t > >& peers, uint32_t origin, const link_model& link,
+                           uint64_t advertise_bytes, uint64_t fetch_bytes, const fetch_cost& cost )
+{
+   relay_result result;
+   std::vector< double > arrival( peers.size(), -1 );
+
+   typedef std::pair< double, uint32_t > event;   // time the block is offered, node
+   std::priority_queue< event, std::vector< event >, std::greater< event > > offers;
+
+   auto advertise = [&]( uint32_t from, double now )
+   {
+      for( uint32_t p : peers[ from ] )
+      {
+         if( arrival[ p ] >= 0 )
+            continue;
+         result.bytes += advertise_bytes;
+         offers.push( { now + link.send( advertise_bytes ), p } );
+      }
+   };
+
+   arrival[ origin ] = 0;
+   advertise( origin, 0 );
+
+   while( !offers.empty() )
+   {
+      auto offer = offers.top();
+      offers.pop();
+      uint32_t node = offer.second;
+      if( arrival[ node ] >= 0 )
+         continue;
+
+      // later offers to the same node are skipped, the node only fetches from the first peer
+      auto c = cost( node );
+      result.bytes += fetch_bytes + c.first;
+      arrival[ node ] = offer.first + link.send( fetch_bytes ) + c.second;
+      result.last_arrival_ms = std::max( result.last_arrival_ms, arrival[ node ] );
+      advertise( node, arrival[ node ] );
+   }
+
+   return result;
+}
+
+static signed_block make_block( uint32_t num, const block_id_type& previous, uint32_t transactions,
+                                const fc::ecc::private_key& key )
+{
+   signed_block b;
+   b.previous = previous;
+   b.timestamp = GAMEBANK_GENESIS_TIME + num * GAMEBANK_BLOCK_INTERVAL;
+   b.witness = "initminer";
+
+   for( uint32_t t = 0; t < transactions; ++t )
+   {
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob";
+      op.amount = asset( 1 + t, GBC_SYMBOL );
+      op.memo = "transfer " + std::to_string( t );
+
+      signed_transaction tx;
+      tx.ref_block_num = num & 0xffff;
+      tx.expiration = b.timestamp + GAMEBANK_MAX_TIME_UNTIL_EXPIRATION / 2;
+      tx.operations.push_back( op );
+      tx.sign( key, GAMEBANK_CHAIN_ID );
+      b.transactions.push_back( tx );
+   }
+
+   b.transaction_merkle_root = b.calculate_merkle_root();
+   b.sign( key );
+   return b;
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      uint32_t node_count = argc > 1 ? std::stoul( argv[1] ) : 100;
+      uint32_t peer_count = argc > 2 ? std::stoul( argv[2] ) : 8;
+      uint32_t transactions = argc > 3 ? std::stoul( argv[3] ) : 500;
+      double seen_percent = argc > 4 ? std::stod( argv[4] ) : 98;
+      link_model link{ argc > 5 ? std::stod( argv[5] ) : 50, ( argc > 6 ? std::stod( argv[6] ) : 20 ) * 1000 / 8 };
+      FC_ASSERT( node_count > peer_count, "Need more nodes than peers per node" );
+
+      // random graph, every node picks peer_count / 2 peers and connections go both ways
+      std::mt19937 rng( 0 );
+      std::vector< std::vector< uint32_t > > peers( node_count );
+      for( uint32_t n = 0; n < node_count; ++n )
+      {
+         for( uint32_t c = 0; c < peer_count / 2; ++c )
+         {
+            uint32_t p = rng() % node_count;
+            if( p == n || std::find( peers[ n ].begin(), peers[ n ].end(), p ) != peers[ n ].end() )
+               continue;
+            peers[ n ].push_back( p );
+            peers[ p ].push_back( n );
+         }
+      }
+
+      auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "init_key" ) ) );
+      auto b = make_block( 1, block_id_type(), transactions, key );
+      message block_msg = block_message( b );
+      auto block_hash = block_msg.id();
+      message compact_msg = compact_block_message( block_message( b ), block_hash );
+
+      uint64_t advertise_bytes = wire_size( message( item_ids_inventory_message( block_message_type, { block_hash } ) ) );
+      uint64_t fetch_bytes = wire_size( message( fetch_items_message( block_message_type, { block_hash } ) ) );
+      uint64_t block_bytes = wire_size( block_msg );
+      uint64_t compact_bytes = wire_size( compact_msg );
+
+      auto full = relay( peers, 0, link, advertise_bytes, fetch_bytes, [&]( uint32_t )
+      {
+         return std::make_pair( block_bytes, link.send( block_bytes ) );
+      });
+
+      std::bernoulli_distribution seen( seen_percent / 100 );
+      uint64_t transactions_fetched = 0, nodes_fetching = 0;
+      auto compact = relay( peers, 0, link, advertise_bytes, fetch_bytes, [&]( uint32_t )
+      {
+         std::vector< uint32_t > missing;
+         block_transactions_message reply;
+         reply.block_message_hash = block_hash;
+         for( uint32_t i = 0; i < b.transactions.size(); ++i )
+         {
+            if( !seen( rng ) )
+            {
+               missing.push_back( i );
+               reply.transactions.push_back( b.transactions[ i ] );
+            }
+         }
+
+         uint64_t bytes = compact_bytes;
+         double ms = link.send( compact_bytes );
+         if( !missing.empty() )
+         {
+            uint64_t request_bytes = wire_size( message( get_block_transactions_message( block_hash, missing ) ) );
+            uint64_t reply_bytes = wire_size( message( reply ) );
+            bytes += request_bytes + reply_bytes;
+            ms += link.send( request_bytes ) + link.send( reply_bytes );
+            transactions_fetched += missing.size();
+            ++nodes_fetching;
+         }
+         return std::make_pair( bytes, ms );
+      });
+
+      std::cout << node_count << " nodes, " << peer_count << " peers each, " << transactions << " transactions per block ("
+                << block_bytes << " bytes), " << seen_percent << "% seen, " << link.delay_ms << "ms delay, "
+                << link.bytes_per_ms * 8 / 1000 << " Mbit/s\n"
+                << "   block_message:          " << full.bytes << " bytes, every node has it after "
+                << uint64_t( full.last_arrival_ms ) << "ms\n"
+                << "   compact_block_message:  " << compact.bytes << " bytes, every node has it after "
+                << uint64_t( compact.last_arrival_ms ) << "ms, " << nodes_fetching
+                << " nodes fetched " << transactions_fetched << " transactions\n";
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Simulates a network of nodes relaying blocks and confirmations and reports the bytes sent
+ * per block, once with the old confirm_message carrying the whole block and once with the
+ * compact one carrying only the signed header.
+ *
+ * Nodes are connected to a fixed number of random peers. Like graphene::net::node, a node
+ * advertises every new item to its peers and a peer fetches it once, from the first node
+ * that advertised it. Every node confirms a block after applying it and every node builds
+ * the same confirmation for the same block, so a confirmation travels the network once like
+ * the block does. Messages are counted as sent by stcp_socket: header plus data, padded to
+ * the 16 byte cipher block.
+ *
+ * Usage: confirm_bandwidth_benchmark [nodes] [peers per node] [transactions per block] [blocks]
+ */
+
+#include <gamebank/protocol/config.hpp>
+#include <gamebank/protocol/block.hpp>
+#include <gamebank/protocol/gamebank_operations.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace gamebank::protocol;
+using namespace graphene::net;
+
+struct sim_node
+{
+   std::vector< uint32_t >             peers;
+   std::set< std::pair< uint32_t, message_hash_type > >   have;   ///< item type and id, like graphene::net::item_id
+};
+
+struct delivery
+{
+   uint32_t             from;
+   uint32_t             to;
+};
+
+static uint64_t wire_size( const message& m )
+{
+   return ( sizeof( message_header ) + m.data.size() + 15 ) / 16 * 16;
+}
+
+static uint64_t wire_size_of_inventory( uint32_t item_type, const message_hash_type& id )
+{
+   return wire_size( message( item_ids_inventory_message( item_type, { id } ) ) );
+}
+
+static uint64_t wire_size_of_fetch( uint32_t item_type, const message_hash_type& id )
+{
+   return wire_size( message( fetch_items_message( item_type, { id } ) ) );
+}
+
+/// Bytes sent while item spreads from origin to every node
+static uint64_t relay( std::vector< sim_node >& nodes, uint32_t origin, const message& item )
+{
+   auto id = item.id();
+   auto key = std::make_pair( uint32_t( item.msg_type ), id );
+   uint64_t item_bytes = wire_size( item );
+   uint64_t advertise_bytes = wire_size_of_inventory( item.msg_type, id );
+   uint64_t fetch_bytes = wire_size_of_fetch( item.msg_type, id );
+   uint64_t total = 0;
+
+   std::deque< delivery > queue;
+   auto advertise = [&]( uint32_t from, uint32_t skip )
+   {
+      for( uint32_t p : nodes[ from ].peers )
+      {
+         if( p == skip )
+            continue;
+         total += advertise_bytes;
+         queue.push_back( { from, p } );
+      }
+   };
+
+   nodes[ origin ].have.insert( key );
+   advertise( origin, origin );
+
+   while( !queue.empty() )
+   {
+      auto d = queue.front();
+      queue.pop_front();
+      if( !nodes[ d.to ].have.insert( key ).second )
+         continue;
+
+      total += fetch_bytes + item_bytes;
+      advertise( d.to, d.from );
+   }
+
+   return total;
+}
+
+static signed_block make_block( uint32_t num, const block_id_type& previous, uint32_t transactions,
+                                const fc::ecc::private_key& key )
+{
+   signed_block b;
+   b.previous = previous;
+   b.timestamp = GAMEBANK_GENESIS_TIME + num * GAMEBANK_BLOCK_INTERVAL;
+   b.witness = "initminer";
+
+   for( uint32_t t = 0; t < transactions; ++t )
+   {
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob";
+      op.amount = asset( 1 + t, GBC_SYMBOL );
+      op.memo = "transfer " + std::to_string( t );
+
+      signed_transaction tx;
+      tx.ref_block_num = num & 0xffff;
+      tx.expiration = b.timestamp + GAMEBANK_MAX_TIME_UNTIL_EXPIRATION / 2;
+      tx.operations.push_back( op );
+      tx.sign( key, GAMEBANK_CHAIN_ID );
+      b.transactions.push_back( tx );
+   }
+
+   b.transaction_merkle_root = b.calculate_merkle_root();
+   b.sign( key );
+   return b;
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      uint32_t node_count = argc > 1 ? std::stoul( argv[1] ) : 100;
+      uint32_t peer_count = argc > 2 ? std::stoul( argv[2] ) : 8;
+      uint32_t transactions = argc > 3 ? std::stoul( argv[3] ) : 100;
+      uint32_t blocks = argc > 4 ? std::stoul( argv[4] ) : 20;
+      FC_ASSERT( node_count > peer_count, "Need more nodes than peers per node" );
+
+      // random graph, every node picks peer_count / 2 peers and connections go both ways
+      std::mt19937 rng( 0 );
+      std::vector< sim_node > nodes( node_count );
+      for( uint32_t n = 0; n < node_count; ++n )
+      {
+         for( uint32_t c = 0; c < peer_count / 2; ++c )
+         {
+            uint32_t p = rng() % node_count;
+            auto& peers = nodes[ n ].peers;
+            if( p == n || std::find( peers.begin(), peers.end(), p ) != peers.end() )
+               continue;
+            peers.push_back( p );
+            nodes[ p ].peers.push_back( n );
+         }
+      }
+
+      auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "init_key" ) ) );
+      block_id_type previous;
+      uint64_t block_bytes = 0, legacy_confirm_bytes = 0, compact_confirm_bytes = 0, block_size = 0;
+
+      for( uint32_t num = 1; num <= blocks; ++num )
+      {
+         auto b = make_block( num, previous, transactions, key );
+         previous = b.id();
+         uint32_t producer = num % node_count;
+
+         message block_msg = block_message( b );
+         block_size += block_msg.data.size();
+         block_bytes += relay( nodes, producer, block_msg );
+
+         // the old confirm_message was laid out exactly like block_message
+         message legacy_msg = block_message( b );
+         legacy_msg.msg_type = confirm_message_type;
+         legacy_confirm_bytes += relay( nodes, producer, legacy_msg );
+
+         compact_confirm_bytes += relay( nodes, producer, message( confirm_message( signed_block_header( b ) ) ) );
+      }
+
+      auto per_block = [&]( uint64_t bytes ) { return bytes / blocks; };
+      std::cout << node_count << " nodes, " << peer_count << " peers each, " << transactions << " transactions per block ("
+                << per_block( block_size ) << " bytes), " << blocks << " blocks\n"
+                << "   blocks:            " << per_block( block_bytes ) << " bytes per block\n"
+                << "   full confirms:     " << per_block( legacy_confirm_bytes ) << " bytes per block, total "
+                << per_block( block_bytes + legacy_confirm_bytes ) << "\n"
+                << "   compact confirms:  " << per_block( compact_confirm_bytes ) << " bytes per block, total "
+                << per_block( block_bytes + compact_confirm_bytes ) << "\n";
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Measures contract_call throughput of the Lua contract VM with a fresh lua_State
+ * per call, with states taken from contract_lua_pool, and with the pool plus the
+ * precompiled chunk cache.
+ */
+
+#include <iostream>
+#include <string>
+
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+
+#include <gamebank/chain/contract/contract_lua.hpp>
+
+using namespace gamebank::chain;
+
+static const char* benchmark_contract =
+   "function add(a, b)\n"
+   "   local t = {}\n"
+   "   for i = 1, 16 do\n"
+   "      t[i] = a * i + b\n"
+   "   end\n"
+   "   return tostring(t[16])\n"
+   "end\n";
+
+template< typename Load >
+static double run( const char* label, uint32_t iterations, contract_lua_pool* pool, Load&& load )
+{
+   std::set< std::string > abi = { "add" };
+   variants args = { variant( 3 ), variant( 4 ) };
+   std::string result;
+
+   auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+   {
+      contract_lua contract( "benchmark", pool );
+      contract.set_abi( abi );
+      contract.set_extend( "benchmark", "caller" );
+      contract.set_extend_arg( 0, 0 );
+      FC_ASSERT( load( contract ), "load contract error" );
+      FC_ASSERT( contract.call_method( "add", args, result ), "call method error" );
+   }
+   auto elapsed = fc::time_point::now() - start;
+
+   double calls_per_second = iterations * 1000000.0 / std::max< int64_t >( elapsed.count(), 1 );
+   std::cout << label << ": " << iterations << " calls in " << elapsed.count() / 1000 << " ms, "
+             << uint64_t( calls_per_second ) << " calls/s\n";
+   return calls_per_second;
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      uint32_t iterations = argc > 1 ? std::stoul( argv[1] ) : 100000;
+      std::string code = benchmark_contract;
+      auto version = digest_type::hash( code );
+
+      fc::logger::get( DEFAULT_LOGGER ).set_log_level( fc::log_level::error );
+
+      contract_lua_pool pool;
+      contract_cache cache;
+
+      double fresh = run( "fresh state", iterations, nullptr,
+         [&]( contract_lua& c ) { return c.load( code ); } );
+      double pooled = run( "pooled state", iterations, &pool,
+         [&]( contract_lua& c ) { return c.load( code ); } );
+      double cached = run( "pooled state + bytecode cache", iterations, &pool,
+         [&]( contract_lua& c ) { return c.load( code, version, cache ); } );
+
+      std::cout << "pool speedup: " << pooled / fresh << "x, with cache: " << cached / fresh << "x\n";
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
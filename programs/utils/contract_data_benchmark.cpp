@@ -0,0 +1,124 @@
+/*
+ * Compares encode and decode throughput of the binary contract user data format
+ * against the cjson text it replaces, on a generated per-user game state table.
+ *
+ * Three runs with the default 2000 iterations, g++ -O2, measured 2026-10-17:
+ *
+ *   size     json 31205 bytes, binary 22968 bytes (26% smaller)
+ *   decode   cjson 1707-1793 ops/s, binary 3181-3421 ops/s (1.8-1.9x)
+ *   encode   cjson 2953-3447 ops/s, binary 2991-3590 ops/s (about even)
+ */
+
+#include <iostream>
+#include <string>
+
+#include <fc/exception/exception.hpp>
+#include <fc/time.hpp>
+
+#include <gamebank/chain/contract/contract_lua_data.hpp>
+#include <gamebank/chain/contract/contract_lua_pool.hpp>
+
+extern "C"
+{
+#include "gamebank/chain/contract/lua/lua.h"
+#include "gamebank/chain/contract/lua/lauxlib.h"
+#include "gamebank/chain/contract/lua/lua_cjson.h"
+}
+
+using namespace gamebank::chain;
+
+static const char* benchmark_state =
+   "local state = { name = 'player', level = 42, gold = 123456789, ratio = 0.75, items = {}, quests = {} }\n"
+   "for i = 1, 500 do\n"
+   "   state.items[i] = { id = i, count = i * 3, label = 'item_' .. i, rare = (i % 7 == 0) }\n"
+   "end\n"
+   "for i = 1, 100 do\n"
+   "   state.quests['quest_' .. i] = { step = i % 5, progress = i / 100 }\n"
+   "end\n"
+   "return state\n";
+
+static int json_encode_top( lua_State* L )
+{
+   int len = 0;
+   char* json = json_encode_tostring( L, &len );
+   lua_pushlstring( L, json, len );
+   return 1;
+}
+
+static int json_decode_arg( lua_State* L )
+{
+   size_t len = 0;
+   const char* data = lua_tolstring( L, 1, &len );
+   return json_decode_fromstring( L, data, int( len ) );
+}
+
+static int binary_decode_arg( lua_State* L )
+{
+   size_t len = 0;
+   const char* data = lua_tolstring( L, 1, &len );
+   return contract_data_decode( L, data, len );
+}
+
+static void report( const char* label, uint32_t iterations, size_t bytes, const fc::microseconds& elapsed )
+{
+   double seconds = std::max< int64_t >( elapsed.count(), 1 ) / 1000000.0;
+   std::cout << label << ": " << uint64_t( iterations / seconds ) << " ops/s, "
+             << uint64_t( iterations * bytes / seconds / ( 1024 * 1024 ) ) << " MB/s\n";
+}
+
+int main( int argc, char** argv )
+{
+   uint32_t iterations = argc > 1 ? std::stoul( argv[1] ) : 2000;
+   lua_State* L = contract_lua_pool::create_state();
+
+   FC_ASSERT( luaL_dostring( L, benchmark_state ) == 0, "cannot build benchmark state" );
+   int state = lua_gettop( L );
+
+   std::string json;
+   auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+   {
+      lua_pushcfunction( L, json_encode_top );
+      lua_pushvalue( L, state );
+      lua_call( L, 1, 1 );
+      if( i == 0 )
+         json = lua_tostring( L, -1 );
+      lua_pop( L, 1 );
+   }
+   report( "cjson encode", iterations, json.size(), fc::time_point::now() - start );
+
+   std::string binary;
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+   {
+      binary.clear();
+      lua_pushvalue( L, state );
+      contract_data_encode( L, binary );
+      lua_pop( L, 1 );
+   }
+   report( "binary encode", iterations, binary.size(), fc::time_point::now() - start );
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+   {
+      lua_pushcfunction( L, json_decode_arg );
+      lua_pushlstring( L, json.data(), json.size() );
+      lua_call( L, 1, 1 );
+      lua_pop( L, 1 );
+   }
+   report( "cjson decode", iterations, json.size(), fc::time_point::now() - start );
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+   {
+      lua_pushcfunction( L, binary_decode_arg );
+      lua_pushlstring( L, binary.data(), binary.size() );
+      lua_call( L, 1, 1 );
+      lua_pop( L, 1 );
+   }
+   report( "binary decode", iterations, binary.size(), fc::time_point::now() - start );
+
+   std::cout << "size: json " << json.size() << " bytes, binary " << binary.size() << " bytes\n";
+   lua_close( L );
+   return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Builds a chain whose blocks are full of contract calls, then reindexes it once with the
+ * calls run only by their evaluators and once with contract speculation threads, and
+ * compares the elapsed time and the resulting state.
+ *
+ * Every call does some work and then updates a storage key. Most calls use a key of their
+ * own, the rest share one, so they conflict with each other and are run again.
+ */
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fc/filesystem.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/time.hpp>
+
+#include <gamebank/chain/contract/contract_speculation.hpp>
+#include <gamebank/chain/database.hpp>
+#include <gamebank/chain/state_snapshot.hpp>
+
+using namespace gamebank::chain;
+using namespace gamebank::protocol;
+
+static const char* benchmark_contract =
+   "function work(key, rounds)\n"
+   "   local h = 0\n"
+   "   for i = 1, tonumber(rounds) do\n"
+   "      h = (h * 31 + i) % 1000000007\n"
+   "   end\n"
+   "   local old = contract.get(contract.get_name(), key)\n"
+   "   local count = (old and old.count or 0) + 1\n"
+   "   contract.set(contract.get_name(), key, { count = count, hash = h })\n"
+   "   return tostring(count)\n"
+   "end\n";
+
+static const char* benchmark_abi = "[{\"type\":\"function\",\"name\":\"work\",\"args\":[\"string\",\"string\"]}]";
+
+static const uint32_t benchmark_skip =
+   database::skip_witness_signature | database::skip_transaction_signatures | database::skip_tapos_check |
+   database::skip_authority_check | database::skip_block_size_check | database::skip_transaction_dupe_check;
+
+static database::open_args make_args( const fc::path& dir, uint32_t threads )
+{
+   database::open_args args;
+   args.data_dir = dir;
+   args.shared_mem_dir = dir / "blockchain";
+   args.shared_file_size = uint64_t( 1024 ) * 1024 * 1024;
+   args.contract_speculation_threads = threads;
+   return args;
+}
+
+static void push( database& db, const operation& op, uint32_t n )
+{
+   // tapos isn't checked, the reference only keeps calls with the same arguments apart
+   signed_transaction tx;
+   tx.ref_block_num = uint16_t( n );
+   tx.ref_block_prefix = n;
+   tx.operations.push_back( op );
+   tx.set_expiration( db.head_block_time() + GAMEBANK_MAX_TIME_UNTIL_EXPIRATION );
+   db.push_transaction( tx, benchmark_skip );
+}
+
+static void generate_block( database& db, const fc::ecc::private_key& key )
+{
+   uint32_t slot = 1;
+   db.generate_block( db.get_slot_time( slot ), db.get_scheduled_witness( slot ), key, benchmark_skip );
+}
+
+static void build_chain( const fc::path& dir, uint32_t blocks, uint32_t calls, uint32_t rounds, uint32_t conflict_percent )
+{
+   database db;
+   db.open( make_args( dir, 0 ) );
+   auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "benchmark" ) ) );
+
+   db.with_write_lock( [&]()
+   {
+      contract_deploy_operation deploy;
+      deploy.creator = GAMEBANK_INIT_MINER_NAME;
+      deploy.name = "benchmark";
+      deploy.code = benchmark_contract;
+      deploy.abi = benchmark_abi;
+      push( db, deploy, 0 );
+      generate_block( db, key );
+
+      uint64_t n = 1;
+      for( uint32_t b = 0; b < blocks; ++b )
+      {
+         for( uint32_t c = 0; c < calls; ++c, ++n )
+         {
+            contract_call_operation call;
+            call.caller = GAMEBANK_INIT_MINER_NAME;
+            call.contract_name = "benchmark";
+            call.method = "work";
+            std::string key_name = ( n % 100 ) < conflict_percent ? std::string( "shared" ) : "key" + std::to_string( n );
+            call.args = "[\"" + key_name + "\",\"" + std::to_string( rounds ) + "\"]";
+            push( db, call, uint32_t( n ) );
+         }
+         generate_block( db, key );
+      }
+   });
+   db.close();
+}
+
+/// Every index packed by its state_snapshot_support, by name
+static std::map< std::string, std::vector< char > > dump_state( database& db )
+{
+   std::map< std::string, std::vector< char > > result;
+   db.with_read_lock( [&]()
+   {
+      db.for_each_index_extension< state_snapshot_support >( [&]( std::shared_ptr< state_snapshot_support > ext )
+      {
+         ext->dump( result[ ext->name() ] );
+      });
+   });
+   return result;
+}
+
+static std::map< std::string, std::vector< char > > reindex( const fc::path& dir, uint32_t threads, double& seconds )
+{
+   database db;
+   auto start = fc::time_point::now();
+   db.reindex( make_args( dir, threads ) );
+   seconds = std::max< int64_t >( ( fc::time_point::now() - start ).count(), 1 ) / 1000000.0;
+
+   if( auto speculator = db.get_contract_speculator() )
+   {
+      auto stats = speculator->get_stats();
+      std::cout << "  " << stats.calls << " calls run ahead, " << stats.committed << " committed, "
+                << stats.reexecuted << " run again\n";
+   }
+   auto state = dump_state( db );
+   db.close();
+   return state;
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      uint32_t blocks = argc > 1 ? std::stoul( argv[1] ) : 200;
+      uint32_t calls = argc > 2 ? std::stoul( argv[2] ) : 200;
+      uint32_t threads = argc > 3 ? std::stoul( argv[3] ) : 4;
+      uint32_t rounds = argc > 4 ? std::stoul( argv[4] ) : 20000;
+      uint32_t conflict_percent = argc > 5 ? std::stoul( argv[5] ) : 10;
+
+      fc::logger::get( DEFAULT_LOGGER ).set_log_level( fc::log_level::error );
+
+      fc::temp_directory dir;
+      build_chain( dir.path(), blocks, calls, rounds, conflict_percent );
+
+      double serial = 0, speculative = 0;
+      auto serial_state = reindex( dir.path(), 0, serial );
+      std::cout << "serial: " << blocks << " blocks in " << serial << " s, " << uint64_t( blocks * calls / serial ) << " calls/s\n";
+      auto speculative_state = reindex( dir.path(), threads, speculative );
+      std::cout << threads << " speculation threads: " << blocks << " blocks in " << speculative << " s, "
+                << uint64_t( blocks * calls / speculative ) << " calls/s\n";
+
+      std::cout << "speedup: " << serial / speculative << "x, state "
+                << ( serial_state == speculative_state ? "identical" : "DIFFERS" ) << "\n";
+      if( serial_state != speculative_state )
+         return 1;
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
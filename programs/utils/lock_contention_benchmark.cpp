@@ -0,0 +1,206 @@
+/*
+ * Mixes reader threads with a writer applying blocks to a chainbase database, once with
+ * global_locking and once with index_locking, and reports how long the readers waited.
+ *
+ * The writer imitates the chain_plugin write thread: it holds the write lock for up to
+ * hold_ms while applying blocks that modify the account index, then sleeps 10ms. Half of
+ * the readers query the account index, the other half an index the writer never touches,
+ * like an API reading plugin state that is not updated by every block.
+ */
+
+#include <chainbase/chainbase.hpp>
+
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chainbase;
+using namespace boost::multi_index;
+
+struct bench_account : public chainbase::object< 0, bench_account >
+{
+   template< typename Constructor, typename Allocator >
+   bench_account( Constructor&& c, Allocator&& a ) { c( *this ); }
+
+   id_type  id;
+   int64_t  balance = 0;
+};
+
+typedef multi_index_container<
+   bench_account,
+   indexed_by<
+      ordered_unique< member< bench_account, bench_account::id_type, &bench_account::id > >,
+      ordered_non_unique< member< bench_account, int64_t, &bench_account::balance > >
+   >,
+   chainbase::allocator< bench_account >
+> bench_account_index;
+
+CHAINBASE_SET_INDEX_TYPE( bench_account, bench_account_index )
+
+struct bench_tag : public chainbase::object< 1, bench_tag >
+{
+   template< typename Constructor, typename Allocator >
+   bench_tag( Constructor&& c, Allocator&& a ) { c( *this ); }
+
+   id_type  id;
+   int64_t  score = 0;
+};
+
+typedef multi_index_container<
+   bench_tag,
+   indexed_by<
+      ordered_unique< member< bench_tag, bench_tag::id_type, &bench_tag::id > >,
+      ordered_non_unique< member< bench_tag, int64_t, &bench_tag::score > >
+   >,
+   chainbase::allocator< bench_tag >
+> bench_tag_index;
+
+CHAINBASE_SET_INDEX_TYPE( bench_tag, bench_tag_index )
+
+typedef std::chrono::steady_clock bench_clock;
+
+static int64_t micros_since( bench_clock::time_point start )
+{
+   return std::chrono::duration_cast< std::chrono::microseconds >( bench_clock::now() - start ).count();
+}
+
+static void report( const std::string& name, std::vector< int64_t >& waits, double seconds )
+{
+   std::sort( waits.begin(), waits.end() );
+   auto pct = [&]( double p ) { return waits.empty() ? 0 : waits[ std::min< size_t >( waits.size() - 1, waits.size() * p ) ]; };
+   std::cout << "   " << name << ": " << uint64_t( waits.size() / seconds ) << " reads/s, wait p50 " << pct( 0.5 )
+             << "us p99 " << pct( 0.99 ) << "us max " << ( waits.empty() ? 0 : waits.back() ) << "us\n";
+}
+
+static void run( database::lock_mode mode, uint32_t objects, uint32_t readers, uint32_t hold_ms, uint32_t seconds )
+{
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   {
+      database db;
+      db.open( temp, 0, 256ull * 1024 * 1024 );
+      db.add_index< bench_account_index >();
+      db.add_index< bench_tag_index >();
+
+      for( uint32_t i = 0; i < objects; ++i )
+      {
+         db.create< bench_account >( [&]( bench_account& a ) { a.balance = i; } );
+         db.create< bench_tag >( [&]( bench_tag& t ) { t.score = i; } );
+      }
+      db.set_revision( 0 );
+      db.set_lock_mode( mode );
+
+      std::atomic< bool > running( true );
+      std::atomic< uint64_t > blocks( 0 );
+
+      std::thread writer( [&]()
+      {
+         std::mt19937 rng( 0 );
+         while( running )
+         {
+            auto start = bench_clock::now();
+            db.with_write_lock( [&]()
+            {
+               while( running && micros_since( start ) < hold_ms * 1000 )
+               {
+                  auto session = db.start_undo_session();
+                  for( uint32_t i = 0; i < 200; ++i )
+                  {
+                     const auto& a = db.get< bench_account >( bench_account::id_type( rng() % objects ) );
+                     db.modify( a, [&]( bench_account& x ) { x.balance += 1; } );
+                  }
+                  session.push();
+                  if( db.revision() > 20 )
+                     db.commit( db.revision() - 20 );
+                  ++blocks;
+               }
+            });
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+         }
+      });
+
+      std::vector< std::vector< int64_t > > waits( readers );
+      std::vector< std::thread > workers;
+      for( uint32_t r = 0; r < readers; ++r )
+      {
+         workers.emplace_back( [&, r]()
+         {
+            std::mt19937 rng( r + 1 );
+            bool accounts = r % 2 == 0;
+            while( running )
+            {
+               auto start = bench_clock::now();
+               int64_t waited = -1;
+               auto query = [&]()
+               {
+                  waited = micros_since( start );
+                  int64_t sum = 0;
+                  if( accounts )
+                  {
+                     const auto& idx = db.get_index< bench_account_index >().indices();
+                     for( auto itr = idx.lower_bound( bench_account::id_type( rng() % objects ) ); itr != idx.end() && sum < 100; ++itr )
+                        sum += 1;
+                  }
+                  else
+                  {
+                     const auto& idx = db.get_index< bench_tag_index >().indices();
+                     for( auto itr = idx.lower_bound( bench_tag::id_type( rng() % objects ) ); itr != idx.end() && sum < 100; ++itr )
+                        sum += 1;
+                  }
+                  return sum;
+               };
+
+               try
+               {
+                  if( accounts )
+                     db.with_index_read_lock< bench_account_index >( [&]() { return query(); }, 0 );
+                  else
+                     db.with_index_read_lock< bench_tag_index >( [&]() { return query(); }, 0 );
+               }
+               catch( const lock_exception& ) {}
+
+               if( waited >= 0 )
+                  waits[ r ].push_back( waited );
+            }
+         });
+      }
+
+      std::this_thread::sleep_for( std::chrono::seconds( seconds ) );
+      running = false;
+      for( auto& w : workers )
+         w.join();
+      writer.join();
+
+      std::vector< int64_t > account_waits, tag_waits;
+      for( uint32_t r = 0; r < readers; ++r )
+      {
+         auto& dest = r % 2 == 0 ? account_waits : tag_waits;
+         dest.insert( dest.end(), waits[ r ].begin(), waits[ r ].end() );
+      }
+
+      std::cout << ( mode == database::global_locking ? "global_locking" : "index_locking" ) << ": "
+                << uint64_t( blocks / double( seconds ) ) << " blocks/s\n";
+      report( "account readers", account_waits, seconds );
+      report( "tag readers", tag_waits, seconds );
+   }
+   boost::filesystem::remove_all( temp );
+}
+
+int main( int argc, char** argv )
+{
+   uint32_t objects = argc > 1 ? std::stoul( argv[1] ) : 100000;
+   uint32_t readers = argc > 2 ? std::stoul( argv[2] ) : 4;
+   uint32_t hold_ms = argc > 3 ? std::stoul( argv[3] ) : 500;
+   uint32_t seconds = argc > 4 ? std::stoul( argv[4] ) : 5;
+
+   run( database::global_locking, objects, readers, hold_ms, seconds );
+   run( database::index_locking, objects, readers, hold_ms, seconds );
+   return 0;
+}
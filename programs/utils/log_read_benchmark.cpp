@@ -0,0 +1,131 @@
+/*
+ * Measures random read_block_by_num throughput of the block log and the contract log
+ * with a growing number of reader threads, on logs generated in a temporary directory.
+ *
+ * Each log is read twice per thread count: once the way the logs were read before they
+ * were memory mapped, through one pair of fstreams behind a mutex, as the baseline, and
+ * once through read_block_by_num.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fc/bitutil.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/time.hpp>
+
+#include <gamebank/chain/block_log.hpp>
+#include <gamebank/chain/contract_log.hpp>
+
+using namespace gamebank::chain;
+
+static void make_entry( uint32_t num, signed_block& b )
+{
+   b.previous._hash[0] = fc::endian_reverse_u32( num - 1 );
+   b.timestamp = fc::time_point_sec( num * 3 );
+   b.transactions.resize( 4 );
+}
+
+static void make_entry( uint32_t num, signed_contract& c )
+{
+   c.block_id._hash[0] = fc::endian_reverse_u32( num );
+   c.previous._hash[0] = fc::endian_reverse_u32( num - 1 );
+   c.transactions.resize( 4 );
+}
+
+/// The read path the logs had before they were mapped: seek the index stream, then unpack from the log stream
+template< typename Entry >
+class fstream_log_reader
+{
+   public:
+      explicit fstream_log_reader( const fc::path& file ) :
+         _log_stream( file.generic_string().c_str(), std::ios::in | std::ios::binary ),
+         _index_stream( ( file.generic_string() + ".index" ).c_str(), std::ios::in | std::ios::binary )
+      {}
+
+      fc::optional< Entry > read_block_by_num( uint32_t block_num )
+      {
+         std::lock_guard< std::mutex > lock( _mutex );
+         uint64_t pos;
+         _index_stream.seekg( sizeof( uint64_t ) * ( block_num - 1 ) );
+         _index_stream.read( (char*)&pos, sizeof( pos ) );
+
+         fc::optional< Entry > result = Entry();
+         _log_stream.seekg( pos );
+         fc::raw::unpack( _log_stream, *result );
+         return result;
+      }
+
+   private:
+      std::mutex     _mutex;
+      std::fstream   _log_stream;
+      std::fstream   _index_stream;
+};
+
+template< typename Reader >
+static double read_random( Reader& reader, uint32_t blocks, uint32_t reads, uint32_t threads )
+{
+   std::vector< std::thread > workers;
+   auto start = fc::time_point::now();
+   for( uint32_t t = 0; t < threads; ++t )
+   {
+      workers.emplace_back( [&reader, blocks, reads, threads, t]()
+      {
+         std::mt19937 rng( t );
+         std::uniform_int_distribution< uint32_t > dist( 1, blocks );
+         for( uint32_t i = 0; i < reads / threads; ++i )
+            FC_ASSERT( reader.read_block_by_num( dist( rng ) ).valid() );
+      } );
+   }
+   for( auto& w : workers )
+      w.join();
+
+   double seconds = std::max< int64_t >( ( fc::time_point::now() - start ).count(), 1 ) / 1000000.0;
+   return reads / threads * threads / seconds;
+}
+
+template< typename Log, typename Entry >
+static void run( const char* name, const fc::path& file, uint32_t blocks, uint32_t reads, uint32_t max_threads )
+{
+   Log log;
+   log.open( file );
+
+   Entry entry;
+   auto start = fc::time_point::now();
+   for( uint32_t i = 1; i <= blocks; ++i )
+   {
+      make_entry( i, entry );
+      log.append( entry );
+   }
+   log.flush();
+   std::cout << name << " append: " << blocks << " entries in " << ( fc::time_point::now() - start ).count() / 1000 << " ms\n";
+
+   fstream_log_reader< Entry > baseline( file );
+   for( uint32_t threads = 1; threads <= max_threads; threads *= 2 )
+   {
+      uint64_t fstream_reads = read_random( baseline, blocks, reads, threads );
+      uint64_t mapped_reads = read_random( log, blocks, reads, threads );
+      std::cout << name << " " << threads << " threads: fstream " << fstream_reads << " reads/s, mapped "
+                << mapped_reads << " reads/s, " << double( mapped_reads ) / fstream_reads << "x\n";
+   }
+
+   log.close();
+}
+
+int main( int argc, char** argv )
+{
+   uint32_t blocks = argc > 1 ? std::stoul( argv[1] ) : 100000;
+   uint32_t reads = argc > 2 ? std::stoul( argv[2] ) : 200000;
+   uint32_t max_threads = argc > 3 ? std::stoul( argv[3] ) : std::max( 1u, std::thread::hardware_concurrency() );
+
+   fc::temp_directory dir;
+   run< block_log, signed_block >( "block_log", dir.path() / "block_log", blocks, reads, max_threads );
+   run< contract_log, signed_contract >( "contract_log", dir.path() / "contract_log", blocks, reads, max_threads );
+   return 0;
+}
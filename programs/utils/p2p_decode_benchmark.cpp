@@ -0,0 +1,193 @@
+/*
+ * Sends signed blocks over local encrypted p2p connections from many peers at once and
+ * reports how many blocks per second one receiving thread handles, first decrypting and
+ * recovering signature keys on that thread like before, then with a message_decode_pool.
+ *
+ * The receiver does what the node and p2p_plugin do before a block reaches the chain: it
+ * decrypts the message, recovers the signature keys of its transactions (prepare_message)
+ * and unpacks it on the receiving thread. Every peer sends its blocks back to back.
+ *
+ * Usage: p2p_decode_benchmark [peers] [blocks per peer] [transactions per block] [decode threads]
+ */
+
+#include <gamebank/protocol/config.hpp>
+#include <gamebank/protocol/block.hpp>
+#include <gamebank/protocol/gamebank_operations.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message_decode_pool.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace gamebank::protocol;
+using namespace graphene::net;
+
+typedef std::chrono::steady_clock bench_clock;
+
+static void prepare( const message& m )
+{
+   auto b = m.as< block_message >().block;
+   for( const auto& trx : b.transactions )
+      trx.get_signature_keys( GAMEBANK_CHAIN_ID );
+}
+
+struct receiver : public message_oriented_connection_delegate
+{
+   std::unique_ptr< message_decode_pool >  pool;
+   std::atomic< uint64_t >                 received{ 0 };
+   std::atomic< uint64_t >                 transactions{ 0 };
+
+   virtual void on_message( message_oriented_connection*, const message& m ) override
+   {
+      if( !pool )
+         prepare( m );
+      transactions += m.as< block_message >().block.transactions.size();
+      ++received;
+   }
+
+   virtual void on_connection_closed( message_oriented_connection* ) override {}
+
+   virtual message_decode_pool* get_message_decode_pool( const message_header& ) override
+   {
+      return pool.get();
+   }
+};
+
+struct sender : public message_oriented_connection_delegate
+{
+   virtual void on_message( message_oriented_connection*, const message& ) override {}
+   virtual void on_connection_closed( message_oriented_connection* ) override {}
+};
+
+static signed_block make_block( uint32_t num, uint32_t transactions, const fc::ecc::private_key& key )
+{
+   signed_block b;
+   b.timestamp = GAMEBANK_GENESIS_TIME + num * GAMEBANK_BLOCK_INTERVAL;
+   b.witness = "initminer";
+
+   for( uint32_t t = 0; t < transactions; ++t )
+   {
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob";
+      op.amount = asset( 1 + t, GBC_SYMBOL );
+      op.memo = "transfer " + std::to_string( t );
+
+      signed_transaction tx;
+      tx.ref_block_num = num & 0xffff;
+      tx.expiration = b.timestamp + GAMEBANK_MAX_TIME_UNTIL_EXPIRATION / 2;
+      tx.operations.push_back( op );
+      tx.sign( key, GAMEBANK_CHAIN_ID );
+      b.transactions.push_back( tx );
+   }
+
+   b.transaction_merkle_root = b.calculate_merkle_root();
+   b.sign( key );
+   return b;
+}
+
+static void run( uint32_t peers, uint32_t blocks_per_peer, const std::vector< message >& blocks, uint32_t decode_threads )
+{
+   fc::thread receive_thread( "p2p" );
+   fc::thread send_thread( "senders" );
+   receiver r;
+   sender s;
+   if( decode_threads )
+      r.pool.reset( new message_decode_pool( decode_threads, &prepare ) );
+
+   fc::tcp_server server;
+   std::vector< std::shared_ptr< message_oriented_connection > > incoming, outgoing;
+   std::vector< fc::future< void > > accepts;
+
+   auto endpoint = receive_thread.async( [&]()
+   {
+      server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+      return server.get_local_endpoint();
+   }).wait();
+
+   auto accept_loop = receive_thread.async( [&]()
+   {
+      for( uint32_t i = 0; i < peers; ++i )
+      {
+         auto c = std::make_shared< message_oriented_connection >( &r );
+         server.accept( c->get_socket() );
+         incoming.push_back( c );
+         accepts.push_back( fc::async( [c]() { c->accept(); } ) );
+      }
+   });
+
+   send_thread.async( [&]()
+   {
+      for( uint32_t i = 0; i < peers; ++i )
+      {
+         auto c = std::make_shared< message_oriented_connection >( &s );
+         c->connect_to( endpoint );
+         outgoing.push_back( c );
+      }
+   }).wait();
+   accept_loop.wait();
+   receive_thread.async( [&]() { for( auto& a : accepts ) a.wait(); } ).wait();
+
+   auto start = bench_clock::now();
+   send_thread.async( [&]()
+   {
+      std::vector< fc::future< void > > sends;
+      for( auto& c : outgoing )
+      {
+         sends.push_back( fc::async( [&, c]()
+         {
+            for( uint32_t i = 0; i < blocks_per_peer; ++i )
+               c->send_message( blocks[ i % blocks.size() ] );
+         }));
+      }
+      for( auto& f : sends )
+         f.wait();
+   }).wait();
+
+   uint64_t total = uint64_t( peers ) * blocks_per_peer;
+   while( r.received < total )
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+   double seconds = std::chrono::duration_cast< std::chrono::microseconds >( bench_clock::now() - start ).count() / 1e6;
+
+   send_thread.async( [&]() { for( auto& c : outgoing ) c->destroy_connection( "benchmark done" ); outgoing.clear(); } ).wait();
+   receive_thread.async( [&]() { for( auto& c : incoming ) c->destroy_connection( "benchmark done" ); incoming.clear(); server.close(); } ).wait();
+
+   std::cout << "   " << decode_threads << " decode threads: " << uint64_t( total / seconds ) << " blocks/s, "
+             << uint64_t( r.transactions / seconds ) << " transactions/s\n";
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      uint32_t peers = argc > 1 ? std::stoul( argv[1] ) : 50;
+      uint32_t blocks_per_peer = argc > 2 ? std::stoul( argv[2] ) : 20;
+      uint32_t transactions = argc > 3 ? std::stoul( argv[3] ) : 100;
+      uint32_t decode_threads = argc > 4 ? std::stoul( argv[4] ) : 4;
+
+      auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "init_key" ) ) );
+      std::vector< message > blocks;
+      for( uint32_t num = 1; num <= 10; ++num )
+         blocks.push_back( block_message( make_block( num, transactions, key ) ) );
+
+      std::cout << peers << " peers sending " << blocks_per_peer << " blocks of " << transactions << " transactions each\n";
+      run( peers, blocks_per_peer, blocks, 0 );
+      run( peers, blocks_per_peer, blocks, decode_threads );
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * Starts several local nodes that have the same chain of blocks and one empty node that
+ * connects to all of them, then reports the wall clock time until the empty node has synced
+ * every block. Runs once syncing from a single peer and once from all of them.
+ *
+ * Every node runs a graphene::net::node on localhost with an in memory chain as its delegate.
+ * The chain only checks that a block links to its head, so the time measured is the time the
+ * network code takes to fetch the blocks and hand them over in order.
+ *
+ * Usage: p2p_sync_benchmark [blocks] [peers] [transactions per block]
+ */
+
+#include <gamebank/protocol/config.hpp>
+#include <gamebank/protocol/block.hpp>
+#include <gamebank/protocol/gamebank_operations.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/node.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/range/adaptor/reversed.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace gamebank::protocol;
+using namespace graphene::net;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/// A chain without forks, the p2p_plugin does the same against the database
+struct memory_chain : public node_delegate
+{
+   std::vector< signed_block >   blocks;
+   std::vector< block_id_type >  ids;
+
+   uint32_t head_num()const { return ids.size(); }
+
+   bool is_known( const item_hash_t& id )const
+   {
+      uint32_t num = block_header::num_from_id( id );
+      return num > 0 && num <= ids.size() && ids[ num - 1 ] == id;
+   }
+
+   void push( const signed_block& b )
+   {
+      FC_ASSERT( b.previous == get_head_block_id(), "Block does not link to the head block" );
+      blocks.push_back( b );
+      ids.push_back( b.id() );
+   }
+
+   virtual chain_id_type get_chain_id()const override { return GAMEBANK_CHAIN_ID; }
+
+   virtual bool has_item( const item_id& id ) override
+   {
+      return id.item_type == block_message_type && is_known( id.item_hash );
+   }
+
+   virtual bool handle_confirm( const confirm_message& ) override { return false; }
+
+   virtual bool handle_block( const block_message& blk_msg, bool, std::vector< fc::uint160_t >& ) override
+   {
+      if( !is_known( blk_msg.block_id ) )
+         push( blk_msg.block );
+      return false;
+   }
+
+   virtual void handle_transaction( const trx_message& ) override {}
+
+   virtual void handle_message( const message& ) override
+   {
+      FC_THROW( "Invalid Message Type" );
+   }
+
+   virtual std::vector< item_hash_t > get_block_ids( const std::vector< item_hash_t >& blockchain_synopsis,
+                                                     uint32_t& remaining_item_count, uint32_t limit ) override
+   {
+      std::vector< item_hash_t > result;
+      remaining_item_count = 0;
+
+      block_id_type last_known_block_id;
+      for( const item_hash_t& id : boost::adaptors::reverse( blockchain_synopsis ) )
+      {
+         if( id == block_id_type() || is_known( id ) )
+         {
+            last_known_block_id = id;
+            break;
+         }
+      }
+
+      for( uint32_t num = block_header::num_from_id( last_known_block_id ); num <= head_num() && result.size() < limit; ++num )
+         if( num > 0 )
+            result.push_back( ids[ num - 1 ] );
+
+      if( !result.empty() && block_header::num_from_id( result.back() ) < head_num() )
+         remaining_item_count = head_num() - block_header::num_from_id( result.back() );
+      return result;
+   }
+
+   virtual message get_item( const item_id& id ) override
+   {
+      FC_ASSERT( id.item_type == block_message_type && is_known( id.item_hash ) );
+      return block_message( blocks[ block_header::num_from_id( id.item_hash ) - 1 ] );
+   }
+
+   virtual std::vector< item_hash_t > get_blockchain_synopsis( const item_hash_t& reference_point,
+                                                               uint32_t number_of_blocks_after_reference_point ) override
+   {
+      std::vector< item_hash_t > synopsis;
+      uint32_t high_block_num = reference_point == item_hash_t() ? head_num()
+                                                                 : std::min( block_header::num_from_id( reference_point ), head_num() );
+      if( high_block_num == 0 )
+         return synopsis;
+
+      uint32_t low_block_num = 1;
+      uint32_t true_high_block_num = high_block_num + number_of_blocks_after_reference_point;
+      do
+      {
+         synopsis.push_back( ids[ low_block_num - 1 ] );
+         low_block_num += ( true_high_block_num - low_block_num + 2 ) / 2;
+      }
+      while( low_block_num <= high_block_num );
+      return synopsis;
+   }
+
+   virtual void sync_status( uint32_t, uint32_t ) override {}
+   virtual void connection_count_changed( uint32_t ) override {}
+
+   virtual uint32_t get_block_number( const item_hash_t& block_id ) override
+   {
+      return block_header::num_from_id( block_id );
+   }
+
+   virtual fc::time_point_sec get_block_time( const item_hash_t& block_id ) override
+   {
+      if( block_id == item_hash_t() )
+         return GAMEBANK_GENESIS_TIME;
+      if( !is_known( block_id ) )
+         return fc::time_point_sec::min();
+      return blocks[ block_header::num_from_id( block_id ) - 1 ].timestamp;
+   }
+
+   virtual fc::time_point_sec get_blockchain_now() override { return fc::time_point::now(); }
+
+   virtual item_hash_t get_head_block_id()const override
+   {
+      return ids.empty() ? block_id_type() : ids.back();
+   }
+
+   virtual uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t )const override { return 0; }
+
+   virtual void error_encountered( const std::string&, const fc::oexception& ) override {}
+};
+
+struct local_node
+{
+   memory_chain                    chain;
+   std::shared_ptr< node >         p2p;
+
+   local_node( const fc::path& data_dir )
+   {
+      p2p = std::make_shared< node >( "p2p_sync_benchmark" );
+      p2p->load_configuration( data_dir );
+      p2p->set_node_delegate( &chain );
+      p2p->listen_on_endpoint( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ), false );
+      p2p->listen_to_p2p_network();
+      p2p->connect_to_p2p_network();
+   }
+
+   ~local_node()
+   {
+      p2p->close();
+   }
+
+   void sync()
+   {
+      p2p->sync_from( item_id( block_message_type, chain.get_head_block_id() ), std::vector< uint32_t >() );
+   }
+};
+
+static std::vector< signed_block > make_chain( uint32_t count, uint32_t transactions )
+{
+   auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "init_key" ) ) );
+
+   // signing is not what is measured, every block carries copies of the same transactions
+   std::vector< signed_transaction > trxs;
+   for( uint32_t t = 0; t < transactions; ++t )
+   {
+      transfer_operation op;
+      op.from = "alice";
+      op.to = "bob";
+      op.amount = asset( 1 + t, GBC_SYMBOL );
+      op.memo = "transfer " + std::to_string( t );
+
+      signed_transaction tx;
+      tx.expiration = fc::time_point_sec( fc::time_point::now() ) + GAMEBANK_MAX_TIME_UNTIL_EXPIRATION / 2;
+      tx.operations.push_back( op );
+      tx.sign( key, GAMEBANK_CHAIN_ID );
+      trxs.push_back( tx );
+   }
+
+   // the last block is the current one, peers won't offer blocks from the future
+   fc::time_point_sec first_time = fc::time_point_sec( fc::time_point::now() ) - count * GAMEBANK_BLOCK_INTERVAL;
+   std::vector< signed_block > result;
+   block_id_type previous;
+   for( uint32_t num = 1; num <= count; ++num )
+   {
+      signed_block b;
+      b.previous = previous;
+      b.timestamp = first_time + num * GAMEBANK_BLOCK_INTERVAL;
+      b.witness = "initminer";
+      b.transactions = trxs;
+      b.transaction_merkle_root = b.calculate_merkle_root();
+      b.sign( key );
+      previous = b.id();
+      result.push_back( std::move( b ) );
+   }
+   return result;
+}
+
+static void run( const std::vector< signed_block >& blocks, uint32_t peers )
+{
+   fc::temp_directory data_dir;
+   std::vector< std::unique_ptr< local_node > > seeds;
+   for( uint32_t i = 0; i < peers; ++i )
+   {
+      seeds.emplace_back( new local_node( data_dir.path() / ( "seed" + std::to_string( i ) ) ) );
+      for( const auto& b : blocks )
+         seeds.back()->chain.push( b );
+      seeds.back()->sync();
+   }
+
+   local_node syncing( data_dir.path() / "syncing" );
+   auto start = bench_clock::now();
+   syncing.sync();
+   for( const auto& seed : seeds )
+      syncing.p2p->connect_to_endpoint( seed->p2p->get_actual_listening_endpoint() );
+
+   // delegate calls run on this thread, so wait by yielding to them
+   while( syncing.chain.head_num() < blocks.size() )
+   {
+      fc::usleep( fc::milliseconds( 1 ) );
+      FC_ASSERT( bench_clock::now() - start < std::chrono::minutes( 10 ), "Sync did not finish, stopped at block ${n}",
+                 ("n", syncing.chain.head_num()) );
+   }
+   double seconds = std::chrono::duration_cast< std::chrono::microseconds >( bench_clock::now() - start ).count() / 1e6;
+
+   FC_ASSERT( syncing.chain.get_head_block_id() == blocks.back().id() );
+   std::cout << "   " << peers << ( peers == 1 ? " peer:  " : " peers: " ) << seconds << " s, "
+             << uint64_t( blocks.size() / seconds ) << " blocks/s\n";
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      uint32_t block_count = argc > 1 ? std::stoul( argv[1] ) : 20000;
+      uint32_t peers = argc > 2 ? std::stoul( argv[2] ) : 4;
+      uint32_t transactions = argc > 3 ? std::stoul( argv[3] ) : 10;
+
+      auto blocks = make_chain( block_count, transactions );
+      std::cout << "syncing " << block_count << " blocks of " << transactions << " transactions each\n";
+      run( blocks, 1 );
+      if( peers > 1 )
+         run( blocks, peers );
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
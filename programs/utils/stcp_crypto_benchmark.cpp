@@ -0,0 +1,206 @@
+/*
+ * Checks that stcp_socket::write_encrypted and read_decrypted are wire compatible with
+ * sending and receiving through write() and read(), then reports the throughput of both
+ * paths over a local connection at several message sizes.
+ *
+ * Messages are framed like message_oriented_connection does: an 8 byte message_header, the
+ * data and zero padding to a multiple of 16. The old path copies each message into a padded
+ * buffer and sends it with write(), which stcp_socket encrypts in 4k chunks, the receiver
+ * decrypts through readsome() in 4k chunks. MB/s per core divides the bytes sent by the CPU
+ * time used by the whole process, sender and receiver together.
+ *
+ * Usage: stcp_crypto_benchmark [MB per message size]
+ */
+
+#include <graphene/net/message.hpp>
+#include <graphene/net/stcp_socket.hpp>
+
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace graphene::net;
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct socket_pair
+{
+   fc::thread        writer_thread{ "writer" };
+   fc::thread        reader_thread{ "reader" };
+   stcp_socket       writer;
+   stcp_socket       reader;
+   fc::tcp_server    server;
+
+   socket_pair()
+   {
+      auto endpoint = reader_thread.async( [&]()
+      {
+         server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+         return server.get_local_endpoint();
+      }).wait();
+      auto accepted = reader_thread.async( [&]()
+      {
+         server.accept( reader.get_socket() );
+         reader.accept();
+      });
+      writer_thread.async( [&]() { writer.connect_to( endpoint ); } ).wait();
+      accepted.wait();
+   }
+
+   ~socket_pair()
+   {
+      writer_thread.async( [&]() { writer.close(); } ).wait();
+      reader_thread.async( [&]() { reader.close(); server.close(); } ).wait();
+   }
+};
+
+static size_t padded( size_t size )
+{
+   return 16 * ( ( sizeof( message_header ) + size + 15 ) / 16 );
+}
+
+static void send( stcp_socket& sock, const message& m, bool batched )
+{
+   if( batched )
+   {
+      sock.write_encrypted( { stcp_socket::buffer_piece( (const char*)&m, sizeof( message_header ) ),
+                              stcp_socket::buffer_piece( m.data.data(), m.size ) } );
+   }
+   else
+   {
+      size_t size = padded( m.size );
+      std::unique_ptr< char[] > buffer( new char[ size ] );
+      memset( buffer.get(), 0, size );
+      memcpy( buffer.get(), (const char*)&m, sizeof( message_header ) );
+      memcpy( buffer.get() + sizeof( message_header ), m.data.data(), m.size );
+      sock.write( buffer.get(), size );
+   }
+   sock.flush();
+}
+
+/// Returns the padded bytes following the header, checks the header against expected
+static std::vector< char > receive( stcp_socket& sock, const message& expected, bool batched )
+{
+   size_t size = padded( expected.size );
+   std::shared_ptr< char > buffer( new char[ size ], []( char* p ) { delete[] p; } );
+   sock.read( buffer.get(), 16 );
+   if( batched && size > 16 )
+      sock.read_decrypted( buffer, size - 16, 16 );
+   else if( size > 16 )
+      sock.read( buffer.get() + 16, size - 16 );
+
+   message_header header;
+   memcpy( (char*)&header, buffer.get(), sizeof( header ) );
+   FC_ASSERT( header.size == expected.size && header.msg_type == expected.msg_type, "Header mismatch" );
+   return std::vector< char >( buffer.get() + sizeof( message_header ), buffer.get() + size );
+}
+
+static message make_message( size_t size, std::mt19937& rng )
+{
+   message m;
+   m.msg_type = 1001;
+   m.size = size;
+   m.data.resize( size );
+   for( auto& c : m.data )
+      c = char( rng() );
+   return m;
+}
+
+static bool check_compatibility()
+{
+   socket_pair sockets;
+   std::mt19937 rng( 0 );
+   std::vector< size_t > sizes = { 0, 1, 7, 8, 9, 15, 16, 17, 24, 25, 100, 4087, 4088, 4089, 4096, 65539, 1024 * 1024 + 5 };
+
+   std::vector< message > messages;
+   for( size_t size : sizes )
+      for( int mode = 0; mode < 4; ++mode )
+         messages.push_back( make_message( size, rng ) );
+
+   // every combination of old and new writer and reader, all on one stream
+   auto writes = sockets.writer_thread.async( [&]()
+   {
+      for( size_t i = 0; i < messages.size(); ++i )
+         send( sockets.writer, messages[i], i % 2 );
+   });
+
+   bool ok = true;
+   sockets.reader_thread.async( [&]()
+   {
+      for( size_t i = 0; i < messages.size(); ++i )
+      {
+         auto body = receive( sockets.reader, messages[i], ( i / 2 ) % 2 );
+         std::vector< char > expected( messages[i].data );
+         expected.resize( body.size(), 0 );
+         if( body != expected )
+         {
+            std::cerr << "mismatch for a " << messages[i].size << " byte message, writer "
+                      << ( i % 2 ? "batched" : "chunked" ) << ", reader " << ( ( i / 2 ) % 2 ? "batched" : "chunked" ) << "\n";
+            ok = false;
+         }
+      }
+   }).wait();
+   writes.wait();
+   return ok;
+}
+
+static void measure( size_t size, uint64_t total_bytes, bool batched )
+{
+   socket_pair sockets;
+   std::mt19937 rng( 1 );
+   message m = make_message( size, rng );
+   uint64_t count = std::max< uint64_t >( 1, total_bytes / padded( size ) );
+
+   auto cpu_start = std::clock();
+   auto start = bench_clock::now();
+   auto writes = sockets.writer_thread.async( [&]()
+   {
+      for( uint64_t i = 0; i < count; ++i )
+         send( sockets.writer, m, batched );
+   });
+   sockets.reader_thread.async( [&]()
+   {
+      for( uint64_t i = 0; i < count; ++i )
+         receive( sockets.reader, m, batched );
+   }).wait();
+   writes.wait();
+
+   double seconds = std::chrono::duration_cast< std::chrono::microseconds >( bench_clock::now() - start ).count() / 1e6;
+   double cpu_seconds = double( std::clock() - cpu_start ) / CLOCKS_PER_SEC;
+   double mb = double( count * padded( size ) ) / ( 1024 * 1024 );
+   std::cout << "   " << ( batched ? "batched" : "chunked" ) << ": " << uint64_t( mb / seconds ) << " MB/s, "
+             << uint64_t( mb / cpu_seconds ) << " MB/s per core\n";
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      uint64_t mb_per_size = argc > 1 ? std::stoull( argv[1] ) : 256;
+
+      if( !check_compatibility() )
+         return 1;
+      std::cout << "wire compatible with write() and read()\n";
+
+      for( size_t size : { 256, 4096, 64 * 1024, 1024 * 1024 } )
+      {
+         std::cout << size << " byte messages\n";
+         measure( size, mb_per_size * 1024 * 1024, false );
+         measure( size, mb_per_size * 1024 * 1024, true );
+      }
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
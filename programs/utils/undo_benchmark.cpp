@@ -0,0 +1,115 @@
+/*
+ * Applies blocks to a chainbase database the way the chain does during normal operation and
+ * reports how long the undo bookkeeping takes and how much shared memory the undo history uses.
+ *
+ * Every block is an undo session holding transactions, each one its own session modifying
+ * random objects and squashed into the block. The block session itself then modifies more
+ * objects directly, like the per-block processing that runs outside transactions. The last
+ * history blocks are kept as undo history, older ones are committed, and at the end all of
+ * them are undone as a fork switch would.
+ */
+
+#include <chainbase/chainbase.hpp>
+
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace chainbase;
+using namespace boost::multi_index;
+
+struct bench_object : public chainbase::object< 0, bench_object >
+{
+   template< typename Constructor, typename Allocator >
+   bench_object( Constructor&& c, Allocator&& a ) { c( *this ); }
+
+   id_type                    id;
+   int64_t                    balance = 0;
+   std::array< int64_t, 6 >   payload = {};
+};
+
+typedef multi_index_container<
+   bench_object,
+   indexed_by<
+      ordered_unique< member< bench_object, bench_object::id_type, &bench_object::id > >,
+      ordered_non_unique< member< bench_object, int64_t, &bench_object::balance > >
+   >,
+   chainbase::allocator< bench_object >
+> bench_object_index;
+
+CHAINBASE_SET_INDEX_TYPE( bench_object, bench_object_index )
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double seconds_since( bench_clock::time_point start )
+{
+   return std::chrono::duration< double >( bench_clock::now() - start ).count();
+}
+
+int main( int argc, char** argv )
+{
+   uint32_t objects = argc > 1 ? std::stoul( argv[1] ) : 200000;
+   uint32_t blocks = argc > 2 ? std::stoul( argv[2] ) : 400;
+   uint32_t transactions = argc > 3 ? std::stoul( argv[3] ) : 50;
+   uint32_t modifications = argc > 4 ? std::stoul( argv[4] ) : 20;
+   uint32_t block_modifications = argc > 5 ? std::stoul( argv[5] ) : 5000;
+   uint32_t history = argc > 6 ? std::stoul( argv[6] ) : 21;
+
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   {
+      database db;
+      db.open( temp, 0, 1024ull * 1024 * 1024 );
+      db.add_index< bench_object_index >();
+
+      for( uint32_t i = 0; i < objects; ++i )
+         db.create< bench_object >( [&]( bench_object& o ) { o.balance = i; } );
+      db.set_revision( 0 );
+      size_t free_before = db.get_free_memory();
+      size_t most_used = 0;
+
+      std::mt19937 rng( 0 );
+      auto modify_random = [&]()
+      {
+         const auto& o = db.get< bench_object >( bench_object::id_type( rng() % objects ) );
+         db.modify( o, [&]( bench_object& x ) { x.balance += 1; x.payload[0] += 1; } );
+      };
+
+      auto start = bench_clock::now();
+      for( uint32_t b = 0; b < blocks; ++b )
+      {
+         auto block = db.start_undo_session();
+         for( uint32_t t = 0; t < transactions; ++t )
+         {
+            auto trx = db.start_undo_session();
+            for( uint32_t m = 0; m < modifications; ++m )
+               modify_random();
+            trx.squash();
+         }
+         for( uint32_t m = 0; m < block_modifications; ++m )
+            modify_random();
+         block.push();
+
+         if( db.revision() > int64_t( history ) )
+            db.commit( db.revision() - history );
+         most_used = std::max( most_used, free_before - db.get_free_memory() );
+      }
+      double apply_seconds = seconds_since( start );
+
+      start = bench_clock::now();
+      db.undo_all();
+      double undo_seconds = seconds_since( start );
+
+      std::cout << blocks << " blocks of " << transactions << "x" << modifications << " squashed + " << block_modifications
+                << " block modifications on " << objects << " objects\n";
+      std::cout << "   apply: " << apply_seconds << " s, " << uint64_t( blocks / apply_seconds ) << " blocks/s\n";
+      std::cout << "   undo " << history << " blocks: " << undo_seconds << " s\n";
+      std::cout << "   peak undo memory: " << most_used / 1024 << " KB\n";
+   }
+   boost::filesystem::remove_all( temp );
+   return 0;
+}